@@ -4,15 +4,16 @@ use diagnostics;
 use LWP::Simple;
 use File::Temp qw/tempdir/;
 use File::Slurp qw/read_file/;
-use File::Basename qw/basename/;
+use File::Basename qw/basename dirname/;
 use File::Spec;
-use File::Copy qw/move/;
+use File::Copy qw/move copy/;
 use File::Copy::Recursive qw/dircopy/;
 use File::Remove qw/remove/;
 use File::Find qw/find/;
 use File::stat qw/stat lstat/;
 use File::chmod qw/chmod/;
 use File::HomeDir qw/my_home/;
+use File::Path qw//;
 use Data::Dumper;
 use Getopt::Long;
 use Log::Log4perl qw/:easy/;
@@ -24,7 +25,7 @@ use Archive::Tar;
 use Archive::Tar::Constant qw/FILE/;
 use Cwd qw/getcwd abs_path/;
 use IPC::Run qw/run/;
-use POSIX qw/EXIT_SUCCESS EXIT_FAILURE/;
+use POSIX qw/EXIT_SUCCESS EXIT_FAILURE lgamma/;
 
 # ---------
 # Constants
@@ -52,6 +53,15 @@ my %opts = (
     logLevel        => 'INFO',
     cleanup         => 1,
     debian          => 1,
+    cache           => File::Spec->catdir(File::HomeDir->my_home, '.cache', 'libmarpa-packaging'),
+    benchmark       => 0,
+    benchmarkRuns   => 10,
+    benchmarkRepetitions => 3,
+    benchmarkThreshold   => 5,
+    benchmarkAlpha       => 0.01,
+    pgo             => 1,
+    hwcaps          => 1,
+    prof            => 1,
 );
 my %cmdOpts = (
     'version=i'         => sub { $opts{libMarpaVersion} = $_[1] },
@@ -59,6 +69,15 @@ my %cmdOpts = (
     'repository=s'      => sub { $opts{repository} = $_[1] },
     'debian!'           => sub { $opts{debian} = $_[1] },
     'cleanup!'          => sub { $opts{cleanup} = $_[1] },
+    'cache=s'           => sub { $opts{cache} = $_[1] },
+    'benchmark!'        => sub { $opts{benchmark} = $_[1] },
+    'benchmarkRuns=i'   => sub { $opts{benchmarkRuns} = $_[1] },
+    'benchmarkRepetitions=i' => sub { $opts{benchmarkRepetitions} = $_[1] },
+    'benchmarkThreshold=f'   => sub { $opts{benchmarkThreshold} = $_[1] },
+    'benchmarkAlpha=f'       => sub { $opts{benchmarkAlpha} = $_[1] },
+    'pgo!'              => sub { $opts{pgo} = $_[1] },
+    'hwcaps!'           => sub { $opts{hwcaps} = $_[1] },
+    'prof!'             => sub { $opts{prof} = $_[1] },
     'help!'             => sub { help(\%opts) },
     'verbose!'          => sub { $opts{logLevel} = $_[1] ? 'DEBUG' : 'WARN' },
     );
@@ -90,10 +109,19 @@ if (! $opts{libMarpaVersion}) {
 
 $log->infof('Options in use: %s', \%opts);
 
+# ----------------------------------------------------------------
+# Performance regression matrix: a regression blocks the packaging
+# ----------------------------------------------------------------
+if ($opts{benchmark}) {
+    if (! benchmarkVersions(\%map, \%opts)) {
+	die "Performance regression of libmarpa $opts{libMarpaVersion}, packaging aborted\n";
+    }
+}
+
 # ------------
 # Load tarball
 # ------------
-my $tarball = getCPANTarball($opts{libMarpaVersion}, \%map, $TMP_DIRNAME);
+my $tarball = getCPANTarball($opts{libMarpaVersion}, \%map, $TMP_DIRNAME, $opts{cache});
 
 # ---------------
 # Extract tarball
@@ -178,6 +206,51 @@ where options are all optional and can be:
   --repository                  Reprepro managed debian repository.
                                 Default value: $optsp->{repository}
 
+  --cache=directory             Local cache of CPAN tarballs. Tarballs are
+                                downloaded only when not in the cache.
+                                Default value: $optsp->{cache}
+
+  --[no]benchmark               Build every libmarpa version of mapFilename,
+                                run examples/benchmark against each of them,
+                                and compare them side by side. A statistically
+                                significant slowdown of libMarpaVersion versus
+                                the previous version, on the total time of a
+                                workload, aborts the packaging, and exits with
+                                a failure status even with --nodebian. Phase
+                                times and the process peak RSS are for
+                                information only.
+                                Default value: $optsp->{benchmark}
+
+  --benchmarkRuns=n             Number of benchmark runs, i.e. samples, per version.
+                                Default value: $optsp->{benchmarkRuns}
+
+  --benchmarkRepetitions=n      Repetitions inside a benchmark run.
+                                Default value: $optsp->{benchmarkRepetitions}
+
+  --benchmarkThreshold=percent  Minimum slowdown considered a regression.
+                                Default value: $optsp->{benchmarkThreshold}
+
+  --benchmarkAlpha=p            Family-wise significance level of Welch's t-tests
+                                on total times, Holm-corrected across workloads.
+                                Default value: $optsp->{benchmarkAlpha}
+
+  --[no]pgo                     Add the libmarpa-pgo package: libmarpa built with
+                                a profile of examples/benchmark, and with
+                                link-time optimization, installed side by side
+                                with libmarpa.
+                                Default value: $optsp->{pgo}
+
+  --[no]hwcaps                  On amd64, add to the libmarpa package builds for
+                                x86-64-v2, x86-64-v3 and x86-64-v4, in
+                                glibc-hwcaps subdirectories: the dynamic loader
+                                picks the best one for the host.
+                                Default value: $optsp->{hwcaps}
+
+  --[no]prof                    Add the libmarpa-prof package: libmarpa with
+                                frame pointers, debug information and USDT
+                                probes, installed side by side with libmarpa.
+                                Default value: $optsp->{prof}
+
   --[no]help                    This help.
 
 Version  : $VERSION
@@ -193,7 +266,7 @@ HELP
 # Get CPAN Tarball
 # #############################################################################
 sub getCPANTarball {
-    my ($libMarpaVersion, $mapp, $tmpdir) = @_;
+    my ($libMarpaVersion, $mapp, $tmpdir, $cachedir) = @_;
 
     my $uri = URI->new($mapp->{$libMarpaVersion});
 
@@ -203,9 +276,23 @@ sub getCPANTarball {
     my $base = basename($path);
     my $dst = File::Spec->catdir($tmpdir, $base);
 
-    $log->debugf('Saving %s to %s', "$uri", "$dst");
+    my $cached = $cachedir ? File::Spec->catfile($cachedir, $base) : undef;
+    if ($cached && -s $cached) {
+	$log->debugf('Copying cached %s to %s', $cached, $dst);
+	copy($cached, $dst) || die "Cannot copy $cached to $dst, $!";
+    } else {
+	$log->debugf('Saving %s to %s', "$uri", "$dst");
+
+	getstore($uri, $dst) || die "Cannot save $uri to $dst\n";
 
-    getstore($uri, $dst) || die "Cannot save $uri to $dst\n";
+	if ($cached) {
+	    if (! -d $cachedir) {
+		File::Path::make_path($cachedir);
+	    }
+	    $log->debugf('Caching %s in %s', $dst, $cached);
+	    copy($dst, $cached) || $log->warnf('Cannot copy %s to %s, %s', $dst, $cached, $!);
+	}
+    }
 
     $log->debugf('Size of %s: %d bytes', $dst, -s $dst);
 
@@ -267,6 +354,268 @@ sub extractCPANTarball {
     return;
 }
 
+# #############################################################################
+# Performance regression matrix
+# #############################################################################
+sub benchmarkVersions {
+    my ($mapp, $optsp) = @_;
+
+    my @versions = sort { benchmarkVersionCmp($a, $b) } keys %{$mapp};
+
+    my $candidate = $optsp->{libMarpaVersion};
+    my @older = grep { benchmarkVersionCmp($_, $candidate) < 0 } @versions;
+    my $baseline = $older[-1];
+
+    my %samples = ();
+    foreach (@versions) {
+	$samples{$_} = benchmarkVersion($_, $mapp, $optsp);
+    }
+
+    if (! defined($baseline)) {
+	$log->warnf('No libmarpa version older than %s, nothing to compare with', $candidate);
+	benchmarkReport(\@versions, \%samples, undef, undef, $optsp);
+	return 1;
+    }
+
+    return benchmarkReport(\@versions, \%samples, $baseline, $candidate, $optsp);
+}
+
+sub benchmarkVersionCmp {
+    my ($a, $b) = @_;
+
+    my @a = split(/\./, $a);
+    my @b = split(/\./, $b);
+    return ($a[0] <=> $b[0]) || ($a[1] <=> $b[1]) || ($a[2] <=> $b[2]);
+}
+
+#
+# Builds libmarpa $version as a static library, links examples/benchmark
+# against it, and returns { "family\tsize" => { metric => [ samples ] } }
+#
+sub benchmarkVersion {
+    my ($version, $mapp, $optsp) = @_;
+
+    my $logPrefix = "benchmark $version";
+    my $cwd = getcwd();
+    my $tmpDir = tempdir(CLEANUP => $optsp->{cleanup});
+    my $prefix = File::Spec->catdir($tmpDir, 'install');
+    my $examplesDir = File::Spec->catdir($tmpDir, 'examples');
+
+    my $tarball = getCPANTarball($version, $mapp, $tmpDir, $optsp->{cache});
+    my %subDirs = (
+	libmarpa_dist => undef
+	);
+    extractCPANTarball($tarball, $tmpDir, \%subDirs);
+
+    $log->infof('[%s] Building libmarpa in %s', $logPrefix, $subDirs{libmarpa_dist});
+    chdir($subDirs{libmarpa_dist}) || die "Cannot chdir to $subDirs{libmarpa_dist}, $!";
+    if (! -e 'configure') {
+	_system(['autoreconf', '-fi'], $logPrefix);
+    }
+    _system(['sh', 'configure', "--prefix=$prefix", '--disable-shared', '--enable-static'], $logPrefix);
+    _system(['make'], $logPrefix);
+    _system(['make', 'install'], $logPrefix);
+    chdir($cwd) || die "Cannot chdir to $cwd, $!";
+
+    $log->infof('[%s] Building benchmark in %s', $logPrefix, $examplesDir);
+    dircopy(File::Spec->catdir(dirname(abs_path($0)), 'examples'), $examplesDir) || die "Cannot copy examples to $examplesDir, $!";
+    chdir($examplesDir) || die "Cannot chdir to $examplesDir, $!";
+    _system(['make', 'clean'], $logPrefix);
+    _system(['make', 'benchmark',
+	     'CFLAGS=-Wall -O2 -I' . File::Spec->catdir($prefix, 'include'),
+	     'LDFLAGS=' . File::Spec->catfile($prefix, 'lib', 'libmarpa.a') . ' -lm'], $logPrefix);
+
+    my %samples = ();
+    foreach my $run (1..$optsp->{benchmarkRuns}) {
+	$log->infof('[%s] Run %d/%d', $logPrefix, $run, $optsp->{benchmarkRuns});
+	my ($out, $err) = _system(['./benchmark', $optsp->{benchmarkRepetitions}], $logPrefix);
+	my @header = ();
+	foreach (split(/\n/, $out)) {
+	    my @fields = split(/\t/, $_);
+	    if (! @header) {
+		@header = @fields;
+		next;
+	    }
+	    my %row = ();
+	    @row{@header} = @fields;
+	    my $key = "$row{family}\t$row{size}";
+	    my $total = 0;
+	    foreach (grep { /_ns$/ } @header) {
+		push(@{$samples{$key}->{$_}}, $row{$_});
+		$total += $row{$_};
+	    }
+	    push(@{$samples{$key}->{total_ns}}, $total);
+	    push(@{$samples{$key}->{process_maxrss_kb}}, $row{process_maxrss_kb});
+	}
+    }
+
+    chdir($cwd) || die "Cannot chdir to $cwd, $!";
+
+    return \%samples;
+}
+
+#
+# Side by side table of all versions. Returns false if $candidate is
+# significantly slower than $baseline on the total time of at least one
+# workload. Only total_ns is gated, with Holm's correction across
+# workloads: the other measures are printed for information.
+#
+sub benchmarkReport {
+    my ($versionsp, $samplesp, $baseline, $candidate, $optsp) = @_;
+
+    my $ok = 1;
+    my @metrics = qw/precompute_ns feed_ns bocage_ns order_ns tree_ns valuation_ns total_ns process_maxrss_kb/;
+    my @keys = sort keys %{$samplesp->{$versionsp->[-1]}};
+    my %significant = ();
+
+    if (defined($baseline)) {
+	my %pValues = ();
+	foreach my $key (@keys) {
+	    my $baseSamples = $samplesp->{$baseline}->{$key}->{total_ns};
+	    my $candSamples = $samplesp->{$candidate}->{$key}->{total_ns};
+	    $pValues{$key} = benchmarkWelchPValue($baseSamples, $candSamples) if ($baseSamples && $candSamples);
+	}
+	my @sorted = sort { $pValues{$a} <=> $pValues{$b} } keys %pValues;
+	foreach my $rank (0..$#sorted) {
+	    last if ($pValues{$sorted[$rank]} >= $optsp->{benchmarkAlpha} / (scalar(@sorted) - $rank));
+	    $significant{$sorted[$rank]} = 1;
+	}
+    }
+
+    printf "%-10s %8s %-17s", 'family', 'size', 'measure';
+    printf " %14s", $_ foreach (@{$versionsp});
+    printf " %9s %10s %s", 'delta', 'p-value', 'verdict' if (defined($baseline));
+    print "\n";
+
+    foreach my $key (@keys) {
+	my ($family, $size) = split(/\t/, $key);
+	foreach my $metric (@metrics) {
+	    printf "%-10s %8s %-17s", $family, $size, $metric;
+	    foreach (@{$versionsp}) {
+		my $samples = $samplesp->{$_}->{$key}->{$metric};
+		if ($samples) {
+		    printf " %14.0f", (benchmarkMeanVariance($samples))[0];
+		} else {
+		    printf " %14s", '-';
+		}
+	    }
+	    if (defined($baseline)) {
+		my $baseSamples = $samplesp->{$baseline}->{$key}->{$metric};
+		my $candSamples = $samplesp->{$candidate}->{$key}->{$metric};
+		if ($baseSamples && $candSamples) {
+		    my ($baseMean) = benchmarkMeanVariance($baseSamples);
+		    my ($candMean) = benchmarkMeanVariance($candSamples);
+		    my $delta = ($baseMean > 0) ? 100 * ($candMean - $baseMean) / $baseMean : 0;
+		    my $p = benchmarkWelchPValue($baseSamples, $candSamples);
+		    my $verdict = ($metric ne 'total_ns') ? '(info)'
+			: ($delta > $optsp->{benchmarkThreshold} && $significant{$key}) ? 'REGRESSION'
+			: ($delta < -$optsp->{benchmarkThreshold} && $significant{$key}) ? 'improvement'
+			: '';
+		    $ok = 0 if ($verdict eq 'REGRESSION');
+		    printf " %+8.2f%% %10.4g %s", $delta, $p, $verdict;
+		}
+	    }
+	    print "\n";
+	}
+    }
+
+    return $ok;
+}
+
+sub benchmarkMeanVariance {
+    my ($samples) = @_;
+
+    my $n = scalar(@{$samples});
+    my $mean = 0;
+    $mean += $_ foreach (@{$samples});
+    $mean /= $n;
+    my $variance = 0;
+    if ($n > 1) {
+	$variance += ($_ - $mean) ** 2 foreach (@{$samples});
+	$variance /= ($n - 1);
+    }
+
+    return ($mean, $variance);
+}
+
+#
+# Two-sided p-value of Welch's t-test
+#
+sub benchmarkWelchPValue {
+    my ($samples1, $samples2) = @_;
+
+    my $n1 = scalar(@{$samples1});
+    my $n2 = scalar(@{$samples2});
+    return 1 if ($n1 < 2 || $n2 < 2);
+
+    my ($mean1, $variance1) = benchmarkMeanVariance($samples1);
+    my ($mean2, $variance2) = benchmarkMeanVariance($samples2);
+    my $se1 = $variance1 / $n1;
+    my $se2 = $variance2 / $n2;
+    if ($se1 + $se2 <= 0) {
+	return ($mean1 == $mean2) ? 1 : 0;
+    }
+
+    my $t = ($mean2 - $mean1) / sqrt($se1 + $se2);
+    my $df = (($se1 + $se2) ** 2) / ((($se1 ** 2) / ($n1 - 1)) + (($se2 ** 2) / ($n2 - 1)));
+
+    return benchmarkIncompleteBeta($df / ($df + $t * $t), $df / 2, 0.5);
+}
+
+#
+# Regularized incomplete beta function I_x(a, b)
+#
+sub benchmarkIncompleteBeta {
+    my ($x, $a, $b) = @_;
+
+    return 0 if ($x <= 0);
+    return 1 if ($x >= 1);
+
+    my $front = exp(lgamma($a + $b) - lgamma($a) - lgamma($b) + $a * log($x) + $b * log(1 - $x));
+    if ($x < ($a + 1) / ($a + $b + 2)) {
+	return $front * benchmarkBetaContinuedFraction($x, $a, $b) / $a;
+    } else {
+	return 1 - $front * benchmarkBetaContinuedFraction(1 - $x, $b, $a) / $b;
+    }
+}
+
+#
+# Continued fraction of the incomplete beta function, modified Lentz's method
+#
+sub benchmarkBetaContinuedFraction {
+    my ($x, $a, $b) = @_;
+
+    my $tiny = 1e-300;
+    my $c = 1;
+    my $d = 1 - ($a + $b) * $x / ($a + 1);
+    $d = $tiny if (abs($d) < $tiny);
+    $d = 1 / $d;
+    my $h = $d;
+
+    foreach my $m (1..300) {
+	my $m2 = 2 * $m;
+	my $aa = $m * ($b - $m) * $x / (($a + $m2 - 1) * ($a + $m2));
+	$d = 1 + $aa * $d;
+	$d = $tiny if (abs($d) < $tiny);
+	$c = 1 + $aa / $c;
+	$c = $tiny if (abs($c) < $tiny);
+	$d = 1 / $d;
+	$h *= $d * $c;
+
+	$aa = -($a + $m) * ($a + $b + $m) * $x / (($a + $m2) * ($a + $m2 + 1));
+	$d = 1 + $aa * $d;
+	$d = $tiny if (abs($d) < $tiny);
+	$c = 1 + $aa / $c;
+	$c = $tiny if (abs($c) < $tiny);
+	$d = 1 / $d;
+	my $del = $d * $c;
+	$h *= $del;
+	last if (abs($del - 1) < 1e-12);
+    }
+
+    return $h;
+}
+
 # #############################################################################
 # Process directories
 # #############################################################################
@@ -397,6 +746,14 @@ sub debianize {
 		    }
 		}, $templatesDir);
 	    #
+	    # The profile-guided build trains on the examples
+	    #
+	    if ($dir eq 'libmarpa_dist' && $optsp->{pgo}) {
+		my $trainingDir = File::Spec->catdir('debian', 'training');
+		$log->debugf('[%s] Copying examples to %s', $logPrefix, $trainingDir);
+		dircopy(File::Spec->catdir($cwd, 'examples'), $trainingDir) || die "Cannot copy examples to $trainingDir, $!";
+	    }
+	    #
 	    # Redo the changelog
 	    #
 	    my $changelog = File::Spec->catfile('debian', 'changelog');
@@ -473,6 +830,13 @@ sub debianize {
 	    # Build the package
 	    #
 	    my @debuild = ('debuild', '-us', '-uc');
+	    if ($dir eq 'libmarpa_dist') {
+		my @profiles = ();
+		push(@profiles, 'nopgo') if (! $optsp->{pgo});
+		push(@profiles, 'nohwcaps') if (! $optsp->{hwcaps});
+		push(@profiles, 'noprof') if (! $optsp->{prof});
+		push(@debuild, '-P' . join(',', @profiles)) if (@profiles);
+	    }
 	    _system(\@debuild, $logPrefix);
 	    #
 	    # Display the content of debian/tmp
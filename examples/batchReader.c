@@ -0,0 +1,692 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "batchReader.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define BATCHREADER_IO_URING 1
+#endif
+#endif
+
+typedef struct batchReaderContext {
+  const char              **paths;
+  size_t                    nPaths;
+  batchReaderOption_t       option;
+  batchReaderCallback_t     callback;
+  void                     *userDataPtr;
+  char                     *buffers;        /* queueDepth buffers of bufferSize bytes */
+  batchReaderStatistics_t   statistics;
+} batchReaderContext_t;
+
+static int _batchReaderOpen(batchReaderContext_t *contextPtr, size_t fileIndex, size_t *sizePtr, int *rcPtr);
+static int _batchReaderOversize(batchReaderContext_t *contextPtr, size_t fileIndex, int fd, size_t size);
+/* Returns 0, or -1 if the callback stopped */
+static int _batchReaderDeliver(batchReaderContext_t *contextPtr, size_t fileIndex, const char *bufferPtr, size_t length, int errorNumber);
+static int _batchReaderThreads(batchReaderContext_t *contextPtr);
+#ifdef BATCHREADER_IO_URING
+static int _batchReaderIoUring(batchReaderContext_t *contextPtr);
+#endif
+
+int batchReaderRun(const char **paths, size_t nPaths, batchReaderOption_t *optionPtr, batchReaderCallback_t callbackPtr, void *userDataPtr, batchReaderStatistics_t *statisticsPtr)
+{
+  batchReaderOption_t  defaultOption = BATCHREADER_OPTION_DEFAULT;
+  batchReaderContext_t context;
+  int                  rc            = 1;
+
+  if ((paths == NULL && nPaths > 0) || callbackPtr == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  context.paths       = paths;
+  context.nPaths      = nPaths;
+  context.option      = (optionPtr != NULL) ? *optionPtr : defaultOption;
+  context.callback    = callbackPtr;
+  context.userDataPtr = userDataPtr;
+  memset(&(context.statistics), 0, sizeof(batchReaderStatistics_t));
+  if (context.option.queueDepth <= 0) {
+    context.option.queueDepth = defaultOption.queueDepth;
+  }
+  if (context.option.bufferSize <= 0) {
+    context.option.bufferSize = defaultOption.bufferSize;
+  }
+  if (context.option.nThreads <= 0) {
+    context.option.nThreads = defaultOption.nThreads;
+  }
+
+  /* Page aligned, for registration */
+  if (posix_memalign((void **) &(context.buffers), 4096, (size_t) context.option.queueDepth * context.option.bufferSize) != 0) {
+    errno = ENOMEM;
+    return -1;
+  }
+
+#ifdef BATCHREADER_IO_URING
+  if (context.option.useThreads == 0) {
+    /* 1 means that io_uring is not available */
+    rc = _batchReaderIoUring(&context);
+  }
+#endif
+  if (rc > 0) {
+    rc = _batchReaderThreads(&context);
+  }
+
+  free(context.buffers);
+  if (statisticsPtr != NULL) {
+    *statisticsPtr = context.statistics;
+  }
+
+  return rc;
+}
+
+/* Returns the file descriptor, or -1 once the error has been delivered, with the callback return value in *rcPtr */
+static int _batchReaderOpen(batchReaderContext_t *contextPtr, size_t fileIndex, size_t *sizePtr, int *rcPtr)
+{
+  struct stat st;
+  int         fd = open(contextPtr->paths[fileIndex], O_RDONLY | O_CLOEXEC);
+  int         errorNumber;
+
+  if (fd >= 0 && fstat(fd, &st) == 0) {
+    *sizePtr = (size_t) st.st_size;
+    return fd;
+  }
+
+  errorNumber = errno;
+  if (fd >= 0) {
+    close(fd);
+  }
+  *rcPtr = _batchReaderDeliver(contextPtr, fileIndex, NULL, 0, errorNumber);
+  return -1;
+}
+
+/* Synchronous read of a file larger than the buffers. Returns 0, or -1 if the callback stopped */
+static int _batchReaderOversize(batchReaderContext_t *contextPtr, size_t fileIndex, int fd, size_t size)
+{
+  char   *bufferPtr = malloc(size);
+  size_t  done      = 0;
+  int     rc;
+
+  contextPtr->statistics.nOversize++;
+  if (bufferPtr == NULL) {
+    return _batchReaderDeliver(contextPtr, fileIndex, NULL, 0, ENOMEM);
+  }
+  while (done < size) {
+    ssize_t n = pread(fd, bufferPtr + done, size - done, (off_t) done);
+
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      int errorNumber = errno;
+
+      free(bufferPtr);
+      return _batchReaderDeliver(contextPtr, fileIndex, NULL, 0, errorNumber);
+    }
+    if (n == 0) {
+      /* Truncated meanwhile */
+      break;
+    }
+    done += (size_t) n;
+  }
+  rc = _batchReaderDeliver(contextPtr, fileIndex, bufferPtr, done, 0);
+  free(bufferPtr);
+
+  return rc;
+}
+
+static int _batchReaderDeliver(batchReaderContext_t *contextPtr, size_t fileIndex, const char *bufferPtr, size_t length, int errorNumber)
+{
+  contextPtr->statistics.nFiles++;
+  if (errorNumber != 0) {
+    contextPtr->statistics.nErrors++;
+  } else {
+    contextPtr->statistics.nBytes += length;
+  }
+
+  if ((*contextPtr->callback)(contextPtr->userDataPtr, fileIndex, contextPtr->paths[fileIndex], bufferPtr, length, errorNumber) < 0) {
+    errno = ECANCELED;
+    return -1;
+  }
+
+  return 0;
+}
+
+/* ------------------------------------------------------------------------ */
+/* Thread pool fallback                                                     */
+/* ------------------------------------------------------------------------ */
+
+typedef struct batchReaderRecord {
+  size_t  fileIndex;
+  int     buffer;          /* Index in the pool */
+  size_t  length;
+  int     errorNumber;
+  char   *oversizePtr;     /* Or NULL */
+} batchReaderRecord_t;
+
+typedef struct batchReaderPool {
+  batchReaderContext_t *contextPtr;
+  pthread_mutex_t       mutex;
+  pthread_cond_t        freeCond;       /* A buffer was released */
+  pthread_cond_t        doneCond;       /* A record was queued */
+  int                  *freeBuffers;
+  int                   nFree;
+  batchReaderRecord_t  *records;        /* Ring of completed reads: never more than queueDepth */
+  int                   recordHead;
+  int                   nRecords;
+  size_t                nextFile;
+  int                   stop;
+} batchReaderPool_t;
+
+static void *_batchReaderWorker(void *poolPtr);
+
+static int _batchReaderThreads(batchReaderContext_t *contextPtr)
+{
+  batchReaderPool_t  pool;
+  pthread_t         *threads;
+  int                nThreads   = 0;
+  int                queueDepth = contextPtr->option.queueDepth;
+  size_t             nDelivered = 0;
+  int                rc         = 0;
+  int                i;
+
+  contextPtr->statistics.ioUring = 0;
+  if (contextPtr->nPaths <= 0) {
+    return 0;
+  }
+
+  pool.contextPtr  = contextPtr;
+  pool.freeBuffers = malloc(queueDepth * sizeof(int));
+  pool.records     = malloc(queueDepth * sizeof(batchReaderRecord_t));
+  threads          = malloc(contextPtr->option.nThreads * sizeof(pthread_t));
+  if (pool.freeBuffers == NULL || pool.records == NULL || threads == NULL) {
+    free(pool.freeBuffers);
+    free(pool.records);
+    free(threads);
+    return -1;
+  }
+  for (i = 0; i < queueDepth; i++) {
+    pool.freeBuffers[i] = i;
+  }
+  pool.nFree      = queueDepth;
+  pool.recordHead = 0;
+  pool.nRecords   = 0;
+  pool.nextFile   = 0;
+  pool.stop       = 0;
+  pthread_mutex_init(&(pool.mutex), NULL);
+  pthread_cond_init(&(pool.freeCond), NULL);
+  pthread_cond_init(&(pool.doneCond), NULL);
+
+  while (nThreads < contextPtr->option.nThreads && pthread_create(&(threads[nThreads]), NULL, &_batchReaderWorker, &pool) == 0) {
+    nThreads++;
+  }
+  if (nThreads <= 0) {
+    rc = -1;
+  }
+
+  /* Every file gives exactly one record */
+  while (rc == 0 && nDelivered < contextPtr->nPaths) {
+    batchReaderRecord_t record;
+
+    pthread_mutex_lock(&(pool.mutex));
+    while (pool.nRecords <= 0) {
+      pthread_cond_wait(&(pool.doneCond), &(pool.mutex));
+    }
+    record          = pool.records[pool.recordHead];
+    pool.recordHead = (pool.recordHead + 1) % queueDepth;
+    pool.nRecords--;
+    pthread_mutex_unlock(&(pool.mutex));
+
+    if (record.oversizePtr != NULL) {
+      contextPtr->statistics.nOversize++;
+      rc = _batchReaderDeliver(contextPtr, record.fileIndex, record.oversizePtr, record.length, 0);
+      free(record.oversizePtr);
+    } else {
+      rc = _batchReaderDeliver(contextPtr, record.fileIndex, (record.errorNumber == 0) ? contextPtr->buffers + (size_t) record.buffer * contextPtr->option.bufferSize : NULL, record.length, record.errorNumber);
+    }
+    nDelivered++;
+
+    /* Recycled */
+    pthread_mutex_lock(&(pool.mutex));
+    pool.freeBuffers[pool.nFree++] = record.buffer;
+    pthread_cond_signal(&(pool.freeCond));
+    pthread_mutex_unlock(&(pool.mutex));
+  }
+  pthread_mutex_lock(&(pool.mutex));
+  pool.stop = 1;
+  pthread_cond_broadcast(&(pool.freeCond));
+  pthread_mutex_unlock(&(pool.mutex));
+  for (i = 0; i < nThreads; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  /* Records not delivered because the callback stopped */
+  while (pool.nRecords > 0) {
+    free(pool.records[pool.recordHead].oversizePtr);
+    pool.recordHead = (pool.recordHead + 1) % queueDepth;
+    pool.nRecords--;
+  }
+
+  pthread_cond_destroy(&(pool.doneCond));
+  pthread_cond_destroy(&(pool.freeCond));
+  pthread_mutex_destroy(&(pool.mutex));
+  free(threads);
+  free(pool.records);
+  free(pool.freeBuffers);
+
+  return rc;
+}
+
+static void *_batchReaderWorker(void *poolPtr)
+{
+  batchReaderPool_t    *pool       = (batchReaderPool_t *) poolPtr;
+  batchReaderContext_t *contextPtr = pool->contextPtr;
+  size_t                bufferSize = contextPtr->option.bufferSize;
+
+  while (1) {
+    batchReaderRecord_t record;
+    struct stat         st;
+    char               *bufferPtr;
+    size_t              size = 0;
+    int                 fd;
+
+    pthread_mutex_lock(&(pool->mutex));
+    while (pool->nFree <= 0 && pool->stop == 0) {
+      pthread_cond_wait(&(pool->freeCond), &(pool->mutex));
+    }
+    if (pool->stop != 0 || pool->nextFile >= contextPtr->nPaths) {
+      pthread_mutex_unlock(&(pool->mutex));
+      break;
+    }
+    record.fileIndex = pool->nextFile++;
+    record.buffer    = pool->freeBuffers[--pool->nFree];
+    pthread_mutex_unlock(&(pool->mutex));
+
+    record.length      = 0;
+    record.errorNumber = 0;
+    record.oversizePtr = NULL;
+    bufferPtr          = contextPtr->buffers + (size_t) record.buffer * bufferSize;
+
+    fd = open(contextPtr->paths[record.fileIndex], O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+      record.errorNumber = errno;
+    } else {
+      size = (size_t) st.st_size;
+      if (size > bufferSize) {
+	bufferPtr = record.oversizePtr = malloc(size);
+	if (bufferPtr == NULL) {
+	  record.errorNumber = ENOMEM;
+	}
+      }
+      while (record.errorNumber == 0 && record.length < size) {
+	ssize_t n = pread(fd, bufferPtr + record.length, size - record.length, (off_t) record.length);
+
+	if (n < 0 && errno != EINTR) {
+	  record.errorNumber = errno;
+	} else if (n == 0) {
+	  break;
+	} else if (n > 0) {
+	  record.length += (size_t) n;
+	}
+      }
+      if (record.errorNumber != 0) {
+	free(record.oversizePtr);
+	record.oversizePtr = NULL;
+	record.length      = 0;
+      }
+    }
+    if (fd >= 0) {
+      close(fd);
+    }
+
+    pthread_mutex_lock(&(pool->mutex));
+    pool->records[(pool->recordHead + pool->nRecords) % contextPtr->option.queueDepth] = record;
+    pool->nRecords++;
+    pthread_cond_signal(&(pool->doneCond));
+    pthread_mutex_unlock(&(pool->mutex));
+  }
+
+  return NULL;
+}
+
+#ifdef BATCHREADER_IO_URING
+/* ------------------------------------------------------------------------ */
+/* io_uring, with the raw system calls: no liburing dependency              */
+/* ------------------------------------------------------------------------ */
+
+typedef struct batchReaderRing {
+  int                  fd;
+  unsigned            *sqTail;
+  unsigned            *sqMask;
+  unsigned            *sqArray;
+  unsigned            *cqHead;
+  unsigned            *cqTail;
+  unsigned            *cqMask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void                *sqRingPtr;
+  size_t               sqRingSize;
+  void                *cqRingPtr;      /* Same as sqRingPtr with IORING_FEAT_SINGLE_MMAP */
+  size_t               cqRingSize;
+  size_t               sqesSize;
+} batchReaderRing_t;
+
+typedef struct batchReaderSlot {
+  size_t fileIndex;
+  int    fd;             /* -1 when the slot is free */
+  size_t size;
+  size_t done;
+} batchReaderSlot_t;
+
+static int  _batchReaderRingCreate(batchReaderRing_t *ringPtr, unsigned nEntries);
+static void _batchReaderRingFree(batchReaderRing_t *ringPtr);
+static int  _batchReaderRingSupports(batchReaderRing_t *ringPtr, int opcode);
+static void _batchReaderRingRead(batchReaderRing_t *ringPtr, int opcode, int slot, int fd, char *bufferPtr, size_t length, size_t offset);
+
+static int _batchReaderIoUring(batchReaderContext_t *contextPtr)
+{
+  batchReaderRing_t  ring;
+  batchReaderSlot_t *slots;
+  int               *freeSlots;
+  struct iovec      *iovecs;
+  int                queueDepth = contextPtr->option.queueDepth;
+  size_t             bufferSize = contextPtr->option.bufferSize;
+  int                opcode     = IORING_OP_READ_FIXED;
+  int                nFree      = queueDepth;
+  int                inFlight   = 0;
+  unsigned           toSubmit   = 0;
+  size_t             nextFile   = 0;
+  int                rc         = 0;
+  int                errorNumber;
+  int                i;
+
+  if (_batchReaderRingCreate(&ring, (unsigned) queueDepth) < 0) {
+    return 1;
+  }
+  contextPtr->statistics.ioUring = 1;
+
+  slots     = malloc(queueDepth * sizeof(batchReaderSlot_t));
+  freeSlots = malloc(queueDepth * sizeof(int));
+  iovecs    = malloc(queueDepth * sizeof(struct iovec));
+  if (slots == NULL || freeSlots == NULL || iovecs == NULL) {
+    free(slots);
+    free(freeSlots);
+    free(iovecs);
+    _batchReaderRingFree(&ring);
+    return -1;
+  }
+  for (i = 0; i < queueDepth; i++) {
+    freeSlots[i]          = i;
+    slots[i].fd           = -1;
+    iovecs[i].iov_base    = contextPtr->buffers + (size_t) i * bufferSize;
+    iovecs[i].iov_len     = bufferSize;
+  }
+  /*
+   * Registration pins the buffers: it may exceed RLIMIT_MEMLOCK, then plain reads
+   * are used. IORING_OP_READ only exists from Linux 5.6: before, the threads read.
+   */
+  if (syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_BUFFERS, iovecs, queueDepth) < 0) {
+    if (! _batchReaderRingSupports(&ring, IORING_OP_READ)) {
+      free(slots);
+      free(freeSlots);
+      free(iovecs);
+      _batchReaderRingFree(&ring);
+      contextPtr->statistics.ioUring = 0;
+      return 1;
+    }
+    opcode = IORING_OP_READ;
+  }
+
+  while (nextFile < contextPtr->nPaths || inFlight > 0) {
+    unsigned head;
+
+    /* Starts reads into the free buffers, unless the callback stopped */
+    while (rc == 0 && nFree > 0 && nextFile < contextPtr->nPaths) {
+      size_t fileIndex = nextFile++;
+      size_t size;
+      int    fd        = _batchReaderOpen(contextPtr, fileIndex, &size, &rc);
+      int    slot;
+
+      if (fd < 0) {
+	continue;
+      }
+      if (size <= 0 || size > bufferSize) {
+	rc = (size <= 0) ? _batchReaderDeliver(contextPtr, fileIndex, iovecs[0].iov_base, 0, 0) : _batchReaderOversize(contextPtr, fileIndex, fd, size);
+	close(fd);
+	continue;
+      }
+      slot                  = freeSlots[--nFree];
+      slots[slot].fileIndex = fileIndex;
+      slots[slot].fd        = fd;
+      slots[slot].size      = size;
+      slots[slot].done      = 0;
+      _batchReaderRingRead(&ring, opcode, slot, fd, iovecs[slot].iov_base, size, 0);
+      inFlight++;
+      toSubmit++;
+    }
+    if (rc < 0) {
+      /* In-flight reads still write into the buffers: they are waited for */
+      nextFile = contextPtr->nPaths;
+    }
+    if (inFlight <= 0) {
+      continue;
+    }
+
+    /* Submits, and waits for at least one completion */
+    {
+      long n = syscall(__NR_io_uring_enter, ring.fd, toSubmit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+
+      if (n < 0) {
+	if (errno == EINTR) {
+	  continue;
+	}
+	rc = -1;
+	break;
+      }
+      toSubmit -= (unsigned) n;
+    }
+
+    head = *ring.cqHead;
+    while (head != __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE)) {
+      struct io_uring_cqe *cqePtr  = &(ring.cqes[head & *ring.cqMask]);
+      int                  slot    = (int) cqePtr->user_data;
+      int                  res     = cqePtr->res;
+      batchReaderSlot_t   *slotPtr = &(slots[slot]);
+
+      head++;
+      if (res > 0) {
+	slotPtr->done += (size_t) res;
+	if (slotPtr->done < slotPtr->size) {
+	  /* Short read: the rest */
+	  _batchReaderRingRead(&ring, opcode, slot, slotPtr->fd, (char *) iovecs[slot].iov_base + slotPtr->done, slotPtr->size - slotPtr->done, slotPtr->done);
+	  toSubmit++;
+	  continue;
+	}
+      }
+      close(slotPtr->fd);
+      slotPtr->fd = -1;
+      inFlight--;
+      if (rc == 0) {
+	rc = (res < 0) ?
+	  _batchReaderDeliver(contextPtr, slotPtr->fileIndex, NULL, 0, -res) :
+	  _batchReaderDeliver(contextPtr, slotPtr->fileIndex, iovecs[slot].iov_base, slotPtr->done, 0);
+      }
+      /* Recycled */
+      freeSlots[nFree++] = slot;
+    }
+    __atomic_store_n(ring.cqHead, head, __ATOMIC_RELEASE);
+  }
+
+  /*
+   * After an io_uring_enter() failure, reads still in flight write into the buffers,
+   * and ring teardown does not wait for them: they are reaped first. Reads not
+   * submitted yet are taken back from the submission queue.
+   */
+  errorNumber = errno;
+  if (inFlight > 0) {
+    unsigned tail = *ring.sqTail;
+
+    while (toSubmit > 0) {
+      int slot = (int) ring.sqes[--tail & *ring.sqMask].user_data;
+
+      close(slots[slot].fd);
+      slots[slot].fd = -1;
+      inFlight--;
+      toSubmit--;
+    }
+    __atomic_store_n(ring.sqTail, tail, __ATOMIC_RELEASE);
+  }
+  while (inFlight > 0) {
+    unsigned head;
+
+    if (syscall(__NR_io_uring_enter, ring.fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      break;
+    }
+    head = *ring.cqHead;
+    while (head != __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE)) {
+      int slot = (int) ring.cqes[head & *ring.cqMask].user_data;
+
+      head++;
+      close(slots[slot].fd);
+      slots[slot].fd = -1;
+      inFlight--;
+    }
+    __atomic_store_n(ring.cqHead, head, __ATOMIC_RELEASE);
+  }
+  if (inFlight > 0) {
+    /* Cannot be reaped: the buffers are left to the kernel, i.e. never freed */
+    for (i = 0; i < queueDepth; i++) {
+      if (slots[i].fd >= 0) {
+	close(slots[i].fd);
+      }
+    }
+    contextPtr->buffers = NULL;
+  }
+
+  free(slots);
+  free(freeSlots);
+  free(iovecs);
+  _batchReaderRingFree(&ring);
+  errno = errorNumber;
+
+  return rc;
+}
+
+static int _batchReaderRingCreate(batchReaderRing_t *ringPtr, unsigned nEntries)
+{
+  struct io_uring_params params;
+  char                  *sqRingPtr;
+  char                  *cqRingPtr;
+
+  memset(&params, 0, sizeof(params));
+  ringPtr->fd = (int) syscall(__NR_io_uring_setup, nEntries, &params);
+  if (ringPtr->fd < 0) {
+    return -1;
+  }
+
+  ringPtr->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ringPtr->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0 && ringPtr->cqRingSize > ringPtr->sqRingSize) {
+    ringPtr->sqRingSize = ringPtr->cqRingSize;
+  }
+  ringPtr->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+  ringPtr->sqRingPtr = mmap(NULL, ringPtr->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringPtr->fd, IORING_OFF_SQ_RING);
+  if (ringPtr->sqRingPtr == MAP_FAILED) {
+    close(ringPtr->fd);
+    return -1;
+  }
+  if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+    ringPtr->cqRingPtr = ringPtr->sqRingPtr;
+  } else {
+    ringPtr->cqRingPtr = mmap(NULL, ringPtr->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringPtr->fd, IORING_OFF_CQ_RING);
+    if (ringPtr->cqRingPtr == MAP_FAILED) {
+      munmap(ringPtr->sqRingPtr, ringPtr->sqRingSize);
+      close(ringPtr->fd);
+      return -1;
+    }
+  }
+  ringPtr->sqes = mmap(NULL, ringPtr->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringPtr->fd, IORING_OFF_SQES);
+  if (ringPtr->sqes == MAP_FAILED) {
+    if (ringPtr->cqRingPtr != ringPtr->sqRingPtr) {
+      munmap(ringPtr->cqRingPtr, ringPtr->cqRingSize);
+    }
+    munmap(ringPtr->sqRingPtr, ringPtr->sqRingSize);
+    close(ringPtr->fd);
+    return -1;
+  }
+
+  sqRingPtr        = (char *) ringPtr->sqRingPtr;
+  cqRingPtr        = (char *) ringPtr->cqRingPtr;
+  ringPtr->sqTail  = (unsigned *) (sqRingPtr + params.sq_off.tail);
+  ringPtr->sqMask  = (unsigned *) (sqRingPtr + params.sq_off.ring_mask);
+  ringPtr->sqArray = (unsigned *) (sqRingPtr + params.sq_off.array);
+  ringPtr->cqHead  = (unsigned *) (cqRingPtr + params.cq_off.head);
+  ringPtr->cqTail  = (unsigned *) (cqRingPtr + params.cq_off.tail);
+  ringPtr->cqMask  = (unsigned *) (cqRingPtr + params.cq_off.ring_mask);
+  ringPtr->cqes    = (struct io_uring_cqe *) (cqRingPtr + params.cq_off.cqes);
+
+  return 0;
+}
+
+static void _batchReaderRingFree(batchReaderRing_t *ringPtr)
+{
+  munmap(ringPtr->sqes, ringPtr->sqesSize);
+  if (ringPtr->cqRingPtr != ringPtr->sqRingPtr) {
+    munmap(ringPtr->cqRingPtr, ringPtr->cqRingSize);
+  }
+  munmap(ringPtr->sqRingPtr, ringPtr->sqRingSize);
+  close(ringPtr->fd);
+}
+
+/* IORING_REGISTER_PROBE appeared with IORING_OP_READ: a kernel without the probe does not have the opcode either */
+static int _batchReaderRingSupports(batchReaderRing_t *ringPtr, int opcode)
+{
+  size_t                 size     = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+  struct io_uring_probe *probePtr = calloc(1, size);
+  int                    rc       = 0;
+
+  if (probePtr == NULL) {
+    return 0;
+  }
+  if (syscall(__NR_io_uring_register, ringPtr->fd, IORING_REGISTER_PROBE, probePtr, 256) == 0 &&
+      opcode <= probePtr->last_op &&
+      (probePtr->ops[opcode].flags & IO_URING_OP_SUPPORTED) != 0) {
+    rc = 1;
+  }
+  free(probePtr);
+
+  return rc;
+}
+
+/* Queues a read, submitted by the next io_uring_enter(). There is always room: one entry per slot */
+static void _batchReaderRingRead(batchReaderRing_t *ringPtr, int opcode, int slot, int fd, char *bufferPtr, size_t length, size_t offset)
+{
+  unsigned             tail   = *ringPtr->sqTail;
+  unsigned             index  = tail & *ringPtr->sqMask;
+  struct io_uring_sqe *sqePtr = &(ringPtr->sqes[index]);
+
+  memset(sqePtr, 0, sizeof(struct io_uring_sqe));
+  sqePtr->opcode    = (unsigned char) opcode;
+  sqePtr->fd        = fd;
+  sqePtr->addr      = (unsigned long) bufferPtr;
+  sqePtr->len       = (unsigned) length;
+  sqePtr->off       = (unsigned long long) offset;
+  sqePtr->buf_index = (unsigned short) slot;    /* Ignored by IORING_OP_READ */
+  sqePtr->user_data = (unsigned long long) slot;
+
+  ringPtr->sqArray[index] = index;
+  __atomic_store_n(ringPtr->sqTail, tail + 1, __ATOMIC_RELEASE);
+}
+#endif /* BATCHREADER_IO_URING */
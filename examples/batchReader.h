@@ -0,0 +1,48 @@
+#ifndef BATCH_READER_H
+#define BATCH_READER_H
+
+#include <stddef.h>
+
+/*
+ * Batch ingestion of many small files for the parser: reads stay in flight
+ * while the calling thread tokenizes, feeds and valuates completed files.
+ *
+ * On Linux, reads go through io_uring into registered buffers (IORING_OP_READ_FIXED),
+ * with queueDepth reads in flight, or with IORING_OP_READ when registration exceeds
+ * RLIMIT_MEMLOCK. When io_uring is not available, e.g. an old kernel or a seccomp
+ * filter, or when useThreads is set, nThreads threads read with pread() into the
+ * same buffer pool instead.
+ *
+ * A buffer is recycled as soon as the callback returns: memory is the
+ * buffer pool, whatever the number of files. A file larger than bufferSize
+ * is read synchronously into a temporary buffer.
+ */
+
+/*
+ * Called from the calling thread, in completion order. errorNumber is 0, or the errno of the
+ * failed open() or read(), then bufferPtr is NULL. bufferPtr is only valid during the call.
+ * A negative return value stops: remaining reads are cancelled.
+ */
+typedef int (*batchReaderCallback_t)(void *userDataPtr, size_t fileIndex, const char *path, const char *bufferPtr, size_t length, int errorNumber);
+
+typedef struct batchReaderOption {
+  int    queueDepth;   /* Reads in flight, and number of buffers */
+  size_t bufferSize;   /* In bytes */
+  int    nThreads;     /* Thread pool fallback */
+  int    useThreads;   /* Skips io_uring */
+} batchReaderOption_t;
+
+#define BATCHREADER_OPTION_DEFAULT { 64, 64 * 1024, 4, 0 }
+
+typedef struct batchReaderStatistics {
+  int    ioUring;      /* 1 if io_uring was used */
+  size_t nFiles;
+  size_t nErrors;
+  size_t nBytes;
+  size_t nOversize;    /* Files larger than bufferSize */
+} batchReaderStatistics_t;
+
+/* Returns 0 when all files were delivered, even with read errors, -1 on failure or when the callback stopped */
+int batchReaderRun(const char **paths, size_t nPaths, batchReaderOption_t *optionPtr, batchReaderCallback_t callbackPtr, void *userDataPtr, batchReaderStatistics_t *statisticsPtr);
+
+#endif /* BATCH_READER_H */
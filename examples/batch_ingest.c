@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <marpa.h>
+#include "thin_macros.h"
+#include "parseDriver.h"
+#include "parseMetrics.h"
+#include "batchReader.h"
+
+/*
+  Many small files, one sum each, generated in a temporary directory,
+  then read with batchReaderRun() and parsed as each read completes.
+  -t forces the thread pool reader instead of io_uring.
+
+  sum ::= sum plus number
+  sum ::= number
+
+  Execution  : ./batch_ingest [-t] [nFiles]
+*/
+
+typedef struct s_user {
+  Marpa_Grammar    g;
+  Marpa_Symbol_ID  plus, number;
+  Marpa_Rule_ID    plus_rule_id;
+  parseDriver_t   *parseDriverPtr;
+  long long       *values;           /* Valuator stack */
+  int              nValues;
+  long long        total;
+  size_t           nRejected;
+} s_user_t;
+
+static void _check        (Marpa_Error_Code errorCode, const char *call, int forcedCondition);
+static int  _fileCallback (void *userDataPtr, size_t fileIndex, const char *path, const char *bufferPtr, size_t length, int errorNumber);
+static int  _stepCallback (void *userDataPtr, Marpa_Value v, Marpa_Step_Type stepType);
+static int  _treeCallback (void *userDataPtr, int treeIndex);
+
+struct marpa_error_description_s {
+  Marpa_Error_Code error_code;
+  const char*name;
+  const char*suggested;
+};
+extern const struct marpa_error_description_s marpa_error_description[];
+
+int main(int argc, char **argv) {
+  Marpa_Config             c;
+  Marpa_Symbol_ID          sum;
+  Marpa_Rule_ID            number_rule_id;
+  s_user_t                 user;
+  batchReaderOption_t      option = BATCHREADER_OPTION_DEFAULT;
+  batchReaderStatistics_t  statistics;
+  char                     directory[] = "/tmp/batch_ingest.XXXXXX";
+  const char             **paths;
+  long long                expected = 0;
+  int                      nFiles;
+  int                      argi = 1;
+  int                      rc;
+  uint64_t                 start;
+  int                      i;
+
+  if (argi < argc && strcmp(argv[argi], "-t") == 0) {
+    option.useThreads = 1;
+    argi++;
+  }
+  nFiles = (argi < argc) ? atoi(argv[argi]) : 20000;
+  if (nFiles <= 0) {
+    fprintf(stderr, "Usage: %s [-t] [nFiles]\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  INIT_CONFIG(c);
+  CREATE_GRAMMAR(user.g, c);
+
+  CREATE_SYMBOL(sum, user.g);
+  CREATE_SYMBOL(user.plus, user.g);
+  CREATE_SYMBOL(user.number, user.g);
+
+  SET_START_SYMBOL(sum, user.g);
+
+  {
+    Marpa_Symbol_ID rhs[] = { sum, user.plus, user.number };
+    CREATE_RULE(user.plus_rule_id, user.g, sum, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { user.number };
+    CREATE_RULE(number_rule_id,    user.g, sum, rhs, ARRAY_LENGTH(rhs));
+  }
+
+  PRECOMPUTE(user.g);
+
+  user.parseDriverPtr = parseDriverCreate(user.g, NULL, &_stepCallback, &_treeCallback, &user);
+  user.values         = NULL;
+  user.nValues        = 0;
+  user.total          = 0;
+  user.nRejected      = 0;
+  paths               = malloc(nFiles * sizeof(char *));
+  if (user.parseDriverPtr == NULL || paths == NULL || mkdtemp(directory) == NULL) {
+    fprintf(stderr, "Initialization failure: %s\n", strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  /* Files of 1 to 200 numbers */
+  srand(42);
+  for (i = 0; i < nFiles; i++) {
+    char *path = malloc(sizeof(directory) + 16);
+    FILE *fp;
+    int   nNumbers = 1 + rand() % 200;
+    int   j;
+
+    if (path == NULL) {
+      fprintf(stderr, "malloc() failure\n");
+      exit(EXIT_FAILURE);
+    }
+    sprintf(path, "%s/%d.txt", directory, i);
+    fp = fopen(path, "w");
+    if (fp == NULL) {
+      fprintf(stderr, "%s: %s\n", path, strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+    for (j = 0; j < nNumbers; j++) {
+      int number = rand() % 1000;
+
+      fprintf(fp, (j > 0) ? "+%d" : "%d", number);
+      expected += number;
+    }
+    fclose(fp);
+    paths[i] = path;
+  }
+
+  start = parseMetricsNow();
+  rc    = batchReaderRun(paths, nFiles, &option, &_fileCallback, &user, &statistics);
+  if (rc < 0) {
+    fprintf(stderr, "batchReaderRun(): %s\n", strerror(errno));
+  } else {
+    fprintf(stderr, "%s: %ld files, %ld bytes, %ld errors, %ld rejected, total %lld, %.3f s\n",
+	    (statistics.ioUring != 0) ? "io_uring" : "thread pool",
+	    (long) statistics.nFiles,
+	    (long) statistics.nBytes,
+	    (long) statistics.nErrors,
+	    (long) user.nRejected,
+	    user.total,
+	    (double) (parseMetricsNow() - start) / 1e9);
+    if (user.total != expected) {
+      fprintf(stderr, "MISMATCH: expected total %lld\n", expected);
+      rc = -1;
+    }
+  }
+
+  for (i = 0; i < nFiles; i++) {
+    unlink(paths[i]);
+    free((char *) paths[i]);
+  }
+  rmdir(directory);
+  free(paths);
+  free(user.values);
+  parseDriverFree(&(user.parseDriverPtr));
+  marpa_g_unref(user.g);
+
+  exit((rc < 0) ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+/* The buffer is recycled when this returns: the file is fed and valuated right here */
+static int _fileCallback(void *userDataPtr, size_t fileIndex, const char *path, const char *bufferPtr, size_t length, int errorNumber) {
+  s_user_t         *userPtr = (s_user_t *) userDataPtr;
+  Marpa_Recognizer  r;
+  size_t            i = 0;
+  int               rc = 0;
+
+  if (errorNumber != 0) {
+    fprintf(stderr, "%s: %s\n", path, strerror(errorNumber));
+    return 0;
+  }
+
+  CREATE_RECOGNIZER(r, userPtr->g);
+  START_INPUT(r, userPtr->g);
+  while (rc == 0 && i < length) {
+    Marpa_Symbol_ID symbolId;
+    int             value = 0;
+
+    if (bufferPtr[i] >= '0' && bufferPtr[i] <= '9') {
+      symbolId = userPtr->number;
+      while (i < length && bufferPtr[i] >= '0' && bufferPtr[i] <= '9') {
+	value = value * 10 + (bufferPtr[i++] - '0');
+      }
+    } else if (bufferPtr[i] == '+') {
+      symbolId = userPtr->plus;
+      value    = '+';
+      i++;
+    } else {
+      rc = -1;
+      break;
+    }
+    if (marpa_r_alternative(r, symbolId, value, 1) != MARPA_ERR_NONE || marpa_r_earleme_complete(r) < 0) {
+      rc = -1;
+    }
+  }
+  if (rc == 0 && parseDriverRun(userPtr->parseDriverPtr, r) < 0) {
+    rc = -1;
+  }
+  marpa_r_unref(r);
+
+  /* A bad file does not stop the batch */
+  if (rc < 0) {
+    userPtr->nRejected++;
+  }
+  return 0;
+}
+
+static int _stepCallback(void *userDataPtr, Marpa_Value v, Marpa_Step_Type stepType) {
+  s_user_t *userPtr = (s_user_t *) userDataPtr;
+  int       top     = (stepType == MARPA_STEP_RULE) ? marpa_v_arg_n(v) : marpa_v_result(v);
+
+  if (top >= userPtr->nValues) {
+    int        nValues = (top + 1) * 2;
+    long long *values  = realloc(userPtr->values, nValues * sizeof(long long));
+
+    if (values == NULL) {
+      return -1;
+    }
+    userPtr->values  = values;
+    userPtr->nValues = nValues;
+  }
+
+  switch (stepType) {
+  case MARPA_STEP_TOKEN:
+    userPtr->values[marpa_v_result(v)] = marpa_v_token_value(v);
+    break;
+  case MARPA_STEP_RULE:
+    if (marpa_v_rule(v) == userPtr->plus_rule_id) {
+      userPtr->values[marpa_v_result(v)] = userPtr->values[marpa_v_arg_0(v)] + userPtr->values[marpa_v_arg_n(v)];
+    }
+    /* The other rule passes its only value through: it already is at arg_0 */
+    break;
+  default:
+    break;
+  }
+
+  return 0;
+}
+
+static int _treeCallback(void *userDataPtr, int treeIndex) {
+  s_user_t *userPtr = (s_user_t *) userDataPtr;
+
+  userPtr->total += userPtr->values[0];
+  return 0;
+}
+
+static void _check(Marpa_Error_Code errorCode, const char *call, int forcedCondition) {
+  if (forcedCondition != 0 || errorCode != MARPA_ERR_NONE) {
+    const char *function = (call != NULL) ? call : "<unknown>";
+    const char *msg = (errorCode >= 0 && errorCode < MARPA_ERROR_COUNT) ? marpa_error_description[errorCode].name : "Generic error";
+    fprintf(stderr,"%s: %s", function, msg);
+    exit(EXIT_FAILURE);
+  }
+}
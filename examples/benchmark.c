@@ -0,0 +1,446 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <marpa.h>
+#include "thin_macros.h"
+#include "parseDriver.h"
+#include "parseMetrics.h"
+
+/*
+  End-to-end benchmark over grammar families, with inputs of increasing size:
+
+  ambiguous : S ::= E; E ::= E op E | number
+  left      : S ::= L; L ::= L item | item
+  right     : S ::= R; R ::= item R | item       (Leo memoization)
+  sequence  : S ::= item+
+  json      : value ::= object | array | string | number
+              object ::= '{' pair* separated by ',' '}'
+              pair ::= string ':' value
+              array ::= '[' value* separated by ',' ']'
+
+  Every (family, size) runs in its own process, so that peak RSS is its own.
+  Each phase reports the minimum over the repetitions. process_maxrss_kb is
+  the peak RSS of that whole process, over all phases and repetitions: it
+  is not a per phase measure.
+  Output is one tab separated line per (family, size), after a header line.
+
+  Execution  : ./benchmark [repetitions [scale]]
+*/
+
+#define BENCHMARK_MAX_TREES 1000      /* Ambiguous family would be exponential otherwise */
+
+typedef enum benchmarkFamily {
+  BENCHMARK_FAMILY_AMBIGUOUS = 0,
+  BENCHMARK_FAMILY_LEFT,
+  BENCHMARK_FAMILY_RIGHT,
+  BENCHMARK_FAMILY_SEQUENCE,
+  BENCHMARK_FAMILY_JSON,
+  BENCHMARK_FAMILY_COUNT
+} benchmarkFamily_t;
+
+/* Symbols of all the families: only some of them are used by a given family */
+typedef struct benchmarkGrammar {
+  Marpa_Grammar   g;
+  Marpa_Symbol_ID number;
+  Marpa_Symbol_ID op;
+  Marpa_Symbol_ID item;
+  Marpa_Symbol_ID string;
+  Marpa_Symbol_ID lbrace;
+  Marpa_Symbol_ID rbrace;
+  Marpa_Symbol_ID lbracket;
+  Marpa_Symbol_ID rbracket;
+  Marpa_Symbol_ID colon;
+  Marpa_Symbol_ID comma;
+} benchmarkGrammar_t;
+
+typedef struct benchmarkResult {
+  uint64_t precompute;
+  uint64_t feed;
+  uint64_t bocage;
+  uint64_t order;
+  uint64_t tree;
+  uint64_t valuation;
+  int      nTrees;
+} benchmarkResult_t;
+
+static const char *familyNames[BENCHMARK_FAMILY_COUNT] = { "ambiguous", "left", "right", "sequence", "json" };
+/* Sizes are in tokens, but for the ambiguous family where they are operands */
+static const int   familySizes[BENCHMARK_FAMILY_COUNT][4] = {
+  {     5,    10,     20,     40 },
+  {  1000, 10000, 100000, 500000 },
+  {  1000, 10000, 100000, 500000 },
+  {  1000, 10000, 100000, 500000 },
+  {  1000, 10000, 100000, 500000 }
+};
+
+static void _check          (Marpa_Error_Code errorCode, const char *call, int forcedCondition);
+static void _grammar        (benchmarkFamily_t family, benchmarkGrammar_t *grammarPtr);
+static int  _tokens         (benchmarkFamily_t family, benchmarkGrammar_t *grammarPtr, int size, Marpa_Symbol_ID **tokensPtr);
+static void _run            (benchmarkFamily_t family, int size, int repetitions);
+static int  _stepCallback   (void *userDataPtr, Marpa_Value v, Marpa_Step_Type stepType);
+static void _min            (uint64_t *minPtr, uint64_t value);
+
+struct marpa_error_description_s {
+  Marpa_Error_Code error_code;
+  const char*name;
+  const char*suggested;
+};
+extern const struct marpa_error_description_s marpa_error_description[];
+
+int main(int argc, char **argv) {
+  int               repetitions = (argc > 1) ? atoi(argv[1]) : 3;
+  double            scale       = (argc > 2) ? atof(argv[2]) : 1.0;
+  benchmarkFamily_t family;
+
+  if (repetitions <= 0 || scale <= 0) {
+    fprintf(stderr, "Usage: %s [repetitions [scale]]\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  fprintf(stdout, "family\tsize\ttokens\tprecompute_ns\tfeed_ns\tbocage_ns\torder_ns\ttree_ns\tvaluation_ns\ttrees\ttrees_per_s\tprocess_maxrss_kb\n");
+  fflush(stdout);
+
+  for (family = 0; family < BENCHMARK_FAMILY_COUNT; family++) {
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_LENGTH(familySizes[family]); i++) {
+      int   size = (int) (familySizes[family][i] * ((family == BENCHMARK_FAMILY_AMBIGUOUS) ? 1.0 : scale));
+      pid_t pid;
+      int   status;
+
+      if (size <= 0) {
+	continue;
+      }
+      pid = fork();
+      if (pid < 0) {
+	fprintf(stderr, "fork(): %s\n", strerror(errno));
+	exit(EXIT_FAILURE);
+      }
+      if (pid == 0) {
+	_run(family, size, repetitions);
+	exit(EXIT_SUCCESS);
+      }
+      if (waitpid(pid, &status, 0) < 0 || ! WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+	fprintf(stderr, "%s/%d: failure\n", familyNames[family], size);
+      }
+    }
+  }
+
+  exit(EXIT_SUCCESS);
+}
+
+static void _run(benchmarkFamily_t family, int size, int repetitions) {
+  benchmarkResult_t result;
+  Marpa_Symbol_ID  *tokens  = NULL;
+  int               nTokens = 0;
+  struct rusage     usage;
+  double            treeSeconds;
+  int               repetition;
+
+  result.precompute = result.feed = result.bocage = result.order = result.tree = result.valuation = UINT64_MAX;
+  result.nTrees     = 0;
+
+  for (repetition = 0; repetition < repetitions; repetition++) {
+    benchmarkGrammar_t      grammar;
+    parseEnumeratorOption_t option = PARSEENUMERATOR_OPTION_DEFAULT;
+    parseDriver_t          *parseDriverPtr;
+    Marpa_Recognizer        r;
+    uint64_t                start;
+    int                     nTrees;
+    int                     i;
+
+    option.maxTrees   = BENCHMARK_MAX_TREES;
+    option.metricsPtr = parseMetricsCreate();
+    if (option.metricsPtr == NULL) {
+      fprintf(stderr, "parseMetricsCreate(): %s\n", strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+
+    _grammar(family, &grammar);
+    start = parseMetricsNow();
+    PRECOMPUTE(grammar.g);
+    _min(&result.precompute, parseMetricsNow() - start);
+
+    /* The same input for all repetitions */
+    if (tokens == NULL) {
+      nTokens = _tokens(family, &grammar, size, &tokens);
+    }
+
+    start = parseMetricsNow();
+    CREATE_RECOGNIZER(r, grammar.g);
+    START_INPUT(r, grammar.g);
+    for (i = 0; i < nTokens; i++) {
+      ALTERNATIVE(r, grammar.g, tokens[i], i, 1);
+      EARLEME_COMPLETE(r, grammar.g);
+    }
+    _min(&result.feed, parseMetricsNow() - start);
+
+    parseDriverPtr = parseDriverCreate(grammar.g, &option, &_stepCallback, NULL, NULL);
+    if (parseDriverPtr == NULL) {
+      fprintf(stderr, "parseDriverCreate(): %s\n", strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+    nTrees = parseDriverRun(parseDriverPtr, r);
+    _check(marpa_g_error(grammar.g, NULL), "parseDriverRun()", nTrees < 0);
+    result.nTrees = nTrees;
+
+    _min(&result.bocage,    parseMetricsTotal(option.metricsPtr, PARSEMETRICS_PHASE_BOCAGE));
+    _min(&result.order,     parseMetricsTotal(option.metricsPtr, PARSEMETRICS_PHASE_ORDER));
+    /* tree_ns stays the whole tree phase: marpa_t_new() and every marpa_t_next() */
+    _min(&result.tree,      parseMetricsTotal(option.metricsPtr, PARSEMETRICS_PHASE_TREE_NEW) + parseMetricsTotal(option.metricsPtr, PARSEMETRICS_PHASE_TREE));
+    _min(&result.valuation, parseMetricsTotal(option.metricsPtr, PARSEMETRICS_PHASE_VALUATION));
+
+    parseDriverFree(&parseDriverPtr);
+    parseMetricsFree(&(option.metricsPtr));
+    marpa_r_unref(r);
+    marpa_g_unref(grammar.g);
+  }
+
+  getrusage(RUSAGE_SELF, &usage);
+  treeSeconds = (double) (result.tree + result.valuation) / 1e9;
+
+  fprintf(stdout, "%s\t%d\t%d\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu\t%d\t%.1f\t%ld\n",
+	  familyNames[family],
+	  size,
+	  nTokens,
+	  (unsigned long long) result.precompute,
+	  (unsigned long long) result.feed,
+	  (unsigned long long) result.bocage,
+	  (unsigned long long) result.order,
+	  (unsigned long long) result.tree,
+	  (unsigned long long) result.valuation,
+	  result.nTrees,
+	  (treeSeconds > 0) ? (double) result.nTrees / treeSeconds : 0.0,
+	  (long) usage.ru_maxrss);
+  fflush(stdout);
+
+  free(tokens);
+}
+
+static void _grammar(benchmarkFamily_t family, benchmarkGrammar_t *grammarPtr) {
+  Marpa_Config    c;
+  Marpa_Grammar   g;
+  Marpa_Symbol_ID S;
+  Marpa_Rule_ID   ruleId;
+
+  /* Symbols that the family does not use stay at -1 */
+  grammarPtr->number   = -1;
+  grammarPtr->op       = -1;
+  grammarPtr->item     = -1;
+  grammarPtr->string   = -1;
+  grammarPtr->lbrace   = -1;
+  grammarPtr->rbrace   = -1;
+  grammarPtr->lbracket = -1;
+  grammarPtr->rbracket = -1;
+  grammarPtr->colon    = -1;
+  grammarPtr->comma    = -1;
+
+  INIT_CONFIG(c);
+  CREATE_GRAMMAR(g, c);
+  grammarPtr->g = g;
+
+  CREATE_SYMBOL(S, g);
+  SET_START_SYMBOL(S, g);
+
+  switch (family) {
+  case BENCHMARK_FAMILY_AMBIGUOUS:
+    {
+      Marpa_Symbol_ID E;
+
+      CREATE_SYMBOL(E, g);
+      CREATE_SYMBOL(grammarPtr->op, g);
+      CREATE_SYMBOL(grammarPtr->number, g);
+      {
+	Marpa_Symbol_ID rhs[] = { E };
+	CREATE_RULE(ruleId, g, S, rhs, ARRAY_LENGTH(rhs));
+      }
+      {
+	Marpa_Symbol_ID rhs[] = { E, grammarPtr->op, E };
+	CREATE_RULE(ruleId, g, E, rhs, ARRAY_LENGTH(rhs));
+      }
+      {
+	Marpa_Symbol_ID rhs[] = { grammarPtr->number };
+	CREATE_RULE(ruleId, g, E, rhs, ARRAY_LENGTH(rhs));
+      }
+    }
+    break;
+  case BENCHMARK_FAMILY_LEFT:
+  case BENCHMARK_FAMILY_RIGHT:
+    {
+      Marpa_Symbol_ID list;
+
+      CREATE_SYMBOL(list, g);
+      CREATE_SYMBOL(grammarPtr->item, g);
+      {
+	Marpa_Symbol_ID rhs[] = { list };
+	CREATE_RULE(ruleId, g, S, rhs, ARRAY_LENGTH(rhs));
+      }
+      if (family == BENCHMARK_FAMILY_LEFT) {
+	Marpa_Symbol_ID rhs[] = { list, grammarPtr->item };
+	CREATE_RULE(ruleId, g, list, rhs, ARRAY_LENGTH(rhs));
+      } else {
+	Marpa_Symbol_ID rhs[] = { grammarPtr->item, list };
+	CREATE_RULE(ruleId, g, list, rhs, ARRAY_LENGTH(rhs));
+      }
+      {
+	Marpa_Symbol_ID rhs[] = { grammarPtr->item };
+	CREATE_RULE(ruleId, g, list, rhs, ARRAY_LENGTH(rhs));
+      }
+    }
+    break;
+  case BENCHMARK_FAMILY_SEQUENCE:
+    CREATE_SYMBOL(grammarPtr->item, g);
+    CREATE_SEQUENCE(ruleId, g, S, grammarPtr->item, -1, 1, 0);
+    break;
+  case BENCHMARK_FAMILY_JSON:
+    {
+      Marpa_Symbol_ID value, object, array, members, pair, elements;
+
+      CREATE_SYMBOL(value, g);
+      CREATE_SYMBOL(object, g);
+      CREATE_SYMBOL(array, g);
+      CREATE_SYMBOL(members, g);
+      CREATE_SYMBOL(pair, g);
+      CREATE_SYMBOL(elements, g);
+      CREATE_SYMBOL(grammarPtr->string, g);
+      CREATE_SYMBOL(grammarPtr->number, g);
+      CREATE_SYMBOL(grammarPtr->lbrace, g);
+      CREATE_SYMBOL(grammarPtr->rbrace, g);
+      CREATE_SYMBOL(grammarPtr->lbracket, g);
+      CREATE_SYMBOL(grammarPtr->rbracket, g);
+      CREATE_SYMBOL(grammarPtr->colon, g);
+      CREATE_SYMBOL(grammarPtr->comma, g);
+      {
+	Marpa_Symbol_ID rhs[] = { value };
+	CREATE_RULE(ruleId, g, S, rhs, ARRAY_LENGTH(rhs));
+      }
+      {
+	Marpa_Symbol_ID rhs[] = { object };
+	CREATE_RULE(ruleId, g, value, rhs, ARRAY_LENGTH(rhs));
+      }
+      {
+	Marpa_Symbol_ID rhs[] = { array };
+	CREATE_RULE(ruleId, g, value, rhs, ARRAY_LENGTH(rhs));
+      }
+      {
+	Marpa_Symbol_ID rhs[] = { grammarPtr->string };
+	CREATE_RULE(ruleId, g, value, rhs, ARRAY_LENGTH(rhs));
+      }
+      {
+	Marpa_Symbol_ID rhs[] = { grammarPtr->number };
+	CREATE_RULE(ruleId, g, value, rhs, ARRAY_LENGTH(rhs));
+      }
+      {
+	Marpa_Symbol_ID rhs[] = { grammarPtr->lbrace, members, grammarPtr->rbrace };
+	CREATE_RULE(ruleId, g, object, rhs, ARRAY_LENGTH(rhs));
+      }
+      CREATE_SEQUENCE(ruleId, g, members, pair, grammarPtr->comma, 0, MARPA_PROPER_SEPARATION);
+      {
+	Marpa_Symbol_ID rhs[] = { grammarPtr->string, grammarPtr->colon, value };
+	CREATE_RULE(ruleId, g, pair, rhs, ARRAY_LENGTH(rhs));
+      }
+      {
+	Marpa_Symbol_ID rhs[] = { grammarPtr->lbracket, elements, grammarPtr->rbracket };
+	CREATE_RULE(ruleId, g, array, rhs, ARRAY_LENGTH(rhs));
+      }
+      CREATE_SEQUENCE(ruleId, g, elements, value, grammarPtr->comma, 0, MARPA_PROPER_SEPARATION);
+    }
+    break;
+  default:
+    fprintf(stderr, "Unknown family %d\n", (int) family);
+    exit(EXIT_FAILURE);
+  }
+}
+
+/* Deterministic token stream of about size tokens. Returns the number of tokens */
+static int _tokens(benchmarkFamily_t family, benchmarkGrammar_t *grammarPtr, int size, Marpa_Symbol_ID **tokensPtr) {
+  /* The largest json object below is 17 tokens, plus brackets and commas */
+  Marpa_Symbol_ID *tokens  = malloc((size * 2 + 32) * sizeof(Marpa_Symbol_ID));
+  int              nTokens = 0;
+  int              i;
+
+  if (tokens == NULL) {
+    fprintf(stderr, "malloc() failure\n");
+    exit(EXIT_FAILURE);
+  }
+
+  switch (family) {
+  case BENCHMARK_FAMILY_AMBIGUOUS:
+    for (i = 0; i < size; i++) {
+      if (i > 0) {
+	tokens[nTokens++] = grammarPtr->op;
+      }
+      tokens[nTokens++] = grammarPtr->number;
+    }
+    break;
+  case BENCHMARK_FAMILY_LEFT:
+  case BENCHMARK_FAMILY_RIGHT:
+  case BENCHMARK_FAMILY_SEQUENCE:
+    for (i = 0; i < size; i++) {
+      tokens[nTokens++] = grammarPtr->item;
+    }
+    break;
+  case BENCHMARK_FAMILY_JSON:
+    /* [ {"k":n,"a":[n,n],"o":{"k":"s"}}, ... ] */
+    tokens[nTokens++] = grammarPtr->lbracket;
+    while (nTokens < size) {
+      if (nTokens > 1) {
+	tokens[nTokens++] = grammarPtr->comma;
+      }
+      tokens[nTokens++] = grammarPtr->lbrace;
+      tokens[nTokens++] = grammarPtr->string;
+      tokens[nTokens++] = grammarPtr->colon;
+      tokens[nTokens++] = grammarPtr->number;
+      tokens[nTokens++] = grammarPtr->comma;
+      tokens[nTokens++] = grammarPtr->string;
+      tokens[nTokens++] = grammarPtr->colon;
+      tokens[nTokens++] = grammarPtr->lbracket;
+      tokens[nTokens++] = grammarPtr->number;
+      tokens[nTokens++] = grammarPtr->comma;
+      tokens[nTokens++] = grammarPtr->number;
+      tokens[nTokens++] = grammarPtr->rbracket;
+      tokens[nTokens++] = grammarPtr->comma;
+      tokens[nTokens++] = grammarPtr->string;
+      tokens[nTokens++] = grammarPtr->colon;
+      tokens[nTokens++] = grammarPtr->lbrace;
+      tokens[nTokens++] = grammarPtr->string;
+      tokens[nTokens++] = grammarPtr->colon;
+      tokens[nTokens++] = grammarPtr->string;
+      tokens[nTokens++] = grammarPtr->rbrace;
+      tokens[nTokens++] = grammarPtr->rbrace;
+    }
+    tokens[nTokens++] = grammarPtr->rbracket;
+    break;
+  default:
+    fprintf(stderr, "Unknown family %d\n", (int) family);
+    exit(EXIT_FAILURE);
+  }
+
+  *tokensPtr = tokens;
+  return nTokens;
+}
+
+/* Valuation cost only: no semantics */
+static int _stepCallback(void *userDataPtr, Marpa_Value v, Marpa_Step_Type stepType) {
+  return 0;
+}
+
+static void _min(uint64_t *minPtr, uint64_t value) {
+  if (value < *minPtr) {
+    *minPtr = value;
+  }
+}
+
+static void _check(Marpa_Error_Code errorCode, const char *call, int forcedCondition) {
+  if (forcedCondition != 0 || errorCode != MARPA_ERR_NONE) {
+    const char *function = (call != NULL) ? call : "<unknown>";
+    const char *msg = (errorCode >= 0 && errorCode < MARPA_ERROR_COUNT) ? marpa_error_description[errorCode].name : "Generic error";
+    fprintf(stderr,"%s: %s", function, msg);
+    exit(EXIT_FAILURE);
+  }
+}
@@ -0,0 +1,349 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include "charClassScanner.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CHARCLASSSCANNER_X86
+#include <immintrin.h>
+#endif
+
+#define CHARCLASSSCANNER_BLOCK_SIZE 64
+#define CHARCLASSSCANNER_INIT_SIZE  1024
+
+/* One bit per byte of a block, for each class but PUNCT that is what remains */
+typedef struct charClassMasks {
+  uint64_t digit;
+  uint64_t alpha;
+  uint64_t space;
+  uint64_t other;
+} charClassMasks_t;
+
+typedef void (*charClassMasksCallback_t)(const unsigned char *p, charClassMasks_t *masksPtr);
+
+struct charClassScanner {
+  charClassScannerImplementation_t implementation;
+  charClassMasksCallback_t         masksCallback;   /* Full blocks only */
+  unsigned int                     options;
+  charClassSpan_t                 *spans;
+  size_t                           nSpans;
+  size_t                           allocSize;
+};
+
+static void _charClassMasksScalar(const unsigned char *p, size_t n, charClassMasks_t *masksPtr);
+static void _charClassMasksScalarBlock(const unsigned char *p, charClassMasks_t *masksPtr);
+static int  _charClassSpanPush(charClassScanner_t *charClassScannerPtr, size_t offset, size_t length, charClass_t charClass);
+#ifdef CHARCLASSSCANNER_X86
+static void _charClassMasksSse2(const unsigned char *p, charClassMasks_t *masksPtr);
+static void _charClassMasksAvx2(const unsigned char *p, charClassMasks_t *masksPtr);
+#endif
+
+charClassScanner_t *charClassScannerCreate(charClassScannerImplementation_t implementation, unsigned int options)
+{
+  charClassScanner_t       *charClassScannerPtr;
+  charClassMasksCallback_t  masksCallback = NULL;
+
+#ifdef CHARCLASSSCANNER_X86
+  __builtin_cpu_init();
+  if (implementation == CHARCLASSSCANNER_IMPLEMENTATION_AUTO) {
+    implementation = __builtin_cpu_supports("avx2") ? CHARCLASSSCANNER_IMPLEMENTATION_AVX2 :
+                     __builtin_cpu_supports("sse2") ? CHARCLASSSCANNER_IMPLEMENTATION_SSE2 :
+                                                      CHARCLASSSCANNER_IMPLEMENTATION_SCALAR;
+  }
+  switch (implementation) {
+  case CHARCLASSSCANNER_IMPLEMENTATION_AVX2:
+    if (__builtin_cpu_supports("avx2")) {
+      masksCallback = &_charClassMasksAvx2;
+    }
+    break;
+  case CHARCLASSSCANNER_IMPLEMENTATION_SSE2:
+    if (__builtin_cpu_supports("sse2")) {
+      masksCallback = &_charClassMasksSse2;
+    }
+    break;
+  default:
+    break;
+  }
+#else
+  if (implementation == CHARCLASSSCANNER_IMPLEMENTATION_AUTO) {
+    implementation = CHARCLASSSCANNER_IMPLEMENTATION_SCALAR;
+  }
+#endif
+  if (implementation == CHARCLASSSCANNER_IMPLEMENTATION_SCALAR) {
+    masksCallback = &_charClassMasksScalarBlock;
+  }
+  if (masksCallback == NULL) {
+    errno = ENOTSUP;
+    return NULL;
+  }
+
+  charClassScannerPtr = malloc(sizeof(charClassScanner_t));
+  if (charClassScannerPtr == NULL) {
+    return NULL;
+  }
+  charClassScannerPtr->spans = malloc(CHARCLASSSCANNER_INIT_SIZE * sizeof(charClassSpan_t));
+  if (charClassScannerPtr->spans == NULL) {
+    free(charClassScannerPtr);
+    return NULL;
+  }
+  charClassScannerPtr->implementation = implementation;
+  charClassScannerPtr->masksCallback  = masksCallback;
+  charClassScannerPtr->options        = options;
+  charClassScannerPtr->nSpans         = 0;
+  charClassScannerPtr->allocSize      = CHARCLASSSCANNER_INIT_SIZE;
+
+  return charClassScannerPtr;
+}
+
+size_t charClassScannerScan(charClassScanner_t *charClassScannerPtr, const char *inputPtr, size_t inputLength)
+{
+  const unsigned char *p           = (const unsigned char *) inputPtr;
+  uint64_t             prevDigit   = 0;
+  uint64_t             prevAlpha   = 0;
+  uint64_t             prevSpace   = 0;
+  uint64_t             prevOther   = 0;
+  size_t               spanOffset  = 0;
+  charClass_t          spanClass   = CHARCLASS_PUNCT;
+  int                  spanIsOpen  = 0;
+  size_t               pos;
+
+  if (charClassScannerPtr == NULL || (inputPtr == NULL && inputLength > 0)) {
+    errno = EINVAL;
+    return (size_t) -1;
+  }
+
+  charClassScannerPtr->nSpans = 0;
+
+  for (pos = 0; pos < inputLength; pos += CHARCLASSSCANNER_BLOCK_SIZE) {
+    size_t           n = inputLength - pos;
+    uint64_t         valid;
+    uint64_t         punct;
+    uint64_t         boundaries;
+    charClassMasks_t masks;
+
+    if (n >= CHARCLASSSCANNER_BLOCK_SIZE) {
+      n     = CHARCLASSSCANNER_BLOCK_SIZE;
+      valid = ~((uint64_t) 0);
+      (*charClassScannerPtr->masksCallback)(p + pos, &masks);
+    } else {
+      valid = (((uint64_t) 1) << n) - 1;
+      _charClassMasksScalar(p + pos, n, &masks);
+    }
+
+    /* A span starts where the class differs from the previous byte, and on every PUNCT byte */
+    punct      = valid & ~(masks.digit | masks.alpha | masks.space | masks.other);
+    boundaries = punct
+      | (masks.digit & ~((masks.digit << 1) | prevDigit))
+      | (masks.alpha & ~((masks.alpha << 1) | prevAlpha))
+      | (masks.space & ~((masks.space << 1) | prevSpace))
+      | (masks.other & ~((masks.other << 1) | prevOther));
+
+    while (boundaries != 0) {
+      int      bit     = __builtin_ctzll(boundaries);
+      uint64_t bitMask = ((uint64_t) 1) << bit;
+
+      if (spanIsOpen) {
+	if (_charClassSpanPush(charClassScannerPtr, spanOffset, pos + bit - spanOffset, spanClass) < 0) {
+	  return (size_t) -1;
+	}
+      }
+      spanIsOpen = 1;
+      spanOffset = pos + bit;
+      spanClass  = (masks.digit & bitMask) ? CHARCLASS_DIGIT :
+                   (masks.alpha & bitMask) ? CHARCLASS_ALPHA :
+                   (masks.space & bitMask) ? CHARCLASS_SPACE :
+                   (masks.other & bitMask) ? CHARCLASS_OTHER :
+                                             CHARCLASS_PUNCT;
+      boundaries &= boundaries - 1;
+    }
+
+    prevDigit = (masks.digit >> (n - 1)) & 1;
+    prevAlpha = (masks.alpha >> (n - 1)) & 1;
+    prevSpace = (masks.space >> (n - 1)) & 1;
+    prevOther = (masks.other >> (n - 1)) & 1;
+  }
+
+  if (spanIsOpen) {
+    if (_charClassSpanPush(charClassScannerPtr, spanOffset, inputLength - spanOffset, spanClass) < 0) {
+      return (size_t) -1;
+    }
+  }
+
+  return charClassScannerPtr->nSpans;
+}
+
+charClassSpan_t *charClassScannerSpans(charClassScanner_t *charClassScannerPtr)
+{
+  return (charClassScannerPtr != NULL) ? charClassScannerPtr->spans : NULL;
+}
+
+charClassScannerImplementation_t charClassScannerImplementation(charClassScanner_t *charClassScannerPtr)
+{
+  return (charClassScannerPtr != NULL) ? charClassScannerPtr->implementation : CHARCLASSSCANNER_IMPLEMENTATION_AUTO;
+}
+
+const char *charClassScannerImplementationName(charClassScannerImplementation_t implementation)
+{
+  switch (implementation) {
+  case CHARCLASSSCANNER_IMPLEMENTATION_SCALAR:
+    return "scalar";
+  case CHARCLASSSCANNER_IMPLEMENTATION_SSE2:
+    return "sse2";
+  case CHARCLASSSCANNER_IMPLEMENTATION_AVX2:
+    return "avx2";
+  default:
+    return "auto";
+  }
+}
+
+void charClassScannerFree(charClassScanner_t **charClassScannerPtrPtr)
+{
+  charClassScanner_t *charClassScannerPtr;
+
+  if (charClassScannerPtrPtr == NULL) {
+    return;
+  }
+  charClassScannerPtr = *charClassScannerPtrPtr;
+  if (charClassScannerPtr == NULL) {
+    return;
+  }
+
+  free(charClassScannerPtr->spans);
+  free(charClassScannerPtr);
+
+  *charClassScannerPtrPtr = NULL;
+  return;
+}
+
+static int _charClassSpanPush(charClassScanner_t *charClassScannerPtr, size_t offset, size_t length, charClass_t charClass)
+{
+  charClassSpan_t *spanPtr;
+
+  if (charClass == CHARCLASS_SPACE && (charClassScannerPtr->options & CHARCLASSSCANNER_OPTION_SKIP_SPACE) == CHARCLASSSCANNER_OPTION_SKIP_SPACE) {
+    return 0;
+  }
+
+  if (charClassScannerPtr->nSpans >= charClassScannerPtr->allocSize) {
+    size_t           allocSize = charClassScannerPtr->allocSize * 2;
+    charClassSpan_t *spans     = realloc(charClassScannerPtr->spans, allocSize * sizeof(charClassSpan_t));
+
+    if (spans == NULL) {
+      return -1;
+    }
+    charClassScannerPtr->spans     = spans;
+    charClassScannerPtr->allocSize = allocSize;
+  }
+
+  spanPtr = &(charClassScannerPtr->spans[charClassScannerPtr->nSpans++]);
+  spanPtr->offset    = offset;
+  spanPtr->length    = length;
+  spanPtr->charClass = charClass;
+
+  return 0;
+}
+
+static void _charClassMasksScalar(const unsigned char *p, size_t n, charClassMasks_t *masksPtr)
+{
+  size_t i;
+
+  masksPtr->digit = 0;
+  masksPtr->alpha = 0;
+  masksPtr->space = 0;
+  masksPtr->other = 0;
+
+  for (i = 0; i < n; i++) {
+    unsigned char c   = p[i];
+    uint64_t      bit = ((uint64_t) 1) << i;
+
+    if (c >= '0' && c <= '9') {
+      masksPtr->digit |= bit;
+    } else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_') {
+      masksPtr->alpha |= bit;
+    } else if (c == ' ' || (c >= '\t' && c <= '\r')) {
+      masksPtr->space |= bit;
+    } else if (c >= 0x80) {
+      masksPtr->other |= bit;
+    }
+  }
+}
+
+static void _charClassMasksScalarBlock(const unsigned char *p, charClassMasks_t *masksPtr)
+{
+  _charClassMasksScalar(p, CHARCLASSSCANNER_BLOCK_SIZE, masksPtr);
+}
+
+#ifdef CHARCLASSSCANNER_X86
+/* Signed byte comparisons are fine: all ranges are ASCII, and bytes >= 0x80 are negative. Nothing beyond SSE2 is needed */
+
+__attribute__((target("sse2")))
+static void _charClassMasksSse2(const unsigned char *p, charClassMasks_t *masksPtr)
+{
+  const __m128i zeroMinus = _mm_set1_epi8('0' - 1);
+  const __m128i ninePlus  = _mm_set1_epi8('9' + 1);
+  const __m128i aMinus    = _mm_set1_epi8('a' - 1);
+  const __m128i zPlus     = _mm_set1_epi8('z' + 1);
+  const __m128i lowerBit  = _mm_set1_epi8(0x20);
+  const __m128i underline = _mm_set1_epi8('_');
+  const __m128i blank     = _mm_set1_epi8(' ');
+  const __m128i tabMinus  = _mm_set1_epi8('\t' - 1);
+  const __m128i crPlus    = _mm_set1_epi8('\r' + 1);
+  int           i;
+
+  masksPtr->digit = 0;
+  masksPtr->alpha = 0;
+  masksPtr->space = 0;
+  masksPtr->other = 0;
+
+  for (i = 0; i < CHARCLASSSCANNER_BLOCK_SIZE; i += 16) {
+    __m128i x     = _mm_loadu_si128((const __m128i *) (p + i));
+    __m128i lower = _mm_or_si128(x, lowerBit);
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(x, zeroMinus), _mm_cmpgt_epi8(ninePlus, x));
+    __m128i alpha = _mm_or_si128(_mm_and_si128(_mm_cmpgt_epi8(lower, aMinus), _mm_cmpgt_epi8(zPlus, lower)),
+				 _mm_cmpeq_epi8(x, underline));
+    __m128i space = _mm_or_si128(_mm_cmpeq_epi8(x, blank),
+				 _mm_and_si128(_mm_cmpgt_epi8(x, tabMinus), _mm_cmpgt_epi8(crPlus, x)));
+
+    masksPtr->digit |= ((uint64_t) (uint16_t) _mm_movemask_epi8(digit)) << i;
+    masksPtr->alpha |= ((uint64_t) (uint16_t) _mm_movemask_epi8(alpha)) << i;
+    masksPtr->space |= ((uint64_t) (uint16_t) _mm_movemask_epi8(space)) << i;
+    masksPtr->other |= ((uint64_t) (uint16_t) _mm_movemask_epi8(x))     << i;
+  }
+}
+
+__attribute__((target("avx2")))
+static void _charClassMasksAvx2(const unsigned char *p, charClassMasks_t *masksPtr)
+{
+  const __m256i zeroMinus = _mm256_set1_epi8('0' - 1);
+  const __m256i ninePlus  = _mm256_set1_epi8('9' + 1);
+  const __m256i aMinus    = _mm256_set1_epi8('a' - 1);
+  const __m256i zPlus     = _mm256_set1_epi8('z' + 1);
+  const __m256i lowerBit  = _mm256_set1_epi8(0x20);
+  const __m256i underline = _mm256_set1_epi8('_');
+  const __m256i blank     = _mm256_set1_epi8(' ');
+  const __m256i tabMinus  = _mm256_set1_epi8('\t' - 1);
+  const __m256i crPlus    = _mm256_set1_epi8('\r' + 1);
+  int           i;
+
+  masksPtr->digit = 0;
+  masksPtr->alpha = 0;
+  masksPtr->space = 0;
+  masksPtr->other = 0;
+
+  for (i = 0; i < CHARCLASSSCANNER_BLOCK_SIZE; i += 32) {
+    __m256i x     = _mm256_loadu_si256((const __m256i *) (p + i));
+    __m256i lower = _mm256_or_si256(x, lowerBit);
+    __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(x, zeroMinus), _mm256_cmpgt_epi8(ninePlus, x));
+    __m256i alpha = _mm256_or_si256(_mm256_and_si256(_mm256_cmpgt_epi8(lower, aMinus), _mm256_cmpgt_epi8(zPlus, lower)),
+				    _mm256_cmpeq_epi8(x, underline));
+    __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(x, blank),
+				    _mm256_and_si256(_mm256_cmpgt_epi8(x, tabMinus), _mm256_cmpgt_epi8(crPlus, x)));
+
+    masksPtr->digit |= ((uint64_t) (uint32_t) _mm256_movemask_epi8(digit)) << i;
+    masksPtr->alpha |= ((uint64_t) (uint32_t) _mm256_movemask_epi8(alpha)) << i;
+    masksPtr->space |= ((uint64_t) (uint32_t) _mm256_movemask_epi8(space)) << i;
+    masksPtr->other |= ((uint64_t) (uint32_t) _mm256_movemask_epi8(x))     << i;
+  }
+}
+#endif
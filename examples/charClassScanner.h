@@ -0,0 +1,51 @@
+#ifndef CHAR_CLASS_SCANNER_H
+#define CHAR_CLASS_SCANNER_H
+
+#include <stddef.h>
+
+/*
+ * Splits raw text into character class spans, 64 bytes at a time.
+ * Boundaries are at every class change; every PUNCT byte is a span of its own.
+ * Spans are meant to be the candidate lexemes given to the recognizer feed.
+ *
+ * Identifiers mixing letters and digits come out as adjacent ALPHA and DIGIT spans.
+ */
+
+typedef struct charClassScanner charClassScanner_t;
+
+typedef enum charClass {
+  CHARCLASS_DIGIT = 0,    /* [0-9]                         */
+  CHARCLASS_ALPHA,        /* [A-Za-z_]                     */
+  CHARCLASS_SPACE,        /* [ \t\n\v\f\r]                 */
+  CHARCLASS_PUNCT,        /* Any other ASCII byte          */
+  CHARCLASS_OTHER         /* Bytes >= 0x80                 */
+} charClass_t;
+
+typedef enum charClassScannerImplementation {
+  CHARCLASSSCANNER_IMPLEMENTATION_AUTO = 0, /* Best one supported by the running CPU */
+  CHARCLASSSCANNER_IMPLEMENTATION_SCALAR,
+  CHARCLASSSCANNER_IMPLEMENTATION_SSE2,
+  CHARCLASSSCANNER_IMPLEMENTATION_AVX2
+} charClassScannerImplementation_t;
+
+#define CHARCLASSSCANNER_OPTION_SKIP_SPACE 0x01
+
+#define CHARCLASSSCANNER_OPTION_DEFAULT CHARCLASSSCANNER_OPTION_SKIP_SPACE
+
+typedef struct charClassSpan {
+  size_t      offset;
+  size_t      length;
+  charClass_t charClass;
+} charClassSpan_t;
+
+/* Returns NULL with errno set to ENOTSUP if the implementation is not supported by the running CPU */
+charClassScanner_t *charClassScannerCreate(charClassScannerImplementation_t implementation, unsigned int options);
+
+/* Returns the number of spans, or (size_t)-1 on failure. Spans stay valid until next scan */
+size_t                           charClassScannerScan(charClassScanner_t *charClassScannerPtr, const char *inputPtr, size_t inputLength);
+charClassSpan_t                 *charClassScannerSpans(charClassScanner_t *charClassScannerPtr);
+charClassScannerImplementation_t charClassScannerImplementation(charClassScanner_t *charClassScannerPtr);
+const char                      *charClassScannerImplementationName(charClassScannerImplementation_t implementation);
+void                             charClassScannerFree(charClassScanner_t **charClassScannerPtrPtr);
+
+#endif /* CHAR_CLASS_SCANNER_H */
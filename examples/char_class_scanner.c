@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "thin_macros.h"
+#include "charClassScanner.h"
+
+/*
+  Cross-checks every charClassScanner implementation supported by the
+  running CPU against the scalar one, on all 256 byte values and on
+  random text, then reports their throughput.
+
+  Execution  : ./char_class_scanner [megabytes [iterations]]
+*/
+
+static double _now(void);
+static int    _spansEqual(charClassSpan_t *spans1, size_t nSpans1, charClassSpan_t *spans2, size_t nSpans2);
+
+int main(int argc, char **argv) {
+  static const char *alphabet = "0123456789 +-*/()abcdefghijklmnopqrstuvwxyz_\t\n,;.=\"\xc3\xa9";
+  charClassScannerImplementation_t implementations[] = {
+    CHARCLASSSCANNER_IMPLEMENTATION_SCALAR,
+    CHARCLASSSCANNER_IMPLEMENTATION_SSE2,
+    CHARCLASSSCANNER_IMPLEMENTATION_AVX2
+  };
+  size_t              megabytes      = (argc > 1) ? (size_t) atol(argv[1]) : 64;
+  int                 iterations     = (argc > 2) ? atoi(argv[2]) : 10;
+  size_t              inputLength    = megabytes * 1024 * 1024;
+  size_t              alphabetLength = strlen(alphabet);
+  char               *input;
+  charClassScanner_t *referencePtr;
+  charClassSpan_t    *referenceSpans;
+  size_t              nReferenceSpans;
+  unsigned char       allBytes[512];   /* Every byte value, ascending then descending: full blocks */
+  size_t              i;
+  int                 rc = EXIT_SUCCESS;
+
+  if (inputLength <= 0 || iterations <= 0) {
+    fprintf(stderr, "Usage: %s [megabytes [iterations]]\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  /* Random text, made of runs so that spans have realistic lengths */
+  input = malloc(inputLength);
+  if (input == NULL) {
+    fprintf(stderr, "malloc() failure\n");
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < 256; i++) {
+    allBytes[i]       = (unsigned char) i;
+    allBytes[511 - i] = (unsigned char) i;
+  }
+  srand(42);
+  for (i = 0; i < inputLength; ) {
+    char   c   = alphabet[rand() % alphabetLength];
+    size_t run = 1 + rand() % 8;
+
+    while (run-- > 0 && i < inputLength) {
+      input[i++] = c;
+    }
+  }
+
+  referencePtr = charClassScannerCreate(CHARCLASSSCANNER_IMPLEMENTATION_SCALAR, 0);
+  if (referencePtr == NULL) {
+    fprintf(stderr, "charClassScannerCreate(): %s\n", strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  for (i = 0; i < ARRAY_LENGTH(implementations); i++) {
+    charClassScanner_t *charClassScannerPtr = charClassScannerCreate(implementations[i], 0);
+    const char         *name                = charClassScannerImplementationName(implementations[i]);
+    size_t              nSpans;
+    double              start;
+    double              elapsed;
+    int                 iteration;
+
+    if (charClassScannerPtr == NULL) {
+      fprintf(stderr, "%-8s: %s\n", name, strerror(errno));
+      continue;
+    }
+
+    /* Correctness against the scalar path: the class of every byte value... */
+    nSpans = charClassScannerScan(charClassScannerPtr, (const char *) allBytes, sizeof(allBytes));
+    if (! _spansEqual(charClassScannerSpans(charClassScannerPtr), nSpans, charClassScannerSpans(referencePtr), charClassScannerScan(referencePtr, (const char *) allBytes, sizeof(allBytes)))) {
+      fprintf(stderr, "%-8s: MISMATCH on the 256 byte values\n", name);
+      rc = EXIT_FAILURE;
+    }
+
+    /* ... and text, including all the partial tail lengths */
+    nReferenceSpans = charClassScannerScan(referencePtr, input, inputLength);
+    referenceSpans  = charClassScannerSpans(referencePtr);
+    nSpans          = charClassScannerScan(charClassScannerPtr, input, inputLength);
+    if (! _spansEqual(charClassScannerSpans(charClassScannerPtr), nSpans, referenceSpans, nReferenceSpans)) {
+      fprintf(stderr, "%-8s: MISMATCH on full input (%ld spans instead of %ld)\n", name, (long) nSpans, (long) nReferenceSpans);
+      rc = EXIT_FAILURE;
+    } else {
+      size_t length;
+
+      for (length = 0; length <= 256 && length <= inputLength; length++) {
+	size_t nShortReferenceSpans = charClassScannerScan(referencePtr, input + 1, length);
+	size_t nShortSpans          = charClassScannerScan(charClassScannerPtr, input + 1, length);
+
+	if (! _spansEqual(charClassScannerSpans(charClassScannerPtr), nShortSpans, charClassScannerSpans(referencePtr), nShortReferenceSpans)) {
+	  fprintf(stderr, "%-8s: MISMATCH on unaligned input of length %ld\n", name, (long) length);
+	  rc = EXIT_FAILURE;
+	  break;
+	}
+      }
+    }
+
+    /* Throughput */
+    start = _now();
+    for (iteration = 0; iteration < iterations; iteration++) {
+      charClassScannerScan(charClassScannerPtr, input, inputLength);
+    }
+    elapsed = _now() - start;
+    fprintf(stdout, "%-8s: %ld spans, %.3f GB/s\n",
+	    name,
+	    (long) nSpans,
+	    (elapsed > 0) ? ((double) inputLength * iterations) / elapsed / 1e9 : 0.0);
+
+    charClassScannerFree(&charClassScannerPtr);
+  }
+
+  charClassScannerFree(&referencePtr);
+  free(input);
+
+  exit(rc);
+}
+
+static double _now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static int _spansEqual(charClassSpan_t *spans1, size_t nSpans1, charClassSpan_t *spans2, size_t nSpans2) {
+  size_t i;
+
+  if (nSpans1 != nSpans2) {
+    return 0;
+  }
+  for (i = 0; i < nSpans1; i++) {
+    if (spans1[i].offset    != spans2[i].offset ||
+	spans1[i].length    != spans2[i].length ||
+	spans1[i].charClass != spans2[i].charClass) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
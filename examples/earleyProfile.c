@@ -0,0 +1,246 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "earleyProfile.h"
+
+#define EARLEYPROFILE_INIT_SIZE 1024
+
+struct earleyProfile {
+  Marpa_Grammar         g;
+  Marpa_Recognizer      r;
+  earleyProfileEntry_t *entries;
+  size_t                nEntries;
+  size_t                allocSize;
+  int                   nAlternatives;   /* Since last earleme completion */
+};
+
+static uint64_t _earleyProfileNanoseconds(void);
+static int      _earleyProfileCompare(const void *p1, const void *p2);
+
+earleyProfile_t *earleyProfileCreate(Marpa_Grammar g, Marpa_Recognizer r)
+{
+  earleyProfile_t *earleyProfilePtr;
+
+  if (g == NULL || r == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  earleyProfilePtr = malloc(sizeof(earleyProfile_t));
+  if (earleyProfilePtr == NULL) {
+    return NULL;
+  }
+  earleyProfilePtr->entries = malloc(EARLEYPROFILE_INIT_SIZE * sizeof(earleyProfileEntry_t));
+  if (earleyProfilePtr->entries == NULL) {
+    free(earleyProfilePtr);
+    return NULL;
+  }
+
+  earleyProfilePtr->g             = marpa_g_ref(g);
+  earleyProfilePtr->r             = marpa_r_ref(r);
+  earleyProfilePtr->nEntries      = 0;
+  earleyProfilePtr->allocSize     = EARLEYPROFILE_INIT_SIZE;
+  earleyProfilePtr->nAlternatives = 0;
+
+  return earleyProfilePtr;
+}
+
+int earleyProfileAlternative(earleyProfile_t *earleyProfilePtr, Marpa_Symbol_ID tokenId, int value, int length)
+{
+  int rc = marpa_r_alternative(earleyProfilePtr->r, tokenId, value, length);
+
+  if (rc == MARPA_ERR_NONE) {
+    earleyProfilePtr->nAlternatives++;
+  }
+
+  return rc;
+}
+
+int earleyProfileEarlemeComplete(earleyProfile_t *earleyProfilePtr)
+{
+  uint64_t              start = _earleyProfileNanoseconds();
+  int                   rc    = marpa_r_earleme_complete(earleyProfilePtr->r);
+  uint64_t              end   = _earleyProfileNanoseconds();
+  earleyProfileEntry_t *entryPtr;
+
+  if (rc < 0) {
+    return rc;
+  }
+
+  if (earleyProfilePtr->nEntries >= earleyProfilePtr->allocSize) {
+    size_t                allocSize = earleyProfilePtr->allocSize * 2;
+    earleyProfileEntry_t *entries   = realloc(earleyProfilePtr->entries, allocSize * sizeof(earleyProfileEntry_t));
+
+    if (entries == NULL) {
+      /* Profiling must not break the parse: this earleme is just not recorded */
+      earleyProfilePtr->nAlternatives = 0;
+      return rc;
+    }
+    earleyProfilePtr->entries   = entries;
+    earleyProfilePtr->allocSize = allocSize;
+  }
+
+  entryPtr = &(earleyProfilePtr->entries[earleyProfilePtr->nEntries++]);
+  entryPtr->earleySetId   = marpa_r_latest_earley_set(earleyProfilePtr->r);
+  entryPtr->earleySetSize = _marpa_r_earley_set_size(earleyProfilePtr->r, entryPtr->earleySetId);
+  entryPtr->nAlternatives = earleyProfilePtr->nAlternatives;
+  entryPtr->nEvents       = rc;
+  entryPtr->nanoseconds   = end - start;
+
+  earleyProfilePtr->nAlternatives = 0;
+
+  return rc;
+}
+
+size_t earleyProfileCount(earleyProfile_t *earleyProfilePtr)
+{
+  return (earleyProfilePtr != NULL) ? earleyProfilePtr->nEntries : 0;
+}
+
+earleyProfileEntry_t *earleyProfileEntries(earleyProfile_t *earleyProfilePtr)
+{
+  return (earleyProfilePtr != NULL) ? earleyProfilePtr->entries : NULL;
+}
+
+int earleyProfileWrite(earleyProfile_t *earleyProfilePtr, FILE *fp)
+{
+  size_t i;
+
+  if (earleyProfilePtr == NULL || fp == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  fprintf(fp, "set\tsize\talternatives\tevents\tns\n");
+  for (i = 0; i < earleyProfilePtr->nEntries; i++) {
+    earleyProfileEntry_t *entryPtr = &(earleyProfilePtr->entries[i]);
+
+    fprintf(fp, "%d\t%d\t%d\t%d\t%llu\n",
+	    entryPtr->earleySetId,
+	    entryPtr->earleySetSize,
+	    entryPtr->nAlternatives,
+	    entryPtr->nEvents,
+	    (unsigned long long) entryPtr->nanoseconds);
+  }
+
+  return ferror(fp) ? -1 : 0;
+}
+
+int earleyProfileReport(earleyProfile_t *earleyProfilePtr, FILE *fp, int topN)
+{
+  earleyProfileEntry_t *sorted;
+  int                  *ruleCounts;
+  int                   nRules;
+  uint64_t              totalNanoseconds = 0;
+  size_t                i;
+
+  if (earleyProfilePtr == NULL || fp == NULL || topN <= 0) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  nRules     = marpa_g_highest_rule_id(earleyProfilePtr->g) + 1;
+  sorted     = malloc((earleyProfilePtr->nEntries + 1) * sizeof(earleyProfileEntry_t));
+  ruleCounts = malloc((nRules > 0 ? nRules : 1) * sizeof(int));
+  if (sorted == NULL || ruleCounts == NULL) {
+    free(sorted);
+    free(ruleCounts);
+    return -1;
+  }
+
+  for (i = 0; i < earleyProfilePtr->nEntries; i++) {
+    totalNanoseconds += earleyProfilePtr->entries[i].nanoseconds;
+  }
+  memcpy(sorted, earleyProfilePtr->entries, earleyProfilePtr->nEntries * sizeof(earleyProfileEntry_t));
+  qsort(sorted, earleyProfilePtr->nEntries, sizeof(earleyProfileEntry_t), &_earleyProfileCompare);
+
+  fprintf(fp, "%ld earlemes, %llu ns in marpa_r_earleme_complete()\n", (long) earleyProfilePtr->nEntries, (unsigned long long) totalNanoseconds);
+  for (i = 0; i < earleyProfilePtr->nEntries && i < (size_t) topN; i++) {
+    earleyProfileEntry_t *entryPtr = &(sorted[i]);
+    int                   position;
+    Marpa_Earley_Set_ID   origin;
+    Marpa_Rule_ID         ruleId;
+    int                   n;
+
+    fprintf(fp, "#%ld: set %d, %llu ns, %d Earley items, %d alternatives, %d events\n",
+	    (long) (i + 1),
+	    entryPtr->earleySetId,
+	    (unsigned long long) entryPtr->nanoseconds,
+	    entryPtr->earleySetSize,
+	    entryPtr->nAlternatives,
+	    entryPtr->nEvents);
+
+    /* Rules responsible: the ones with most progress items at this Earley set */
+    memset(ruleCounts, 0, nRules * sizeof(int));
+    if (marpa_r_progress_report_start(earleyProfilePtr->r, entryPtr->earleySetId) < 0) {
+      continue;
+    }
+    while ((ruleId = marpa_r_progress_item(earleyProfilePtr->r, &position, &origin)) >= 0) {
+      if (ruleId < nRules) {
+	ruleCounts[ruleId]++;
+      }
+    }
+    marpa_r_progress_report_finish(earleyProfilePtr->r);
+
+    for (n = 0; n < topN; n++) {
+      Marpa_Rule_ID bestRuleId = -1;
+      Marpa_Rule_ID j;
+
+      for (j = 0; j < nRules; j++) {
+	if (ruleCounts[j] > 0 && (bestRuleId < 0 || ruleCounts[j] > ruleCounts[bestRuleId])) {
+	  bestRuleId = j;
+	}
+      }
+      if (bestRuleId < 0) {
+	break;
+      }
+      fprintf(fp, "    rule %d: %d items\n", bestRuleId, ruleCounts[bestRuleId]);
+      ruleCounts[bestRuleId] = 0;
+    }
+  }
+
+  free(sorted);
+  free(ruleCounts);
+
+  return ferror(fp) ? -1 : 0;
+}
+
+void earleyProfileFree(earleyProfile_t **earleyProfilePtrPtr)
+{
+  earleyProfile_t *earleyProfilePtr;
+
+  if (earleyProfilePtrPtr == NULL) {
+    return;
+  }
+  earleyProfilePtr = *earleyProfilePtrPtr;
+  if (earleyProfilePtr == NULL) {
+    return;
+  }
+
+  marpa_r_unref(earleyProfilePtr->r);
+  marpa_g_unref(earleyProfilePtr->g);
+  free(earleyProfilePtr->entries);
+  free(earleyProfilePtr);
+
+  *earleyProfilePtrPtr = NULL;
+  return;
+}
+
+static uint64_t _earleyProfileNanoseconds(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
+/* Slowest first */
+static int _earleyProfileCompare(const void *p1, const void *p2)
+{
+  const earleyProfileEntry_t *entry1Ptr = (const earleyProfileEntry_t *) p1;
+  const earleyProfileEntry_t *entry2Ptr = (const earleyProfileEntry_t *) p2;
+
+  return (entry1Ptr->nanoseconds < entry2Ptr->nanoseconds) ? 1 : (entry1Ptr->nanoseconds > entry2Ptr->nanoseconds) ? -1 : 0;
+}
@@ -0,0 +1,39 @@
+#ifndef EARLEY_PROFILE_H
+#define EARLEY_PROFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <marpa.h>
+
+/*
+ * Opt-in per-earleme profiling of the recognizer feed: for every completed
+ * earleme, the Earley set size, the number of alternatives, the number of
+ * events, and the time spent in marpa_r_earleme_complete().
+ * See PROFILED_ALTERNATIVE() and PROFILED_EARLEME_COMPLETE() in thin_macros.h.
+ */
+
+typedef struct earleyProfile earleyProfile_t;
+
+typedef struct earleyProfileEntry {
+  Marpa_Earley_Set_ID earleySetId;
+  int                 earleySetSize;
+  int                 nAlternatives;
+  int                 nEvents;
+  uint64_t            nanoseconds;
+} earleyProfileEntry_t;
+
+earleyProfile_t      *earleyProfileCreate(Marpa_Grammar g, Marpa_Recognizer r);
+
+/* Same return values as marpa_r_alternative() and marpa_r_earleme_complete() */
+int                   earleyProfileAlternative(earleyProfile_t *earleyProfilePtr, Marpa_Symbol_ID tokenId, int value, int length);
+int                   earleyProfileEarlemeComplete(earleyProfile_t *earleyProfilePtr);
+
+size_t                earleyProfileCount(earleyProfile_t *earleyProfilePtr);
+earleyProfileEntry_t *earleyProfileEntries(earleyProfile_t *earleyProfilePtr);
+/* One tab separated line per earleme, preceded by a header line */
+int                   earleyProfileWrite(earleyProfile_t *earleyProfilePtr, FILE *fp);
+/* The topN slowest earlemes, each with the topN rules having most Earley items there */
+int                   earleyProfileReport(earleyProfile_t *earleyProfilePtr, FILE *fp, int topN);
+void                  earleyProfileFree(earleyProfile_t **earleyProfilePtrPtr);
+
+#endif /* EARLEY_PROFILE_H */
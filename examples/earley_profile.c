@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <marpa.h>
+#include "thin_macros.h"
+#include "earleyProfile.h"
+
+/*
+  Per-earleme profile of the recognition of 1+1+...+1 with the
+  ambiguous_grammar.c grammar. The profile goes to stdout, the
+  report of the hot positions to stderr.
+
+  :start ::= S
+  S ::= E
+  E ::= E op E
+  E ::= number
+
+  Execution  : ./earley_profile [operands [topN]]
+*/
+
+static void _check        (Marpa_Error_Code errorCode, const char *call, int forcedCondition);
+
+struct marpa_error_description_s {
+  Marpa_Error_Code error_code;
+  const char*name;
+  const char*suggested;
+};
+extern const struct marpa_error_description_s marpa_error_description[];
+
+int main(int argc, char **argv) {
+  Marpa_Config     c;
+  Marpa_Grammar    g;
+  Marpa_Symbol_ID  S, E, op, number;
+  Marpa_Rule_ID    start_rule_id, op_rule_id, number_rule_id;
+  Marpa_Recognizer r;
+  earleyProfile_t *earleyProfilePtr;
+  int              nOperands = (argc > 1) ? atoi(argv[1]) : 100;
+  int              topN      = (argc > 2) ? atoi(argv[2]) : 5;
+  int              i;
+
+  if (nOperands <= 0 || topN <= 0) {
+    fprintf(stderr, "Usage: %s [operands [topN]]\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  INIT_CONFIG(c);
+  CREATE_GRAMMAR(g, c);
+
+  CREATE_SYMBOL(S, g);
+  CREATE_SYMBOL(E, g);
+  CREATE_SYMBOL(op, g);
+  CREATE_SYMBOL(number, g);
+
+  SET_START_SYMBOL(S, g);
+
+  {
+    Marpa_Symbol_ID rhs[] = { E };
+    CREATE_RULE(start_rule_id,  g, S, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { E, op, E };
+    CREATE_RULE(op_rule_id,     g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { number };
+    CREATE_RULE(number_rule_id, g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+
+  PRECOMPUTE(g);
+  CREATE_RECOGNIZER(r, g);
+  START_INPUT(r, g);
+
+  earleyProfilePtr = earleyProfileCreate(g, r);
+  if (earleyProfilePtr == NULL) {
+    fprintf(stderr, "earleyProfileCreate(): %s\n", strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  for (i = 0; i < nOperands; i++) {
+    if (i > 0) {
+      PROFILED_ALTERNATIVE(earleyProfilePtr, r, g, op, '+', 1);
+      PROFILED_EARLEME_COMPLETE(earleyProfilePtr, r, g);
+    }
+    PROFILED_ALTERNATIVE(earleyProfilePtr, r, g, number, 1, 1);
+    PROFILED_EARLEME_COMPLETE(earleyProfilePtr, r, g);
+  }
+
+  earleyProfileWrite(earleyProfilePtr, stdout);
+  earleyProfileReport(earleyProfilePtr, stderr, topN);
+  fprintf(stderr, "Rules: start=%d, op=%d, number=%d\n", start_rule_id, op_rule_id, number_rule_id);
+
+  earleyProfileFree(&earleyProfilePtr);
+  marpa_r_unref(r);
+  marpa_g_unref(g);
+
+  exit(EXIT_SUCCESS);
+}
+
+static void _check(Marpa_Error_Code errorCode, const char *call, int forcedCondition) {
+  if (forcedCondition != 0 || errorCode != MARPA_ERR_NONE) {
+    const char *function = (call != NULL) ? call : "<unknown>";
+    const char *msg = (errorCode >= 0 && errorCode < MARPA_ERROR_COUNT) ? marpa_error_description[errorCode].name : "Generic error";
+    fprintf(stderr,"%s: %s", function, msg);
+    exit(EXIT_FAILURE);
+  }
+}
@@ -0,0 +1,284 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "earlySemantics.h"
+
+struct earlySemantics {
+  Marpa_Grammar                 g;
+  parseDriver_t                *parseDriverPtr;
+  earlySemanticsEventCallback_t eventCallback;
+  void                         *userDataPtr;
+  Marpa_Recognizer              r;
+  Marpa_Earleme                 origin;
+  char                         *isItemSymbol;   /* Indexed by symbol id */
+  char                         *isStartRule;    /* Indexed by rule id */
+  int                           nRules;
+  earlySemanticsStatistics_t    statistics;
+};
+
+static int _earlySemanticsStart(earlySemantics_t *earlySemanticsPtr);
+static int _earlySemanticsEvents(earlySemantics_t *earlySemanticsPtr, int *itemCompletedPtr);
+static int _earlySemanticsBoundary(earlySemantics_t *earlySemanticsPtr, Marpa_Earley_Set_ID earleySetId);
+
+earlySemantics_t *earlySemanticsCreate(Marpa_Grammar g, earlySemanticsOption_t *optionPtr, parseDriver_t *parseDriverPtr, earlySemanticsEventCallback_t eventCallbackPtr, void *userDataPtr)
+{
+  earlySemantics_t *earlySemanticsPtr;
+  Marpa_Symbol_ID   startSymbolId;
+  int               highestSymbolId;
+  int               highestRuleId;
+  int               i;
+
+  if (g == NULL || optionPtr == NULL || optionPtr->nItemSymbols <= 0 || optionPtr->itemSymbols == NULL ||
+      (optionPtr->nPredictionSymbols > 0 && optionPtr->predictionSymbols == NULL) ||
+      parseDriverPtr == NULL || marpa_g_is_precomputed(g) != 0) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  startSymbolId   = marpa_g_start_symbol(g);
+  highestSymbolId = marpa_g_highest_symbol_id(g);
+  highestRuleId   = marpa_g_highest_rule_id(g);
+  if (startSymbolId < 0 || highestSymbolId < 0 || highestRuleId < 0) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  earlySemanticsPtr = malloc(sizeof(earlySemantics_t));
+  if (earlySemanticsPtr == NULL) {
+    return NULL;
+  }
+  earlySemanticsPtr->isItemSymbol = calloc(highestSymbolId + 1, sizeof(char));
+  earlySemanticsPtr->isStartRule  = calloc(highestRuleId + 1, sizeof(char));
+  if (earlySemanticsPtr->isItemSymbol == NULL || earlySemanticsPtr->isStartRule == NULL) {
+    goto err;
+  }
+
+  /* Events must be set before precomputation */
+  for (i = 0; i < optionPtr->nItemSymbols; i++) {
+    Marpa_Symbol_ID symbolId = optionPtr->itemSymbols[i];
+
+    if (symbolId < 0 || symbolId > highestSymbolId || marpa_g_symbol_is_completion_event_set(g, symbolId, 1) < 0) {
+      errno = EINVAL;
+      goto err;
+    }
+    earlySemanticsPtr->isItemSymbol[symbolId] = 1;
+  }
+  for (i = 0; i < optionPtr->nPredictionSymbols; i++) {
+    if (marpa_g_symbol_is_prediction_event_set(g, optionPtr->predictionSymbols[i], 1) < 0) {
+      errno = EINVAL;
+      goto err;
+    }
+  }
+  for (i = 0; i <= highestRuleId; i++) {
+    earlySemanticsPtr->isStartRule[i] = (marpa_g_rule_lhs(g, i) == startSymbolId) ? 1 : 0;
+  }
+  if (marpa_g_precompute(g) < 0) {
+    goto err;
+  }
+
+  earlySemanticsPtr->g                       = marpa_g_ref(g);
+  earlySemanticsPtr->parseDriverPtr          = parseDriverPtr;
+  earlySemanticsPtr->eventCallback           = eventCallbackPtr;
+  earlySemanticsPtr->userDataPtr             = userDataPtr;
+  earlySemanticsPtr->r                       = NULL;
+  earlySemanticsPtr->origin                  = 0;
+  earlySemanticsPtr->nRules                  = highestRuleId + 1;
+  earlySemanticsPtr->statistics.nBoundaries  = 0;
+  earlySemanticsPtr->statistics.nUnambiguous = 0;
+  earlySemanticsPtr->statistics.nRecognizers = 0;
+
+  if (_earlySemanticsStart(earlySemanticsPtr) < 0) {
+    earlySemanticsFree(&earlySemanticsPtr);
+    return NULL;
+  }
+  /* Predictions at the start of the input */
+  if (_earlySemanticsEvents(earlySemanticsPtr, NULL) < 0) {
+    earlySemanticsFree(&earlySemanticsPtr);
+    return NULL;
+  }
+
+  return earlySemanticsPtr;
+
+ err:
+  free(earlySemanticsPtr->isItemSymbol);
+  free(earlySemanticsPtr->isStartRule);
+  free(earlySemanticsPtr);
+  return NULL;
+}
+
+int earlySemanticsAlternative(earlySemantics_t *earlySemanticsPtr, Marpa_Symbol_ID symbolId, int value, int length)
+{
+  if (earlySemanticsPtr == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  return marpa_r_alternative(earlySemanticsPtr->r, symbolId, value, length);
+}
+
+int earlySemanticsEarlemeComplete(earlySemantics_t *earlySemanticsPtr)
+{
+  Marpa_Earley_Set_ID earleySetId;
+  Marpa_Bocage        b;
+  int                 itemCompleted = 0;
+  int                 nTrees;
+
+  if (earlySemanticsPtr == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (marpa_r_earleme_complete(earlySemanticsPtr->r) < 0 || _earlySemanticsEvents(earlySemanticsPtr, &itemCompleted) < 0) {
+    return -1;
+  }
+
+  /* A token ending after the current earleme would be lost by a new recognizer */
+  earleySetId = marpa_r_latest_earley_set(earlySemanticsPtr->r);
+  if (itemCompleted == 0 ||
+      marpa_r_furthest_earleme(earlySemanticsPtr->r) != marpa_r_current_earleme(earlySemanticsPtr->r) ||
+      _earlySemanticsBoundary(earlySemanticsPtr, earleySetId) <= 0) {
+    return 0;
+  }
+
+  /* All the parses of the rest of the input start here: the items so far are final */
+  b = marpa_b_new(earlySemanticsPtr->r, earleySetId);
+  if (b == NULL) {
+    /* The start rules do not complete here */
+    return 0;
+  }
+  earlySemanticsPtr->statistics.nBoundaries++;
+  if (marpa_b_ambiguity_metric(b) == 1) {
+    earlySemanticsPtr->statistics.nUnambiguous++;
+  }
+  nTrees = parseDriverRunBocage(earlySemanticsPtr->parseDriverPtr, b);
+  marpa_b_unref(b);
+  if (nTrees < 0) {
+    return -1;
+  }
+
+  earlySemanticsPtr->origin += marpa_r_current_earleme(earlySemanticsPtr->r);
+  if (_earlySemanticsStart(earlySemanticsPtr) < 0) {
+    return -1;
+  }
+  /* The predictions of the new recognizer were reported by the previous one: its events are not read */
+
+  return nTrees;
+}
+
+int earlySemanticsEnd(earlySemantics_t *earlySemanticsPtr)
+{
+  if (earlySemanticsPtr == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  /* Nothing since the last boundary */
+  if (marpa_r_current_earleme(earlySemanticsPtr->r) == 0 && earlySemanticsPtr->statistics.nBoundaries > 0) {
+    return 0;
+  }
+
+  return parseDriverRun(earlySemanticsPtr->parseDriverPtr, earlySemanticsPtr->r);
+}
+
+Marpa_Earleme earlySemanticsOrigin(earlySemantics_t *earlySemanticsPtr)
+{
+  return (earlySemanticsPtr != NULL) ? earlySemanticsPtr->origin : -1;
+}
+
+Marpa_Recognizer earlySemanticsRecognizer(earlySemantics_t *earlySemanticsPtr)
+{
+  return (earlySemanticsPtr != NULL) ? earlySemanticsPtr->r : NULL;
+}
+
+void earlySemanticsStatistics(earlySemantics_t *earlySemanticsPtr, earlySemanticsStatistics_t *statisticsPtr)
+{
+  if (earlySemanticsPtr != NULL && statisticsPtr != NULL) {
+    *statisticsPtr = earlySemanticsPtr->statistics;
+  }
+}
+
+void earlySemanticsFree(earlySemantics_t **earlySemanticsPtrPtr)
+{
+  earlySemantics_t *earlySemanticsPtr;
+
+  if (earlySemanticsPtrPtr == NULL || *earlySemanticsPtrPtr == NULL) {
+    return;
+  }
+  earlySemanticsPtr = *earlySemanticsPtrPtr;
+
+  if (earlySemanticsPtr->r != NULL) {
+    marpa_r_unref(earlySemanticsPtr->r);
+  }
+  marpa_g_unref(earlySemanticsPtr->g);
+  free(earlySemanticsPtr->isItemSymbol);
+  free(earlySemanticsPtr->isStartRule);
+  free(earlySemanticsPtr);
+
+  *earlySemanticsPtrPtr = NULL;
+}
+
+/* Replaces the current recognizer by a new started one */
+static int _earlySemanticsStart(earlySemantics_t *earlySemanticsPtr)
+{
+  if (earlySemanticsPtr->r != NULL) {
+    marpa_r_unref(earlySemanticsPtr->r);
+  }
+  earlySemanticsPtr->r = marpa_r_new(earlySemanticsPtr->g);
+  if (earlySemanticsPtr->r == NULL) {
+    return -1;
+  }
+  earlySemanticsPtr->statistics.nRecognizers++;
+
+  return (marpa_r_start_input(earlySemanticsPtr->r) < 0) ? -1 : 0;
+}
+
+static int _earlySemanticsEvents(earlySemantics_t *earlySemanticsPtr, int *itemCompletedPtr)
+{
+  Marpa_Earleme earleme = earlySemanticsPtr->origin + marpa_r_current_earleme(earlySemanticsPtr->r);
+  int           nEvents = marpa_g_event_count(earlySemanticsPtr->g);
+  int           i;
+
+  for (i = 0; i < nEvents; i++) {
+    Marpa_Event      event;
+    Marpa_Event_Type eventType = marpa_g_event(earlySemanticsPtr->g, &event, i);
+    Marpa_Symbol_ID  symbolId;
+
+    if (eventType != MARPA_EVENT_SYMBOL_COMPLETED && eventType != MARPA_EVENT_SYMBOL_PREDICTED) {
+      continue;
+    }
+    symbolId = marpa_g_event_value(&event);
+    if (eventType == MARPA_EVENT_SYMBOL_COMPLETED && itemCompletedPtr != NULL && earlySemanticsPtr->isItemSymbol[symbolId] != 0) {
+      *itemCompletedPtr = 1;
+    }
+    if (earlySemanticsPtr->eventCallback != NULL &&
+	(*earlySemanticsPtr->eventCallback)(earlySemanticsPtr->userDataPtr, eventType, symbolId, earleme) < 0) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+/* 1 when no Earley item other than the start rules ones is in progress at this set, 0 if some is, -1 on failure */
+static int _earlySemanticsBoundary(earlySemantics_t *earlySemanticsPtr, Marpa_Earley_Set_ID earleySetId)
+{
+  Marpa_Rule_ID       ruleId;
+  int                 position;
+  Marpa_Earley_Set_ID origin;
+  int                 rc = 1;
+
+  if (marpa_r_progress_report_start(earlySemanticsPtr->r, earleySetId) < 0) {
+    return -1;
+  }
+  /* Position -1 is a completion, position 0 a prediction */
+  while ((ruleId = marpa_r_progress_item(earlySemanticsPtr->r, &position, &origin)) >= 0) {
+    if (position > 0 && origin < earleySetId && (ruleId >= earlySemanticsPtr->nRules || earlySemanticsPtr->isStartRule[ruleId] == 0)) {
+      rc = 0;
+      break;
+    }
+  }
+  marpa_r_progress_report_finish(earlySemanticsPtr->r);
+
+  return rc;
+}
@@ -0,0 +1,57 @@
+#ifndef EARLY_SEMANTICS_H
+#define EARLY_SEMANTICS_H
+
+#include <marpa.h>
+#include "parseDriver.h"
+
+/*
+ * Streaming valuation of a document made of top-level items, e.g.
+ * document ::= item*, as the document start symbol.
+ *
+ * Completion events are enabled on the item symbols. After each earleme,
+ * when an item was completed and no Earley item other than the start
+ * rules ones is in progress, i.e. no item spans the current position,
+ * the items since the last such boundary are valuated right away with
+ * a bocage at the current Earley set, then a new recognizer goes on with
+ * the rest of the input. Unambiguous items skip the parseDriver
+ * enumeration; the work per boundary is proportional to the items it valuates.
+ */
+
+typedef struct earlySemantics earlySemantics_t;
+
+/* Completion and prediction events on the selected symbols, at an absolute earleme. A negative return value aborts */
+typedef int (*earlySemanticsEventCallback_t)(void *userDataPtr, Marpa_Event_Type eventType, Marpa_Symbol_ID symbolId, Marpa_Earleme earleme);
+
+typedef struct earlySemanticsOption {
+  const Marpa_Symbol_ID *itemSymbols;         /* Completion events, valuation triggers */
+  int                    nItemSymbols;
+  const Marpa_Symbol_ID *predictionSymbols;   /* Prediction events, reported only */
+  int                    nPredictionSymbols;
+} earlySemanticsOption_t;
+
+typedef struct earlySemanticsStatistics {
+  unsigned long nBoundaries;   /* Early valuations */
+  unsigned long nUnambiguous;  /* ... of them valuated without enumeration */
+  unsigned long nRecognizers;
+} earlySemanticsStatistics_t;
+
+/*
+ * g must not be precomputed yet: events are set on the selected symbols, then g is precomputed.
+ * parseDriverPtr valuates, the step callback gets Earley set ids relative to earlySemanticsOrigin().
+ */
+earlySemantics_t *earlySemanticsCreate(Marpa_Grammar g, earlySemanticsOption_t *optionPtr, parseDriver_t *parseDriverPtr, earlySemanticsEventCallback_t eventCallbackPtr, void *userDataPtr);
+
+/* marpa_r_alternative() on the current recognizer: MARPA_ERR_NONE, an error code, or -1 if earlySemanticsPtr is NULL */
+int              earlySemanticsAlternative(earlySemantics_t *earlySemanticsPtr, Marpa_Symbol_ID symbolId, int value, int length);
+/* marpa_r_earleme_complete(), events, and valuation at a boundary. Returns the number of trees valuated, or -1 */
+int              earlySemanticsEarlemeComplete(earlySemantics_t *earlySemanticsPtr);
+/* End of input: valuates the pending items. Returns the number of trees valuated, or -1 */
+int              earlySemanticsEnd(earlySemantics_t *earlySemanticsPtr);
+/* Absolute earleme at which the current recognizer started */
+Marpa_Earleme    earlySemanticsOrigin(earlySemantics_t *earlySemanticsPtr);
+/* Current recognizer, e.g. for expected terminals. Valid until next earleme */
+Marpa_Recognizer earlySemanticsRecognizer(earlySemantics_t *earlySemanticsPtr);
+void             earlySemanticsStatistics(earlySemantics_t *earlySemanticsPtr, earlySemanticsStatistics_t *statisticsPtr);
+void             earlySemanticsFree(earlySemantics_t **earlySemanticsPtrPtr);
+
+#endif /* EARLY_SEMANTICS_H */
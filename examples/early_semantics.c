@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <marpa.h>
+#include "thin_macros.h"
+#include "earlySemantics.h"
+
+/*
+  A stream of statements valuated as soon as each one is complete,
+  instead of at end of input. "1+2*3;" is ambiguous: it is valuated early
+  too, with all its trees.
+
+  document ::= statement*
+  statement ::= E semicolon
+  E ::= E op E
+  E ::= number
+
+  Execution  : ./early_semantics [input]
+*/
+
+#define MAX_TOKENS 64
+
+typedef struct s_user {
+  Marpa_Rule_ID     statement_rule_id;
+  Marpa_Rule_ID     op_rule_id;
+  int               values[MAX_TOKENS];
+  const char       *input;
+  earlySemantics_t *earlySemanticsPtr;
+} s_user_t;
+
+static void _check         (Marpa_Error_Code errorCode, const char *call, int forcedCondition);
+static int  _stepCallback  (void *userDataPtr, Marpa_Value v, Marpa_Step_Type stepType);
+static int  _eventCallback (void *userDataPtr, Marpa_Event_Type eventType, Marpa_Symbol_ID symbolId, Marpa_Earleme earleme);
+
+struct marpa_error_description_s {
+  Marpa_Error_Code error_code;
+  const char*name;
+  const char*suggested;
+};
+extern const struct marpa_error_description_s marpa_error_description[];
+
+int main(int argc, char **argv) {
+  Marpa_Config               c;
+  Marpa_Grammar              g;
+  Marpa_Symbol_ID            document, statement, E, op, number, semicolon;
+  Marpa_Rule_ID              document_rule_id, number_rule_id;
+  parseDriver_t             *parseDriverPtr;
+  earlySemanticsOption_t     option;
+  earlySemanticsStatistics_t statistics;
+  s_user_t                   user;
+  const char                *p;
+  int                        nTrees;
+
+  user.input = (argc > 1) ? argv[1] : "1+2;3*4;1+2*3;5;6-1;";
+
+  INIT_CONFIG(c);
+  CREATE_GRAMMAR(g, c);
+
+  CREATE_SYMBOL(document, g);
+  CREATE_SYMBOL(statement, g);
+  CREATE_SYMBOL(E, g);
+  CREATE_SYMBOL(op, g);
+  CREATE_SYMBOL(number, g);
+  CREATE_SYMBOL(semicolon, g);
+
+  SET_START_SYMBOL(document, g);
+
+  CREATE_SEQUENCE(document_rule_id, g, document, statement, -1, 0, 0);
+  {
+    Marpa_Symbol_ID rhs[] = { E, semicolon };
+    CREATE_RULE(user.statement_rule_id, g, statement, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { E, op, E };
+    CREATE_RULE(user.op_rule_id,        g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { number };
+    CREATE_RULE(number_rule_id,         g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+
+  parseDriverPtr = parseDriverCreate(g, NULL, &_stepCallback, NULL, &user);
+  if (parseDriverPtr == NULL) {
+    fprintf(stderr, "parseDriverCreate(): %s\n", strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  /* Statements are the top-level items. This precomputes the grammar */
+  option.itemSymbols        = &statement;
+  option.nItemSymbols       = 1;
+  option.predictionSymbols  = &statement;
+  option.nPredictionSymbols = 1;
+  user.earlySemanticsPtr = earlySemanticsCreate(g, &option, parseDriverPtr, &_eventCallback, &user);
+  _check(marpa_g_error(g, NULL), "earlySemanticsCreate()", user.earlySemanticsPtr == NULL);
+
+  for (p = user.input; *p != '\0'; p++) {
+    Marpa_Symbol_ID symbolId = (*p >= '0' && *p <= '9') ? number : ((*p == ';') ? semicolon : op);
+    int             value    = (symbolId == number) ? *p - '0' : *p;
+
+    _check(earlySemanticsAlternative(user.earlySemanticsPtr, symbolId, value, 1), "earlySemanticsAlternative()", 0);
+    nTrees = earlySemanticsEarlemeComplete(user.earlySemanticsPtr);
+    _check(marpa_g_error(g, NULL), "earlySemanticsEarlemeComplete()", nTrees < 0);
+    if (nTrees > 0) {
+      fprintf(stderr, "... %d tree(s) valuated after reading %ld of %ld characters\n", nTrees, (long) (p - user.input) + 1, (long) strlen(user.input));
+    }
+  }
+  nTrees = earlySemanticsEnd(user.earlySemanticsPtr);
+  _check(marpa_g_error(g, NULL), "earlySemanticsEnd()", nTrees < 0);
+  if (nTrees > 0) {
+    fprintf(stderr, "... %d tree(s) valuated at end of input\n", nTrees);
+  }
+
+  earlySemanticsStatistics(user.earlySemanticsPtr, &statistics);
+  fprintf(stderr, "Early valuations: %lu, unambiguous: %lu, recognizers: %lu\n", statistics.nBoundaries, statistics.nUnambiguous, statistics.nRecognizers);
+
+  earlySemanticsFree(&(user.earlySemanticsPtr));
+  parseDriverFree(&parseDriverPtr);
+  marpa_g_unref(g);
+
+  exit(EXIT_SUCCESS);
+}
+
+static int _stepCallback(void *userDataPtr, Marpa_Value v, Marpa_Step_Type stepType) {
+  s_user_t *userPtr = (s_user_t *) userDataPtr;
+
+  switch (stepType) {
+  case MARPA_STEP_TOKEN:
+    if (marpa_v_result(v) >= MAX_TOKENS) {
+      return -1;
+    }
+    userPtr->values[marpa_v_result(v)] = marpa_v_token_value(v);
+    break;
+  case MARPA_STEP_RULE:
+    if (marpa_v_rule(v) == userPtr->op_rule_id) {
+      int  arg_0 = marpa_v_arg_0(v);
+      int *left  = &(userPtr->values[arg_0]);
+      int  right = userPtr->values[marpa_v_arg_n(v)];
+
+      switch (userPtr->values[arg_0 + 1]) {
+      case '+': *left += right; break;
+      case '-': *left -= right; break;
+      case '*': *left *= right; break;
+      default:
+	return -1;
+      }
+    } else if (marpa_v_rule(v) == userPtr->statement_rule_id) {
+      /* Earley set ids are relative to the recognizer: one character per earleme */
+      Marpa_Earleme origin = earlySemanticsOrigin(userPtr->earlySemanticsPtr);
+      int           start  = origin + marpa_v_rule_start_es_id(v);
+      int           end    = origin + marpa_v_es_id(v);
+
+      fprintf(stderr, "%.*s = %d\n", end - start, userPtr->input + start, userPtr->values[marpa_v_arg_0(v)]);
+    }
+    /* Other rules pass their only value through: it already is at arg_0 */
+    break;
+  default:
+    break;
+  }
+
+  return 0;
+}
+
+static int _eventCallback(void *userDataPtr, Marpa_Event_Type eventType, Marpa_Symbol_ID symbolId, Marpa_Earleme earleme) {
+  fprintf(stderr, "Earleme %d: statement %s\n", earleme, (eventType == MARPA_EVENT_SYMBOL_PREDICTED) ? "predicted" : "completed");
+  return 0;
+}
+
+static void _check(Marpa_Error_Code errorCode, const char *call, int forcedCondition) {
+  if (forcedCondition != 0 || errorCode != MARPA_ERR_NONE) {
+    const char *function = (call != NULL) ? call : "<unknown>";
+    const char *msg = (errorCode >= 0 && errorCode < MARPA_ERROR_COUNT) ? marpa_error_description[errorCode].name : "Generic error";
+    fprintf(stderr,"%s: %s", function, msg);
+    exit(EXIT_FAILURE);
+  }
+}
@@ -0,0 +1,299 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "expectedLexer.h"
+
+#define EXPECTEDLEXER_CACHE_SIZE 16   /* Expected sets remembered, direct mapped */
+
+/* Candidate matchers of an expected set: many Earley sets share the same one */
+typedef struct expectedLexerCacheEntry {
+  int              nExpected;                           /* -1 when empty */
+  Marpa_Symbol_ID *expected;                            /* The key, as marpa_r_terminals_expected() returned it */
+  int              nCandidates;
+  Marpa_Symbol_ID *candidates;
+} expectedLexerCacheEntry_t;
+
+struct expectedLexer {
+  Marpa_Grammar                   g;
+  Marpa_Recognizer                r;
+  void                           *userDataPtr;
+  int                             nSymbols;
+  expectedLexerMatcherCallback_t *matcherCallbacks;     /* Indexed by symbol ID */
+  expectedLexerDiscardCallback_t  discardCallback;
+  Marpa_Symbol_ID                *expectedBuf;          /* marpa_r_terminals_expected() output */
+  /* Candidate matchers for the latest Earley set, from the cache */
+  int                             nCandidates;
+  Marpa_Symbol_ID                *candidates;
+  expectedLexerCacheEntry_t      *cache;
+  Marpa_Symbol_ID                *cacheSymbols;         /* Keys and candidates of all the entries */
+  size_t                          cacheHits;
+  /* Longest matches at current position */
+  int                             nMatches;
+  Marpa_Symbol_ID                *matchSymbols;
+  int                            *matchValues;
+  size_t                          matcherCalls;
+};
+
+static int  _expectedLexerCandidates(expectedLexer_t *expectedLexerPtr);
+static void _expectedLexerCacheClear(expectedLexer_t *expectedLexerPtr);
+
+expectedLexer_t *expectedLexerCreate(Marpa_Grammar g, Marpa_Recognizer r, void *userDataPtr)
+{
+  expectedLexer_t *expectedLexerPtr;
+  int              highestSymbolId;
+  int              i;
+
+  if (g == NULL || r == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  highestSymbolId = marpa_g_highest_symbol_id(g);
+  if (highestSymbolId < 0) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  expectedLexerPtr = malloc(sizeof(expectedLexer_t));
+  if (expectedLexerPtr == NULL) {
+    return NULL;
+  }
+
+  expectedLexerPtr->g                = g;
+  expectedLexerPtr->r                = r;
+  expectedLexerPtr->userDataPtr      = userDataPtr;
+  expectedLexerPtr->nSymbols         = highestSymbolId + 1;
+  expectedLexerPtr->discardCallback  = NULL;
+  expectedLexerPtr->nCandidates      = 0;
+  expectedLexerPtr->candidates       = NULL;
+  expectedLexerPtr->cacheHits        = 0;
+  expectedLexerPtr->nMatches         = 0;
+  expectedLexerPtr->matcherCalls     = 0;
+  expectedLexerPtr->matcherCallbacks = calloc(expectedLexerPtr->nSymbols, sizeof(expectedLexerMatcherCallback_t));
+  expectedLexerPtr->expectedBuf      = malloc(expectedLexerPtr->nSymbols * sizeof(Marpa_Symbol_ID));
+  expectedLexerPtr->cache            = malloc(EXPECTEDLEXER_CACHE_SIZE * sizeof(expectedLexerCacheEntry_t));
+  expectedLexerPtr->cacheSymbols     = malloc(2 * EXPECTEDLEXER_CACHE_SIZE * expectedLexerPtr->nSymbols * sizeof(Marpa_Symbol_ID));
+  expectedLexerPtr->matchSymbols     = malloc(expectedLexerPtr->nSymbols * sizeof(Marpa_Symbol_ID));
+  expectedLexerPtr->matchValues      = malloc(expectedLexerPtr->nSymbols * sizeof(int));
+
+  if (expectedLexerPtr->matcherCallbacks == NULL ||
+      expectedLexerPtr->expectedBuf      == NULL ||
+      expectedLexerPtr->cache            == NULL ||
+      expectedLexerPtr->cacheSymbols     == NULL ||
+      expectedLexerPtr->matchSymbols     == NULL ||
+      expectedLexerPtr->matchValues      == NULL) {
+    free(expectedLexerPtr->matcherCallbacks);
+    free(expectedLexerPtr->expectedBuf);
+    free(expectedLexerPtr->cache);
+    free(expectedLexerPtr->cacheSymbols);
+    free(expectedLexerPtr->matchSymbols);
+    free(expectedLexerPtr->matchValues);
+    free(expectedLexerPtr);
+    errno = ENOMEM;
+    return NULL;
+  }
+  for (i = 0; i < EXPECTEDLEXER_CACHE_SIZE; i++) {
+    expectedLexerPtr->cache[i].expected   = expectedLexerPtr->cacheSymbols + (size_t) (2 * i) * expectedLexerPtr->nSymbols;
+    expectedLexerPtr->cache[i].candidates = expectedLexerPtr->cacheSymbols + (size_t) (2 * i + 1) * expectedLexerPtr->nSymbols;
+  }
+  _expectedLexerCacheClear(expectedLexerPtr);
+
+  marpa_r_ref(r);
+  return expectedLexerPtr;
+}
+
+int expectedLexerMatcherSet(expectedLexer_t *expectedLexerPtr, Marpa_Symbol_ID symbolId, expectedLexerMatcherCallback_t matcherCallbackPtr)
+{
+  if (expectedLexerPtr == NULL || symbolId < 0 || symbolId >= expectedLexerPtr->nSymbols) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  expectedLexerPtr->matcherCallbacks[symbolId] = matcherCallbackPtr;
+  /* Candidates depend on the registered matchers */
+  _expectedLexerCacheClear(expectedLexerPtr);
+
+  return 0;
+}
+
+int expectedLexerDiscardSet(expectedLexer_t *expectedLexerPtr, expectedLexerDiscardCallback_t discardCallbackPtr)
+{
+  if (expectedLexerPtr == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  expectedLexerPtr->discardCallback = discardCallbackPtr;
+
+  return 0;
+}
+
+int expectedLexerRead(expectedLexer_t *expectedLexerPtr, const char *inputPtr, size_t inputLength, size_t *consumedPtr)
+{
+  size_t pos = 0;
+  int    rc  = 0;
+
+  if (expectedLexerPtr == NULL || (inputPtr == NULL && inputLength > 0)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  while (pos < inputLength) {
+    size_t bestLength = 0;
+    int    i;
+
+    if (expectedLexerPtr->discardCallback != NULL) {
+      pos += (*expectedLexerPtr->discardCallback)(expectedLexerPtr->userDataPtr, inputPtr + pos, inputLength - pos);
+      if (pos >= inputLength) {
+	break;
+      }
+    }
+
+    if (marpa_r_is_exhausted(expectedLexerPtr->r)) {
+      rc = -1;
+      break;
+    }
+
+    if (_expectedLexerCandidates(expectedLexerPtr) < 0) {
+      rc = -1;
+      break;
+    }
+
+    /* Try only the expected terminals, and keep all the longest matches */
+    expectedLexerPtr->nMatches = 0;
+    for (i = 0; i < expectedLexerPtr->nCandidates; i++) {
+      Marpa_Symbol_ID symbolId = expectedLexerPtr->candidates[i];
+      int             value    = 0;
+      size_t          length;
+
+      expectedLexerPtr->matcherCalls++;
+      length = (*expectedLexerPtr->matcherCallbacks[symbolId])(expectedLexerPtr->userDataPtr, symbolId, inputPtr + pos, inputLength - pos, &value);
+      if (length <= 0 || length < bestLength) {
+	continue;
+      }
+      if (length > bestLength) {
+	bestLength = length;
+	expectedLexerPtr->nMatches = 0;
+      }
+      expectedLexerPtr->matchSymbols[expectedLexerPtr->nMatches] = symbolId;
+      expectedLexerPtr->matchValues[expectedLexerPtr->nMatches]  = value;
+      expectedLexerPtr->nMatches++;
+    }
+
+    if (bestLength <= 0) {
+      rc = -1;
+      break;
+    }
+
+    for (i = 0; i < expectedLexerPtr->nMatches; i++) {
+      marpa_g_error_clear(expectedLexerPtr->g);
+      if (marpa_r_alternative(expectedLexerPtr->r, expectedLexerPtr->matchSymbols[i], expectedLexerPtr->matchValues[i], 1) != MARPA_ERR_NONE) {
+	rc = -1;
+	break;
+      }
+    }
+    if (rc < 0) {
+      break;
+    }
+
+    marpa_g_error_clear(expectedLexerPtr->g);
+    if (marpa_r_earleme_complete(expectedLexerPtr->r) < 0) {
+      rc = -1;
+      break;
+    }
+
+    pos += bestLength;
+  }
+
+  if (consumedPtr != NULL) {
+    *consumedPtr = pos;
+  }
+
+  return rc;
+}
+
+size_t expectedLexerMatcherCalls(expectedLexer_t *expectedLexerPtr)
+{
+  return (expectedLexerPtr != NULL) ? expectedLexerPtr->matcherCalls : 0;
+}
+
+size_t expectedLexerCacheHits(expectedLexer_t *expectedLexerPtr)
+{
+  return (expectedLexerPtr != NULL) ? expectedLexerPtr->cacheHits : 0;
+}
+
+void expectedLexerFree(expectedLexer_t **expectedLexerPtrPtr)
+{
+  expectedLexer_t *expectedLexerPtr;
+
+  if (expectedLexerPtrPtr == NULL) {
+    return;
+  }
+  expectedLexerPtr = *expectedLexerPtrPtr;
+  if (expectedLexerPtr == NULL) {
+    return;
+  }
+
+  marpa_r_unref(expectedLexerPtr->r);
+
+  free(expectedLexerPtr->matcherCallbacks);
+  free(expectedLexerPtr->expectedBuf);
+  free(expectedLexerPtr->cache);
+  free(expectedLexerPtr->cacheSymbols);
+  free(expectedLexerPtr->matchSymbols);
+  free(expectedLexerPtr->matchValues);
+  free(expectedLexerPtr);
+
+  *expectedLexerPtrPtr = NULL;
+  return;
+}
+
+/* The expected set changes with every Earley set, but takes few distinct values: its candidates are cached by content */
+static int _expectedLexerCandidates(expectedLexer_t *expectedLexerPtr)
+{
+  expectedLexerCacheEntry_t *entryPtr;
+  unsigned int               hash = 0;
+  int                        nExpected;
+  int                        i;
+
+  marpa_g_error_clear(expectedLexerPtr->g);
+  nExpected = marpa_r_terminals_expected(expectedLexerPtr->r, expectedLexerPtr->expectedBuf);
+  if (nExpected < 0) {
+    return -1;
+  }
+
+  /* libmarpa lists the expected terminals by increasing symbol id: the same set is the same array, and another order would only miss */
+  for (i = 0; i < nExpected; i++) {
+    hash = (hash ^ (unsigned int) expectedLexerPtr->expectedBuf[i]) * 16777619U;
+  }
+  entryPtr = &(expectedLexerPtr->cache[(hash ^ (unsigned int) nExpected) % EXPECTEDLEXER_CACHE_SIZE]);
+
+  if (entryPtr->nExpected == nExpected &&
+      memcmp(entryPtr->expected, expectedLexerPtr->expectedBuf, nExpected * sizeof(Marpa_Symbol_ID)) == 0) {
+    expectedLexerPtr->cacheHits++;
+  } else {
+    memcpy(entryPtr->expected, expectedLexerPtr->expectedBuf, nExpected * sizeof(Marpa_Symbol_ID));
+    entryPtr->nExpected   = nExpected;
+    entryPtr->nCandidates = 0;
+    for (i = 0; i < nExpected; i++) {
+      Marpa_Symbol_ID symbolId = expectedLexerPtr->expectedBuf[i];
+      if (expectedLexerPtr->matcherCallbacks[symbolId] != NULL) {
+	entryPtr->candidates[entryPtr->nCandidates++] = symbolId;
+      }
+    }
+  }
+  expectedLexerPtr->nCandidates = entryPtr->nCandidates;
+  expectedLexerPtr->candidates  = entryPtr->candidates;
+
+  return expectedLexerPtr->nCandidates;
+}
+
+static void _expectedLexerCacheClear(expectedLexer_t *expectedLexerPtr)
+{
+  int i;
+
+  for (i = 0; i < EXPECTEDLEXER_CACHE_SIZE; i++) {
+    expectedLexerPtr->cache[i].nExpected = -1;
+  }
+}
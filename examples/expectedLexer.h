@@ -0,0 +1,33 @@
+#ifndef EXPECTED_LEXER_H
+#define EXPECTED_LEXER_H
+
+#include <stddef.h>
+#include <marpa.h>
+
+/*
+ * Lexer driven by marpa_r_terminals_expected(): at every earleme only the
+ * matchers of the terminals the recognizer can accept are tried.
+ * All the longest matches are emitted as alternatives of length 1, then
+ * the earleme is completed. The matchers to try are cached by expected
+ * set: Earley sets that expect the same terminals share them.
+ */
+
+typedef struct expectedLexer expectedLexer_t;
+
+/* Returns the number of bytes matched at inputPtr (0 if none), and sets *valuePtr to the token value */
+typedef size_t (*expectedLexerMatcherCallback_t)(void *userDataPtr, Marpa_Symbol_ID symbolId, const char *inputPtr, size_t inputLength, int *valuePtr);
+/* Returns the number of bytes to skip at inputPtr before next lexeme (0 if none) */
+typedef size_t (*expectedLexerDiscardCallback_t)(void *userDataPtr, const char *inputPtr, size_t inputLength);
+
+expectedLexer_t *expectedLexerCreate(Marpa_Grammar g, Marpa_Recognizer r, void *userDataPtr);
+
+int    expectedLexerMatcherSet(expectedLexer_t *expectedLexerPtr, Marpa_Symbol_ID symbolId, expectedLexerMatcherCallback_t matcherCallbackPtr);
+int    expectedLexerDiscardSet(expectedLexer_t *expectedLexerPtr, expectedLexerDiscardCallback_t discardCallbackPtr);
+/* Returns 0 when all input was consumed, -1 otherwise; *consumedPtr is always set to the stop position */
+int    expectedLexerRead(expectedLexer_t *expectedLexerPtr, const char *inputPtr, size_t inputLength, size_t *consumedPtr);
+size_t expectedLexerMatcherCalls(expectedLexer_t *expectedLexerPtr);
+/* Earley sets whose candidate matchers came from the cache */
+size_t expectedLexerCacheHits(expectedLexer_t *expectedLexerPtr);
+void   expectedLexerFree(expectedLexer_t **expectedLexerPtrPtr);
+
+#endif /* EXPECTED_LEXER_H */
@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <marpa.h>
+#include "thin_macros.h"
+#include "genericStack.h"
+#include "expectedLexer.h"
+
+/*
+  Same grammar as ambiguous_grammar.c, but input is real text lexed
+  with expectedLexer: only the matchers of expected terminals are tried.
+
+  :start ::= S
+  S ::= E
+  E ::= E op E
+  E ::= number
+
+  Execution  : ./expected_lexer [expression]
+*/
+
+static void _check        (Marpa_Error_Code errorCode, const char *call, int forcedCondition);
+static size_t _number     (void *userDataPtr, Marpa_Symbol_ID symbolId, const char *inputPtr, size_t inputLength, int *valuePtr);
+static size_t _op         (void *userDataPtr, Marpa_Symbol_ID symbolId, const char *inputPtr, size_t inputLength, int *valuePtr);
+static size_t _whitespace (void *userDataPtr, const char *inputPtr, size_t inputLength);
+
+struct marpa_error_description_s {
+  Marpa_Error_Code error_code;
+  const char*name;
+  const char*suggested;
+};
+extern const struct marpa_error_description_s marpa_error_description[];
+void stack_failure_callback(const char *file, int line, int errnum, const char *function);
+
+int main(int argc, char **argv) {
+  /* Marpa variables */
+  Marpa_Config        c;
+  Marpa_Grammar       g;
+  Marpa_Symbol_ID     S, E, op, number;
+  Marpa_Rule_ID       start_rule_id, op_rule_id, number_rule_id;
+  Marpa_Recognizer    r;
+  Marpa_Earley_Set_ID latest_earley_set_ID;
+  Marpa_Bocage        b;
+  Marpa_Order         o;
+  Marpa_Tree          t;
+  /* User variables */
+  const char         *input = (argc > 1) ? argv[1] : "2 - 0 * 3 + 1";
+  expectedLexer_t    *expectedLexerPtr;
+  size_t              consumed;
+  int                 nbParses = 0;
+
+  INIT_CONFIG(c);
+  CREATE_GRAMMAR(g, c);
+
+  CREATE_SYMBOL(S, g);
+  CREATE_SYMBOL(E, g);
+  CREATE_SYMBOL(op, g);
+  CREATE_SYMBOL(number, g);
+
+  SET_START_SYMBOL(S, g);
+
+  {
+    Marpa_Symbol_ID rhs[] = { E };
+    CREATE_RULE(start_rule_id,  g, S, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { E, op, E };
+    CREATE_RULE(op_rule_id,     g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { number };
+    CREATE_RULE(number_rule_id, g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+
+  PRECOMPUTE(g);
+  CREATE_RECOGNIZER(r, g);
+  START_INPUT(r, g);
+
+  /* Lex and feed the recognizer */
+  /* --------------------------- */
+  expectedLexerPtr = expectedLexerCreate(g, r, NULL);
+  if (expectedLexerPtr == NULL) {
+    fprintf(stderr, "expectedLexerCreate(): %s\n", strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  expectedLexerMatcherSet(expectedLexerPtr, number, &_number);
+  expectedLexerMatcherSet(expectedLexerPtr, op, &_op);
+  expectedLexerDiscardSet(expectedLexerPtr, &_whitespace);
+
+  if (expectedLexerRead(expectedLexerPtr, input, strlen(input), &consumed) < 0) {
+    fprintf(stderr, "Lexing failure at position %ld: \"%s\"\n", (long) consumed, input + consumed);
+    exit(EXIT_FAILURE);
+  }
+  fprintf(stderr, "%ld bytes lexed with %ld matcher calls, %ld cache hits\n", (long) consumed, (long) expectedLexerMatcherCalls(expectedLexerPtr), (long) expectedLexerCacheHits(expectedLexerPtr));
+  /* The default input alternates two expected sets, { number } and { op }: all its Earley sets but the first two hit */
+  if (argc <= 1 && expectedLexerCacheHits(expectedLexerPtr) != 5) {
+    fprintf(stderr, "Expected 5 cache hits\n");
+    exit(EXIT_FAILURE);
+  }
+  expectedLexerFree(&expectedLexerPtr);
+
+  latest_earley_set_ID = marpa_r_latest_earley_set(r);
+  CREATE_BOCAGE(b, g, r, latest_earley_set_ID);
+  CREATE_ORDER(o, b, g);
+  CREATE_TREE(t, o, g);
+
+  while (marpa_t_next(t) >= 0) {
+    int nextok = 1;
+    Marpa_Value v;
+    genericStack_t *genericStackPtr;
+    int *resultp;
+
+    CREATE_VALUATOR(v, t, g);
+    genericStackPtr = genericStackCreate(sizeof(int),
+					 GENERICSTACK_OPTION_DEFAULT,
+					 &stack_failure_callback,
+					 NULL,
+					 NULL,
+					 NULL);
+
+    marpa_v_rule_is_valued_set(v, op_rule_id, 1);
+    marpa_v_rule_is_valued_set(v, start_rule_id, 1);
+    marpa_v_rule_is_valued_set(v, number_rule_id, 1);
+
+    while (nextok) {
+      Marpa_Step_Type type = marpa_v_step(v);
+      int             new;
+
+      switch (type) {
+      case MARPA_STEP_TOKEN:
+	new = marpa_v_token_value(v);
+	genericStackSet(genericStackPtr, marpa_v_result(v), &new);
+	break;
+      case MARPA_STEP_RULE:
+	{
+	  Marpa_Rule_ID rule_id = marpa_v_rule(v);
+	  int arg_0             = marpa_v_arg_0(v);
+	  int arg_n             = marpa_v_arg_n(v);
+
+	  if (rule_id == op_rule_id) {
+	    int left  = *((int *) genericStackGet(genericStackPtr, arg_0));
+	    int opc   = *((int *) genericStackGet(genericStackPtr, arg_0 + 1));
+	    int right = *((int *) genericStackGet(genericStackPtr, arg_n));
+
+	    switch (opc) {
+	    case '+': new = left + right; break;
+	    case '-': new = left - right; break;
+	    case '*': new = left * right; break;
+	    default:
+	      fprintf(stderr, "Unknown op %c\n", opc);
+	      exit(EXIT_FAILURE);
+	    }
+	    genericStackSet(genericStackPtr, arg_0, &new);
+	  } else {
+	    /* start and number rules: value is passed through */
+	    new = *((int *) genericStackGet(genericStackPtr, arg_0));
+	    genericStackSet(genericStackPtr, arg_0, &new);
+	  }
+	  break;
+	}
+      case MARPA_STEP_INACTIVE:
+	nextok = 0;
+	break;
+      default:
+	fprintf(stderr, "Unexpected type %d\n", type);
+	exit(EXIT_FAILURE);
+      }
+    }
+
+    resultp = genericStackGet(genericStackPtr, 0);
+    if (resultp == NULL) {
+      fprintf(stderr, "No result !?\n");
+    } else {
+      fprintf(stderr, "Parse %d: %s == %d\n", ++nbParses, input, *resultp);
+    }
+    genericStackFree(&genericStackPtr);
+    marpa_v_unref(v);
+  }
+
+  marpa_t_unref(t);
+  marpa_o_unref(o);
+  marpa_b_unref(b);
+  marpa_r_unref(r);
+  marpa_g_unref(g);
+
+  exit(EXIT_SUCCESS);
+}
+
+static size_t _number(void *userDataPtr, Marpa_Symbol_ID symbolId, const char *inputPtr, size_t inputLength, int *valuePtr) {
+  size_t length = 0;
+  int    value  = 0;
+
+  while (length < inputLength && isdigit((unsigned char) inputPtr[length])) {
+    value = value * 10 + (inputPtr[length] - '0');
+    length++;
+  }
+  *valuePtr = value;
+
+  return length;
+}
+
+static size_t _op(void *userDataPtr, Marpa_Symbol_ID symbolId, const char *inputPtr, size_t inputLength, int *valuePtr) {
+  /* strchr() also finds the terminating NUL */
+  if (inputLength > 0 && inputPtr[0] != '\0' && strchr("+-*", inputPtr[0]) != NULL) {
+    *valuePtr = inputPtr[0];
+    return 1;
+  }
+  return 0;
+}
+
+static size_t _whitespace(void *userDataPtr, const char *inputPtr, size_t inputLength) {
+  size_t length = 0;
+
+  while (length < inputLength && isspace((unsigned char) inputPtr[length])) {
+    length++;
+  }
+
+  return length;
+}
+
+static void _check(Marpa_Error_Code errorCode, const char *call, int forcedCondition) {
+  if (forcedCondition != 0 || errorCode != MARPA_ERR_NONE) {
+    const char *function = (call != NULL) ? call : "<unknown>";
+    const char *msg = (errorCode >= 0 && errorCode < MARPA_ERROR_COUNT) ? marpa_error_description[errorCode].name : "Generic error";
+    fprintf(stderr,"%s: %s", function, msg);
+    exit(EXIT_FAILURE);
+  }
+}
+
+void stack_failure_callback(const char *file, int line, int errnum, const char *function) {
+  fprintf(stderr, "%s(%d) : %s in function %s\n", file, line, strerror(errnum), function);
+  exit(EXIT_FAILURE);
+}
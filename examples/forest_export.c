@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <marpa.h>
+#include "thin_macros.h"
+#include "parseForest.h"
+#include "parseCount.h"
+
+/*
+  Exports all the parses of an expression of the ambiguous_grammar.c
+  grammar as one shared forest file, maps the file back, and counts
+  the parses with a single forward pass over its or-nodes.
+
+  :start ::= S
+  S ::= E
+  E ::= E op E
+  E ::= number
+
+  Execution  : ./forest_export [expression [file]]
+*/
+
+static void _check        (Marpa_Error_Code errorCode, const char *call, int forcedCondition);
+
+struct marpa_error_description_s {
+  Marpa_Error_Code error_code;
+  const char*name;
+  const char*suggested;
+};
+extern const struct marpa_error_description_s marpa_error_description[];
+
+int main(int argc, char **argv) {
+  Marpa_Config                c;
+  Marpa_Grammar               g;
+  Marpa_Symbol_ID             S, E, op, number;
+  Marpa_Rule_ID               start_rule_id, op_rule_id, number_rule_id;
+  Marpa_Recognizer            r;
+  Marpa_Bocage                b;
+  const char                 *input = (argc > 1) ? argv[1] : "1+2*3-4+5*6";
+  const char                 *path  = (argc > 2) ? argv[2] : "forest.bin";
+  const char                 *p;
+  parseForest_t              *parseForestPtr;
+  const parseForestHeader_t  *headerPtr;
+  const parseForestOrNode_t  *orNodes;
+  const parseForestAndNode_t *andNodes;
+  uint64_t                   *counts;
+  uint64_t                    nParses;
+  uint32_t                    i;
+  FILE                       *fp;
+
+  INIT_CONFIG(c);
+  CREATE_GRAMMAR(g, c);
+
+  CREATE_SYMBOL(S, g);
+  CREATE_SYMBOL(E, g);
+  CREATE_SYMBOL(op, g);
+  CREATE_SYMBOL(number, g);
+
+  SET_START_SYMBOL(S, g);
+
+  {
+    Marpa_Symbol_ID rhs[] = { E };
+    CREATE_RULE(start_rule_id,  g, S, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { E, op, E };
+    CREATE_RULE(op_rule_id,     g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { number };
+    CREATE_RULE(number_rule_id, g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+
+  PRECOMPUTE(g);
+  CREATE_RECOGNIZER(r, g);
+  START_INPUT(r, g);
+  for (p = input; *p != '\0'; p++) {
+    if (*p >= '0' && *p <= '9') {
+      ALTERNATIVE(r, g, number, *p - '0', 1);
+    } else {
+      ALTERNATIVE(r, g, op, *p, 1);
+    }
+    EARLEME_COMPLETE(r, g);
+  }
+  CREATE_BOCAGE(b, g, r, marpa_r_latest_earley_set(r));
+
+  /* Export */
+  /* ------ */
+  parseForestPtr = parseForestCreate(g, b);
+  _check(marpa_g_error(g, NULL), "parseForestCreate()", parseForestPtr == NULL);
+  fp = fopen(path, "wb");
+  if (fp == NULL || parseForestWrite(parseForestPtr, fp) < 0 || fclose(fp) != 0) {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  parseForestFree(&parseForestPtr);
+  _check(marpa_g_error(g, NULL), "parseCount()", parseCount(g, b, &nParses, NULL, NULL) < 0);
+
+  /* Consumer side: the file only */
+  /* ---------------------------- */
+  parseForestPtr = parseForestMap(path);
+  if (parseForestPtr == NULL) {
+    fprintf(stderr, "parseForestMap(): %s\n", strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  headerPtr = parseForestHeader(parseForestPtr);
+  orNodes   = parseForestOrNodes(parseForestPtr);
+  andNodes  = parseForestAndNodes(parseForestPtr);
+
+  /* Children come first, parseForestMap() checked it: one pass, in file order */
+  counts = malloc((headerPtr->nOrNodes + 1) * sizeof(uint64_t));
+  if (counts == NULL) {
+    fprintf(stderr, "malloc() failure\n");
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < headerPtr->nOrNodes; i++) {
+    uint32_t j;
+
+    counts[i] = 0;
+    for (j = orNodes[i].firstAndNode; j < orNodes[i].firstAndNode + orNodes[i].nAndNodes; j++) {
+      uint64_t predecessorCount = (andNodes[j].predecessor >= 0) ? counts[andNodes[j].predecessor] : 1;
+      uint64_t causeCount       = (andNodes[j].cause >= 0) ? counts[andNodes[j].cause] : 1;
+
+      counts[i] += predecessorCount * causeCount;
+    }
+    if ((orNodes[i].flags & PARSEFOREST_OR_NODE_WHOLE) && orNodes[i].symbolId == E) {
+      fprintf(stdout, "E [%d, %d]: %llu parses\n", orNodes[i].startEarleySetId, orNodes[i].endEarleySetId, (unsigned long long) counts[i]);
+    }
+  }
+
+  fprintf(stderr, "%s: %llu parses in %u or-nodes and %u and-nodes, %ld bytes in %s\n",
+	  input,
+	  (unsigned long long) ((headerPtr->topOrNode >= 0) ? counts[headerPtr->topOrNode] : 1),
+	  headerPtr->nOrNodes,
+	  headerPtr->nAndNodes,
+	  (long) parseForestSize(parseForestPtr),
+	  path);
+  if (headerPtr->topOrNode >= 0 && counts[headerPtr->topOrNode] != nParses) {
+    fprintf(stderr, "MISMATCH with parseCount(): %llu\n", (unsigned long long) nParses);
+    exit(EXIT_FAILURE);
+  }
+
+  free(counts);
+  parseForestFree(&parseForestPtr);
+  marpa_b_unref(b);
+  marpa_r_unref(r);
+  marpa_g_unref(g);
+
+  exit(EXIT_SUCCESS);
+}
+
+static void _check(Marpa_Error_Code errorCode, const char *call, int forcedCondition) {
+  if (forcedCondition != 0 || errorCode != MARPA_ERR_NONE) {
+    const char *function = (call != NULL) ? call : "<unknown>";
+    const char *msg = (errorCode >= 0 && errorCode < MARPA_ERROR_COUNT) ? marpa_error_description[errorCode].name : "Generic error";
+    fprintf(stderr,"%s: %s", function, msg);
+    exit(EXIT_FAILURE);
+  }
+}
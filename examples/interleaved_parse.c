@@ -0,0 +1,278 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <marpa.h>
+#include "thin_macros.h"
+#include "parseTask.h"
+
+/*
+  Many small parses and a few large ones on one thread, with input that
+  arrives in packets. Run to completion one after the other, a short
+  parse waits for every large parse before it. Interleaved round robin
+  by parseTaskResume(), it waits for at most one quantum of each other
+  parse per round.
+
+  :start ::= S
+  S ::= E
+  E ::= E E
+  E ::= a
+
+  Execution  : ./interleaved_parse [quantum]
+*/
+
+#define N_PARSES     1000
+#define SHORT_TOKENS 4
+#define LONG_TOKENS  200
+#define LONG_EVERY   50      /* One parse in LONG_EVERY is long */
+#define PACKET       8       /* Tokens per input packet */
+#define MAX_TREES    4
+
+typedef struct s_parse {
+  Marpa_Symbol_ID  a;
+  int              nTokens;
+  int              nFed;
+  int              nAvailable;     /* Tokens received but not fed */
+  uint64_t         latency;        /* From the start of the run to done */
+  parseTask_t     *parseTaskPtr;
+} s_parse_t;
+
+static void _check        (Marpa_Error_Code errorCode, const char *call, int forcedCondition);
+static int  _feedCallback (void *userDataPtr, Marpa_Recognizer r);
+static int  _stepCallback (void *userDataPtr, Marpa_Value v, Marpa_Step_Type stepType);
+static void _run          (Marpa_Grammar g, s_parse_t *parses, int quantum, int interleaved);
+static void _receive      (s_parse_t *parsePtr);
+static void _report       (const char *description, s_parse_t *parses, uint64_t elapsed);
+static int  _compare      (const void *p1, const void *p2);
+
+struct marpa_error_description_s {
+  Marpa_Error_Code error_code;
+  const char*name;
+  const char*suggested;
+};
+extern const struct marpa_error_description_s marpa_error_description[];
+
+int main(int argc, char **argv) {
+  Marpa_Config     c;
+  Marpa_Grammar    g;
+  Marpa_Symbol_ID  S, E, a;
+  Marpa_Rule_ID    start_rule_id, pair_rule_id, a_rule_id;
+  s_parse_t       *parses;
+  int              quantum = (argc > 1) ? atoi(argv[1]) : 64;
+  int              interleaved;
+  int              i;
+
+  if (quantum <= 0) {
+    fprintf(stderr, "Usage: %s [quantum]\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  INIT_CONFIG(c);
+  CREATE_GRAMMAR(g, c);
+
+  CREATE_SYMBOL(S, g);
+  CREATE_SYMBOL(E, g);
+  CREATE_SYMBOL(a, g);
+
+  SET_START_SYMBOL(S, g);
+
+  {
+    Marpa_Symbol_ID rhs[] = { E };
+    CREATE_RULE(start_rule_id, g, S, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { E, E };
+    CREATE_RULE(pair_rule_id,  g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { a };
+    CREATE_RULE(a_rule_id,     g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+
+  PRECOMPUTE(g);
+
+  parses = malloc(N_PARSES * sizeof(s_parse_t));
+  if (parses == NULL) {
+    fprintf(stderr, "malloc() failure\n");
+    exit(EXIT_FAILURE);
+  }
+
+  for (interleaved = 0; interleaved <= 1; interleaved++) {
+    for (i = 0; i < N_PARSES; i++) {
+      parses[i].a          = a;
+      parses[i].nTokens    = (i % LONG_EVERY == LONG_EVERY - 1) ? LONG_TOKENS : SHORT_TOKENS;
+      parses[i].nFed       = 0;
+      parses[i].nAvailable = 0;
+      parses[i].latency    = 0;
+    }
+    _run(g, parses, quantum, interleaved);
+  }
+
+  free(parses);
+  marpa_g_unref(g);
+
+  exit(EXIT_SUCCESS);
+}
+
+/* Event loop: every round, a packet for each waiting parse, then one resume of each runnable parse */
+static void _run(Marpa_Grammar g, s_parse_t *parses, int quantum, int interleaved) {
+  parseTaskOption_t  option   = PARSETASK_OPTION_DEFAULT;
+  int               *ready    = malloc(2 * N_PARSES * sizeof(int));   /* This round, then the next */
+  int               *waiting  = malloc(N_PARSES * sizeof(int));
+  int                nReady   = 0;
+  int                nWaiting = 0;
+  int                nDone    = 0;
+  uint64_t           start;
+  int                i;
+
+  if (ready == NULL || waiting == NULL) {
+    fprintf(stderr, "malloc() failure\n");
+    exit(EXIT_FAILURE);
+  }
+
+  option.maxTrees = MAX_TREES;
+  start = parseMetricsNow();
+  for (i = 0; i < N_PARSES; i++) {
+    parses[i].parseTaskPtr = parseTaskCreate(g, &option, &_feedCallback, &_stepCallback, NULL, &(parses[i]));
+    if (parses[i].parseTaskPtr == NULL) {
+      fprintf(stderr, "parseTaskCreate(): %s\n", strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+    waiting[nWaiting++] = i;
+  }
+
+  if (! interleaved) {
+    /* Blocking input: each parse keeps the thread until it is done */
+    for (i = 0; i < N_PARSES; i++) {
+      int state;
+
+      while ((state = parseTaskResume(parses[i].parseTaskPtr, quantum)) != PARSETASK_STATE_DONE) {
+	if (state == PARSETASK_STATE_WAITING) {
+	  _receive(&(parses[i]));
+	}
+      }
+      parses[i].latency = parseMetricsNow() - start;
+    }
+    nDone = N_PARSES;
+  }
+
+  while (nDone < N_PARSES) {
+    int nRunning;
+
+    for (i = 0; i < nWaiting; i++) {
+      _receive(&(parses[waiting[i]]));
+      ready[nReady++] = waiting[i];
+    }
+    nWaiting = 0;
+
+    nRunning = nReady;
+    for (i = 0; i < nRunning; i++) {
+      s_parse_t *parsePtr = &(parses[ready[i]]);
+
+      switch (parseTaskResume(parsePtr->parseTaskPtr, quantum)) {
+      case PARSETASK_STATE_RUNNABLE:
+	ready[nReady++] = ready[i];
+	break;
+      case PARSETASK_STATE_WAITING:
+	waiting[nWaiting++] = ready[i];
+	break;
+      case PARSETASK_STATE_DONE:
+	parsePtr->latency = parseMetricsNow() - start;
+	nDone++;
+	break;
+      default:
+	fprintf(stderr, "parseTaskResume(): %s\n", strerror(errno));
+	exit(EXIT_FAILURE);
+      }
+    }
+    memmove(ready, ready + nRunning, (nReady - nRunning) * sizeof(int));
+    nReady -= nRunning;
+  }
+
+  _report(interleaved ? "interleaved" : "one after the other", parses, parseMetricsNow() - start);
+
+  for (i = 0; i < N_PARSES; i++) {
+    parseTaskFree(&(parses[i].parseTaskPtr));
+  }
+  free(ready);
+  free(waiting);
+}
+
+/* Simulated input: the next packet of tokens */
+static void _receive(s_parse_t *parsePtr) {
+  parsePtr->nAvailable = parsePtr->nTokens - parsePtr->nFed;
+  if (parsePtr->nAvailable > PACKET) {
+    parsePtr->nAvailable = PACKET;
+  }
+}
+
+static void _report(const char *description, s_parse_t *parses, uint64_t elapsed) {
+  uint64_t          *latencies = malloc(N_PARSES * sizeof(uint64_t));
+  parseTaskResult_t  result;
+  unsigned long      nResumes = 0;
+  int                nShort   = 0;
+  int                nFailed  = 0;
+  int                i;
+
+  if (latencies == NULL) {
+    fprintf(stderr, "malloc() failure\n");
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < N_PARSES; i++) {
+    parseTaskResult(parses[i].parseTaskPtr, &result);
+    nResumes += result.nResumes;
+    if (result.status != PARSETASK_STATUS_OK) {
+      nFailed++;
+    }
+    if (parses[i].nTokens == SHORT_TOKENS) {
+      latencies[nShort++] = parses[i].latency;
+    }
+  }
+  qsort(latencies, nShort, sizeof(uint64_t), &_compare);
+
+  fprintf(stderr, "%-20s: %.3f s, %lu resumes, %d not ok, short parses done at p50 %.3f ms, p99 %.3f ms\n",
+	  description,
+	  (double) elapsed / 1e9,
+	  nResumes,
+	  nFailed,
+	  (double) latencies[nShort / 2] / 1e6,
+	  (double) latencies[(nShort * 99) / 100] / 1e6);
+
+  free(latencies);
+}
+
+static int _feedCallback(void *userDataPtr, Marpa_Recognizer r) {
+  s_parse_t *parsePtr = (s_parse_t *) userDataPtr;
+
+  if (parsePtr->nFed >= parsePtr->nTokens) {
+    return 0;
+  }
+  if (parsePtr->nAvailable <= 0) {
+    return PARSETASK_FEED_WAIT;
+  }
+  parsePtr->nAvailable--;
+  parsePtr->nFed++;
+
+  return (marpa_r_alternative(r, parsePtr->a, 1, 1) == MARPA_ERR_NONE) ? 1 : -1;
+}
+
+/* Valuation only walks the steps: the point is the scheduling */
+static int _stepCallback(void *userDataPtr, Marpa_Value v, Marpa_Step_Type stepType) {
+  return 0;
+}
+
+static int _compare(const void *p1, const void *p2) {
+  uint64_t l1 = *((const uint64_t *) p1);
+  uint64_t l2 = *((const uint64_t *) p2);
+
+  return (l1 < l2) ? -1 : (l1 > l2) ? 1 : 0;
+}
+
+static void _check(Marpa_Error_Code errorCode, const char *call, int forcedCondition) {
+  if (forcedCondition != 0 || errorCode != MARPA_ERR_NONE) {
+    const char *function = (call != NULL) ? call : "<unknown>";
+    const char *msg = (errorCode >= 0 && errorCode < MARPA_ERROR_COUNT) ? marpa_error_description[errorCode].name : "Generic error";
+    fprintf(stderr,"%s: %s", function, msg);
+    exit(EXIT_FAILURE);
+  }
+}
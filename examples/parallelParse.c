@@ -0,0 +1,260 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "parallelParse.h"
+
+#define PARALLELPARSE_CHUNKS_PER_THREAD 4   /* Load balancing between uneven chunks */
+#define PARALLELPARSE_INIT_SIZE         64
+
+#define PARALLELPARSE_STATUS_PENDING    0   /* Not parsed by a worker */
+#define PARALLELPARSE_STATUS_OK         1
+#define PARALLELPARSE_STATUS_INCOMPLETE 2   /* Ends inside an item: merged with the next chunk */
+#define PARALLELPARSE_STATUS_REJECTED   3
+
+typedef struct parallelParseChunk {
+  size_t offset;
+  size_t length;
+  int    status;
+  size_t errorOffset;                       /* In the input, when rejected */
+  void  *result;
+} parallelParseChunk_t;
+
+typedef struct parallelParseContext {
+  const char               *inputPtr;
+  parallelParseCallbacks_t *callbacksPtr;
+  void                     *userDataPtr;
+  parallelParseChunk_t     *chunks;
+  size_t                    nChunks;
+  size_t                    nextChunk;   /* Shared by the workers */
+} parallelParseContext_t;
+
+static void *_parallelParseWorker(void *contextPtr);
+static int   _parallelParseChunk(parallelParseContext_t *contextPtr, Marpa_Grammar g, size_t offset, size_t length, void **resultPtr, size_t *errorOffsetPtr);
+static void  _parallelParseFree(parallelParseContext_t *contextPtr, void *result);
+
+int parallelParseRun(const char *inputPtr, size_t inputLength, parallelParseOption_t *optionPtr, parallelParseCallbacks_t *callbacksPtr, void *userDataPtr, parallelParseStatistics_t *statisticsPtr)
+{
+  parallelParseOption_t   defaultOption = PARALLELPARSE_OPTION_DEFAULT;
+  parallelParseOption_t   option        = (optionPtr != NULL) ? *optionPtr : defaultOption;
+  parallelParseContext_t  context;
+  pthread_t              *threads       = NULL;
+  int                     nThreads      = 0;
+  size_t                  allocSize     = PARALLELPARSE_INIT_SIZE;
+  size_t                  chunkSize;
+  size_t                  offset;
+  size_t                  nFallbacks    = 0;
+  size_t                  errorOffset   = 0;
+  Marpa_Grammar           g             = NULL;
+  size_t                  i;
+  int                     rc            = -1;
+
+  if ((inputPtr == NULL && inputLength > 0) ||
+      callbacksPtr == NULL ||
+      callbacksPtr->grammarCallback == NULL ||
+      callbacksPtr->boundaryCallback == NULL ||
+      callbacksPtr->feedCallback == NULL ||
+      callbacksPtr->valueCallback == NULL ||
+      callbacksPtr->resultCallback == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (option.nThreads <= 0) {
+    long nCpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    option.nThreads = (nCpus > 0) ? (int) nCpus : 1;
+  }
+  if (option.minChunkSize <= 0) {
+    option.minChunkSize = defaultOption.minChunkSize;
+  }
+
+  context.inputPtr     = inputPtr;
+  context.callbacksPtr = callbacksPtr;
+  context.userDataPtr  = userDataPtr;
+  context.nChunks      = 0;
+  context.nextChunk    = 0;
+  context.chunks       = malloc(allocSize * sizeof(parallelParseChunk_t));
+  if (context.chunks == NULL) {
+    return -1;
+  }
+
+  /* Pre-scan: chunks of about the same size, cut at candidate split points */
+  chunkSize = inputLength / ((size_t) option.nThreads * PARALLELPARSE_CHUNKS_PER_THREAD);
+  if (chunkSize < option.minChunkSize) {
+    chunkSize = option.minChunkSize;
+  }
+  for (offset = 0; offset < inputLength; ) {
+    size_t end = (inputLength - offset > chunkSize) ? (*callbacksPtr->boundaryCallback)(userDataPtr, inputPtr, inputLength, offset + chunkSize) : inputLength;
+
+    if (end <= offset || end > inputLength) {
+      end = inputLength;
+    }
+    if (context.nChunks >= allocSize) {
+      parallelParseChunk_t *chunks = realloc(context.chunks, allocSize * 2 * sizeof(parallelParseChunk_t));
+
+      if (chunks == NULL) {
+	goto done;
+      }
+      context.chunks  = chunks;
+      allocSize      *= 2;
+    }
+    context.chunks[context.nChunks].offset      = offset;
+    context.chunks[context.nChunks].length      = end - offset;
+    context.chunks[context.nChunks].status      = PARALLELPARSE_STATUS_PENDING;
+    context.chunks[context.nChunks].errorOffset = 0;
+    context.chunks[context.nChunks].result      = NULL;
+    context.nChunks++;
+    offset = end;
+  }
+
+  /* Parallel phase. Chunks left pending, e.g. because no thread could start, are parsed below */
+  if (context.nChunks > 1) {
+    int nWanted = (context.nChunks < (size_t) option.nThreads) ? (int) context.nChunks : option.nThreads;
+
+    threads = malloc(nWanted * sizeof(pthread_t));
+    if (threads != NULL) {
+      while (nThreads < nWanted && pthread_create(&(threads[nThreads]), NULL, &_parallelParseWorker, &context) == 0) {
+	nThreads++;
+      }
+    }
+  }
+  for (i = 0; i < (size_t) nThreads; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  /* Stitching, in input order */
+  for (i = 0; i < context.nChunks; ) {
+    parallelParseChunk_t *chunkPtr = &(context.chunks[i]);
+    size_t                j        = i;
+    size_t                length   = chunkPtr->length;
+    void                 *result   = chunkPtr->result;
+    int                   status   = chunkPtr->status;
+    size_t                rejected = chunkPtr->errorOffset;
+
+    chunkPtr->result = NULL;
+    if (status != PARALLELPARSE_STATUS_OK) {
+      if (g == NULL) {
+	g = (*callbacksPtr->grammarCallback)(userDataPtr);
+	if (g == NULL) {
+	  goto done;
+	}
+      }
+      if (status == PARALLELPARSE_STATUS_PENDING) {
+	status = _parallelParseChunk(&context, g, chunkPtr->offset, length, &result, &rejected);
+      }
+      /* Fallback: the split point at the end of chunk j was not a valid one. A rejection is final */
+      while (status == PARALLELPARSE_STATUS_INCOMPLETE && ++j < context.nChunks) {
+	_parallelParseFree(&context, context.chunks[j].result);
+	context.chunks[j].result = NULL;
+	length = context.chunks[j].offset + context.chunks[j].length - chunkPtr->offset;
+	nFallbacks++;
+	status = _parallelParseChunk(&context, g, chunkPtr->offset, length, &result, &rejected);
+      }
+      if (status != PARALLELPARSE_STATUS_OK) {
+	errorOffset = (status == PARALLELPARSE_STATUS_REJECTED) ? rejected : chunkPtr->offset;
+	errno       = EILSEQ;
+	goto done;
+      }
+    }
+    if ((*callbacksPtr->resultCallback)(userDataPtr, chunkPtr->offset, length, result) < 0) {
+      errno = ECANCELED;
+      goto done;
+    }
+    i = j + 1;
+  }
+  rc = 0;
+
+ done:
+  for (i = 0; i < context.nChunks; i++) {
+    _parallelParseFree(&context, context.chunks[i].result);
+  }
+  if (statisticsPtr != NULL) {
+    statisticsPtr->nThreads    = nThreads;
+    statisticsPtr->nChunks     = context.nChunks;
+    statisticsPtr->nFallbacks  = nFallbacks;
+    statisticsPtr->errorOffset = errorOffset;
+  }
+  if (g != NULL) {
+    marpa_g_unref(g);
+  }
+  free(threads);
+  free(context.chunks);
+
+  return rc;
+}
+
+static void *_parallelParseWorker(void *contextPtr)
+{
+  parallelParseContext_t *context = (parallelParseContext_t *) contextPtr;
+  Marpa_Grammar           g       = (*context->callbacksPtr->grammarCallback)(context->userDataPtr);
+  size_t                  i;
+
+  if (g == NULL) {
+    /* Chunks stay pending, for the other workers or the calling thread */
+    return NULL;
+  }
+
+  while ((i = __atomic_fetch_add(&(context->nextChunk), 1, __ATOMIC_RELAXED)) < context->nChunks) {
+    parallelParseChunk_t *chunkPtr = &(context->chunks[i]);
+
+    chunkPtr->status = _parallelParseChunk(context, g, chunkPtr->offset, chunkPtr->length, &(chunkPtr->result), &(chunkPtr->errorOffset));
+  }
+
+  marpa_g_unref(g);
+
+  return NULL;
+}
+
+/* Returns PARALLELPARSE_STATUS_OK if the chunk parses as a whole, else INCOMPLETE, or REJECTED with *errorOffsetPtr set */
+static int _parallelParseChunk(parallelParseContext_t *contextPtr, Marpa_Grammar g, size_t offset, size_t length, void **resultPtr, size_t *errorOffsetPtr)
+{
+  parallelParseCallbacks_t *callbacksPtr = contextPtr->callbacksPtr;
+  const char               *chunkPtr     = contextPtr->inputPtr + offset;
+  Marpa_Recognizer          r;
+  Marpa_Bocage              b;
+  size_t                    error        = 0;
+  int                       rc           = -1;
+
+  *resultPtr = NULL;
+
+  marpa_g_error_clear(g);
+  r = marpa_r_new(g);
+  if (r != NULL && marpa_r_start_input(r) >= 0) {
+    rc = (*callbacksPtr->feedCallback)(contextPtr->userDataPtr, g, r, chunkPtr, length, &error);
+    if (rc >= 0) {
+      /* Every token was accepted: no bocage at the end of the chunk means that its last item is incomplete */
+      b = marpa_b_new(r, marpa_r_latest_earley_set(r));
+      if (b == NULL) {
+	rc = PARALLELPARSE_INCOMPLETE;
+      } else {
+	rc = (*callbacksPtr->valueCallback)(contextPtr->userDataPtr, g, b, chunkPtr, length, resultPtr);
+	marpa_b_unref(b);
+      }
+    }
+  }
+  if (r != NULL) {
+    marpa_r_unref(r);
+  }
+
+  if (rc < 0) {
+    _parallelParseFree(contextPtr, *resultPtr);
+    *resultPtr = NULL;
+    if (rc == PARALLELPARSE_INCOMPLETE) {
+      return PARALLELPARSE_STATUS_INCOMPLETE;
+    }
+    *errorOffsetPtr = offset + ((error < length) ? error : 0);
+    return PARALLELPARSE_STATUS_REJECTED;
+  }
+
+  return PARALLELPARSE_STATUS_OK;
+}
+
+static void _parallelParseFree(parallelParseContext_t *contextPtr, void *result)
+{
+  if (result != NULL && contextPtr->callbacksPtr->freeCallback != NULL) {
+    (*contextPtr->callbacksPtr->freeCallback)(contextPtr->userDataPtr, result);
+  }
+}
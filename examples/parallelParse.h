@@ -0,0 +1,61 @@
+#ifndef PARALLEL_PARSE_H
+#define PARALLEL_PARSE_H
+
+#include <stddef.h>
+#include <marpa.h>
+
+/*
+ * Parallel parsing of a large input made of independent top-level items,
+ * e.g. document ::= item*, with an item never spanning a split point.
+ *
+ * A pre-scan cuts the input into chunks at candidate split points given by
+ * boundaryCallback. Chunks are parsed concurrently, each worker thread with
+ * its own grammar and one recognizer per chunk, so that Earley sets never
+ * hold more than a chunk. Chunk results are delivered in input order.
+ *
+ * A chunk that ends inside an item means that the split point at its end
+ * was not a valid one: the chunk is merged with the next ones and parsed
+ * again, until it parses or the input ends, in which case the input is
+ * invalid. A chunk that is rejected fails the input at once.
+ */
+
+/* Feed or value callback return value: the chunk ends inside an item. Any other negative value rejects the input */
+#define PARALLELPARSE_INCOMPLETE (-2)
+
+typedef struct parallelParseCallbacks {
+  /* Precomputed grammar for a worker thread: libmarpa objects must not be shared between threads */
+  Marpa_Grammar (*grammarCallback)(void *userDataPtr);
+  /* First candidate split point at or after offset, i.e. where an item would start, or inputLength */
+  size_t        (*boundaryCallback)(void *userDataPtr, const char *inputPtr, size_t inputLength, size_t offset);
+  /* Feeds a chunk to a started recognizer. On rejection, sets *errorPtr to the offset of the rejected input in the chunk */
+  int           (*feedCallback)(void *userDataPtr, Marpa_Grammar g, Marpa_Recognizer r, const char *chunkPtr, size_t chunkLength, size_t *errorPtr);
+  /* Valuates the chunk into *resultPtr. A negative return value means the chunk is not parseable */
+  int           (*valueCallback)(void *userDataPtr, Marpa_Grammar g, Marpa_Bocage b, const char *chunkPtr, size_t chunkLength, void **resultPtr);
+  /* In input order, from the calling thread, that now owns result. A negative return value stops */
+  int           (*resultCallback)(void *userDataPtr, size_t offset, size_t length, void *result);
+  /* Optional: releases a result that will not be delivered */
+  void          (*freeCallback)(void *userDataPtr, void *result);
+} parallelParseCallbacks_t;
+
+typedef struct parallelParseOption {
+  int    nThreads;        /* 0 means the number of online CPUs */
+  size_t minChunkSize;    /* In bytes */
+} parallelParseOption_t;
+
+#define PARALLELPARSE_OPTION_DEFAULT { 0, 1024 * 1024 }
+
+typedef struct parallelParseStatistics {
+  int    nThreads;
+  size_t nChunks;         /* After the pre-scan */
+  size_t nFallbacks;      /* Chunks parsed again merged with the next ones */
+  size_t errorOffset;     /* When parallelParseRun() fails: where the input was rejected, or the start of the chunks that end inside an item */
+} parallelParseStatistics_t;
+
+/*
+ * All callbacks but freeCallback are required; all but resultCallback may run concurrently.
+ * Returns 0 on success, -1 on failure: errno is EILSEQ when the input does not parse,
+ * ECANCELED when resultCallback stopped.
+ */
+int parallelParseRun(const char *inputPtr, size_t inputLength, parallelParseOption_t *optionPtr, parallelParseCallbacks_t *callbacksPtr, void *userDataPtr, parallelParseStatistics_t *statisticsPtr);
+
+#endif /* PARALLEL_PARSE_H */
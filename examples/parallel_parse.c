@@ -0,0 +1,328 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <marpa.h>
+#include "thin_macros.h"
+#include "parallelParse.h"
+
+/*
+  Sum of all the numbers of a large generated input, one sum per line,
+  parsed first with one thread, then with all CPUs. Lines may be continued
+  with a backslash: the naive split points given to parallelParseRun() are
+  then wrong, and the fallback merges chunks.
+
+  document ::= line*
+  line ::= sum newline
+  sum ::= sum plus number
+  sum ::= number
+
+  Execution  : ./parallel_parse [megabytes [threads]]
+*/
+
+typedef struct s_grammar {
+  Marpa_Grammar   g;
+  Marpa_Symbol_ID document, line, sum, plus, number, newline;
+  Marpa_Rule_ID   document_rule_id, line_rule_id, sum_rule_id, number_rule_id;
+} s_grammar_t;
+
+typedef struct s_result {
+  long long total;
+  long      nLines;
+} s_result_t;
+
+static void          _check    (Marpa_Error_Code errorCode, const char *call, int forcedCondition);
+static Marpa_Grammar _grammar  (void *userDataPtr);
+static size_t        _boundary (void *userDataPtr, const char *inputPtr, size_t inputLength, size_t offset);
+static int           _feed     (void *userDataPtr, Marpa_Grammar g, Marpa_Recognizer r, const char *chunkPtr, size_t chunkLength, size_t *errorPtr);
+static int           _value    (void *userDataPtr, Marpa_Grammar g, Marpa_Bocage b, const char *chunkPtr, size_t chunkLength, void **resultPtr);
+static int           _result   (void *userDataPtr, size_t offset, size_t length, void *result);
+static void          _free     (void *userDataPtr, void *result);
+static double        _now      (void);
+
+/* Symbol ids are the same in every grammar: they are taken from the first one */
+static s_grammar_t grammar;
+
+struct marpa_error_description_s {
+  Marpa_Error_Code error_code;
+  const char*name;
+  const char*suggested;
+};
+extern const struct marpa_error_description_s marpa_error_description[];
+
+int main(int argc, char **argv) {
+  size_t                    megabytes = (argc > 1) ? (size_t) atol(argv[1]) : 16;
+  int                       nThreads  = (argc > 2) ? atoi(argv[2]) : 0;
+  size_t                    inputLength;
+  size_t                    length    = 0;
+  char                     *input;
+  parallelParseCallbacks_t  callbacks = { &_grammar, &_boundary, &_feed, &_value, &_result, &_free };
+  parallelParseOption_t     option    = PARALLELPARSE_OPTION_DEFAULT;
+  parallelParseStatistics_t statistics;
+  s_result_t                results[2];
+  int                       pass;
+
+  if (megabytes <= 0 || nThreads < 0) {
+    fprintf(stderr, "Usage: %s [megabytes [threads]]\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  inputLength = megabytes * 1024 * 1024;
+  input       = malloc(inputLength + 64);
+  if (input == NULL) {
+    fprintf(stderr, "malloc() failure\n");
+    exit(EXIT_FAILURE);
+  }
+  srand(42);
+  while (length < inputLength) {
+    int nNumbers = 1 + rand() % 8;
+    int i;
+
+    for (i = 0; i < nNumbers; i++) {
+      length += sprintf(input + length, (i > 0) ? "+%d" : "%d", 1 + rand() % 999);
+      if (i < nNumbers - 1 && rand() % 16 == 0) {
+	length += sprintf(input + length, "\\\n");
+      }
+    }
+    input[length++] = '\n';
+  }
+
+  grammar.g = _grammar(NULL);
+
+  for (pass = 0; pass < 2; pass++) {
+    double start;
+
+    option.nThreads   = (pass == 0) ? 1 : nThreads;
+    results[pass].total  = 0;
+    results[pass].nLines = 0;
+    start = _now();
+    if (parallelParseRun(input, length, &option, &callbacks, &(results[pass]), &statistics) < 0) {
+      fprintf(stderr, "parallelParseRun(): %s at offset %ld\n", strerror(errno), (long) statistics.errorOffset);
+      exit(EXIT_FAILURE);
+    }
+    fprintf(stderr, "%2d threads: %ld lines, total %lld, %ld chunks, %ld fallbacks, %.3f s\n",
+	    statistics.nThreads,
+	    results[pass].nLines,
+	    results[pass].total,
+	    (long) statistics.nChunks,
+	    (long) statistics.nFallbacks,
+	    _now() - start);
+  }
+  if (results[0].total != results[1].total || results[0].nLines != results[1].nLines) {
+    fprintf(stderr, "MISMATCH between sequential and parallel results\n");
+    exit(EXIT_FAILURE);
+  }
+
+  marpa_g_unref(grammar.g);
+  free(input);
+
+  exit(EXIT_SUCCESS);
+}
+
+static Marpa_Grammar _grammar(void *userDataPtr) {
+  Marpa_Config c;
+  s_grammar_t  local;
+
+  INIT_CONFIG(c);
+  CREATE_GRAMMAR(local.g, c);
+
+  CREATE_SYMBOL(local.document, local.g);
+  CREATE_SYMBOL(local.line, local.g);
+  CREATE_SYMBOL(local.sum, local.g);
+  CREATE_SYMBOL(local.plus, local.g);
+  CREATE_SYMBOL(local.number, local.g);
+  CREATE_SYMBOL(local.newline, local.g);
+
+  SET_START_SYMBOL(local.document, local.g);
+
+  CREATE_SEQUENCE(local.document_rule_id, local.g, local.document, local.line, -1, 0, 0);
+  {
+    Marpa_Symbol_ID rhs[] = { local.sum, local.newline };
+    CREATE_RULE(local.line_rule_id,   local.g, local.line, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { local.sum, local.plus, local.number };
+    CREATE_RULE(local.sum_rule_id,    local.g, local.sum, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { local.number };
+    CREATE_RULE(local.number_rule_id, local.g, local.sum, rhs, ARRAY_LENGTH(rhs));
+  }
+
+  PRECOMPUTE(local.g);
+
+  if (userDataPtr == NULL) {
+    grammar = local;
+  }
+
+  return local.g;
+}
+
+/* Naive: just after the next newline, continued line or not */
+static size_t _boundary(void *userDataPtr, const char *inputPtr, size_t inputLength, size_t offset) {
+  const char *p = memchr(inputPtr + offset, '\n', inputLength - offset);
+
+  return (p != NULL) ? (size_t) (p - inputPtr) + 1 : inputLength;
+}
+
+static int _feed(void *userDataPtr, Marpa_Grammar g, Marpa_Recognizer r, const char *chunkPtr, size_t chunkLength, size_t *errorPtr) {
+  size_t i = 0;
+
+  while (i < chunkLength) {
+    Marpa_Symbol_ID symbolId;
+    int             value;
+
+    *errorPtr = i;
+    if (chunkPtr[i] >= '0' && chunkPtr[i] <= '9') {
+      symbolId = grammar.number;
+      value    = 0;
+      while (i < chunkLength && chunkPtr[i] >= '0' && chunkPtr[i] <= '9') {
+	value = value * 10 + (chunkPtr[i++] - '0');
+      }
+    } else if (chunkPtr[i] == '+') {
+      symbolId = grammar.plus;
+      value    = '+';
+      i++;
+    } else if (chunkPtr[i] == '\n') {
+      symbolId = grammar.newline;
+      value    = '\n';
+      i++;
+    } else if (chunkPtr[i] == '\\' && i + 1 < chunkLength && chunkPtr[i + 1] == '\n') {
+      /* Line continuation */
+      i += 2;
+      continue;
+    } else if (chunkPtr[i] == '\\' && i + 1 == chunkLength) {
+      /* Cut inside a line continuation */
+      return PARALLELPARSE_INCOMPLETE;
+    } else {
+      return -1;
+    }
+    if (marpa_r_alternative(r, symbolId, value, 1) != MARPA_ERR_NONE || marpa_r_earleme_complete(r) < 0) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+static int _value(void *userDataPtr, Marpa_Grammar g, Marpa_Bocage b, const char *chunkPtr, size_t chunkLength, void **resultPtr) {
+  Marpa_Order  o;
+  Marpa_Tree   t;
+  Marpa_Value  v;
+  long long   *stack     = NULL;
+  int          stackSize = 0;
+  s_result_t  *resultp   = NULL;
+  int          rc        = -1;
+
+  o = marpa_o_new(b);
+  if (o == NULL) {
+    return -1;
+  }
+  t = marpa_t_new(o);
+  if (t == NULL || marpa_t_next(t) < 0 || (v = marpa_v_new(t)) == NULL) {
+    goto tree_done;
+  }
+  marpa_v_valued_force(v);
+
+  while (1) {
+    Marpa_Step_Type stepType = marpa_v_step(v);
+    int             top;
+
+    if (stepType == MARPA_STEP_INACTIVE || stepType < 0) {
+      rc = (stepType == MARPA_STEP_INACTIVE) ? 0 : -1;
+      break;
+    }
+    top = (stepType == MARPA_STEP_RULE) ? marpa_v_arg_n(v) : marpa_v_result(v);
+    if (top >= stackSize) {
+      int        newSize  = (top + 1) * 2;
+      long long *newStack = realloc(stack, newSize * sizeof(long long));
+
+      if (newStack == NULL) {
+	break;
+      }
+      stack     = newStack;
+      stackSize = newSize;
+    }
+
+    switch (stepType) {
+    case MARPA_STEP_TOKEN:
+      stack[marpa_v_result(v)] = marpa_v_token_value(v);
+      break;
+    case MARPA_STEP_RULE:
+      if (marpa_v_rule(v) == grammar.sum_rule_id) {
+	stack[marpa_v_result(v)] = stack[marpa_v_arg_0(v)] + stack[marpa_v_arg_n(v)];
+      } else if (marpa_v_rule(v) == grammar.document_rule_id) {
+	long long total = 0;
+	int       i;
+
+	for (i = marpa_v_arg_0(v); i <= marpa_v_arg_n(v); i++) {
+	  total += stack[i];
+	}
+	stack[marpa_v_result(v)] = total;
+	if (resultp == NULL && (resultp = malloc(sizeof(s_result_t))) == NULL) {
+	  break;
+	}
+	resultp->nLines = marpa_v_arg_n(v) - marpa_v_arg_0(v) + 1;
+      } else {
+	stack[marpa_v_result(v)] = stack[marpa_v_arg_0(v)];
+      }
+      break;
+    case MARPA_STEP_NULLING_SYMBOL:
+      stack[marpa_v_result(v)] = 0;
+      break;
+    default:
+      break;
+    }
+  }
+  marpa_v_unref(v);
+
+  if (rc == 0 && resultp != NULL && stackSize > 0) {
+    resultp->total = stack[0];
+    *resultPtr = resultp;
+    resultp    = NULL;
+  } else {
+    rc = -1;
+  }
+
+ tree_done:
+  if (t != NULL) {
+    marpa_t_unref(t);
+  }
+  marpa_o_unref(o);
+  free(resultp);
+  free(stack);
+
+  return rc;
+}
+
+static int _result(void *userDataPtr, size_t offset, size_t length, void *result) {
+  s_result_t *totalp  = (s_result_t *) userDataPtr;
+  s_result_t *resultp = (s_result_t *) result;
+
+  totalp->total  += resultp->total;
+  totalp->nLines += resultp->nLines;
+  free(resultp);
+
+  return 0;
+}
+
+static void _free(void *userDataPtr, void *result) {
+  free(result);
+}
+
+static double _now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static void _check(Marpa_Error_Code errorCode, const char *call, int forcedCondition) {
+  if (forcedCondition != 0 || errorCode != MARPA_ERR_NONE) {
+    const char *function = (call != NULL) ? call : "<unknown>";
+    const char *msg = (errorCode >= 0 && errorCode < MARPA_ERROR_COUNT) ? marpa_error_description[errorCode].name : "Generic error";
+    fprintf(stderr,"%s: %s", function, msg);
+    exit(EXIT_FAILURE);
+  }
+}
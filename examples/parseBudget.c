@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include "parseBudget.h"
+
+/* Rough libmarpa sizes, Earley item with its source links, and and-node */
+#define PARSEBUDGET_BYTES_PER_EARLEY_ITEM 64
+#define PARSEBUDGET_BYTES_PER_AND_NODE    48
+
+struct parseBudget {
+  parseBudgetOption_t option;
+  uint64_t            start;
+  uint64_t            deadline;      /* 0 means none */
+  int                 countdown;     /* Checks before next clock read */
+  int                 cancelled;     /* Atomic */
+};
+
+static int _parseBudgetCheck(parseBudget_t *parseBudgetPtr, parseBudgetResult_t *resultPtr, parseMetricsPhase_t phase);
+static int _parseBudgetValue(parseBudget_t *parseBudgetPtr, Marpa_Grammar g, Marpa_Tree t, parseDriverStepCallback_t stepCallbackPtr, void *userDataPtr, parseBudgetResult_t *resultPtr);
+
+parseBudget_t *parseBudgetCreate(parseBudgetOption_t *optionPtr)
+{
+  parseBudgetOption_t  defaultOption = PARSEBUDGET_OPTION_DEFAULT;
+  parseBudget_t       *parseBudgetPtr;
+
+  if (optionPtr != NULL && optionPtr->maxSeconds < 0) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  parseBudgetPtr = malloc(sizeof(parseBudget_t));
+  if (parseBudgetPtr == NULL) {
+    return NULL;
+  }
+  parseBudgetPtr->option    = (optionPtr != NULL) ? *optionPtr : defaultOption;
+  parseBudgetPtr->start     = 0;
+  parseBudgetPtr->deadline  = 0;
+  parseBudgetPtr->countdown = 0;
+  parseBudgetPtr->cancelled = 0;
+  if (parseBudgetPtr->option.checkInterval <= 0) {
+    parseBudgetPtr->option.checkInterval = defaultOption.checkInterval;
+  }
+
+  return parseBudgetPtr;
+}
+
+int parseBudgetRun(parseBudget_t *parseBudgetPtr, Marpa_Grammar g, parseBudgetFeedCallback_t feedCallbackPtr, parseDriverStepCallback_t stepCallbackPtr, parseDriverTreeCallback_t treeCallbackPtr, void *userDataPtr, parseBudgetResult_t *resultPtr)
+{
+  Marpa_Recognizer r = NULL;
+  Marpa_Bocage     b = NULL;
+  Marpa_Order      o = NULL;
+  Marpa_Tree       t = NULL;
+  int              rc;
+
+  if (parseBudgetPtr == NULL || g == NULL || feedCallbackPtr == NULL || stepCallbackPtr == NULL || resultPtr == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  resultPtr->status         = PARSEBUDGET_STATUS_OK;
+  resultPtr->phase          = PARSEMETRICS_PHASE_FEED;
+  resultPtr->nEarlemes      = 0;
+  resultPtr->nTrees         = 0;
+  resultPtr->estimatedBytes = 0;
+  parseBudgetPtr->start     = parseMetricsNow();
+  parseBudgetPtr->deadline  = (parseBudgetPtr->option.maxSeconds > 0) ? parseBudgetPtr->start + (uint64_t) (parseBudgetPtr->option.maxSeconds * 1e9) : 0;
+  parseBudgetPtr->countdown = parseBudgetPtr->option.checkInterval;
+  /* A cancellation is for one parse: one that came after the previous parse ended is not for this one */
+  __atomic_store_n(&(parseBudgetPtr->cancelled), 0, __ATOMIC_RELAXED);
+
+  marpa_g_error_clear(g);
+  r = marpa_r_new(g);
+  if (r == NULL || marpa_r_start_input(r) < 0) {
+    resultPtr->status = PARSEBUDGET_STATUS_FAILED;
+    goto done;
+  }
+
+  /* Feed */
+  while (_parseBudgetCheck(parseBudgetPtr, resultPtr, PARSEMETRICS_PHASE_FEED) == 0) {
+    int earleySetSize;
+
+    rc = (*feedCallbackPtr)(userDataPtr, r);
+    if (rc == 0) {
+      break;
+    }
+    if (rc < 0 || marpa_r_earleme_complete(r) < 0) {
+      resultPtr->status = PARSEBUDGET_STATUS_REJECTED;
+      goto done;
+    }
+    resultPtr->nEarlemes++;
+    earleySetSize = _marpa_r_earley_set_size(r, marpa_r_latest_earley_set(r));
+    if (earleySetSize > 0) {
+      resultPtr->estimatedBytes += (size_t) earleySetSize * PARSEBUDGET_BYTES_PER_EARLEY_ITEM;
+    }
+  }
+  if (resultPtr->status != PARSEBUDGET_STATUS_OK) {
+    goto done;
+  }
+
+  /* Bocage and order */
+  b = marpa_b_new(r, marpa_r_latest_earley_set(r));
+  if (b == NULL) {
+    resultPtr->phase  = PARSEMETRICS_PHASE_BOCAGE;
+    resultPtr->status = PARSEBUDGET_STATUS_REJECTED;
+    goto done;
+  }
+  if (_marpa_b_and_node_count(b) > 0) {
+    resultPtr->estimatedBytes += (size_t) _marpa_b_and_node_count(b) * PARSEBUDGET_BYTES_PER_AND_NODE;
+  }
+  if (_parseBudgetCheck(parseBudgetPtr, resultPtr, PARSEMETRICS_PHASE_BOCAGE) < 0) {
+    goto done;
+  }
+  o = marpa_o_new(b);
+  if (o == NULL) {
+    resultPtr->phase  = PARSEMETRICS_PHASE_ORDER;
+    resultPtr->status = PARSEBUDGET_STATUS_FAILED;
+    goto done;
+  }
+
+  /* Trees */
+  t = marpa_t_new(o);
+  if (t == NULL) {
+    resultPtr->phase  = PARSEMETRICS_PHASE_TREE_NEW;
+    resultPtr->status = PARSEBUDGET_STATUS_FAILED;
+    goto done;
+  }
+  while (_parseBudgetCheck(parseBudgetPtr, resultPtr, PARSEMETRICS_PHASE_TREE) == 0) {
+    rc = marpa_t_next(t);
+    if (rc == -1) {
+      /* Exhausted */
+      break;
+    }
+    if (rc < 0) {
+      resultPtr->status = PARSEBUDGET_STATUS_FAILED;
+      break;
+    }
+    if (_parseBudgetValue(parseBudgetPtr, g, t, stepCallbackPtr, userDataPtr, resultPtr) < 0) {
+      break;
+    }
+    resultPtr->nTrees++;
+    if (treeCallbackPtr != NULL && (*treeCallbackPtr)(userDataPtr, resultPtr->nTrees - 1) < 0) {
+      break;
+    }
+  }
+
+ done:
+  if (t != NULL) {
+    marpa_t_unref(t);
+  }
+  if (o != NULL) {
+    marpa_o_unref(o);
+  }
+  if (b != NULL) {
+    marpa_b_unref(b);
+  }
+  if (r != NULL) {
+    marpa_r_unref(r);
+  }
+  resultPtr->elapsedSeconds = (double) (parseMetricsNow() - parseBudgetPtr->start) / 1e9;
+
+  return (resultPtr->status == PARSEBUDGET_STATUS_OK) ? 0 : -1;
+}
+
+void parseBudgetCancel(parseBudget_t *parseBudgetPtr)
+{
+  if (parseBudgetPtr != NULL) {
+    __atomic_store_n(&(parseBudgetPtr->cancelled), 1, __ATOMIC_RELAXED);
+  }
+}
+
+const char *parseBudgetStatusName(parseBudgetStatus_t status)
+{
+  switch (status) {
+  case PARSEBUDGET_STATUS_OK:        return "ok";
+  case PARSEBUDGET_STATUS_REJECTED:  return "rejected";
+  case PARSEBUDGET_STATUS_DEADLINE:  return "deadline exceeded";
+  case PARSEBUDGET_STATUS_MEMORY:    return "memory budget exceeded";
+  case PARSEBUDGET_STATUS_CANCELLED: return "cancelled";
+  case PARSEBUDGET_STATUS_FAILED:    return "failed";
+  default:                           return "unknown";
+  }
+}
+
+void parseBudgetFree(parseBudget_t **parseBudgetPtrPtr)
+{
+  if (parseBudgetPtrPtr == NULL || *parseBudgetPtrPtr == NULL) {
+    return;
+  }
+
+  free(*parseBudgetPtrPtr);
+  *parseBudgetPtrPtr = NULL;
+}
+
+/* Returns 0 within budget, -1 with the status and phase set otherwise */
+static int _parseBudgetCheck(parseBudget_t *parseBudgetPtr, parseBudgetResult_t *resultPtr, parseMetricsPhase_t phase)
+{
+  parseBudgetStatus_t status = PARSEBUDGET_STATUS_OK;
+
+  resultPtr->phase = phase;
+  if (__atomic_load_n(&(parseBudgetPtr->cancelled), __ATOMIC_RELAXED) != 0) {
+    status = PARSEBUDGET_STATUS_CANCELLED;
+  } else if (parseBudgetPtr->option.maxBytes > 0 && resultPtr->estimatedBytes > parseBudgetPtr->option.maxBytes) {
+    status = PARSEBUDGET_STATUS_MEMORY;
+  } else if (parseBudgetPtr->deadline > 0 && --parseBudgetPtr->countdown <= 0) {
+    parseBudgetPtr->countdown = parseBudgetPtr->option.checkInterval;
+    if (parseMetricsNow() > parseBudgetPtr->deadline) {
+      status = PARSEBUDGET_STATUS_DEADLINE;
+    }
+  }
+
+  if (status != PARSEBUDGET_STATUS_OK) {
+    resultPtr->status = status;
+    return -1;
+  }
+
+  return 0;
+}
+
+static int _parseBudgetValue(parseBudget_t *parseBudgetPtr, Marpa_Grammar g, Marpa_Tree t, parseDriverStepCallback_t stepCallbackPtr, void *userDataPtr, parseBudgetResult_t *resultPtr)
+{
+  Marpa_Value v  = parseDriverValueNew(g, t);
+  int         rc = 0;
+
+  if (v == NULL) {
+    resultPtr->phase  = PARSEMETRICS_PHASE_VALUATION;
+    resultPtr->status = PARSEBUDGET_STATUS_FAILED;
+    return -1;
+  }
+
+  while ((rc = _parseBudgetCheck(parseBudgetPtr, resultPtr, PARSEMETRICS_PHASE_VALUATION)) == 0) {
+    Marpa_Step_Type stepType = marpa_v_step(v);
+
+    if (stepType == MARPA_STEP_INACTIVE) {
+      break;
+    }
+    if (stepType < 0 || (*stepCallbackPtr)(userDataPtr, v, stepType) < 0) {
+      resultPtr->status = PARSEBUDGET_STATUS_FAILED;
+      rc = -1;
+      break;
+    }
+  }
+  marpa_v_unref(v);
+
+  return rc;
+}
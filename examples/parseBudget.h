@@ -0,0 +1,63 @@
+#ifndef PARSE_BUDGET_H
+#define PARSE_BUDGET_H
+
+#include <stddef.h>
+#include <marpa.h>
+#include "parseMetrics.h"
+#include "parseDriver.h"
+
+/*
+ * Whole parse pipeline under a deadline and a memory budget: feed,
+ * bocage, order, trees and valuation. Budgets are checked after every
+ * earleme, every marpa_t_next() and every marpa_v_step(); the clock is
+ * only read every checkInterval checks. On a budget exceeded, all the
+ * libmarpa objects of the parse are unref'ed and a structured result
+ * says where and why: nothing exits, the grammar can be reused.
+ *
+ * libmarpa does not report its memory usage: it is estimated from the
+ * number of Earley items in the sets fed, and of and-nodes in the bocage.
+ * A single libmarpa call, e.g. marpa_b_new(), cannot be interrupted: the
+ * memory budget on the Earley items is what bounds the bocage.
+ */
+
+typedef struct parseBudget parseBudget_t;
+
+/* Feeds the alternatives of one earleme. Returns 1 when fed, 0 at end of input, -1 when the input is invalid */
+typedef int (*parseBudgetFeedCallback_t)(void *userDataPtr, Marpa_Recognizer r);
+
+typedef struct parseBudgetOption {
+  double maxSeconds;       /* Deadline, from the start of parseBudgetRun(): 0 means none */
+  size_t maxBytes;         /* Estimated libmarpa memory: 0 means none */
+  int    checkInterval;    /* Checks between two clock reads */
+} parseBudgetOption_t;
+
+#define PARSEBUDGET_OPTION_DEFAULT { 0.0, 0, 64 }
+
+typedef enum parseBudgetStatus {
+  PARSEBUDGET_STATUS_OK = 0,          /* All trees, or a stop from the tree callback */
+  PARSEBUDGET_STATUS_REJECTED,        /* Invalid input, or no parse */
+  PARSEBUDGET_STATUS_DEADLINE,
+  PARSEBUDGET_STATUS_MEMORY,
+  PARSEBUDGET_STATUS_CANCELLED,       /* parseBudgetCancel() */
+  PARSEBUDGET_STATUS_FAILED           /* libmarpa failure, or abort from the step callback */
+} parseBudgetStatus_t;
+
+typedef struct parseBudgetResult {
+  parseBudgetStatus_t status;
+  parseMetricsPhase_t phase;           /* Where the parse stopped */
+  int                 nEarlemes;
+  int                 nTrees;
+  size_t              estimatedBytes;
+  double              elapsedSeconds;
+} parseBudgetResult_t;
+
+/* optionPtr may be NULL. One parseBudget_t per worker, reused for every parse */
+parseBudget_t *parseBudgetCreate(parseBudgetOption_t *optionPtr);
+/* Returns 0 when resultPtr->status is PARSEBUDGET_STATUS_OK, -1 otherwise. The step and tree callbacks are parseDriver's */
+int            parseBudgetRun(parseBudget_t *parseBudgetPtr, Marpa_Grammar g, parseBudgetFeedCallback_t feedCallbackPtr, parseDriverStepCallback_t stepCallbackPtr, parseDriverTreeCallback_t treeCallbackPtr, void *userDataPtr, parseBudgetResult_t *resultPtr);
+/* From any thread: the current parseBudgetRun() stops at its next check. The next parseBudgetRun() starts uncancelled */
+void           parseBudgetCancel(parseBudget_t *parseBudgetPtr);
+const char    *parseBudgetStatusName(parseBudgetStatus_t status);
+void           parseBudgetFree(parseBudget_t **parseBudgetPtrPtr);
+
+#endif /* PARSE_BUDGET_H */
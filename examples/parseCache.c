@@ -0,0 +1,313 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "parseCache.h"
+
+#define PARSECACHE_INIT_BUCKETS 1024   /* Power of two */
+#define PARSECACHE_MULTIPLIER   0x9E3779B97F4A7C15ULL
+#define PARSECACHE_ALIGN(n)     (((n) + 7) & ~((size_t) 7))   /* Results of any type */
+
+typedef struct parseCacheEntry {
+  struct parseCacheEntry *next;        /* In the bucket */
+  uint64_t                hash;
+  uint64_t                grammarId;
+  size_t                  nTokens;
+  size_t                  resultLength;
+  size_t                  size;        /* Charged to the cap */
+  size_t                  clockIndex;
+  int                     referenced;
+  /* Followed by the tokens, then the result */
+} parseCacheEntry_t;
+
+struct parseCache {
+  parseCacheOption_t      option;
+  parseCacheEntry_t     **buckets;
+  size_t                  nBuckets;
+  parseCacheEntry_t     **clock;       /* All entries, as many slots as buckets: NULL is a free slot */
+  size_t                  nSlots;      /* Used so far, free ones included */
+  size_t                 *freeSlots;   /* Most recently freed last */
+  size_t                  nFreeSlots;
+  size_t                  hand;
+  parseCacheStatistics_t  statistics;
+};
+
+#define PARSECACHE_TOKENS(entryPtr) ((parseCacheToken_t *) ((entryPtr) + 1))
+#define PARSECACHE_RESULT(entryPtr) ((void *) ((char *) PARSECACHE_TOKENS(entryPtr) + PARSECACHE_ALIGN((entryPtr)->nTokens * sizeof(parseCacheToken_t))))
+
+static uint64_t           _parseCacheHash(uint64_t grammarId, const parseCacheToken_t *tokens, size_t nTokens);
+static parseCacheEntry_t *_parseCacheFind(parseCache_t *parseCachePtr, uint64_t hash, uint64_t grammarId, const parseCacheToken_t *tokens, size_t nTokens);
+static int                _parseCacheGrow(parseCache_t *parseCachePtr);
+static void               _parseCacheEvict(parseCache_t *parseCachePtr);
+
+parseCache_t *parseCacheCreate(parseCacheOption_t *optionPtr)
+{
+  parseCacheOption_t  defaultOption = PARSECACHE_OPTION_DEFAULT;
+  parseCache_t       *parseCachePtr;
+
+  parseCachePtr = malloc(sizeof(parseCache_t));
+  if (parseCachePtr == NULL) {
+    return NULL;
+  }
+  parseCachePtr->option   = (optionPtr != NULL) ? *optionPtr : defaultOption;
+  parseCachePtr->buckets  = calloc(PARSECACHE_INIT_BUCKETS, sizeof(parseCacheEntry_t *));
+  parseCachePtr->clock     = malloc(PARSECACHE_INIT_BUCKETS * sizeof(parseCacheEntry_t *));
+  parseCachePtr->freeSlots = malloc(PARSECACHE_INIT_BUCKETS * sizeof(size_t));
+  if (parseCachePtr->buckets == NULL || parseCachePtr->clock == NULL || parseCachePtr->freeSlots == NULL) {
+    free(parseCachePtr->buckets);
+    free(parseCachePtr->clock);
+    free(parseCachePtr->freeSlots);
+    free(parseCachePtr);
+    return NULL;
+  }
+  parseCachePtr->nBuckets   = PARSECACHE_INIT_BUCKETS;
+  parseCachePtr->nSlots     = 0;
+  parseCachePtr->nFreeSlots = 0;
+  parseCachePtr->hand       = 0;
+  memset(&(parseCachePtr->statistics), 0, sizeof(parseCacheStatistics_t));
+
+  return parseCachePtr;
+}
+
+int parseCacheGet(parseCache_t *parseCachePtr, uint64_t grammarId, const parseCacheToken_t *tokens, size_t nTokens, const void **resultPtrPtr, size_t *resultLengthPtr)
+{
+  parseCacheEntry_t *entryPtr;
+
+  if (parseCachePtr == NULL || (tokens == NULL && nTokens > 0) || resultPtrPtr == NULL || resultLengthPtr == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  entryPtr = _parseCacheFind(parseCachePtr, _parseCacheHash(grammarId, tokens, nTokens), grammarId, tokens, nTokens);
+  if (entryPtr == NULL) {
+    parseCachePtr->statistics.nMisses++;
+    return 0;
+  }
+
+  entryPtr->referenced = 1;
+  *resultPtrPtr        = PARSECACHE_RESULT(entryPtr);
+  *resultLengthPtr     = entryPtr->resultLength;
+  parseCachePtr->statistics.nHits++;
+
+  return 1;
+}
+
+int parseCachePut(parseCache_t *parseCachePtr, uint64_t grammarId, const parseCacheToken_t *tokens, size_t nTokens, const void *resultPtr, size_t resultLength)
+{
+  uint64_t           hash;
+  size_t             size;
+  size_t             bucket;
+  parseCacheEntry_t *entryPtr;
+
+  if (parseCachePtr == NULL || (tokens == NULL && nTokens > 0) || (resultPtr == NULL && resultLength > 0)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  size = sizeof(parseCacheEntry_t) + PARSECACHE_ALIGN(nTokens * sizeof(parseCacheToken_t)) + resultLength;
+  if (size > parseCachePtr->option.maxBytes) {
+    return 0;
+  }
+  hash = _parseCacheHash(grammarId, tokens, nTokens);
+  if (_parseCacheFind(parseCachePtr, hash, grammarId, tokens, nTokens) != NULL) {
+    return 0;
+  }
+
+  while (parseCachePtr->statistics.nBytes + size > parseCachePtr->option.maxBytes) {
+    _parseCacheEvict(parseCachePtr);
+  }
+  if (parseCachePtr->nFreeSlots == 0 && parseCachePtr->nSlots >= parseCachePtr->nBuckets && _parseCacheGrow(parseCachePtr) < 0) {
+    return -1;
+  }
+
+  entryPtr = malloc(size);
+  if (entryPtr == NULL) {
+    return -1;
+  }
+  entryPtr->hash         = hash;
+  entryPtr->grammarId    = grammarId;
+  entryPtr->nTokens      = nTokens;
+  entryPtr->resultLength = resultLength;
+  entryPtr->size         = size;
+  entryPtr->referenced   = 0;
+  if (nTokens > 0) {
+    memcpy(PARSECACHE_TOKENS(entryPtr), tokens, nTokens * sizeof(parseCacheToken_t));
+  }
+  if (resultLength > 0) {
+    memcpy(PARSECACHE_RESULT(entryPtr), resultPtr, resultLength);
+  }
+
+  bucket                         = (size_t) (hash & (parseCachePtr->nBuckets - 1));
+  entryPtr->next                 = parseCachePtr->buckets[bucket];
+  parseCachePtr->buckets[bucket] = entryPtr;
+  /* In the slot just freed, i.e. behind the hand: looked at after a whole sweep */
+  entryPtr->clockIndex           = (parseCachePtr->nFreeSlots > 0) ? parseCachePtr->freeSlots[--parseCachePtr->nFreeSlots] : parseCachePtr->nSlots++;
+  parseCachePtr->clock[entryPtr->clockIndex] = entryPtr;
+  parseCachePtr->statistics.nEntries++;
+  parseCachePtr->statistics.nBytes += size;
+  parseCachePtr->statistics.nInsertions++;
+
+  return 1;
+}
+
+void parseCacheClear(parseCache_t *parseCachePtr)
+{
+  size_t i;
+
+  if (parseCachePtr == NULL) {
+    return;
+  }
+
+  for (i = 0; i < parseCachePtr->nSlots; i++) {
+    free(parseCachePtr->clock[i]);
+  }
+  memset(parseCachePtr->buckets, 0, parseCachePtr->nBuckets * sizeof(parseCacheEntry_t *));
+  parseCachePtr->nSlots              = 0;
+  parseCachePtr->nFreeSlots          = 0;
+  parseCachePtr->statistics.nEntries = 0;
+  parseCachePtr->statistics.nBytes   = 0;
+  parseCachePtr->hand                = 0;
+}
+
+void parseCacheStatistics(parseCache_t *parseCachePtr, parseCacheStatistics_t *statisticsPtr)
+{
+  if (parseCachePtr != NULL && statisticsPtr != NULL) {
+    *statisticsPtr = parseCachePtr->statistics;
+  }
+}
+
+void parseCacheFree(parseCache_t **parseCachePtrPtr)
+{
+  parseCache_t *parseCachePtr;
+
+  if (parseCachePtrPtr == NULL || *parseCachePtrPtr == NULL) {
+    return;
+  }
+  parseCachePtr = *parseCachePtrPtr;
+
+  parseCacheClear(parseCachePtr);
+  free(parseCachePtr->buckets);
+  free(parseCachePtr->clock);
+  free(parseCachePtr->freeSlots);
+  free(parseCachePtr);
+
+  *parseCachePtrPtr = NULL;
+}
+
+/* Multiply-xorshift over symbol id and value pairs, then a splitmix64 finalizer */
+static uint64_t _parseCacheHash(uint64_t grammarId, const parseCacheToken_t *tokens, size_t nTokens)
+{
+  uint64_t h = (grammarId ^ (uint64_t) nTokens) * PARSECACHE_MULTIPLIER;
+  size_t   i;
+
+  for (i = 0; i < nTokens; i++) {
+    h ^= ((uint64_t) (uint32_t) tokens[i].symbolId << 32) | (uint64_t) (uint32_t) tokens[i].value;
+    h *= PARSECACHE_MULTIPLIER;
+    h ^= h >> 32;
+  }
+
+  h ^= h >> 30;
+  h *= 0xBF58476D1CE4E5B9ULL;
+  h ^= h >> 27;
+  h *= 0x94D049BB133111EBULL;
+  h ^= h >> 31;
+
+  return h;
+}
+
+static parseCacheEntry_t *_parseCacheFind(parseCache_t *parseCachePtr, uint64_t hash, uint64_t grammarId, const parseCacheToken_t *tokens, size_t nTokens)
+{
+  parseCacheEntry_t *entryPtr;
+
+  for (entryPtr = parseCachePtr->buckets[hash & (parseCachePtr->nBuckets - 1)]; entryPtr != NULL; entryPtr = entryPtr->next) {
+    if (entryPtr->hash == hash &&
+	entryPtr->grammarId == grammarId &&
+	entryPtr->nTokens == nTokens &&
+	(nTokens == 0 || memcmp(PARSECACHE_TOKENS(entryPtr), tokens, nTokens * sizeof(parseCacheToken_t)) == 0)) {
+      return entryPtr;
+    }
+  }
+
+  return NULL;
+}
+
+/* Doubles the buckets, the clock array and the free slots */
+static int _parseCacheGrow(parseCache_t *parseCachePtr)
+{
+  size_t              nBuckets = parseCachePtr->nBuckets * 2;
+  parseCacheEntry_t **buckets  = calloc(nBuckets, sizeof(parseCacheEntry_t *));
+  parseCacheEntry_t **clock;
+  size_t             *freeSlots;
+  size_t              i;
+
+  if (buckets == NULL) {
+    return -1;
+  }
+  clock = realloc(parseCachePtr->clock, nBuckets * sizeof(parseCacheEntry_t *));
+  if (clock == NULL) {
+    free(buckets);
+    return -1;
+  }
+  parseCachePtr->clock = clock;
+  freeSlots = realloc(parseCachePtr->freeSlots, nBuckets * sizeof(size_t));
+  if (freeSlots == NULL) {
+    free(buckets);
+    return -1;
+  }
+  parseCachePtr->freeSlots = freeSlots;
+
+  for (i = 0; i < parseCachePtr->nSlots; i++) {
+    parseCacheEntry_t *entryPtr = clock[i];
+    size_t             bucket;
+
+    if (entryPtr == NULL) {
+      continue;
+    }
+    bucket          = (size_t) (entryPtr->hash & (nBuckets - 1));
+    entryPtr->next  = buckets[bucket];
+    buckets[bucket] = entryPtr;
+  }
+  free(parseCachePtr->buckets);
+  parseCachePtr->buckets   = buckets;
+  parseCachePtr->nBuckets  = nBuckets;
+
+  return 0;
+}
+
+/* Advances the hand to the first entry not referenced since last sweep, and evicts it */
+static void _parseCacheEvict(parseCache_t *parseCachePtr)
+{
+  parseCacheEntry_t  *entryPtr;
+  parseCacheEntry_t **previousPtrPtr;
+
+  while (1) {
+    if (parseCachePtr->hand >= parseCachePtr->nSlots) {
+      parseCachePtr->hand = 0;
+    }
+    entryPtr = parseCachePtr->clock[parseCachePtr->hand];
+    if (entryPtr == NULL) {
+      parseCachePtr->hand++;
+      continue;
+    }
+    if (entryPtr->referenced == 0) {
+      break;
+    }
+    entryPtr->referenced = 0;
+    parseCachePtr->hand++;
+  }
+
+  previousPtrPtr = &(parseCachePtr->buckets[entryPtr->hash & (parseCachePtr->nBuckets - 1)]);
+  while (*previousPtrPtr != entryPtr) {
+    previousPtrPtr = &((*previousPtrPtr)->next);
+  }
+  *previousPtrPtr = entryPtr->next;
+
+  /* The slot stays where it is, for the next insertion, and the hand moves past it */
+  parseCachePtr->clock[entryPtr->clockIndex]            = NULL;
+  parseCachePtr->freeSlots[parseCachePtr->nFreeSlots++] = entryPtr->clockIndex;
+  parseCachePtr->hand++;
+  parseCachePtr->statistics.nEntries--;
+  parseCachePtr->statistics.nBytes -= entryPtr->size;
+  parseCachePtr->statistics.nEvictions++;
+  free(entryPtr);
+}
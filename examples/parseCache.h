@@ -0,0 +1,54 @@
+#ifndef PARSE_CACHE_H
+#define PARSE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <marpa.h>
+
+/*
+ * Bounded cache of valuated results, keyed by a grammar identity, e.g.
+ * a version number of the grammar chosen by the caller, and a
+ * token sequence: one token per earleme, i.e. symbol id and value of each
+ * marpa_r_alternative() with length 1. A hit needs no libmarpa call.
+ *
+ * Keys are hashed (64 bits) and compared in full. Eviction is CLOCK:
+ * a hit only sets a reference bit, entries not referenced since the last
+ * sweep of the hand are evicted until the memory cap is respected.
+ */
+
+typedef struct parseCache parseCache_t;
+
+typedef struct parseCacheToken {
+  Marpa_Symbol_ID symbolId;
+  int             value;
+} parseCacheToken_t;
+
+typedef struct parseCacheOption {
+  size_t maxBytes;           /* Keys, results and per-entry overhead */
+} parseCacheOption_t;
+
+#define PARSECACHE_OPTION_DEFAULT { 64 * 1024 * 1024 }
+
+typedef struct parseCacheStatistics {
+  unsigned long nHits;
+  unsigned long nMisses;
+  unsigned long nInsertions;
+  unsigned long nEvictions;
+  size_t        nEntries;
+  size_t        nBytes;
+} parseCacheStatistics_t;
+
+/* optionPtr may be NULL */
+parseCache_t *parseCacheCreate(parseCacheOption_t *optionPtr);
+/*
+ * Returns 1 on a hit, with *resultPtrPtr and *resultLengthPtr set, 0 on a miss, -1 on failure.
+ * The result is owned by the cache and valid until the next parseCachePut().
+ */
+int           parseCacheGet(parseCache_t *parseCachePtr, uint64_t grammarId, const parseCacheToken_t *tokens, size_t nTokens, const void **resultPtrPtr, size_t *resultLengthPtr);
+/* Copies the result. Returns 1 if stored, 0 if it is larger than the cap or already there, -1 on failure */
+int           parseCachePut(parseCache_t *parseCachePtr, uint64_t grammarId, const parseCacheToken_t *tokens, size_t nTokens, const void *resultPtr, size_t resultLength);
+void          parseCacheClear(parseCache_t *parseCachePtr);
+void          parseCacheStatistics(parseCache_t *parseCachePtr, parseCacheStatistics_t *statisticsPtr);
+void          parseCacheFree(parseCache_t **parseCachePtrPtr);
+
+#endif /* PARSE_CACHE_H */
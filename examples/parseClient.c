@@ -0,0 +1,160 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "parseClient.h"
+
+struct parseClient {
+  int             fd;
+  unsigned char  *requestPtr;
+  size_t          requestSize;
+  void           *replyPtr;
+  size_t          replySize;
+  int32_t        *results;
+  int             nResults;      /* Allocated */
+};
+
+parseClient_t *parseClientCreate(const char *socketPath)
+{
+  parseClient_t      *parseClientPtr;
+  struct sockaddr_un  address;
+
+  if (socketPath == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+  if (strlen(socketPath) >= sizeof(address.sun_path)) {
+    errno = ENAMETOOLONG;
+    return NULL;
+  }
+
+  parseClientPtr = malloc(sizeof(parseClient_t));
+  if (parseClientPtr == NULL) {
+    return NULL;
+  }
+  parseClientPtr->requestPtr  = NULL;
+  parseClientPtr->requestSize = 0;
+  parseClientPtr->replyPtr    = NULL;
+  parseClientPtr->replySize   = 0;
+  parseClientPtr->results     = NULL;
+  parseClientPtr->nResults    = 0;
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, socketPath);
+  parseClientPtr->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (parseClientPtr->fd < 0 || connect(parseClientPtr->fd, (struct sockaddr *) &address, sizeof(address)) < 0) {
+    int errnoSave = errno;
+
+    if (parseClientPtr->fd >= 0) {
+      close(parseClientPtr->fd);
+    }
+    free(parseClientPtr);
+    errno = errnoSave;
+    return NULL;
+  }
+
+  return parseClientPtr;
+}
+
+int parseClientParse(parseClient_t *parseClientPtr, int32_t grammarId, const parseProtocolToken_t *tokens, size_t nTokens, const int32_t **resultsPtr, int *nResultsPtr)
+{
+  size_t          length;
+  unsigned char  *p;
+  int32_t         status;
+  int32_t         nResults;
+  size_t          i;
+
+  if (parseClientPtr == NULL || (tokens == NULL && nTokens > 0) || resultsPtr == NULL || nResultsPtr == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (nTokens > (INT32_MAX - 2 * sizeof(int32_t)) / (2 * sizeof(int32_t))) {
+    errno = EMSGSIZE;
+    return -1;
+  }
+
+  /* Request */
+  length = (2 + 2 * nTokens) * sizeof(int32_t);
+  if (length > parseClientPtr->requestSize) {
+    unsigned char *requestPtr = realloc(parseClientPtr->requestPtr, length);
+
+    if (requestPtr == NULL) {
+      return -1;
+    }
+    parseClientPtr->requestPtr  = requestPtr;
+    parseClientPtr->requestSize = length;
+  }
+  p = parseClientPtr->requestPtr;
+  parseProtocolPut(p, grammarId);
+  parseProtocolPut(p + sizeof(int32_t), (int32_t) nTokens);
+  p += 2 * sizeof(int32_t);
+  for (i = 0; i < nTokens; i++) {
+    parseProtocolPut(p, tokens[i].symbolId);
+    parseProtocolPut(p + sizeof(int32_t), tokens[i].value);
+    p += 2 * sizeof(int32_t);
+  }
+  if (parseProtocolWrite(parseClientPtr->fd, parseClientPtr->requestPtr, length) < 0) {
+    return -1;
+  }
+
+  /* Reply */
+  switch (parseProtocolRead(parseClientPtr->fd, &(parseClientPtr->replyPtr), &(parseClientPtr->replySize), PARSEPROTOCOL_MAX_FRAME_DEFAULT, &length)) {
+  case 1:
+    break;
+  case 0:
+    /* The server closed the connection, e.g. it was stopped */
+    errno = ECONNRESET;
+    return -1;
+  default:
+    return -1;
+  }
+  p = parseClientPtr->replyPtr;
+  if (length < 2 * sizeof(int32_t)) {
+    errno = EPROTO;
+    return -1;
+  }
+  status   = parseProtocolGet(p);
+  nResults = parseProtocolGet(p + sizeof(int32_t));
+  if (nResults < 0 || length != (2 + (size_t) nResults) * sizeof(int32_t)) {
+    errno = EPROTO;
+    return -1;
+  }
+  if (nResults > parseClientPtr->nResults) {
+    int32_t *results = realloc(parseClientPtr->results, nResults * sizeof(int32_t));
+
+    if (results == NULL) {
+      return -1;
+    }
+    parseClientPtr->results  = results;
+    parseClientPtr->nResults = nResults;
+  }
+  for (i = 0; i < (size_t) nResults; i++) {
+    parseClientPtr->results[i] = parseProtocolGet(p + (2 + i) * sizeof(int32_t));
+  }
+
+  *resultsPtr  = parseClientPtr->results;
+  *nResultsPtr = nResults;
+
+  return status;
+}
+
+void parseClientFree(parseClient_t **parseClientPtrPtr)
+{
+  parseClient_t *parseClientPtr;
+
+  if (parseClientPtrPtr == NULL || *parseClientPtrPtr == NULL) {
+    return;
+  }
+  parseClientPtr = *parseClientPtrPtr;
+
+  close(parseClientPtr->fd);
+  free(parseClientPtr->requestPtr);
+  free(parseClientPtr->replyPtr);
+  free(parseClientPtr->results);
+  free(parseClientPtr);
+  *parseClientPtrPtr = NULL;
+}
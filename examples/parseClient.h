@@ -0,0 +1,25 @@
+#ifndef PARSE_CLIENT_H
+#define PARSE_CLIENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "parseProtocol.h"
+
+/*
+ * Thin client of parseServer: one connection, reused for every request.
+ * No libmarpa needed: the caller knows the symbol ids of the grammar.
+ * A parseClient_t must not be shared between threads.
+ */
+
+typedef struct parseClient parseClient_t;
+
+parseClient_t *parseClientCreate(const char *socketPath);
+/*
+ * Returns the parseProtocolStatus_t of the reply, or -1 with errno set when the
+ * connection failed: it is unusable then. *resultsPtr, the value of each tree,
+ * is valid until the next call.
+ */
+int            parseClientParse(parseClient_t *parseClientPtr, int32_t grammarId, const parseProtocolToken_t *tokens, size_t nTokens, const int32_t **resultsPtr, int *nResultsPtr);
+void           parseClientFree(parseClient_t **parseClientPtrPtr);
+
+#endif /* PARSE_CLIENT_H */
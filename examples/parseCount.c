@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "parseCount.h"
+
+#define PARSECOUNT_STATE_NEW      0
+#define PARSECOUNT_STATE_VISITING 1   /* On the current DFS path: meeting it again means a cycle */
+#define PARSECOUNT_STATE_DONE     2
+
+static uint64_t _parseCountAdd(uint64_t a, uint64_t b);
+static uint64_t _parseCountMul(uint64_t a, uint64_t b);
+
+int parseCount(Marpa_Grammar g, Marpa_Bocage b, uint64_t *countPtr, parseCountSpanCallback_t spanCallbackPtr, void *userDataPtr)
+{
+  Marpa_Or_Node_ID  topOrNodeId;
+  int               nOrNodes   = 0;
+  int               nAndNodes;
+  int               setId;
+  uint64_t         *counts     = NULL;
+  unsigned char    *states     = NULL;
+  Marpa_Or_Node_ID *stack      = NULL;
+  int               stackSize  = 0;
+  int               isCyclic   = 0;
+  int               rc         = -1;
+
+  marpa_g_error_clear(g);
+
+  /* The null parse has no or-node and exactly one tree */
+  if (marpa_b_is_null(b) > 0) {
+    if (countPtr != NULL) {
+      *countPtr = 1;
+    }
+    return 0;
+  }
+
+  topOrNodeId = _marpa_b_top_or_node(b);
+  nAndNodes   = _marpa_b_and_node_count(b);
+  if (topOrNodeId < 0 || nAndNodes < 0) {
+    return -1;
+  }
+  while ((setId = _marpa_b_or_node_set(b, nOrNodes)) >= 0) {
+    nOrNodes++;
+  }
+  if (setId < -1) {
+    return -1;
+  }
+
+  counts = malloc(nOrNodes * sizeof(uint64_t));
+  states = calloc(nOrNodes, sizeof(unsigned char));
+  /* Every or-node is expanded once, and pushes at most two or-nodes per and-node */
+  stack  = malloc((1 + 2 * nAndNodes) * sizeof(Marpa_Or_Node_ID));
+  if (counts == NULL || states == NULL || stack == NULL) {
+    goto done;
+  }
+
+  /* Iterative post-order DFS from the top or-node: bocages of long inputs are deep */
+  stack[stackSize++] = topOrNodeId;
+  while (stackSize > 0) {
+    Marpa_Or_Node_ID  orNodeId   = stack[stackSize - 1];
+    Marpa_And_Node_ID firstAndNodeId;
+    Marpa_And_Node_ID lastAndNodeId;
+    Marpa_And_Node_ID andNodeId;
+
+    if (states[orNodeId] == PARSECOUNT_STATE_DONE) {
+      stackSize--;
+      continue;
+    }
+
+    firstAndNodeId = _marpa_b_or_node_first_and(b, orNodeId);
+    lastAndNodeId  = _marpa_b_or_node_last_and(b, orNodeId);
+    if (firstAndNodeId < 0 || lastAndNodeId < 0) {
+      goto done;
+    }
+
+    if (states[orNodeId] == PARSECOUNT_STATE_NEW) {
+      states[orNodeId] = PARSECOUNT_STATE_VISITING;
+      for (andNodeId = firstAndNodeId; andNodeId <= lastAndNodeId; andNodeId++) {
+	Marpa_Or_Node_ID children[2];
+	int              i;
+
+	children[0] = _marpa_b_and_node_predecessor(b, andNodeId);
+	children[1] = _marpa_b_and_node_cause(b, andNodeId);
+	for (i = 0; i < 2; i++) {
+	  if (children[i] < 0) {
+	    continue;
+	  }
+	  if (states[children[i]] == PARSECOUNT_STATE_NEW) {
+	    stack[stackSize++] = children[i];
+	  } else if (states[children[i]] == PARSECOUNT_STATE_VISITING) {
+	    isCyclic = 1;
+	  }
+	}
+      }
+      continue;
+    }
+
+    /* All children are done, except those closing a cycle */
+    counts[orNodeId] = 0;
+    for (andNodeId = firstAndNodeId; andNodeId <= lastAndNodeId; andNodeId++) {
+      Marpa_Or_Node_ID predecessorOrNodeId = _marpa_b_and_node_predecessor(b, andNodeId);
+      Marpa_Or_Node_ID causeOrNodeId       = _marpa_b_and_node_cause(b, andNodeId);
+      uint64_t         predecessorCount    = 1;
+      uint64_t         causeCount          = 1;
+
+      if (predecessorOrNodeId >= 0) {
+	predecessorCount = (states[predecessorOrNodeId] == PARSECOUNT_STATE_DONE) ? counts[predecessorOrNodeId] : PARSECOUNT_SATURATED;
+      }
+      if (causeOrNodeId >= 0) {
+	causeCount = (states[causeOrNodeId] == PARSECOUNT_STATE_DONE) ? counts[causeOrNodeId] : PARSECOUNT_SATURATED;
+      }
+      counts[orNodeId] = _parseCountAdd(counts[orNodeId], _parseCountMul(predecessorCount, causeCount));
+    }
+    states[orNodeId] = PARSECOUNT_STATE_DONE;
+    stackSize--;
+  }
+
+  if (spanCallbackPtr != NULL) {
+    Marpa_Or_Node_ID orNodeId;
+
+    for (orNodeId = 0; orNodeId < nOrNodes; orNodeId++) {
+      Marpa_IRL_ID    irlId;
+      Marpa_Symbol_ID symbolId;
+
+      /* Only or-nodes reachable from the top belong to a parse */
+      if (states[orNodeId] != PARSECOUNT_STATE_DONE || _marpa_b_or_node_is_whole(b, orNodeId) <= 0) {
+	continue;
+      }
+      irlId    = _marpa_b_or_node_irl(b, orNodeId);
+      symbolId = _marpa_g_nsy_xsy(g, _marpa_g_irl_lhs(g, irlId));
+      if (symbolId < 0) {
+	/* Internal symbol created by grammar rewriting */
+	continue;
+      }
+      (*spanCallbackPtr)(userDataPtr,
+			 symbolId,
+			 _marpa_g_source_xrl(g, irlId),
+			 _marpa_b_or_node_origin(b, orNodeId),
+			 _marpa_b_or_node_set(b, orNodeId),
+			 counts[orNodeId]);
+    }
+  }
+
+  if (countPtr != NULL) {
+    *countPtr = isCyclic ? PARSECOUNT_SATURATED : counts[topOrNodeId];
+  }
+  rc = (isCyclic || counts[topOrNodeId] == PARSECOUNT_SATURATED) ? 1 : 0;
+
+ done:
+  free(counts);
+  free(states);
+  free(stack);
+
+  return rc;
+}
+
+static uint64_t _parseCountAdd(uint64_t a, uint64_t b)
+{
+  return (a > PARSECOUNT_SATURATED - b) ? PARSECOUNT_SATURATED : a + b;
+}
+
+static uint64_t _parseCountMul(uint64_t a, uint64_t b)
+{
+  if (a == 0 || b == 0) {
+    return 0;
+  }
+  return (a > PARSECOUNT_SATURATED / b) ? PARSECOUNT_SATURATED : a * b;
+}
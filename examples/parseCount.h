@@ -0,0 +1,24 @@
+#ifndef PARSE_COUNT_H
+#define PARSE_COUNT_H
+
+#include <stdint.h>
+#include <marpa.h>
+
+/*
+ * Exact number of parses in a bocage, computed by dynamic programming over
+ * its or-nodes and and-nodes, in time linear in the size of the bocage:
+ *   count(or-node)  = sum of count(and-node) for all its and-nodes
+ *   count(and-node) = count(predecessor or-node) * count(cause or-node)
+ * with tokens and missing predecessors counting as 1.
+ * Counts saturate at PARSECOUNT_SATURATED.
+ */
+
+#define PARSECOUNT_SATURATED UINT64_MAX
+
+/* Called for every whole or-node, i.e. a complete rule instance: symbolId spans Earley sets [startEarleySetId, endEarleySetId] */
+typedef void (*parseCountSpanCallback_t)(void *userDataPtr, Marpa_Symbol_ID symbolId, Marpa_Rule_ID ruleId, Marpa_Earley_Set_ID startEarleySetId, Marpa_Earley_Set_ID endEarleySetId, uint64_t count);
+
+/* Returns 0 if *countPtr is exact, 1 if it saturated (including cycles), -1 on failure */
+int parseCount(Marpa_Grammar g, Marpa_Bocage b, uint64_t *countPtr, parseCountSpanCallback_t spanCallbackPtr, void *userDataPtr);
+
+#endif /* PARSE_COUNT_H */
@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include "parseDriver.h"
+
+struct parseDriver {
+  Marpa_Grammar             g;
+  parseEnumeratorOption_t   option;
+  parseDriverStepCallback_t stepCallback;
+  parseDriverTreeCallback_t treeCallback;
+  void                     *userDataPtr;
+  int                       treeIndex;
+  parseDriverStatistics_t   statistics;
+};
+
+static int _parseDriverValue(parseDriver_t *parseDriverPtr, Marpa_Tree t);
+static int _parseDriverTreeCallback(void *userDataPtr, Marpa_Tree t, int treeIndex);
+
+parseDriver_t *parseDriverCreate(Marpa_Grammar g, parseEnumeratorOption_t *optionPtr, parseDriverStepCallback_t stepCallbackPtr, parseDriverTreeCallback_t treeCallbackPtr, void *userDataPtr)
+{
+  parseEnumeratorOption_t  defaultOption = PARSEENUMERATOR_OPTION_DEFAULT;
+  parseDriver_t           *parseDriverPtr;
+
+  if (g == NULL || stepCallbackPtr == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  if (marpa_g_highest_rule_id(g) < 0) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  parseDriverPtr = malloc(sizeof(parseDriver_t));
+  if (parseDriverPtr == NULL) {
+    return NULL;
+  }
+
+  parseDriverPtr->g                    = marpa_g_ref(g);
+  parseDriverPtr->option               = (optionPtr != NULL) ? *optionPtr : defaultOption;
+  parseDriverPtr->stepCallback         = stepCallbackPtr;
+  parseDriverPtr->treeCallback         = treeCallbackPtr;
+  parseDriverPtr->userDataPtr          = userDataPtr;
+  parseDriverPtr->treeIndex            = 0;
+  parseDriverPtr->statistics.nFastPath = 0;
+  parseDriverPtr->statistics.nFullPath = 0;
+  parseDriverPtr->statistics.nTrees    = 0;
+
+  return parseDriverPtr;
+}
+
+int parseDriverRun(parseDriver_t *parseDriverPtr, Marpa_Recognizer r)
+{
+  Marpa_Bocage b;
+  int          rc;
+
+  if (parseDriverPtr == NULL || r == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  marpa_g_error_clear(parseDriverPtr->g);
+  PARSEMETRICS_TIME(parseDriverPtr->option.metricsPtr, PARSEMETRICS_PHASE_BOCAGE, b = marpa_b_new(r, marpa_r_latest_earley_set(r)));
+  if (b == NULL) {
+    return -1;
+  }
+  rc = parseDriverRunBocage(parseDriverPtr, b);
+  marpa_b_unref(b);
+
+  return rc;
+}
+
+int parseDriverRunBocage(parseDriver_t *parseDriverPtr, Marpa_Bocage b)
+{
+  parseEnumeratorResult_t result;
+
+  if (parseDriverPtr == NULL || b == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  parseDriverPtr->treeIndex = 0;
+
+  if (marpa_b_ambiguity_metric(b) == 1) {
+    /* Exactly one tree: nothing to rank, count or budget */
+    Marpa_Order o;
+    Marpa_Tree  t;
+    int         rc = -1;
+
+    parseDriverPtr->statistics.nFastPath++;
+    marpa_g_error_clear(parseDriverPtr->g);
+    PARSEMETRICS_TIME(parseDriverPtr->option.metricsPtr, PARSEMETRICS_PHASE_ORDER, o = marpa_o_new(b));
+    if (o == NULL) {
+      return -1;
+    }
+    PARSEMETRICS_TIME(parseDriverPtr->option.metricsPtr, PARSEMETRICS_PHASE_TREE_NEW, t = marpa_t_new(o));
+    if (t != NULL) {
+      int next;
+
+      PARSEMETRICS_TIME(parseDriverPtr->option.metricsPtr, PARSEMETRICS_PHASE_TREE, next = marpa_t_next(t));
+      parseMetricsCount(parseDriverPtr->option.metricsPtr, PARSEMETRICS_COUNTER_TREES, 1);
+      if (next >= 0) {
+	/* A stop request from the tree callback is not a failure */
+	_parseDriverValue(parseDriverPtr, t);
+	rc = (parseDriverPtr->treeIndex > 0) ? 1 : -1;
+      }
+      marpa_t_unref(t);
+    }
+    marpa_o_unref(o);
+
+    return rc;
+  }
+
+  /* Full path */
+  parseDriverPtr->statistics.nFullPath++;
+  if (parseEnumeratorRun(parseDriverPtr->g, b, &(parseDriverPtr->option), &_parseDriverTreeCallback, parseDriverPtr, &result) < 0) {
+    return -1;
+  }
+  if (result.stop == PARSEENUMERATOR_STOP_CALLBACK && parseDriverPtr->treeIndex < result.nTrees) {
+    /* Valuation failure, not a stop request from the tree callback */
+    return -1;
+  }
+
+  return result.nTrees;
+}
+
+Marpa_Value parseDriverValueNew(Marpa_Grammar g, Marpa_Tree t)
+{
+  int         highestRuleId = marpa_g_highest_rule_id(g);
+  Marpa_Value v             = marpa_v_new(t);
+  int         ruleId;
+
+  if (v != NULL) {
+    for (ruleId = 0; ruleId <= highestRuleId; ruleId++) {
+      marpa_v_rule_is_valued_set(v, ruleId, 1);
+    }
+  }
+
+  return v;
+}
+
+void parseDriverStatistics(parseDriver_t *parseDriverPtr, parseDriverStatistics_t *statisticsPtr)
+{
+  if (parseDriverPtr != NULL && statisticsPtr != NULL) {
+    *statisticsPtr = parseDriverPtr->statistics;
+  }
+}
+
+void parseDriverFree(parseDriver_t **parseDriverPtrPtr)
+{
+  parseDriver_t *parseDriverPtr;
+
+  if (parseDriverPtrPtr == NULL) {
+    return;
+  }
+  parseDriverPtr = *parseDriverPtrPtr;
+  if (parseDriverPtr == NULL) {
+    return;
+  }
+
+  marpa_g_unref(parseDriverPtr->g);
+  free(parseDriverPtr);
+
+  *parseDriverPtrPtr = NULL;
+  return;
+}
+
+static int _parseDriverValue(parseDriver_t *parseDriverPtr, Marpa_Tree t)
+{
+  parseMetrics_t *metricsPtr = parseDriverPtr->option.metricsPtr;
+  uint64_t        start      = (metricsPtr != NULL) ? parseMetricsNow() : 0;
+  uint64_t        nSteps     = 0;
+  int             depth      = 0;
+  Marpa_Value     v;
+  int             rc         = 0;
+
+  marpa_g_error_clear(parseDriverPtr->g);
+  v = parseDriverValueNew(parseDriverPtr->g, t);
+  if (v == NULL) {
+    return -1;
+  }
+
+  while (rc >= 0) {
+    Marpa_Step_Type stepType = marpa_v_step(v);
+
+    if (stepType == MARPA_STEP_INACTIVE) {
+      break;
+    }
+    if (stepType < 0) {
+      rc = -1;
+      break;
+    }
+    rc = (*parseDriverPtr->stepCallback)(parseDriverPtr->userDataPtr, v, stepType);
+    if (metricsPtr != NULL) {
+      nSteps++;
+      if (stepType == MARPA_STEP_RULE && marpa_v_arg_n(v) >= depth) {
+	depth = marpa_v_arg_n(v) + 1;
+      } else if (stepType != MARPA_STEP_RULE && marpa_v_result(v) >= depth) {
+	depth = marpa_v_result(v) + 1;
+      }
+    }
+  }
+  marpa_v_unref(v);
+
+  if (metricsPtr != NULL) {
+    parseMetricsRecord(metricsPtr, PARSEMETRICS_PHASE_VALUATION, parseMetricsNow() - start);
+    parseMetricsCount(metricsPtr, PARSEMETRICS_COUNTER_VALUATION_STEPS, nSteps);
+    parseMetricsStackDepth(metricsPtr, (uint64_t) depth);
+  }
+
+  if (rc < 0) {
+    return -1;
+  }
+
+  parseDriverPtr->statistics.nTrees++;
+  if (parseDriverPtr->treeCallback != NULL) {
+    rc = (*parseDriverPtr->treeCallback)(parseDriverPtr->userDataPtr, parseDriverPtr->treeIndex);
+  }
+  parseDriverPtr->treeIndex++;
+
+  return rc;
+}
+
+static int _parseDriverTreeCallback(void *userDataPtr, Marpa_Tree t, int treeIndex)
+{
+  return _parseDriverValue((parseDriver_t *) userDataPtr, t);
+}
@@ -0,0 +1,45 @@
+#ifndef PARSE_DRIVER_H
+#define PARSE_DRIVER_H
+
+#include <marpa.h>
+#include "parseEnumerator.h"
+
+/*
+ * Valuation driver, created once per grammar and reused for every parse.
+ *
+ * Right after marpa_b_new(), the bocage ambiguity metric is checked.
+ * When it is 1 the only tree is valuated without parseEnumeratorRun():
+ * no ranking, no parse count walk, no budget checks, and no extra
+ * marpa_t_next() call to discover that there is no other tree. The
+ * order, tree and valuator are still created for every parse: libmarpa
+ * ties them to their bocage, and the valued rules to their valuator.
+ * Otherwise all trees go through parseEnumeratorRun().
+ */
+
+typedef struct parseDriver parseDriver_t;
+
+/* Called after each marpa_v_step() but MARPA_STEP_INACTIVE. A negative return value aborts */
+typedef int (*parseDriverStepCallback_t)(void *userDataPtr, Marpa_Value v, Marpa_Step_Type stepType);
+/* Called when a tree has been fully valuated. A negative return value stops the enumeration */
+typedef int (*parseDriverTreeCallback_t)(void *userDataPtr, int treeIndex);
+
+typedef struct parseDriverStatistics {
+  unsigned long nFastPath;   /* Unambiguous parses, without parseEnumeratorRun() */
+  unsigned long nFullPath;   /* Ambiguous parses, through parseEnumeratorRun() */
+  unsigned long nTrees;
+} parseDriverStatistics_t;
+
+/* optionPtr may be NULL. Its metricsPtr is used for all parses, the other members for ambiguous parses only */
+parseDriver_t *parseDriverCreate(Marpa_Grammar g, parseEnumeratorOption_t *optionPtr, parseDriverStepCallback_t stepCallbackPtr, parseDriverTreeCallback_t treeCallbackPtr, void *userDataPtr);
+
+/* marpa_v_new() with every rule of g valued, as the step callbacks expect. Returns NULL on failure */
+Marpa_Value    parseDriverValueNew(Marpa_Grammar g, Marpa_Tree t);
+
+/* Valuates the parses ending at the latest Earley set. Returns the number of trees, or -1 on failure */
+int   parseDriverRun(parseDriver_t *parseDriverPtr, Marpa_Recognizer r);
+/* Same but with an existing bocage */
+int   parseDriverRunBocage(parseDriver_t *parseDriverPtr, Marpa_Bocage b);
+void  parseDriverStatistics(parseDriver_t *parseDriverPtr, parseDriverStatistics_t *statisticsPtr);
+void  parseDriverFree(parseDriver_t **parseDriverPtrPtr);
+
+#endif /* PARSE_DRIVER_H */
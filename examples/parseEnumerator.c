@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "parseEnumerator.h"
+#include "parseCount.h"
+
+static double _parseEnumeratorNow(void);
+
+int parseEnumeratorRun(Marpa_Grammar g, Marpa_Bocage b, parseEnumeratorOption_t *optionPtr, parseEnumeratorTreeCallback_t treeCallbackPtr, void *userDataPtr, parseEnumeratorResult_t *resultPtr)
+{
+  parseEnumeratorOption_t defaultOption = PARSEENUMERATOR_OPTION_DEFAULT;
+  parseEnumeratorResult_t result;
+  double                  start         = _parseEnumeratorNow();
+  Marpa_Order             o;
+  Marpa_Tree              t;
+  int                     rc            = 0;
+
+  if (optionPtr == NULL) {
+    optionPtr = &defaultOption;
+  }
+
+  result.stop            = PARSEENUMERATOR_STOP_EXHAUSTED;
+  result.nTrees          = 0;
+  result.ambiguityMetric = 0;
+  result.nSkipped        = 0;
+  result.nSkippedIsExact = 1;
+  result.elapsedSeconds  = 0.0;
+
+  /* Ranked order: with high rank only, lower ranked choices are pruned before iteration */
+  marpa_g_error_clear(g);
+  PARSEMETRICS_TIME(optionPtr->metricsPtr, PARSEMETRICS_PHASE_ORDER, {
+      o = marpa_o_new(b);
+      if (o != NULL && (marpa_o_high_rank_only_set(o, optionPtr->highRankOnly) < 0 || marpa_o_rank(o) < 0)) {
+	marpa_o_unref(o);
+	o = NULL;
+      }
+    });
+  if (o == NULL) {
+    return -1;
+  }
+  result.ambiguityMetric = marpa_o_ambiguity_metric(o);
+
+  PARSEMETRICS_TIME(optionPtr->metricsPtr, PARSEMETRICS_PHASE_TREE_NEW, t = marpa_t_new(o));
+  if (t == NULL) {
+    marpa_o_unref(o);
+    return -1;
+  }
+
+  while (1) {
+    int next;
+
+    if (optionPtr->maxTrees > 0 && result.nTrees >= optionPtr->maxTrees) {
+      result.stop = PARSEENUMERATOR_STOP_MAX_TREES;
+      break;
+    }
+    if (optionPtr->maxSeconds > 0 && (_parseEnumeratorNow() - start) >= optionPtr->maxSeconds) {
+      result.stop = PARSEENUMERATOR_STOP_MAX_SECONDS;
+      break;
+    }
+
+    PARSEMETRICS_TIME(optionPtr->metricsPtr, PARSEMETRICS_PHASE_TREE, next = marpa_t_next(t));
+    if (next == -1) {
+      /* No more tree */
+      break;
+    } else if (next < 0) {
+      rc = -1;
+      break;
+    }
+
+    if (treeCallbackPtr != NULL && (*treeCallbackPtr)(userDataPtr, t, result.nTrees++) < 0) {
+      result.stop = PARSEENUMERATOR_STOP_CALLBACK;
+      break;
+    } else if (treeCallbackPtr == NULL) {
+      result.nTrees++;
+    }
+  }
+
+  /* The bocage parse count costs one linear walk, whatever the ambiguity */
+  if (rc == 0) {
+    uint64_t nParses;
+    int      parseCountRc = parseCount(g, b, &nParses, NULL, NULL);
+
+    if (parseCountRc >= 0) {
+      result.nSkipped        = (nParses == PARSECOUNT_SATURATED) ? nParses : nParses - (uint64_t) result.nTrees;
+      result.nSkippedIsExact = (parseCountRc == 0);
+    } else if (result.stop != PARSEENUMERATOR_STOP_EXHAUSTED && marpa_t_next(t) >= 0) {
+      /* One more tree is the most we can afford to look at to tell if anything was skipped */
+      result.nSkipped        = 1;
+      result.nSkippedIsExact = 0;
+    }
+  }
+
+  marpa_t_unref(t);
+  marpa_o_unref(o);
+
+  parseMetricsCount(optionPtr->metricsPtr, PARSEMETRICS_COUNTER_TREES, (uint64_t) result.nTrees);
+  result.elapsedSeconds = _parseEnumeratorNow() - start;
+  if (resultPtr != NULL) {
+    *resultPtr = result;
+  }
+
+  return rc;
+}
+
+static double _parseEnumeratorNow(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
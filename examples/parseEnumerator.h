@@ -0,0 +1,45 @@
+#ifndef PARSE_ENUMERATOR_H
+#define PARSE_ENUMERATOR_H
+
+#include <stdint.h>
+#include <marpa.h>
+#include "parseMetrics.h"
+
+/*
+ * Bounded enumeration of the parses of a bocage, in rank order.
+ * Enumeration stops after maxTrees trees or maxSeconds seconds, whichever comes first,
+ * so that latency does not depend on how ambiguous the input is.
+ */
+
+typedef struct parseEnumeratorOption {
+  int             highRankOnly;    /* Argument to marpa_o_high_rank_only_set() */
+  int             maxTrees;        /* Top-k: 0 means no limit */
+  double          maxSeconds;      /* Wall-clock budget: 0 means no limit */
+  parseMetrics_t *metricsPtr;      /* Order and tree phases, trees counter: NULL means no metrics */
+} parseEnumeratorOption_t;
+
+#define PARSEENUMERATOR_OPTION_DEFAULT { 1, 0, 0.0, NULL }
+
+typedef enum parseEnumeratorStop {
+  PARSEENUMERATOR_STOP_EXHAUSTED = 0,     /* All trees were delivered */
+  PARSEENUMERATOR_STOP_MAX_TREES,
+  PARSEENUMERATOR_STOP_MAX_SECONDS,
+  PARSEENUMERATOR_STOP_CALLBACK
+} parseEnumeratorStop_t;
+
+typedef struct parseEnumeratorResult {
+  parseEnumeratorStop_t stop;
+  int                   nTrees;            /* Trees delivered to the callback */
+  int                   ambiguityMetric;   /* marpa_o_ambiguity_metric() after ranking */
+  uint64_t              nSkipped;          /* Trees of the bocage not delivered, because of budgets or rank pruning */
+  int                   nSkippedIsExact;   /* When 0, nSkipped is a lower bound */
+  double                elapsedSeconds;
+} parseEnumeratorResult_t;
+
+/* Called once per tree, with t positioned by marpa_t_next(). A negative return value stops the enumeration */
+typedef int (*parseEnumeratorTreeCallback_t)(void *userDataPtr, Marpa_Tree t, int treeIndex);
+
+/* Returns 0 on success, -1 on failure with the error in marpa_g_error(g) */
+int parseEnumeratorRun(Marpa_Grammar g, Marpa_Bocage b, parseEnumeratorOption_t *optionPtr, parseEnumeratorTreeCallback_t treeCallbackPtr, void *userDataPtr, parseEnumeratorResult_t *resultPtr);
+
+#endif /* PARSE_ENUMERATOR_H */
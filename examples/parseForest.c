@@ -0,0 +1,343 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "parseForest.h"
+
+#define PARSEFOREST_STATE_NEW      0
+#define PARSEFOREST_STATE_VISITING 1
+#define PARSEFOREST_STATE_DONE     2
+
+struct parseForest {
+  char   *buf;
+  size_t  size;
+  int     isMapped;
+};
+
+static void _parseForestOrNode(Marpa_Grammar g, Marpa_Bocage b, Marpa_Or_Node_ID orNodeId, parseForestOrNode_t *orNodePtr);
+static int  _parseForestCheck (const parseForestHeader_t *headerPtr);
+
+parseForest_t *parseForestCreate(Marpa_Grammar g, Marpa_Bocage b)
+{
+  parseForest_t        *parseForestPtr = NULL;
+  parseForestHeader_t  *headerPtr;
+  parseForestOrNode_t  *orNodes;
+  parseForestAndNode_t *andNodes;
+  Marpa_Or_Node_ID      topOrNodeId    = -1;
+  int                   nBocageOrNodes = 0;
+  int                   nBocageAndNodes;
+  int                   setId;
+  int                  *newIds         = NULL;   /* Bocage or-node id to forest or-node id */
+  Marpa_Or_Node_ID     *order          = NULL;   /* Forest or-node id to bocage or-node id */
+  unsigned char        *states         = NULL;
+  Marpa_Or_Node_ID     *stack          = NULL;
+  int                   stackSize      = 0;
+  uint32_t              nOrNodes       = 0;
+  uint32_t              nAndNodes      = 0;
+  uint32_t              i;
+
+  if (g == NULL || b == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  marpa_g_error_clear(g);
+
+  /* The null parse has no or-node */
+  if (marpa_b_is_null(b) <= 0) {
+    topOrNodeId     = _marpa_b_top_or_node(b);
+    nBocageAndNodes = _marpa_b_and_node_count(b);
+    if (topOrNodeId < 0 || nBocageAndNodes < 0) {
+      errno = EIO;
+      return NULL;
+    }
+    while ((setId = _marpa_b_or_node_set(b, nBocageOrNodes)) >= 0) {
+      nBocageOrNodes++;
+    }
+    if (setId < -1) {
+      errno = EIO;
+      return NULL;
+    }
+
+    newIds = malloc(nBocageOrNodes * sizeof(int));
+    order  = malloc(nBocageOrNodes * sizeof(Marpa_Or_Node_ID));
+    states = calloc(nBocageOrNodes, sizeof(unsigned char));
+    stack  = malloc((1 + 2 * nBocageAndNodes) * sizeof(Marpa_Or_Node_ID));
+    if (newIds == NULL || order == NULL || states == NULL || stack == NULL) {
+      goto done;
+    }
+
+    /* Iterative post-order DFS from the top: only reachable or-nodes are kept */
+    stack[stackSize++] = topOrNodeId;
+    while (stackSize > 0) {
+      Marpa_Or_Node_ID  orNodeId = stack[stackSize - 1];
+      Marpa_And_Node_ID firstAndNodeId;
+      Marpa_And_Node_ID lastAndNodeId;
+      Marpa_And_Node_ID andNodeId;
+
+      if (states[orNodeId] == PARSEFOREST_STATE_DONE) {
+	stackSize--;
+	continue;
+      }
+      if (states[orNodeId] == PARSEFOREST_STATE_VISITING) {
+	states[orNodeId]  = PARSEFOREST_STATE_DONE;
+	newIds[orNodeId]  = nOrNodes;
+	order[nOrNodes++] = orNodeId;
+	stackSize--;
+	continue;
+      }
+
+      firstAndNodeId = _marpa_b_or_node_first_and(b, orNodeId);
+      lastAndNodeId  = _marpa_b_or_node_last_and(b, orNodeId);
+      if (firstAndNodeId < 0 || lastAndNodeId < 0) {
+	errno = EIO;
+	goto done;
+      }
+      states[orNodeId] = PARSEFOREST_STATE_VISITING;
+      nAndNodes += lastAndNodeId - firstAndNodeId + 1;
+      for (andNodeId = firstAndNodeId; andNodeId <= lastAndNodeId; andNodeId++) {
+	Marpa_Or_Node_ID children[2];
+	int              j;
+
+	children[0] = _marpa_b_and_node_cause(b, andNodeId);
+	children[1] = _marpa_b_and_node_predecessor(b, andNodeId);
+	for (j = 0; j < 2; j++) {
+	  if (children[j] >= 0 && states[children[j]] == PARSEFOREST_STATE_VISITING) {
+	    /* A child that is also an ancestor: no post-order puts children first */
+	    errno = ELOOP;
+	    goto done;
+	  }
+	  if (children[j] >= 0 && states[children[j]] == PARSEFOREST_STATE_NEW) {
+	    stack[stackSize++] = children[j];
+	  }
+	}
+      }
+    }
+  }
+
+  parseForestPtr = malloc(sizeof(parseForest_t));
+  if (parseForestPtr == NULL) {
+    goto done;
+  }
+  parseForestPtr->size     = sizeof(parseForestHeader_t) + nOrNodes * sizeof(parseForestOrNode_t) + nAndNodes * sizeof(parseForestAndNode_t);
+  parseForestPtr->isMapped = 0;
+  parseForestPtr->buf      = calloc(1, parseForestPtr->size);
+  if (parseForestPtr->buf == NULL) {
+    free(parseForestPtr);
+    parseForestPtr = NULL;
+    goto done;
+  }
+
+  headerPtr = (parseForestHeader_t *) parseForestPtr->buf;
+  memcpy(headerPtr->magic, PARSEFOREST_MAGIC, sizeof(headerPtr->magic));
+  headerPtr->version        = PARSEFOREST_VERSION;
+  headerPtr->nOrNodes       = nOrNodes;
+  headerPtr->nAndNodes      = nAndNodes;
+  headerPtr->topOrNode      = (nOrNodes > 0) ? (int32_t) newIds[topOrNodeId] : -1;
+  headerPtr->orNodesOffset  = sizeof(parseForestHeader_t);
+  headerPtr->andNodesOffset = sizeof(parseForestHeader_t) + nOrNodes * sizeof(parseForestOrNode_t);
+
+  orNodes   = (parseForestOrNode_t *) (parseForestPtr->buf + headerPtr->orNodesOffset);
+  andNodes  = (parseForestAndNode_t *) (parseForestPtr->buf + headerPtr->andNodesOffset);
+  nAndNodes = 0;
+  for (i = 0; i < nOrNodes; i++) {
+    Marpa_Or_Node_ID  orNodeId      = order[i];
+    Marpa_And_Node_ID lastAndNodeId = _marpa_b_or_node_last_and(b, orNodeId);
+    Marpa_And_Node_ID andNodeId;
+
+    _parseForestOrNode(g, b, orNodeId, &(orNodes[i]));
+    orNodes[i].firstAndNode = nAndNodes;
+    for (andNodeId = _marpa_b_or_node_first_and(b, orNodeId); andNodeId <= lastAndNodeId; andNodeId++) {
+      parseForestAndNode_t *andNodePtr          = &(andNodes[nAndNodes++]);
+      Marpa_Or_Node_ID      predecessorOrNodeId = _marpa_b_and_node_predecessor(b, andNodeId);
+      Marpa_Or_Node_ID      causeOrNodeId       = _marpa_b_and_node_cause(b, andNodeId);
+      int                   tokenValue          = 0;
+      int                   tokenId;
+
+      andNodePtr->predecessor       = (predecessorOrNodeId >= 0) ? newIds[predecessorOrNodeId] : -1;
+      andNodePtr->cause             = (causeOrNodeId >= 0) ? newIds[causeOrNodeId] : -1;
+      andNodePtr->tokenSymbolId     = -1;
+      andNodePtr->tokenValue        = 0;
+      andNodePtr->middleEarleySetId = _marpa_b_and_node_middle(b, andNodeId);
+      if (causeOrNodeId < 0) {
+	tokenId = _marpa_b_and_node_token(b, andNodeId, &tokenValue);
+	if (tokenId >= 0) {
+	  /* The bocage knows internal symbols only */
+	  andNodePtr->tokenSymbolId = _marpa_g_nsy_xsy(g, tokenId);
+	  andNodePtr->tokenValue    = tokenValue;
+	}
+      }
+    }
+    orNodes[i].nAndNodes = nAndNodes - orNodes[i].firstAndNode;
+  }
+
+ done:
+  free(newIds);
+  free(order);
+  free(states);
+  free(stack);
+
+  return parseForestPtr;
+}
+
+parseForest_t *parseForestMap(const char *path)
+{
+  parseForest_t       *parseForestPtr;
+  parseForestHeader_t *headerPtr;
+  struct stat          st;
+  void                *map;
+  int                  fd;
+
+  if (path == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  if (fstat(fd, &st) < 0) {
+    close(fd);
+    return NULL;
+  }
+  if ((size_t) st.st_size < sizeof(parseForestHeader_t)) {
+    close(fd);
+    errno = EILSEQ;
+    return NULL;
+  }
+  map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return NULL;
+  }
+
+  headerPtr = (parseForestHeader_t *) map;
+  if (memcmp(headerPtr->magic, PARSEFOREST_MAGIC, sizeof(headerPtr->magic)) != 0 ||
+      headerPtr->version != PARSEFOREST_VERSION ||
+      headerPtr->orNodesOffset < sizeof(parseForestHeader_t) ||
+      headerPtr->orNodesOffset + (uint64_t) headerPtr->nOrNodes * sizeof(parseForestOrNode_t) > headerPtr->andNodesOffset ||
+      headerPtr->andNodesOffset + (uint64_t) headerPtr->nAndNodes * sizeof(parseForestAndNode_t) > (uint64_t) st.st_size ||
+      _parseForestCheck(headerPtr) < 0) {
+    munmap(map, (size_t) st.st_size);
+    errno = EILSEQ;
+    return NULL;
+  }
+
+  parseForestPtr = malloc(sizeof(parseForest_t));
+  if (parseForestPtr == NULL) {
+    munmap(map, (size_t) st.st_size);
+    return NULL;
+  }
+  parseForestPtr->buf      = map;
+  parseForestPtr->size     = (size_t) st.st_size;
+  parseForestPtr->isMapped = 1;
+
+  return parseForestPtr;
+}
+
+int parseForestWrite(parseForest_t *parseForestPtr, FILE *fp)
+{
+  if (parseForestPtr == NULL || fp == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (fwrite(parseForestPtr->buf, 1, parseForestPtr->size, fp) != parseForestPtr->size) {
+    return -1;
+  }
+
+  return 0;
+}
+
+size_t parseForestSize(parseForest_t *parseForestPtr)
+{
+  return (parseForestPtr != NULL) ? parseForestPtr->size : 0;
+}
+
+const parseForestHeader_t *parseForestHeader(parseForest_t *parseForestPtr)
+{
+  return (parseForestPtr != NULL) ? (const parseForestHeader_t *) parseForestPtr->buf : NULL;
+}
+
+const parseForestOrNode_t *parseForestOrNodes(parseForest_t *parseForestPtr)
+{
+  if (parseForestPtr == NULL) {
+    return NULL;
+  }
+  return (const parseForestOrNode_t *) (parseForestPtr->buf + ((parseForestHeader_t *) parseForestPtr->buf)->orNodesOffset);
+}
+
+const parseForestAndNode_t *parseForestAndNodes(parseForest_t *parseForestPtr)
+{
+  if (parseForestPtr == NULL) {
+    return NULL;
+  }
+  return (const parseForestAndNode_t *) (parseForestPtr->buf + ((parseForestHeader_t *) parseForestPtr->buf)->andNodesOffset);
+}
+
+void parseForestFree(parseForest_t **parseForestPtrPtr)
+{
+  parseForest_t *parseForestPtr;
+
+  if (parseForestPtrPtr == NULL) {
+    return;
+  }
+  parseForestPtr = *parseForestPtrPtr;
+  if (parseForestPtr == NULL) {
+    return;
+  }
+
+  if (parseForestPtr->isMapped) {
+    munmap(parseForestPtr->buf, parseForestPtr->size);
+  } else {
+    free(parseForestPtr->buf);
+  }
+  free(parseForestPtr);
+
+  *parseForestPtrPtr = NULL;
+  return;
+}
+
+static void _parseForestOrNode(Marpa_Grammar g, Marpa_Bocage b, Marpa_Or_Node_ID orNodeId, parseForestOrNode_t *orNodePtr)
+{
+  Marpa_IRL_ID irlId = _marpa_b_or_node_irl(b, orNodeId);
+
+  orNodePtr->ruleId           = _marpa_g_source_xrl(g, irlId);
+  orNodePtr->symbolId         = _marpa_g_nsy_xsy(g, _marpa_g_irl_lhs(g, irlId));
+  orNodePtr->position         = _marpa_b_or_node_position(b, orNodeId);
+  orNodePtr->startEarleySetId = _marpa_b_or_node_origin(b, orNodeId);
+  orNodePtr->endEarleySetId   = _marpa_b_or_node_set(b, orNodeId);
+  orNodePtr->flags            = (_marpa_b_or_node_is_whole(b, orNodeId) > 0) ? PARSEFOREST_OR_NODE_WHOLE : 0;
+}
+
+/* Node indices of a mapped forest are input: the top, the and-nodes ranges, and children before their parents */
+static int _parseForestCheck(const parseForestHeader_t *headerPtr)
+{
+  const parseForestOrNode_t  *orNodes  = (const parseForestOrNode_t *) ((const char *) headerPtr + headerPtr->orNodesOffset);
+  const parseForestAndNode_t *andNodes = (const parseForestAndNode_t *) ((const char *) headerPtr + headerPtr->andNodesOffset);
+  uint32_t                    i;
+  uint32_t                    j;
+
+  if (headerPtr->topOrNode < -1 || (headerPtr->topOrNode >= 0 && (uint32_t) headerPtr->topOrNode >= headerPtr->nOrNodes)) {
+    return -1;
+  }
+  for (i = 0; i < headerPtr->nOrNodes; i++) {
+    if ((uint64_t) orNodes[i].firstAndNode + orNodes[i].nAndNodes > headerPtr->nAndNodes) {
+      return -1;
+    }
+    for (j = orNodes[i].firstAndNode; j < orNodes[i].firstAndNode + orNodes[i].nAndNodes; j++) {
+      if (andNodes[j].predecessor < -1 || (andNodes[j].predecessor >= 0 && (uint32_t) andNodes[j].predecessor >= i) ||
+	  andNodes[j].cause < -1 || (andNodes[j].cause >= 0 && (uint32_t) andNodes[j].cause >= i)) {
+	return -1;
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,71 @@
+#ifndef PARSE_FOREST_H
+#define PARSE_FOREST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <marpa.h>
+
+/*
+ * Shared parse forest exported from a bocage: every parse of the input,
+ * with every common subtree stored once.
+ *
+ * The forest is one flat buffer, identical in memory and on disk:
+ *   parseForestHeader_t, or-nodes array, and-nodes array
+ * Only fixed-width integers, no pointer and no string: a file written
+ * by parseForestWrite() is used in place after parseForestMap().
+ *
+ * Or-nodes reachable from the top are renumbered in post-order: children
+ * always come before their parents, and a single forward pass over the
+ * or-nodes is enough for bottom-up semantics. A bocage with a cycle has no
+ * such order, and is not exported. The and-nodes of an or-node are its
+ * alternatives, and are contiguous.
+ */
+
+#define PARSEFOREST_MAGIC    "MARPAFST"
+#define PARSEFOREST_VERSION  1
+
+#define PARSEFOREST_OR_NODE_WHOLE 0x01   /* Complete rule instance, i.e. dot at the end */
+
+typedef struct parseForest parseForest_t;
+
+typedef struct parseForestHeader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t nOrNodes;
+  uint32_t nAndNodes;
+  int32_t  topOrNode;         /* -1 for the null parse */
+  uint64_t orNodesOffset;     /* In bytes from the header */
+  uint64_t andNodesOffset;
+} parseForestHeader_t;
+
+typedef struct parseForestOrNode {
+  int32_t  ruleId;            /* Rule of the grammar, before internal rewriting */
+  int32_t  symbolId;          /* LHS of ruleId, -1 for internal rewriting symbols */
+  int32_t  position;          /* Dot position in the internal rule */
+  int32_t  startEarleySetId;
+  int32_t  endEarleySetId;
+  uint32_t flags;
+  uint32_t firstAndNode;
+  uint32_t nAndNodes;
+} parseForestOrNode_t;
+
+typedef struct parseForestAndNode {
+  int32_t  predecessor;       /* Or-node, or -1 */
+  int32_t  cause;             /* Or-node, or -1 when the cause is a token */
+  int32_t  tokenSymbolId;     /* -1 when the cause is an or-node */
+  int32_t  tokenValue;
+  int32_t  middleEarleySetId;
+} parseForestAndNode_t;
+
+/* Returns NULL with errno set to EIO when libmarpa failed, see marpa_g_error(g), or to ELOOP when the bocage is cyclic */
+parseForest_t              *parseForestCreate(Marpa_Grammar g, Marpa_Bocage b);
+/* Returns NULL with errno set to EILSEQ if path is not a forest of this version, or if its node indices are out of order */
+parseForest_t              *parseForestMap(const char *path);
+int                         parseForestWrite(parseForest_t *parseForestPtr, FILE *fp);
+size_t                      parseForestSize(parseForest_t *parseForestPtr);
+const parseForestHeader_t  *parseForestHeader(parseForest_t *parseForestPtr);
+const parseForestOrNode_t  *parseForestOrNodes(parseForest_t *parseForestPtr);
+const parseForestAndNode_t *parseForestAndNodes(parseForest_t *parseForestPtr);
+void                        parseForestFree(parseForest_t **parseForestPtrPtr);
+
+#endif /* PARSE_FOREST_H */
@@ -0,0 +1,267 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "parseMetrics.h"
+
+#define PARSEMETRICS_SUB_BUCKET_BITS  4
+#define PARSEMETRICS_SUB_BUCKET_COUNT (1 << PARSEMETRICS_SUB_BUCKET_BITS)
+#define PARSEMETRICS_BUCKET_COUNT     (PARSEMETRICS_SUB_BUCKET_COUNT + (64 - PARSEMETRICS_SUB_BUCKET_BITS) * PARSEMETRICS_SUB_BUCKET_COUNT)
+
+typedef struct parseMetricsHistogram {
+  uint64_t count;
+  uint64_t sum;
+  uint64_t min;
+  uint64_t max;
+  uint64_t buckets[PARSEMETRICS_BUCKET_COUNT];
+} parseMetricsHistogram_t;
+
+struct parseMetrics {
+  parseMetricsHistogram_t histograms[PARSEMETRICS_PHASE_COUNT];
+  uint64_t                counters[PARSEMETRICS_COUNTER_COUNT];
+  uint64_t                stackHighWater;
+};
+
+static const char *_parseMetricsPhaseNames[PARSEMETRICS_PHASE_COUNT] = {
+  "precompute",
+  "feed",
+  "bocage",
+  "order",
+  "tree_new",
+  "tree",
+  "valuation"
+};
+
+static const char *_parseMetricsCounterNames[PARSEMETRICS_COUNTER_COUNT] = {
+  "trees",
+  "valuation_steps"
+};
+
+static parseMetrics_t *_parseMetricsAtExitPtr = NULL;
+
+static int      _parseMetricsBucket(uint64_t value);
+static uint64_t _parseMetricsBucketValue(int bucket);
+static uint64_t _parseMetricsPercentile(parseMetricsHistogram_t *histogramPtr, double percentile);
+static void     _parseMetricsAtExit(void);
+
+parseMetrics_t *parseMetricsCreate(void)
+{
+  parseMetrics_t *parseMetricsPtr = malloc(sizeof(parseMetrics_t));
+
+  if (parseMetricsPtr == NULL) {
+    return NULL;
+  }
+  parseMetricsReset(parseMetricsPtr);
+
+  return parseMetricsPtr;
+}
+
+uint64_t parseMetricsNow(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
+void parseMetricsRecord(parseMetrics_t *parseMetricsPtr, parseMetricsPhase_t phase, uint64_t nanoseconds)
+{
+  parseMetricsHistogram_t *histogramPtr;
+  uint64_t                 current;
+
+  if (parseMetricsPtr == NULL || phase < 0 || phase >= PARSEMETRICS_PHASE_COUNT) {
+    return;
+  }
+  histogramPtr = &(parseMetricsPtr->histograms[phase]);
+
+  __atomic_add_fetch(&(histogramPtr->count), 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&(histogramPtr->sum), nanoseconds, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&(histogramPtr->buckets[_parseMetricsBucket(nanoseconds)]), 1, __ATOMIC_RELAXED);
+
+  current = __atomic_load_n(&(histogramPtr->min), __ATOMIC_RELAXED);
+  while (nanoseconds < current && ! __atomic_compare_exchange_n(&(histogramPtr->min), &current, nanoseconds, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+  }
+  current = __atomic_load_n(&(histogramPtr->max), __ATOMIC_RELAXED);
+  while (nanoseconds > current && ! __atomic_compare_exchange_n(&(histogramPtr->max), &current, nanoseconds, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+  }
+}
+
+void parseMetricsCount(parseMetrics_t *parseMetricsPtr, parseMetricsCounter_t counter, uint64_t n)
+{
+  if (parseMetricsPtr == NULL || counter < 0 || counter >= PARSEMETRICS_COUNTER_COUNT) {
+    return;
+  }
+  __atomic_add_fetch(&(parseMetricsPtr->counters[counter]), n, __ATOMIC_RELAXED);
+}
+
+void parseMetricsStackDepth(parseMetrics_t *parseMetricsPtr, uint64_t depth)
+{
+  uint64_t current;
+
+  if (parseMetricsPtr == NULL) {
+    return;
+  }
+  current = __atomic_load_n(&(parseMetricsPtr->stackHighWater), __ATOMIC_RELAXED);
+  while (depth > current && ! __atomic_compare_exchange_n(&(parseMetricsPtr->stackHighWater), &current, depth, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+  }
+}
+
+uint64_t parseMetricsTotal(parseMetrics_t *parseMetricsPtr, parseMetricsPhase_t phase)
+{
+  if (parseMetricsPtr == NULL || phase < 0 || phase >= PARSEMETRICS_PHASE_COUNT) {
+    return 0;
+  }
+  return __atomic_load_n(&(parseMetricsPtr->histograms[phase].sum), __ATOMIC_RELAXED);
+}
+
+const char *parseMetricsPhaseName(parseMetricsPhase_t phase)
+{
+  if (phase < 0 || phase >= PARSEMETRICS_PHASE_COUNT) {
+    return "unknown";
+  }
+  return _parseMetricsPhaseNames[phase];
+}
+
+int parseMetricsDump(parseMetrics_t *parseMetricsPtr, FILE *fp)
+{
+  int i;
+
+  if (parseMetricsPtr == NULL || fp == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  fprintf(fp, "%-12s %12s %12s %12s %12s %12s %12s %12s %12s\n", "phase(ns)", "count", "min", "mean", "p50", "p90", "p99", "p99.9", "max");
+  for (i = 0; i < PARSEMETRICS_PHASE_COUNT; i++) {
+    parseMetricsHistogram_t *histogramPtr = &(parseMetricsPtr->histograms[i]);
+    uint64_t                 count        = __atomic_load_n(&(histogramPtr->count), __ATOMIC_RELAXED);
+
+    if (count <= 0) {
+      fprintf(fp, "%-12s %12d %12s %12s %12s %12s %12s %12s %12s\n", _parseMetricsPhaseNames[i], 0, "-", "-", "-", "-", "-", "-", "-");
+      continue;
+    }
+    fprintf(fp, "%-12s %12llu %12llu %12llu %12llu %12llu %12llu %12llu %12llu\n",
+	    _parseMetricsPhaseNames[i],
+	    (unsigned long long) count,
+	    (unsigned long long) histogramPtr->min,
+	    (unsigned long long) (histogramPtr->sum / count),
+	    (unsigned long long) _parseMetricsPercentile(histogramPtr, 50.0),
+	    (unsigned long long) _parseMetricsPercentile(histogramPtr, 90.0),
+	    (unsigned long long) _parseMetricsPercentile(histogramPtr, 99.0),
+	    (unsigned long long) _parseMetricsPercentile(histogramPtr, 99.9),
+	    (unsigned long long) histogramPtr->max);
+  }
+  for (i = 0; i < PARSEMETRICS_COUNTER_COUNT; i++) {
+    fprintf(fp, "%s %llu\n", _parseMetricsCounterNames[i], (unsigned long long) __atomic_load_n(&(parseMetricsPtr->counters[i]), __ATOMIC_RELAXED));
+  }
+  fprintf(fp, "stack_high_water %llu\n", (unsigned long long) __atomic_load_n(&(parseMetricsPtr->stackHighWater), __ATOMIC_RELAXED));
+
+  return ferror(fp) ? -1 : 0;
+}
+
+int parseMetricsDumpAtExit(parseMetrics_t *parseMetricsPtr)
+{
+  if (parseMetricsPtr == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (_parseMetricsAtExitPtr == NULL && atexit(&_parseMetricsAtExit) != 0) {
+    return -1;
+  }
+  _parseMetricsAtExitPtr = parseMetricsPtr;
+
+  return 0;
+}
+
+void parseMetricsReset(parseMetrics_t *parseMetricsPtr)
+{
+  int i;
+
+  if (parseMetricsPtr == NULL) {
+    return;
+  }
+  memset(parseMetricsPtr, 0, sizeof(parseMetrics_t));
+  for (i = 0; i < PARSEMETRICS_PHASE_COUNT; i++) {
+    parseMetricsPtr->histograms[i].min = UINT64_MAX;
+  }
+}
+
+void parseMetricsFree(parseMetrics_t **parseMetricsPtrPtr)
+{
+  parseMetrics_t *parseMetricsPtr;
+
+  if (parseMetricsPtrPtr == NULL) {
+    return;
+  }
+  parseMetricsPtr = *parseMetricsPtrPtr;
+  if (parseMetricsPtr == NULL) {
+    return;
+  }
+
+  if (_parseMetricsAtExitPtr == parseMetricsPtr) {
+    _parseMetricsAtExitPtr = NULL;
+  }
+  free(parseMetricsPtr);
+
+  *parseMetricsPtrPtr = NULL;
+  return;
+}
+
+static int _parseMetricsBucket(uint64_t value)
+{
+  int exponent;
+
+  if (value < PARSEMETRICS_SUB_BUCKET_COUNT) {
+    return (int) value;
+  }
+  exponent = 63 - __builtin_clzll(value);
+  return PARSEMETRICS_SUB_BUCKET_COUNT
+    + (exponent - PARSEMETRICS_SUB_BUCKET_BITS) * PARSEMETRICS_SUB_BUCKET_COUNT
+    + (int) ((value >> (exponent - PARSEMETRICS_SUB_BUCKET_BITS)) & (PARSEMETRICS_SUB_BUCKET_COUNT - 1));
+}
+
+/* Lowest value of a bucket */
+static uint64_t _parseMetricsBucketValue(int bucket)
+{
+  int exponent;
+  int subBucket;
+
+  if (bucket < PARSEMETRICS_SUB_BUCKET_COUNT) {
+    return (uint64_t) bucket;
+  }
+  exponent  = PARSEMETRICS_SUB_BUCKET_BITS + (bucket - PARSEMETRICS_SUB_BUCKET_COUNT) / PARSEMETRICS_SUB_BUCKET_COUNT;
+  subBucket = (bucket - PARSEMETRICS_SUB_BUCKET_COUNT) % PARSEMETRICS_SUB_BUCKET_COUNT;
+  return ((uint64_t) (PARSEMETRICS_SUB_BUCKET_COUNT + subBucket)) << (exponent - PARSEMETRICS_SUB_BUCKET_BITS);
+}
+
+static uint64_t _parseMetricsPercentile(parseMetricsHistogram_t *histogramPtr, double percentile)
+{
+  uint64_t count     = histogramPtr->count;
+  uint64_t threshold = (uint64_t) ((percentile / 100.0) * (double) count + 0.5);
+  uint64_t seen      = 0;
+  int      bucket;
+
+  if (threshold <= 0) {
+    threshold = 1;
+  }
+  for (bucket = 0; bucket < PARSEMETRICS_BUCKET_COUNT; bucket++) {
+    seen += histogramPtr->buckets[bucket];
+    if (seen >= threshold) {
+      uint64_t low   = _parseMetricsBucketValue(bucket);
+      uint64_t high  = (bucket + 1 < PARSEMETRICS_BUCKET_COUNT) ? _parseMetricsBucketValue(bucket + 1) - 1 : UINT64_MAX;
+      uint64_t value = low + (high - low) / 2;
+      /* Never report outside of the observed range */
+      return (value < histogramPtr->min) ? histogramPtr->min : (value > histogramPtr->max) ? histogramPtr->max : value;
+    }
+  }
+
+  return histogramPtr->max;
+}
+
+static void _parseMetricsAtExit(void)
+{
+  if (_parseMetricsAtExitPtr != NULL) {
+    parseMetricsDump(_parseMetricsAtExitPtr, stderr);
+  }
+}
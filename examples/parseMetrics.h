@@ -0,0 +1,59 @@
+#ifndef PARSE_METRICS_H
+#define PARSE_METRICS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * Per-phase latency histograms and counters for the parse pipeline.
+ * Histograms are log-linear (HDR-like): 16 sub-buckets per power of two,
+ * i.e. at most 6.25% relative error, from 1 ns to 2^64 ns, in constant memory.
+ * Updates are lock-free, so one parseMetrics_t can be shared by threads.
+ */
+
+typedef struct parseMetrics parseMetrics_t;
+
+typedef enum parseMetricsPhase {
+  PARSEMETRICS_PHASE_PRECOMPUTE = 0,
+  PARSEMETRICS_PHASE_FEED,
+  PARSEMETRICS_PHASE_BOCAGE,
+  PARSEMETRICS_PHASE_ORDER,
+  PARSEMETRICS_PHASE_TREE_NEW,     /* marpa_t_new(): once per parse */
+  PARSEMETRICS_PHASE_TREE,         /* marpa_t_next(): once per tree */
+  PARSEMETRICS_PHASE_VALUATION,
+  PARSEMETRICS_PHASE_COUNT
+} parseMetricsPhase_t;
+
+typedef enum parseMetricsCounter {
+  PARSEMETRICS_COUNTER_TREES = 0,
+  PARSEMETRICS_COUNTER_VALUATION_STEPS,
+  PARSEMETRICS_COUNTER_COUNT
+} parseMetricsCounter_t;
+
+/* Times statement into phase, or just executes it when metricsPtr is NULL */
+#define PARSEMETRICS_TIME(metricsPtr, phase, statement) {		\
+    if ((metricsPtr) == NULL) {						\
+      statement;							\
+    } else {								\
+      uint64_t _parseMetricsStart = parseMetricsNow();			\
+      statement;							\
+      parseMetricsRecord((metricsPtr), (phase), parseMetricsNow() - _parseMetricsStart); \
+    }									\
+  }
+
+parseMetrics_t *parseMetricsCreate(void);
+uint64_t        parseMetricsNow(void);    /* Monotonic clock, in nanoseconds */
+void            parseMetricsRecord(parseMetrics_t *parseMetricsPtr, parseMetricsPhase_t phase, uint64_t nanoseconds);
+void            parseMetricsCount(parseMetrics_t *parseMetricsPtr, parseMetricsCounter_t counter, uint64_t n);
+/* Valuator stack high-water mark */
+void            parseMetricsStackDepth(parseMetrics_t *parseMetricsPtr, uint64_t depth);
+/* Sum of the recorded latencies of a phase, in nanoseconds */
+uint64_t        parseMetricsTotal(parseMetrics_t *parseMetricsPtr, parseMetricsPhase_t phase);
+const char     *parseMetricsPhaseName(parseMetricsPhase_t phase);
+int             parseMetricsDump(parseMetrics_t *parseMetricsPtr, FILE *fp);
+/* Dumps to stderr at exit. Only one parseMetrics_t can be registered */
+int             parseMetricsDumpAtExit(parseMetrics_t *parseMetricsPtr);
+void            parseMetricsReset(parseMetrics_t *parseMetricsPtr);
+void            parseMetricsFree(parseMetrics_t **parseMetricsPtrPtr);
+
+#endif /* PARSE_METRICS_H */
@@ -0,0 +1,170 @@
+#include <stdlib.h>
+#include <errno.h>
+#include "parsePrecedence.h"
+
+struct parsePrecedence {
+  Marpa_Symbol_ID *symbols;          /* Per level */
+  int              nLevels;
+  Marpa_Rule_ID    firstRuleId;
+  int             *alternatives;     /* Per rule, from firstRuleId */
+  int              nRules;
+};
+
+static int _parsePrecedenceRule(parsePrecedence_t *parsePrecedencePtr, Marpa_Grammar g, Marpa_Symbol_ID lhs, Marpa_Symbol_ID *rhs, int length, int alternative);
+
+parsePrecedence_t *parsePrecedenceCreate(Marpa_Grammar g, Marpa_Symbol_ID lhs, parsePrecedenceAlternative_t *alternatives, int nAlternatives)
+{
+  parsePrecedence_t *parsePrecedencePtr;
+  Marpa_Symbol_ID   *rhs;
+  int                maxLength = 0;
+  int                nLevels   = 0;
+  int                i, j;
+
+  if (g == NULL || lhs < 0 || alternatives == NULL || nAlternatives <= 0) {
+    errno = EINVAL;
+    return NULL;
+  }
+  for (i = 0; i < nAlternatives; i++) {
+    if (alternatives[i].level < 0 || alternatives[i].length < 0 || (alternatives[i].rhs == NULL && alternatives[i].length > 0)) {
+      errno = EINVAL;
+      return NULL;
+    }
+    /* Operands at level 0 would be E0 ::= E0 op E0: no tighter level */
+    if (alternatives[i].level == 0 && alternatives[i].assoc != PARSEPRECEDENCE_ASSOC_GROUP) {
+      for (j = 0; j < alternatives[i].length; j++) {
+	if (alternatives[i].rhs[j] == lhs) {
+	  errno = EINVAL;
+	  return NULL;
+	}
+      }
+    }
+    if (alternatives[i].level >= nLevels) {
+      nLevels = alternatives[i].level + 1;
+    }
+    if (alternatives[i].length > maxLength) {
+      maxLength = alternatives[i].length;
+    }
+  }
+
+  parsePrecedencePtr = malloc(sizeof(parsePrecedence_t));
+  if (parsePrecedencePtr == NULL) {
+    return NULL;
+  }
+  parsePrecedencePtr->nLevels      = nLevels;
+  parsePrecedencePtr->firstRuleId  = -1;
+  parsePrecedencePtr->nRules       = 0;
+  parsePrecedencePtr->symbols      = malloc(nLevels * sizeof(Marpa_Symbol_ID));
+  /* lhs ::= En-1, the chain rules, and the alternatives */
+  parsePrecedencePtr->alternatives = malloc((nLevels + nAlternatives) * sizeof(int));
+  rhs                              = malloc((maxLength + 1) * sizeof(Marpa_Symbol_ID));
+  if (parsePrecedencePtr->symbols == NULL || parsePrecedencePtr->alternatives == NULL || rhs == NULL) {
+    goto err;
+  }
+
+  for (i = 0; i < nLevels; i++) {
+    parsePrecedencePtr->symbols[i] = marpa_g_symbol_new(g);
+    if (parsePrecedencePtr->symbols[i] < 0) {
+      goto err;
+    }
+  }
+
+  rhs[0] = parsePrecedencePtr->symbols[nLevels - 1];
+  if (_parsePrecedenceRule(parsePrecedencePtr, g, lhs, rhs, 1, -1) < 0) {
+    goto err;
+  }
+  for (i = 1; i < nLevels; i++) {
+    rhs[0] = parsePrecedencePtr->symbols[i - 1];
+    if (_parsePrecedenceRule(parsePrecedencePtr, g, parsePrecedencePtr->symbols[i], rhs, 1, -1) < 0) {
+      goto err;
+    }
+  }
+
+  for (i = 0; i < nAlternatives; i++) {
+    parsePrecedenceAlternative_t *alternativePtr = &(alternatives[i]);
+    Marpa_Symbol_ID               same           = parsePrecedencePtr->symbols[alternativePtr->level];
+    /* Unused at level 0, that only has groups and alternatives without operands */
+    Marpa_Symbol_ID               tighter        = parsePrecedencePtr->symbols[(alternativePtr->level > 0) ? alternativePtr->level - 1 : 0];
+    int                           first          = -1;
+    int                           last           = -1;
+
+    for (j = 0; j < alternativePtr->length; j++) {
+      if (alternativePtr->rhs[j] == lhs) {
+	if (first < 0) {
+	  first = j;
+	}
+	last = j;
+      }
+    }
+    for (j = 0; j < alternativePtr->length; j++) {
+      if (alternativePtr->rhs[j] != lhs) {
+	rhs[j] = alternativePtr->rhs[j];
+      } else if (alternativePtr->assoc == PARSEPRECEDENCE_ASSOC_GROUP) {
+	rhs[j] = lhs;
+      } else if (alternativePtr->assoc == PARSEPRECEDENCE_ASSOC_RIGHT) {
+	rhs[j] = (j == last) ? same : tighter;
+      } else {
+	rhs[j] = (j == first) ? same : tighter;
+      }
+    }
+    if (_parsePrecedenceRule(parsePrecedencePtr, g, same, rhs, alternativePtr->length, i) < 0) {
+      goto err;
+    }
+  }
+
+  free(rhs);
+  return parsePrecedencePtr;
+
+ err:
+  free(rhs);
+  parsePrecedenceFree(&parsePrecedencePtr);
+  return NULL;
+}
+
+int parsePrecedenceAlternative(parsePrecedence_t *parsePrecedencePtr, Marpa_Rule_ID ruleId)
+{
+  if (parsePrecedencePtr == NULL || ruleId < parsePrecedencePtr->firstRuleId || ruleId >= parsePrecedencePtr->firstRuleId + parsePrecedencePtr->nRules) {
+    return -1;
+  }
+
+  return parsePrecedencePtr->alternatives[ruleId - parsePrecedencePtr->firstRuleId];
+}
+
+Marpa_Symbol_ID parsePrecedenceSymbol(parsePrecedence_t *parsePrecedencePtr, int level)
+{
+  if (parsePrecedencePtr == NULL || level < 0 || level >= parsePrecedencePtr->nLevels) {
+    return -1;
+  }
+
+  return parsePrecedencePtr->symbols[level];
+}
+
+void parsePrecedenceFree(parsePrecedence_t **parsePrecedencePtrPtr)
+{
+  if (parsePrecedencePtrPtr == NULL || *parsePrecedencePtrPtr == NULL) {
+    return;
+  }
+
+  free((*parsePrecedencePtrPtr)->symbols);
+  free((*parsePrecedencePtrPtr)->alternatives);
+  free(*parsePrecedencePtrPtr);
+  *parsePrecedencePtrPtr = NULL;
+}
+
+/* libmarpa numbers rules in creation order: the map is indexed from the first one */
+static int _parsePrecedenceRule(parsePrecedence_t *parsePrecedencePtr, Marpa_Grammar g, Marpa_Symbol_ID lhs, Marpa_Symbol_ID *rhs, int length, int alternative)
+{
+  Marpa_Rule_ID ruleId = marpa_g_rule_new(g, lhs, rhs, length);
+
+  if (ruleId < 0) {
+    return -1;
+  }
+  if (parsePrecedencePtr->nRules == 0) {
+    parsePrecedencePtr->firstRuleId = ruleId;
+  } else if (ruleId != parsePrecedencePtr->firstRuleId + parsePrecedencePtr->nRules) {
+    errno = EINVAL;
+    return -1;
+  }
+  parsePrecedencePtr->alternatives[parsePrecedencePtr->nRules++] = alternative;
+
+  return 0;
+}
@@ -0,0 +1,51 @@
+#ifndef PARSE_PRECEDENCE_H
+#define PARSE_PRECEDENCE_H
+
+#include <marpa.h>
+
+/*
+ * Precedenced rules for one LHS, expanded into stratified rules so that
+ * an expression has a single parse, instead of every bracketing of
+ * E ::= E op E. An operand is an occurrence of the LHS in an alternative;
+ * level 0 binds tightest. For n levels, n new symbols E0..En-1 are
+ * created, and:
+ *
+ *   lhs ::= En-1
+ *   Ek  ::= Ek-1                            for k > 0
+ *   Ek  ::= Ek op Ek-1                      left associative alternative at level k
+ *   Ek  ::= Ek-1 op Ek                      right associative
+ *   Ek  ::= ( lhs )                         group: operands start over from the loosest level
+ *
+ * Level 0 has no tighter level: operators belong at levels above 0, with
+ * the atoms, e.g. numbers and parentheses, at level 0. An alternative at
+ * level 0 with operands that is not a group is EINVAL.
+ *
+ * Generated rules keep the RHS of their alternative, position for
+ * position: semantic actions are written once per alternative, and
+ * parsePrecedenceAlternative() maps a rule of a step back to it.
+ */
+
+typedef struct parsePrecedence parsePrecedence_t;
+
+typedef enum parsePrecedenceAssoc {
+  PARSEPRECEDENCE_ASSOC_LEFT = 0,
+  PARSEPRECEDENCE_ASSOC_RIGHT,
+  PARSEPRECEDENCE_ASSOC_GROUP
+} parsePrecedenceAssoc_t;
+
+typedef struct parsePrecedenceAlternative {
+  int                     level;
+  parsePrecedenceAssoc_t  assoc;
+  Marpa_Symbol_ID        *rhs;         /* Operands are the LHS */
+  int                     length;
+} parsePrecedenceAlternative_t;
+
+/* Creates the symbols and rules in g, before its precomputation. Returns NULL with errno EINVAL on invalid alternatives, else see marpa_g_error() */
+parsePrecedence_t *parsePrecedenceCreate(Marpa_Grammar g, Marpa_Symbol_ID lhs, parsePrecedenceAlternative_t *alternatives, int nAlternatives);
+/* Index of the alternative of a generated rule, or -1 for the rules that pass the value of their only RHS symbol through, and for other rules */
+int                parsePrecedenceAlternative(parsePrecedence_t *parsePrecedencePtr, Marpa_Rule_ID ruleId);
+/* Symbol of a level */
+Marpa_Symbol_ID    parsePrecedenceSymbol(parsePrecedence_t *parsePrecedencePtr, int level);
+void               parsePrecedenceFree(parsePrecedence_t **parsePrecedencePtrPtr);
+
+#endif /* PARSE_PRECEDENCE_H */
@@ -0,0 +1,161 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <arpa/inet.h>
+#include "parseProtocol.h"
+
+static int _parseProtocolReadFully(int fd, unsigned char *p, size_t length);
+
+int parseProtocolWrite(int fd, const void *bufferPtr, size_t length)
+{
+  unsigned char  header[4];
+  struct iovec   iov[2];
+  struct msghdr  msg;
+  int            iovIndex = 0;
+
+  if ((bufferPtr == NULL && length > 0) || length > INT32_MAX) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  parseProtocolPut(header, (int32_t) length);
+  iov[0].iov_base = header;
+  iov[0].iov_len  = sizeof(header);
+  iov[1].iov_base = (void *) bufferPtr;
+  iov[1].iov_len  = length;
+  memset(&msg, 0, sizeof(msg));
+
+  /* Header and payload in one call most of the time */
+  while (iovIndex < 2) {
+    ssize_t n;
+
+    msg.msg_iov    = &(iov[iovIndex]);
+    msg.msg_iovlen = 2 - iovIndex;
+    /* A client that went away is an error, not a SIGPIPE */
+    n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      return -1;
+    }
+    while (iovIndex < 2 && (size_t) n >= iov[iovIndex].iov_len) {
+      n -= iov[iovIndex].iov_len;
+      iovIndex++;
+    }
+    if (iovIndex < 2) {
+      iov[iovIndex].iov_base = (unsigned char *) iov[iovIndex].iov_base + n;
+      iov[iovIndex].iov_len -= n;
+    }
+  }
+
+  return 0;
+}
+
+int parseProtocolRead(int fd, void **bufferPtrPtr, size_t *bufferSizePtr, size_t maxLength, size_t *lengthPtr)
+{
+  unsigned char header[4];
+  size_t        nHeader = 0;
+  size_t        length;
+
+  if (bufferPtrPtr == NULL || bufferSizePtr == NULL || lengthPtr == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  while (nHeader < sizeof(header)) {
+    ssize_t n = read(fd, header + nHeader, sizeof(header) - nHeader);
+
+    if (n < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      return -1;
+    }
+    if (n == 0) {
+      /* End of file is only clean before the first byte of a frame */
+      if (nHeader == 0) {
+	return 0;
+      }
+      errno = EPROTO;
+      return -1;
+    }
+    nHeader += n;
+  }
+
+  length = (size_t) (uint32_t) parseProtocolGet(header);
+  if (length > maxLength) {
+    errno = EMSGSIZE;
+    return -1;
+  }
+  if (length > *bufferSizePtr) {
+    void *bufferPtr = realloc(*bufferPtrPtr, length);
+
+    if (bufferPtr == NULL) {
+      return -1;
+    }
+    *bufferPtrPtr  = bufferPtr;
+    *bufferSizePtr = length;
+  }
+  if (_parseProtocolReadFully(fd, *bufferPtrPtr, length) < 0) {
+    return -1;
+  }
+  *lengthPtr = length;
+
+  return 1;
+}
+
+void parseProtocolPut(unsigned char *p, int32_t value)
+{
+  uint32_t networkValue = htonl((uint32_t) value);
+
+  memcpy(p, &networkValue, sizeof(networkValue));
+}
+
+int32_t parseProtocolGet(const unsigned char *p)
+{
+  uint32_t networkValue;
+
+  memcpy(&networkValue, p, sizeof(networkValue));
+
+  return (int32_t) ntohl(networkValue);
+}
+
+const char *parseProtocolStatusName(parseProtocolStatus_t status)
+{
+  switch (status) {
+  case PARSEPROTOCOL_STATUS_OK:              return "ok";
+  case PARSEPROTOCOL_STATUS_UNKNOWN_GRAMMAR: return "unknown grammar";
+  case PARSEPROTOCOL_STATUS_REJECTED:        return "rejected";
+  case PARSEPROTOCOL_STATUS_MALFORMED:       return "malformed";
+  case PARSEPROTOCOL_STATUS_FAILED:          return "failed";
+  default:                                   return "unknown";
+  }
+}
+
+/* Returns 0, or -1 with errno set: EPROTO on end of file */
+static int _parseProtocolReadFully(int fd, unsigned char *p, size_t length)
+{
+  while (length > 0) {
+    ssize_t n = read(fd, p, length);
+
+    if (n < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      return -1;
+    }
+    if (n == 0) {
+      errno = EPROTO;
+      return -1;
+    }
+    p      += n;
+    length -= n;
+  }
+
+  return 0;
+}
@@ -0,0 +1,42 @@
+#ifndef PARSE_PROTOCOL_H
+#define PARSE_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Binary framing between parseServer and parseClient, over a Unix domain
+ * stream socket. A frame is a 32-bit length, then that many bytes. All
+ * integers are 32-bit, in network byte order.
+ *
+ * Request : grammarId, nTokens, then symbolId and value of each token
+ * Reply   : status, nResults, then the value of each tree, in rank order
+ *
+ * One token per earleme, i.e. marpa_r_alternative() with length 1.
+ * Requests and replies alternate on a connection, which may carry many.
+ */
+
+#define PARSEPROTOCOL_MAX_FRAME_DEFAULT (16 * 1024 * 1024)
+
+typedef enum parseProtocolStatus {
+  PARSEPROTOCOL_STATUS_OK = 0,
+  PARSEPROTOCOL_STATUS_UNKNOWN_GRAMMAR,
+  PARSEPROTOCOL_STATUS_REJECTED,         /* The tokens do not parse */
+  PARSEPROTOCOL_STATUS_MALFORMED,        /* The request does not follow the framing */
+  PARSEPROTOCOL_STATUS_FAILED            /* Valuation failure, or no memory */
+} parseProtocolStatus_t;
+
+typedef struct parseProtocolToken {
+  int32_t symbolId;
+  int32_t value;
+} parseProtocolToken_t;
+
+/* Writes length and payload. Returns 0, or -1 with errno set */
+int         parseProtocolWrite(int fd, const void *bufferPtr, size_t length);
+/* Reads a frame in *bufferPtrPtr, grown as needed. Returns 1, 0 on end of file between frames, -1 with errno set: EMSGSIZE above maxLength, EPROTO on a truncated frame */
+int         parseProtocolRead(int fd, void **bufferPtrPtr, size_t *bufferSizePtr, size_t maxLength, size_t *lengthPtr);
+void        parseProtocolPut(unsigned char *p, int32_t value);
+int32_t     parseProtocolGet(const unsigned char *p);
+const char *parseProtocolStatusName(parseProtocolStatus_t status);
+
+#endif /* PARSE_PROTOCOL_H */
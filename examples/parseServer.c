@@ -0,0 +1,763 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include "parseServer.h"
+#include "parseDriver.h"
+
+#define PARSESERVER_INIT_SIZE 64      /* Valuator stack */
+
+/* An open connection, in the epoll set while it waits for its next request */
+typedef struct parseServerConnection {
+  int                           fd;        /* Non-blocking */
+  struct parseServerConnection *previousPtr;
+  struct parseServerConnection *nextPtr;
+} parseServerConnection_t;
+
+struct parseServer {
+  parseServerOption_t      option;
+  parseServerGrammar_t    *grammars;
+  int                      nGrammars;
+  char                    *socketPath;
+  int                      listenFd;       /* Non-blocking: workers race on accept() */
+  int                      stopPipe[2];    /* Readable once stopped */
+  int                      epollFd;        /* stopPipe[0], listenFd, and connections one shot */
+  pthread_mutex_t          mutex;          /* Protects connectionsPtr */
+  parseServerConnection_t *connectionsPtr; /* Closed by parseServerRun() once the workers exited */
+  int                      failed;         /* Atomic: a worker could not build its grammars */
+  parseServerStatistics_t  statistics;     /* Atomic counters */
+};
+
+typedef struct parseServerWorker parseServerWorker_t;
+
+/* A grammar, as built by a worker */
+typedef struct parseServerWorkerGrammar {
+  parseServerGrammar_t *grammarPtr;
+  parseServerWorker_t  *workerPtr;
+  Marpa_Grammar         g;
+  parseDriver_t        *parseDriverPtr;
+} parseServerWorkerGrammar_t;
+
+struct parseServerWorker {
+  parseServer_t              *parseServerPtr;
+  parseServerWorkerGrammar_t *workerGrammars;
+  int                        *values;        /* Valuator stack */
+  int                         nValues;
+  int                        *results;       /* Value of each tree of the current request */
+  int                         nResults;
+  unsigned char              *replyPtr;      /* Status, nResults and maxTrees values */
+  void                       *requestPtr;
+  size_t                      requestSize;
+};
+
+static void  *_parseServerWorker       (void *workerPtr);
+static int    _parseServerWorkerInit   (parseServerWorker_t *workerPtr);
+static void   _parseServerWorkerFree   (parseServerWorker_t *workerPtr);
+static int    _parseServerWait         (parseServer_t *parseServerPtr, int fd, int timeout);
+static int    _parseServerUnlinkStale  (struct sockaddr_un *addressPtr);
+static int    _parseServerWatch        (parseServer_t *parseServerPtr, int op, int fd, void *dataPtr, uint32_t events);
+static void   _parseServerAccept       (parseServer_t *parseServerPtr);
+static void   _parseServerClose        (parseServer_t *parseServerPtr, parseServerConnection_t *connectionPtr);
+static void   _parseServerConnection   (parseServerWorker_t *workerPtr, parseServerConnection_t *connectionPtr);
+static int    _parseServerFrame        (parseServerWorker_t *workerPtr, int fd, size_t *lengthPtr);
+static int    _parseServerRead         (parseServer_t *parseServerPtr, int fd, unsigned char *p, size_t length);
+static size_t _parseServerRequest      (parseServerWorker_t *workerPtr, const unsigned char *p, size_t length);
+static int    _parseServerStepCallback (void *userDataPtr, Marpa_Value v, Marpa_Step_Type stepType);
+static int    _parseServerTreeCallback (void *userDataPtr, int treeIndex);
+
+parseServer_t *parseServerCreate(const char *socketPath, parseServerGrammar_t *grammars, int nGrammars, parseServerOption_t *optionPtr)
+{
+  parseServerOption_t  defaultOption = PARSESERVER_OPTION_DEFAULT;
+  parseServer_t       *parseServerPtr;
+  struct sockaddr_un   address;
+  struct stat          st;
+  int                  i, j;
+
+  if (socketPath == NULL || grammars == NULL || nGrammars <= 0) {
+    errno = EINVAL;
+    return NULL;
+  }
+  if (strlen(socketPath) >= sizeof(address.sun_path)) {
+    errno = ENAMETOOLONG;
+    return NULL;
+  }
+  for (i = 0; i < nGrammars; i++) {
+    if (grammars[i].grammarCallback == NULL) {
+      errno = EINVAL;
+      return NULL;
+    }
+    for (j = 0; j < i; j++) {
+      if (grammars[j].grammarId == grammars[i].grammarId) {
+	errno = EINVAL;
+	return NULL;
+      }
+    }
+  }
+
+  parseServerPtr = malloc(sizeof(parseServer_t));
+  if (parseServerPtr == NULL) {
+    return NULL;
+  }
+  parseServerPtr->option      = (optionPtr != NULL) ? *optionPtr : defaultOption;
+  parseServerPtr->grammars    = malloc(nGrammars * sizeof(parseServerGrammar_t));
+  parseServerPtr->nGrammars   = nGrammars;
+  parseServerPtr->socketPath  = strdup(socketPath);
+  parseServerPtr->listenFd    = -1;
+  parseServerPtr->stopPipe[0] = -1;
+  parseServerPtr->stopPipe[1] = -1;
+  parseServerPtr->epollFd     = -1;
+  parseServerPtr->connectionsPtr = NULL;
+  parseServerPtr->failed      = 0;
+  memset(&(parseServerPtr->statistics), 0, sizeof(parseServerStatistics_t));
+  if (parseServerPtr->grammars == NULL || parseServerPtr->socketPath == NULL) {
+    goto err;
+  }
+  memcpy(parseServerPtr->grammars, grammars, nGrammars * sizeof(parseServerGrammar_t));
+
+  if (parseServerPtr->option.nThreads <= 0) {
+    long nCpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    parseServerPtr->option.nThreads = (nCpus > 0) ? (int) nCpus : 1;
+  }
+  if (parseServerPtr->option.maxTrees <= 0) {
+    parseServerPtr->option.maxTrees = defaultOption.maxTrees;
+  }
+  if (parseServerPtr->option.maxFrame <= 0) {
+    parseServerPtr->option.maxFrame = defaultOption.maxFrame;
+  }
+  if (parseServerPtr->option.backlog <= 0) {
+    parseServerPtr->option.backlog = defaultOption.backlog;
+  }
+  if (parseServerPtr->option.readTimeout <= 0) {
+    parseServerPtr->option.readTimeout = defaultOption.readTimeout;
+  }
+
+  if (pipe(parseServerPtr->stopPipe) < 0) {
+    goto err;
+  }
+  for (i = 0; i < 2; i++) {
+    if (fcntl(parseServerPtr->stopPipe[i], F_SETFD, FD_CLOEXEC) < 0 ||
+	fcntl(parseServerPtr->stopPipe[i], F_SETFL, O_NONBLOCK) < 0) {
+      goto err;
+    }
+  }
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, socketPath);
+  /* A socket left by a previous server that did not exit cleanly */
+  if (lstat(socketPath, &st) == 0 && S_ISSOCK(st.st_mode) && _parseServerUnlinkStale(&address) < 0) {
+    goto err;
+  }
+  parseServerPtr->listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if (parseServerPtr->listenFd < 0 ||
+      bind(parseServerPtr->listenFd, (struct sockaddr *) &address, sizeof(address)) < 0) {
+    goto err;
+  }
+  if (listen(parseServerPtr->listenFd, parseServerPtr->option.backlog) < 0) {
+    int errnoSave = errno;
+
+    unlink(socketPath);
+    errno = errnoSave;
+    goto err;
+  }
+
+  /* Level-triggered: every worker sees the stop, and the pending connections */
+  parseServerPtr->epollFd = epoll_create1(EPOLL_CLOEXEC);
+  if (parseServerPtr->epollFd < 0 ||
+      _parseServerWatch(parseServerPtr, EPOLL_CTL_ADD, parseServerPtr->stopPipe[0], &(parseServerPtr->stopPipe[0]), EPOLLIN) < 0 ||
+      _parseServerWatch(parseServerPtr, EPOLL_CTL_ADD, parseServerPtr->listenFd, &(parseServerPtr->listenFd), EPOLLIN) < 0) {
+    int errnoSave = errno;
+
+    unlink(socketPath);
+    errno = errnoSave;
+    goto err;
+  }
+  pthread_mutex_init(&(parseServerPtr->mutex), NULL);
+
+  return parseServerPtr;
+
+ err:
+  {
+    int errnoSave = errno;
+
+    if (parseServerPtr->epollFd >= 0) {
+      close(parseServerPtr->epollFd);
+    }
+    if (parseServerPtr->listenFd >= 0) {
+      close(parseServerPtr->listenFd);
+    }
+    if (parseServerPtr->stopPipe[0] >= 0) {
+      close(parseServerPtr->stopPipe[0]);
+      close(parseServerPtr->stopPipe[1]);
+    }
+    free(parseServerPtr->socketPath);
+    free(parseServerPtr->grammars);
+    free(parseServerPtr);
+    errno = errnoSave;
+  }
+
+  return NULL;
+}
+
+int parseServerRun(parseServer_t *parseServerPtr)
+{
+  parseServerWorker_t *workers;
+  pthread_t           *threads;
+  int                  nThreads = 0;
+  int                  i;
+
+  if (parseServerPtr == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  workers = malloc(parseServerPtr->option.nThreads * sizeof(parseServerWorker_t));
+  threads = malloc(parseServerPtr->option.nThreads * sizeof(pthread_t));
+  if (workers == NULL || threads == NULL) {
+    free(workers);
+    free(threads);
+    return -1;
+  }
+
+  for (i = 0; i < parseServerPtr->option.nThreads; i++) {
+    workers[i].parseServerPtr = parseServerPtr;
+    if (pthread_create(&(threads[i]), NULL, &_parseServerWorker, &(workers[i])) != 0) {
+      __atomic_store_n(&(parseServerPtr->failed), 1, __ATOMIC_RELAXED);
+      parseServerStop(parseServerPtr);
+      break;
+    }
+    nThreads++;
+  }
+  for (i = 0; i < nThreads; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  while (parseServerPtr->connectionsPtr != NULL) {
+    _parseServerClose(parseServerPtr, parseServerPtr->connectionsPtr);
+  }
+
+  free(threads);
+  free(workers);
+
+  if (__atomic_load_n(&(parseServerPtr->failed), __ATOMIC_RELAXED) != 0) {
+    errno = ECANCELED;
+    return -1;
+  }
+
+  return 0;
+}
+
+void parseServerStop(parseServer_t *parseServerPtr)
+{
+  if (parseServerPtr != NULL) {
+    /* Level-triggered: the byte is never read, every worker sees it. Async-signal-safe */
+    ssize_t n = write(parseServerPtr->stopPipe[1], "", 1);
+
+    (void) n;
+  }
+}
+
+void parseServerStatistics(parseServer_t *parseServerPtr, parseServerStatistics_t *statisticsPtr)
+{
+  if (parseServerPtr != NULL && statisticsPtr != NULL) {
+    statisticsPtr->nConnections = __atomic_load_n(&(parseServerPtr->statistics.nConnections), __ATOMIC_RELAXED);
+    statisticsPtr->nRequests    = __atomic_load_n(&(parseServerPtr->statistics.nRequests), __ATOMIC_RELAXED);
+    statisticsPtr->nRejected    = __atomic_load_n(&(parseServerPtr->statistics.nRejected), __ATOMIC_RELAXED);
+    statisticsPtr->nFailed      = __atomic_load_n(&(parseServerPtr->statistics.nFailed), __ATOMIC_RELAXED);
+  }
+}
+
+void parseServerFree(parseServer_t **parseServerPtrPtr)
+{
+  parseServer_t *parseServerPtr;
+
+  if (parseServerPtrPtr == NULL || *parseServerPtrPtr == NULL) {
+    return;
+  }
+  parseServerPtr = *parseServerPtrPtr;
+
+  close(parseServerPtr->epollFd);
+  close(parseServerPtr->listenFd);
+  unlink(parseServerPtr->socketPath);
+  close(parseServerPtr->stopPipe[0]);
+  close(parseServerPtr->stopPipe[1]);
+  free(parseServerPtr->socketPath);
+  free(parseServerPtr->grammars);
+  pthread_mutex_destroy(&(parseServerPtr->mutex));
+  free(parseServerPtr);
+  *parseServerPtrPtr = NULL;
+}
+
+static void *_parseServerWorker(void *workerPtr)
+{
+  parseServerWorker_t *worker         = (parseServerWorker_t *) workerPtr;
+  parseServer_t       *parseServerPtr = worker->parseServerPtr;
+
+  if (_parseServerWorkerInit(worker) < 0) {
+    /* Serving with fewer workers would hide the failure */
+    __atomic_store_n(&(parseServerPtr->failed), 1, __ATOMIC_RELAXED);
+    parseServerStop(parseServerPtr);
+    return NULL;
+  }
+
+  /* One ready request at a time: idle connections hold no worker */
+  for (;;) {
+    struct epoll_event event;
+    int                n = epoll_wait(parseServerPtr->epollFd, &event, 1, -1);
+
+    if (n < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      break;
+    }
+    if (n == 0) {
+      continue;
+    }
+    if (event.data.ptr == &(parseServerPtr->stopPipe[0])) {
+      break;
+    }
+    if (event.data.ptr == &(parseServerPtr->listenFd)) {
+      _parseServerAccept(parseServerPtr);
+    } else {
+      _parseServerConnection(worker, (parseServerConnection_t *) event.data.ptr);
+    }
+  }
+
+  _parseServerWorkerFree(worker);
+
+  return NULL;
+}
+
+/* Grammars, parse drivers and buffers of a worker */
+static int _parseServerWorkerInit(parseServerWorker_t *workerPtr)
+{
+  parseServer_t           *parseServerPtr = workerPtr->parseServerPtr;
+  parseEnumeratorOption_t  option         = PARSEENUMERATOR_OPTION_DEFAULT;
+  int                      i;
+
+  workerPtr->workerGrammars = calloc(parseServerPtr->nGrammars, sizeof(parseServerWorkerGrammar_t));
+  workerPtr->values         = malloc(PARSESERVER_INIT_SIZE * sizeof(int));
+  workerPtr->nValues        = PARSESERVER_INIT_SIZE;
+  workerPtr->results        = malloc(parseServerPtr->option.maxTrees * sizeof(int));
+  workerPtr->nResults       = 0;
+  workerPtr->replyPtr       = malloc((2 + parseServerPtr->option.maxTrees) * sizeof(int32_t));
+  workerPtr->requestPtr     = NULL;
+  workerPtr->requestSize    = 0;
+  if (workerPtr->workerGrammars == NULL || workerPtr->values == NULL || workerPtr->results == NULL || workerPtr->replyPtr == NULL) {
+    _parseServerWorkerFree(workerPtr);
+    return -1;
+  }
+
+  option.maxTrees = parseServerPtr->option.maxTrees;
+  for (i = 0; i < parseServerPtr->nGrammars; i++) {
+    parseServerWorkerGrammar_t *workerGrammarPtr = &(workerPtr->workerGrammars[i]);
+
+    workerGrammarPtr->grammarPtr     = &(parseServerPtr->grammars[i]);
+    workerGrammarPtr->workerPtr      = workerPtr;
+    workerGrammarPtr->g              = (*workerGrammarPtr->grammarPtr->grammarCallback)(workerGrammarPtr->grammarPtr->userDataPtr);
+    workerGrammarPtr->parseDriverPtr = NULL;
+    if (workerGrammarPtr->g == NULL) {
+      _parseServerWorkerFree(workerPtr);
+      return -1;
+    }
+    workerGrammarPtr->parseDriverPtr = parseDriverCreate(workerGrammarPtr->g, &option, &_parseServerStepCallback, &_parseServerTreeCallback, workerGrammarPtr);
+    if (workerGrammarPtr->parseDriverPtr == NULL) {
+      _parseServerWorkerFree(workerPtr);
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+static void _parseServerWorkerFree(parseServerWorker_t *workerPtr)
+{
+  int i;
+
+  if (workerPtr->workerGrammars != NULL) {
+    for (i = 0; i < workerPtr->parseServerPtr->nGrammars; i++) {
+      parseDriverFree(&(workerPtr->workerGrammars[i].parseDriverPtr));
+      if (workerPtr->workerGrammars[i].g != NULL) {
+	marpa_g_unref(workerPtr->workerGrammars[i].g);
+      }
+    }
+  }
+  free(workerPtr->workerGrammars);
+  free(workerPtr->values);
+  free(workerPtr->results);
+  free(workerPtr->replyPtr);
+  free(workerPtr->requestPtr);
+  workerPtr->workerGrammars = NULL;
+  workerPtr->values         = NULL;
+  workerPtr->results        = NULL;
+  workerPtr->replyPtr       = NULL;
+  workerPtr->requestPtr     = NULL;
+}
+
+/* Returns 1 when fd is readable, 0 once stopped, -1 on failure, with errno ETIMEDOUT after timeout milliseconds */
+static int _parseServerWait(parseServer_t *parseServerPtr, int fd, int timeout)
+{
+  struct pollfd fds[2];
+
+  fds[0].fd     = parseServerPtr->stopPipe[0];
+  fds[0].events = POLLIN;
+  fds[1].fd     = fd;
+  fds[1].events = POLLIN;
+  for (;;) {
+    int n = poll(fds, 2, timeout);
+
+    if (n < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      return -1;
+    }
+    if (n == 0) {
+      errno = ETIMEDOUT;
+      return -1;
+    }
+    if (fds[0].revents != 0) {
+      return 0;
+    }
+    if (fds[1].revents != 0) {
+      return 1;
+    }
+  }
+}
+
+/* Unlinks the socket file only if nobody listens on it. Returns 0, or -1, with errno EADDRINUSE when a server does */
+static int _parseServerUnlinkStale(struct sockaddr_un *addressPtr)
+{
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  int rc;
+
+  if (fd < 0) {
+    return -1;
+  }
+  /* A full backlog is EAGAIN: still a running server */
+  rc = connect(fd, (struct sockaddr *) addressPtr, sizeof(struct sockaddr_un));
+  if (rc == 0 || (errno != ECONNREFUSED && errno != ENOENT)) {
+    close(fd);
+    errno = EADDRINUSE;
+    return -1;
+  }
+  if (errno == ECONNREFUSED) {
+    unlink(addressPtr->sun_path);
+  }
+  close(fd);
+
+  return 0;
+}
+
+static int _parseServerWatch(parseServer_t *parseServerPtr, int op, int fd, void *dataPtr, uint32_t events)
+{
+  struct epoll_event event;
+
+  memset(&event, 0, sizeof(event));
+  event.events   = events;
+  event.data.ptr = dataPtr;
+
+  return epoll_ctl(parseServerPtr->epollFd, op, fd, &event);
+}
+
+/* A new connection joins the epoll set, until its first request */
+static void _parseServerAccept(parseServer_t *parseServerPtr)
+{
+  parseServerConnection_t *connectionPtr;
+  int                      fd = accept(parseServerPtr->listenFd, NULL, NULL);
+
+  if (fd < 0) {
+    /* Another worker got it, or the client went away */
+    return;
+  }
+  connectionPtr = malloc(sizeof(parseServerConnection_t));
+  if (connectionPtr == NULL || fcntl(fd, F_SETFL, O_NONBLOCK) < 0) {
+    free(connectionPtr);
+    close(fd);
+    return;
+  }
+  connectionPtr->fd          = fd;
+  connectionPtr->previousPtr = NULL;
+  pthread_mutex_lock(&(parseServerPtr->mutex));
+  connectionPtr->nextPtr = parseServerPtr->connectionsPtr;
+  if (connectionPtr->nextPtr != NULL) {
+    connectionPtr->nextPtr->previousPtr = connectionPtr;
+  }
+  parseServerPtr->connectionsPtr = connectionPtr;
+  pthread_mutex_unlock(&(parseServerPtr->mutex));
+  __atomic_add_fetch(&(parseServerPtr->statistics.nConnections), 1, __ATOMIC_RELAXED);
+
+  if (_parseServerWatch(parseServerPtr, EPOLL_CTL_ADD, fd, connectionPtr, EPOLLIN | EPOLLONESHOT) < 0) {
+    _parseServerClose(parseServerPtr, connectionPtr);
+  }
+}
+
+/* Closing the fd also removes it from the epoll set */
+static void _parseServerClose(parseServer_t *parseServerPtr, parseServerConnection_t *connectionPtr)
+{
+  pthread_mutex_lock(&(parseServerPtr->mutex));
+  if (connectionPtr->previousPtr != NULL) {
+    connectionPtr->previousPtr->nextPtr = connectionPtr->nextPtr;
+  } else {
+    parseServerPtr->connectionsPtr = connectionPtr->nextPtr;
+  }
+  if (connectionPtr->nextPtr != NULL) {
+    connectionPtr->nextPtr->previousPtr = connectionPtr->previousPtr;
+  }
+  pthread_mutex_unlock(&(parseServerPtr->mutex));
+  close(connectionPtr->fd);
+  free(connectionPtr);
+}
+
+/* One request of a ready connection. One shot: no other worker sees the connection until it is re-armed */
+static void _parseServerConnection(parseServerWorker_t *workerPtr, parseServerConnection_t *connectionPtr)
+{
+  parseServer_t *parseServerPtr = workerPtr->parseServerPtr;
+  size_t         length;
+  size_t         replyLength;
+  int            rc;
+
+  rc = _parseServerFrame(workerPtr, connectionPtr->fd, &length);
+  if (rc > 0) {
+    replyLength = _parseServerRequest(workerPtr, workerPtr->requestPtr, length);
+    /* Non-blocking: a client that does not read its replies is disconnected once the socket buffer is full */
+    rc = (parseProtocolWrite(connectionPtr->fd, workerPtr->replyPtr, replyLength) < 0) ? -1 : 1;
+  } else if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    /* Spurious readiness: nothing was read */
+    rc = 1;
+  }
+
+  /* End of file, a frame too large, a stalled client or the stop: the connection is closed */
+  if (rc <= 0 || _parseServerWatch(parseServerPtr, EPOLL_CTL_MOD, connectionPtr->fd, connectionPtr, EPOLLIN | EPOLLONESHOT) < 0) {
+    _parseServerClose(parseServerPtr, connectionPtr);
+  }
+}
+
+/* parseProtocolRead() on a non-blocking fd, in workerPtr->requestPtr. Returns 1, 0 on end of file between frames, -1 otherwise: EAGAIN when nothing was read */
+static int _parseServerFrame(parseServerWorker_t *workerPtr, int fd, size_t *lengthPtr)
+{
+  parseServer_t *parseServerPtr = workerPtr->parseServerPtr;
+  unsigned char  header[4];
+  ssize_t        n;
+  size_t         length;
+
+  /* The connection was ready: at least the first byte is there, or end of file */
+  do {
+    n = read(fd, header, 1);
+  } while (n < 0 && errno == EINTR);
+  if (n <= 0) {
+    return (n == 0) ? 0 : -1;
+  }
+  if (_parseServerRead(parseServerPtr, fd, header + 1, sizeof(header) - 1) < 0) {
+    return -1;
+  }
+
+  length = (size_t) (uint32_t) parseProtocolGet(header);
+  if (length > parseServerPtr->option.maxFrame) {
+    errno = EMSGSIZE;
+    return -1;
+  }
+  if (length > workerPtr->requestSize) {
+    void *requestPtr = realloc(workerPtr->requestPtr, length);
+
+    if (requestPtr == NULL) {
+      return -1;
+    }
+    workerPtr->requestPtr  = requestPtr;
+    workerPtr->requestSize = length;
+  }
+  if (_parseServerRead(parseServerPtr, fd, workerPtr->requestPtr, length) < 0) {
+    return -1;
+  }
+  *lengthPtr = length;
+
+  return 1;
+}
+
+/* Waits for the rest of a frame at most readTimeout milliseconds at a time. Returns 0, or -1: ECANCELED once stopped, EPROTO on end of file */
+static int _parseServerRead(parseServer_t *parseServerPtr, int fd, unsigned char *p, size_t length)
+{
+  while (length > 0) {
+    ssize_t n = read(fd, p, length);
+
+    if (n > 0) {
+      p      += n;
+      length -= n;
+      continue;
+    }
+    if (n == 0) {
+      errno = EPROTO;
+      return -1;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      return -1;
+    }
+    switch (_parseServerWait(parseServerPtr, fd, parseServerPtr->option.readTimeout)) {
+    case 1:
+      break;
+    case 0:
+      errno = ECANCELED;
+      return -1;
+    default:
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+/* Writes the reply in workerPtr->replyPtr and returns its length */
+static size_t _parseServerRequest(parseServerWorker_t *workerPtr, const unsigned char *p, size_t length)
+{
+  parseServer_t              *parseServerPtr   = workerPtr->parseServerPtr;
+  parseServerWorkerGrammar_t *workerGrammarPtr = NULL;
+  parseProtocolStatus_t       status           = PARSEPROTOCOL_STATUS_OK;
+  Marpa_Recognizer            r                = NULL;
+  Marpa_Bocage                b                = NULL;
+  size_t                      nTokens          = 0;
+  size_t                      i;
+  int                         k;
+
+  workerPtr->nResults = 0;
+  __atomic_add_fetch(&(parseServerPtr->statistics.nRequests), 1, __ATOMIC_RELAXED);
+
+  if (length < 2 * sizeof(int32_t)) {
+    status = PARSEPROTOCOL_STATUS_MALFORMED;
+  } else {
+    int32_t grammarId = parseProtocolGet(p);
+
+    nTokens = (size_t) (uint32_t) parseProtocolGet(p + sizeof(int32_t));
+    if (nTokens != (length - 2 * sizeof(int32_t)) / (2 * sizeof(int32_t)) || (length - 2 * sizeof(int32_t)) % (2 * sizeof(int32_t)) != 0) {
+      status = PARSEPROTOCOL_STATUS_MALFORMED;
+    } else {
+      status = PARSEPROTOCOL_STATUS_UNKNOWN_GRAMMAR;
+      for (k = 0; k < parseServerPtr->nGrammars; k++) {
+	if (parseServerPtr->grammars[k].grammarId == grammarId) {
+	  workerGrammarPtr = &(workerPtr->workerGrammars[k]);
+	  status           = PARSEPROTOCOL_STATUS_OK;
+	  break;
+	}
+      }
+    }
+  }
+
+  /* Feed */
+  if (status == PARSEPROTOCOL_STATUS_OK) {
+    marpa_g_error_clear(workerGrammarPtr->g);
+    r = marpa_r_new(workerGrammarPtr->g);
+    if (r == NULL || marpa_r_start_input(r) < 0) {
+      status = PARSEPROTOCOL_STATUS_FAILED;
+    }
+  }
+  for (i = 0; status == PARSEPROTOCOL_STATUS_OK && i < nTokens; i++) {
+    const unsigned char *tokenPtr = p + (2 + 2 * i) * sizeof(int32_t);
+
+    if (marpa_r_alternative(r, parseProtocolGet(tokenPtr), parseProtocolGet(tokenPtr + sizeof(int32_t)), 1) != MARPA_ERR_NONE ||
+	marpa_r_earleme_complete(r) < 0) {
+      status = PARSEPROTOCOL_STATUS_REJECTED;
+    }
+  }
+
+  /* Valuation */
+  if (status == PARSEPROTOCOL_STATUS_OK) {
+    b = marpa_b_new(r, marpa_r_latest_earley_set(r));
+    if (b == NULL) {
+      status = PARSEPROTOCOL_STATUS_REJECTED;
+    } else if (parseDriverRunBocage(workerGrammarPtr->parseDriverPtr, b) < 0) {
+      status = PARSEPROTOCOL_STATUS_FAILED;
+    }
+  }
+  if (b != NULL) {
+    marpa_b_unref(b);
+  }
+  if (r != NULL) {
+    marpa_r_unref(r);
+  }
+
+  if (status == PARSEPROTOCOL_STATUS_FAILED) {
+    __atomic_add_fetch(&(parseServerPtr->statistics.nFailed), 1, __ATOMIC_RELAXED);
+  } else if (status != PARSEPROTOCOL_STATUS_OK) {
+    __atomic_add_fetch(&(parseServerPtr->statistics.nRejected), 1, __ATOMIC_RELAXED);
+  }
+  if (status != PARSEPROTOCOL_STATUS_OK) {
+    workerPtr->nResults = 0;
+  }
+
+  parseProtocolPut(workerPtr->replyPtr, status);
+  parseProtocolPut(workerPtr->replyPtr + sizeof(int32_t), workerPtr->nResults);
+  for (k = 0; k < workerPtr->nResults; k++) {
+    parseProtocolPut(workerPtr->replyPtr + (2 + k) * sizeof(int32_t), workerPtr->results[k]);
+  }
+
+  return (2 + workerPtr->nResults) * sizeof(int32_t);
+}
+
+static int _parseServerStepCallback(void *userDataPtr, Marpa_Value v, Marpa_Step_Type stepType)
+{
+  parseServerWorkerGrammar_t *workerGrammarPtr = (parseServerWorkerGrammar_t *) userDataPtr;
+  parseServerWorker_t        *workerPtr        = workerGrammarPtr->workerPtr;
+  int                         top              = (stepType == MARPA_STEP_RULE) ? marpa_v_arg_n(v) : marpa_v_result(v);
+  int                         value;
+
+  if (top >= workerPtr->nValues) {
+    int  nValues = (top + 1) * 2;
+    int *values  = realloc(workerPtr->values, nValues * sizeof(int));
+
+    if (values == NULL) {
+      return -1;
+    }
+    workerPtr->values  = values;
+    workerPtr->nValues = nValues;
+  }
+
+  switch (stepType) {
+  case MARPA_STEP_TOKEN:
+    workerPtr->values[marpa_v_result(v)] = marpa_v_token_value(v);
+    break;
+  case MARPA_STEP_RULE:
+    if (workerGrammarPtr->grammarPtr->ruleCallback == NULL) {
+      value = workerPtr->values[marpa_v_arg_0(v)];
+    } else if ((*workerGrammarPtr->grammarPtr->ruleCallback)(workerGrammarPtr->grammarPtr->userDataPtr,
+							     marpa_v_rule(v),
+							     &(workerPtr->values[marpa_v_arg_0(v)]),
+							     marpa_v_arg_n(v) - marpa_v_arg_0(v) + 1,
+							     &value) < 0) {
+      return -1;
+    }
+    workerPtr->values[marpa_v_result(v)] = value;
+    break;
+  case MARPA_STEP_NULLING_SYMBOL:
+    workerPtr->values[marpa_v_result(v)] = 0;
+    break;
+  default:
+    break;
+  }
+
+  return 0;
+}
+
+static int _parseServerTreeCallback(void *userDataPtr, int treeIndex)
+{
+  parseServerWorkerGrammar_t *workerGrammarPtr = (parseServerWorkerGrammar_t *) userDataPtr;
+  parseServerWorker_t        *workerPtr        = workerGrammarPtr->workerPtr;
+
+  /* The enumeration stops at maxTrees */
+  if (workerPtr->nResults < workerPtr->parseServerPtr->option.maxTrees) {
+    workerPtr->results[workerPtr->nResults++] = workerPtr->values[0];
+  }
+
+  return 0;
+}
@@ -0,0 +1,59 @@
+#ifndef PARSE_SERVER_H
+#define PARSE_SERVER_H
+
+#include <stddef.h>
+#include <marpa.h>
+#include "parseProtocol.h"
+
+/*
+ * Resident parse server on a Unix domain socket, see parseProtocol.h for
+ * the framing. Grammars are built and precomputed once per worker thread,
+ * when the server starts: a request only pays for the recognizer and the
+ * valuation. Connections wait in an epoll set: a worker takes one ready
+ * request at a time, so idle connections hold no worker, and the requests
+ * of all the connections are served concurrently by the workers.
+ *
+ * Values are ints: a token's is its value in the request, a rule's is
+ * computed by ruleCallback from the values of its RHS, a nulling
+ * symbol's is 0. The value of a tree is the value of its start rule.
+ */
+
+typedef struct parseServer parseServer_t;
+
+typedef struct parseServerGrammar {
+  int32_t        grammarId;
+  /* Precomputed grammar for a worker thread: libmarpa objects must not be shared between threads */
+  Marpa_Grammar (*grammarCallback)(void *userDataPtr);
+  /* Value of a rule from the values of its RHS. NULL means the value of the first one. A negative return value fails the request */
+  int           (*ruleCallback)(void *userDataPtr, Marpa_Rule_ID ruleId, const int *args, int nArgs, int *resultPtr);
+  void          *userDataPtr;
+} parseServerGrammar_t;
+
+typedef struct parseServerOption {
+  int    nThreads;        /* 0 means the number of online CPUs */
+  int    maxTrees;        /* Values per reply, in rank order */
+  size_t maxFrame;        /* Larger requests close the connection */
+  int    backlog;         /* listen() */
+  int    readTimeout;     /* Milliseconds for the rest of a started request: a stalled client is disconnected */
+} parseServerOption_t;
+
+#define PARSESERVER_OPTION_DEFAULT { 0, 16, PARSEPROTOCOL_MAX_FRAME_DEFAULT, 128, 5000 }
+
+typedef struct parseServerStatistics {
+  unsigned long nConnections;
+  unsigned long nRequests;
+  unsigned long nRejected;        /* Unknown grammar, malformed or not parsing */
+  unsigned long nFailed;
+} parseServerStatistics_t;
+
+/* Binds and listens: a stale socket file at socketPath is replaced, one a server listens on is EADDRINUSE. grammars is copied */
+parseServer_t *parseServerCreate(const char *socketPath, parseServerGrammar_t *grammars, int nGrammars, parseServerOption_t *optionPtr);
+/* Serves until parseServerStop(). Returns 0, or -1 when a worker could not build its grammars */
+int            parseServerRun(parseServer_t *parseServerPtr);
+/* From any thread, or a signal handler: workers finish their current request and exit */
+void           parseServerStop(parseServer_t *parseServerPtr);
+void           parseServerStatistics(parseServer_t *parseServerPtr, parseServerStatistics_t *statisticsPtr);
+/* Closes and unlinks the socket */
+void           parseServerFree(parseServer_t **parseServerPtrPtr);
+
+#endif /* PARSE_SERVER_H */
@@ -0,0 +1,409 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "parseSession.h"
+
+#define PARSESESSION_INIT_SIZE 1024
+#define PARSESESSION_UNCHANGED ((size_t) -1)
+
+typedef struct parseSessionSlot {
+  Marpa_Recognizer r;          /* NULL when the slot is free */
+  size_t           position;   /* Number of tokens fed */
+} parseSessionSlot_t;
+
+struct parseSession {
+  Marpa_Grammar            g;
+  parseSessionOption_t     option;
+  parseSessionToken_t     *tokens;
+  size_t                   nTokens;
+  size_t                   allocSize;
+  size_t                   firstChanged;   /* Since last invalidation */
+  parseSessionSlot_t      *slots;          /* The live recognizer and the checkpoints */
+  int                      nSlots;
+  long                     errorPosition;
+  parseSessionStatistics_t statistics;
+};
+
+static int    _parseSessionReserve(parseSession_t *parseSessionPtr, size_t nTokens);
+static void   _parseSessionInvalidate(parseSession_t *parseSessionPtr);
+static int    _parseSessionLive(parseSession_t *parseSessionPtr);
+static int    _parseSessionStart(parseSession_t *parseSessionPtr, parseSessionSlot_t *slotPtr);
+static int    _parseSessionFeed(parseSession_t *parseSessionPtr, parseSessionSlot_t *slotPtr, size_t target);
+static size_t _parseSessionCheckpoints(parseSession_t *parseSessionPtr, int liveSlot, size_t budget);
+static void   _parseSessionRelease(parseSessionSlot_t *slotPtr);
+
+parseSession_t *parseSessionCreate(Marpa_Grammar g, parseSessionOption_t *optionPtr)
+{
+  parseSessionOption_t  defaultOption = PARSESESSION_OPTION_DEFAULT;
+  parseSession_t       *parseSessionPtr;
+  int                   i;
+
+  if (g == NULL || (optionPtr != NULL && (optionPtr->nCheckpoints < 0 || optionPtr->checkpointLag <= 0))) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  parseSessionPtr = malloc(sizeof(parseSession_t));
+  if (parseSessionPtr == NULL) {
+    return NULL;
+  }
+  parseSessionPtr->option = (optionPtr != NULL) ? *optionPtr : defaultOption;
+  parseSessionPtr->nSlots = parseSessionPtr->option.nCheckpoints + 1;
+  parseSessionPtr->tokens = malloc(PARSESESSION_INIT_SIZE * sizeof(parseSessionToken_t));
+  parseSessionPtr->slots  = malloc(parseSessionPtr->nSlots * sizeof(parseSessionSlot_t));
+  if (parseSessionPtr->tokens == NULL || parseSessionPtr->slots == NULL) {
+    free(parseSessionPtr->tokens);
+    free(parseSessionPtr->slots);
+    free(parseSessionPtr);
+    return NULL;
+  }
+
+  for (i = 0; i < parseSessionPtr->nSlots; i++) {
+    parseSessionPtr->slots[i].r        = NULL;
+    parseSessionPtr->slots[i].position = 0;
+  }
+  parseSessionPtr->g                    = marpa_g_ref(g);
+  parseSessionPtr->nTokens              = 0;
+  parseSessionPtr->allocSize            = PARSESESSION_INIT_SIZE;
+  parseSessionPtr->firstChanged         = PARSESESSION_UNCHANGED;
+  parseSessionPtr->errorPosition        = -1;
+  parseSessionPtr->statistics.nFed      = 0;
+  parseSessionPtr->statistics.nRebuilds = 0;
+  parseSessionPtr->statistics.nReused   = 0;
+
+  return parseSessionPtr;
+}
+
+int parseSessionSet(parseSession_t *parseSessionPtr, const parseSessionToken_t *tokens, size_t nTokens)
+{
+  size_t nCommon;
+  size_t i;
+
+  if (parseSessionPtr == NULL || (tokens == NULL && nTokens > 0)) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (_parseSessionReserve(parseSessionPtr, nTokens) < 0) {
+    return -1;
+  }
+
+  /* First changed token */
+  nCommon = (nTokens < parseSessionPtr->nTokens) ? nTokens : parseSessionPtr->nTokens;
+  for (i = 0; i < nCommon; i++) {
+    if (tokens[i].symbolId != parseSessionPtr->tokens[i].symbolId || tokens[i].value != parseSessionPtr->tokens[i].value) {
+      break;
+    }
+  }
+  if (i < nCommon || nTokens != parseSessionPtr->nTokens) {
+    if (i < parseSessionPtr->firstChanged) {
+      parseSessionPtr->firstChanged = i;
+    }
+    memcpy(parseSessionPtr->tokens + i, tokens + i, (nTokens - i) * sizeof(parseSessionToken_t));
+    parseSessionPtr->nTokens = nTokens;
+  }
+
+  return 0;
+}
+
+int parseSessionEdit(parseSession_t *parseSessionPtr, size_t start, size_t nDeleted, const parseSessionToken_t *tokens, size_t nInserted)
+{
+  size_t nTokens;
+
+  if (parseSessionPtr == NULL || (tokens == NULL && nInserted > 0) || start > parseSessionPtr->nTokens || nDeleted > parseSessionPtr->nTokens - start) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  nTokens = parseSessionPtr->nTokens - nDeleted + nInserted;
+  if (_parseSessionReserve(parseSessionPtr, nTokens) < 0) {
+    return -1;
+  }
+
+  memmove(parseSessionPtr->tokens + start + nInserted,
+	  parseSessionPtr->tokens + start + nDeleted,
+	  (parseSessionPtr->nTokens - start - nDeleted) * sizeof(parseSessionToken_t));
+  if (nInserted > 0) {
+    memcpy(parseSessionPtr->tokens + start, tokens, nInserted * sizeof(parseSessionToken_t));
+  }
+  parseSessionPtr->nTokens = nTokens;
+  if ((nDeleted > 0 || nInserted > 0) && start < parseSessionPtr->firstChanged) {
+    parseSessionPtr->firstChanged = start;
+  }
+
+  return 0;
+}
+
+Marpa_Recognizer parseSessionRecognizer(parseSession_t *parseSessionPtr)
+{
+  parseSessionSlot_t *slotPtr;
+  int                 liveSlot;
+  int                 rc;
+
+  if (parseSessionPtr == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  parseSessionPtr->errorPosition = -1;
+  _parseSessionInvalidate(parseSessionPtr);
+
+  /* The most advanced recognizer left is the new live one */
+  liveSlot = _parseSessionLive(parseSessionPtr);
+  if (liveSlot < 0) {
+    liveSlot = 0;
+    if (_parseSessionStart(parseSessionPtr, &(parseSessionPtr->slots[liveSlot])) < 0) {
+      return NULL;
+    }
+  } else {
+    parseSessionPtr->statistics.nReused++;
+  }
+  slotPtr = &(parseSessionPtr->slots[liveSlot]);
+
+  rc = _parseSessionFeed(parseSessionPtr, slotPtr, parseSessionPtr->nTokens);
+  if (rc < 0) {
+    return NULL;
+  }
+  if (rc > 0) {
+    parseSessionPtr->errorPosition = (long) slotPtr->position;
+  }
+
+  /* Bounded work: checkpoints never cost more than maxCatchUp tokens each here */
+  _parseSessionCheckpoints(parseSessionPtr, liveSlot, 0);
+
+  return (rc == 0) ? slotPtr->r : NULL;
+}
+
+long parseSessionErrorPosition(parseSession_t *parseSessionPtr)
+{
+  return (parseSessionPtr != NULL) ? parseSessionPtr->errorPosition : -1;
+}
+
+long parseSessionIdle(parseSession_t *parseSessionPtr, size_t maxTokens)
+{
+  int liveSlot;
+  int i;
+
+  if (parseSessionPtr == NULL || maxTokens <= 0) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  _parseSessionInvalidate(parseSessionPtr);
+  liveSlot = _parseSessionLive(parseSessionPtr);
+  if (liveSlot < 0) {
+    /* Nothing to follow yet */
+    return 0;
+  }
+
+  for (i = 0; i < parseSessionPtr->nSlots; i++) {
+    if (parseSessionPtr->slots[i].r == NULL && _parseSessionStart(parseSessionPtr, &(parseSessionPtr->slots[i])) < 0) {
+      return -1;
+    }
+  }
+
+  return (long) _parseSessionCheckpoints(parseSessionPtr, liveSlot, maxTokens);
+}
+
+void parseSessionStatistics(parseSession_t *parseSessionPtr, parseSessionStatistics_t *statisticsPtr)
+{
+  if (parseSessionPtr != NULL && statisticsPtr != NULL) {
+    *statisticsPtr = parseSessionPtr->statistics;
+  }
+}
+
+void parseSessionFree(parseSession_t **parseSessionPtrPtr)
+{
+  parseSession_t *parseSessionPtr;
+  int             i;
+
+  if (parseSessionPtrPtr == NULL) {
+    return;
+  }
+  parseSessionPtr = *parseSessionPtrPtr;
+  if (parseSessionPtr == NULL) {
+    return;
+  }
+
+  for (i = 0; i < parseSessionPtr->nSlots; i++) {
+    _parseSessionRelease(&(parseSessionPtr->slots[i]));
+  }
+  marpa_g_unref(parseSessionPtr->g);
+  free(parseSessionPtr->slots);
+  free(parseSessionPtr->tokens);
+  free(parseSessionPtr);
+
+  *parseSessionPtrPtr = NULL;
+  return;
+}
+
+static int _parseSessionReserve(parseSession_t *parseSessionPtr, size_t nTokens)
+{
+  size_t               allocSize = parseSessionPtr->allocSize;
+  parseSessionToken_t *tokens;
+
+  if (nTokens <= allocSize) {
+    return 0;
+  }
+  while (allocSize < nTokens) {
+    allocSize *= 2;
+  }
+  tokens = realloc(parseSessionPtr->tokens, allocSize * sizeof(parseSessionToken_t));
+  if (tokens == NULL) {
+    return -1;
+  }
+  parseSessionPtr->tokens    = tokens;
+  parseSessionPtr->allocSize = allocSize;
+
+  return 0;
+}
+
+/* Recognizers that were fed a changed token are of no use anymore */
+static void _parseSessionInvalidate(parseSession_t *parseSessionPtr)
+{
+  int i;
+
+  if (parseSessionPtr->firstChanged == PARSESESSION_UNCHANGED) {
+    return;
+  }
+  for (i = 0; i < parseSessionPtr->nSlots; i++) {
+    if (parseSessionPtr->slots[i].r != NULL && parseSessionPtr->slots[i].position > parseSessionPtr->firstChanged) {
+      _parseSessionRelease(&(parseSessionPtr->slots[i]));
+    }
+  }
+  parseSessionPtr->firstChanged = PARSESESSION_UNCHANGED;
+}
+
+static int _parseSessionLive(parseSession_t *parseSessionPtr)
+{
+  int liveSlot = -1;
+  int i;
+
+  for (i = 0; i < parseSessionPtr->nSlots; i++) {
+    if (parseSessionPtr->slots[i].r != NULL && (liveSlot < 0 || parseSessionPtr->slots[i].position > parseSessionPtr->slots[liveSlot].position)) {
+      liveSlot = i;
+    }
+  }
+
+  return liveSlot;
+}
+
+static int _parseSessionStart(parseSession_t *parseSessionPtr, parseSessionSlot_t *slotPtr)
+{
+  marpa_g_error_clear(parseSessionPtr->g);
+  slotPtr->r = marpa_r_new(parseSessionPtr->g);
+  if (slotPtr->r == NULL) {
+    return -1;
+  }
+  if (marpa_r_start_input(slotPtr->r) < 0) {
+    _parseSessionRelease(slotPtr);
+    return -1;
+  }
+  slotPtr->position = 0;
+  parseSessionPtr->statistics.nRebuilds++;
+
+  return 0;
+}
+
+/* Returns 0 when target is reached, 1 if a token is rejected, -1 on failure, in which case the slot is released */
+static int _parseSessionFeed(parseSession_t *parseSessionPtr, parseSessionSlot_t *slotPtr, size_t target)
+{
+  marpa_g_error_clear(parseSessionPtr->g);
+  while (slotPtr->position < target) {
+    parseSessionToken_t *tokenPtr = &(parseSessionPtr->tokens[slotPtr->position]);
+    int                  rc       = marpa_r_alternative(slotPtr->r, tokenPtr->symbolId, tokenPtr->value, 1);
+
+    if (rc == MARPA_ERR_UNEXPECTED_TOKEN_ID) {
+      /* Soft failure: the recognizer is unchanged and still usable */
+      return 1;
+    }
+    if (rc != MARPA_ERR_NONE || marpa_r_earleme_complete(slotPtr->r) < 0) {
+      _parseSessionRelease(slotPtr);
+      return -1;
+    }
+    slotPtr->position++;
+    parseSessionPtr->statistics.nFed++;
+  }
+
+  return 0;
+}
+
+/*
+ * The i-th most advanced recognizer after the live one follows the live one,
+ * i * checkpointLag tokens behind. With a budget of 0, each checkpoint is fed
+ * at most maxCatchUp tokens. Returns the number of tokens fed.
+ */
+static size_t _parseSessionCheckpoints(parseSession_t *parseSessionPtr, int liveSlot, size_t budget)
+{
+  size_t livePosition = parseSessionPtr->slots[liveSlot].position;
+  size_t nFed         = 0;
+  int    nDone        = 0;
+
+  while (1) {
+    parseSessionSlot_t *slotPtr = NULL;
+    size_t              distance;
+    size_t              target;
+    size_t              n;
+    int                 i;
+
+    /* Next most advanced one: slots are few, no need to sort */
+    for (i = 0; i < parseSessionPtr->nSlots; i++) {
+      parseSessionSlot_t *candidatePtr = &(parseSessionPtr->slots[i]);
+      int                 nAhead       = 0;
+      int                 j;
+
+      if (i == liveSlot || candidatePtr->r == NULL) {
+	continue;
+      }
+      for (j = 0; j < parseSessionPtr->nSlots; j++) {
+	if (j != liveSlot && j != i && parseSessionPtr->slots[j].r != NULL &&
+	    (parseSessionPtr->slots[j].position > candidatePtr->position ||
+	     (parseSessionPtr->slots[j].position == candidatePtr->position && j < i))) {
+	  nAhead++;
+	}
+      }
+      if (nAhead == nDone) {
+	slotPtr = candidatePtr;
+	break;
+      }
+    }
+    if (slotPtr == NULL) {
+      break;
+    }
+    nDone++;
+
+    distance = parseSessionPtr->option.checkpointLag * nDone;
+    target   = (livePosition > distance) ? livePosition - distance : 0;
+    if (slotPtr->position >= target) {
+      continue;
+    }
+    n = target - slotPtr->position;
+    if (budget > 0) {
+      if (n > budget - nFed) {
+	n = budget - nFed;
+      }
+    } else if (n > parseSessionPtr->option.maxCatchUp) {
+      n = parseSessionPtr->option.maxCatchUp;
+    }
+    /* Tokens before livePosition were all accepted by the live recognizer */
+    if (_parseSessionFeed(parseSessionPtr, slotPtr, slotPtr->position + n) != 0) {
+      _parseSessionRelease(slotPtr);
+      break;
+    }
+    nFed += n;
+    if (budget > 0 && nFed >= budget) {
+      break;
+    }
+  }
+
+  return nFed;
+}
+
+static void _parseSessionRelease(parseSessionSlot_t *slotPtr)
+{
+  if (slotPtr->r != NULL) {
+    marpa_r_unref(slotPtr->r);
+    slotPtr->r = NULL;
+  }
+  slotPtr->position = 0;
+}
@@ -0,0 +1,61 @@
+#ifndef PARSE_SESSION_H
+#define PARSE_SESSION_H
+
+#include <stddef.h>
+#include <marpa.h>
+
+/*
+ * Incremental re-parse of a document given as a token stream: one token
+ * per earleme, i.e. marpa_r_alternative() with length 1 then marpa_r_earleme_complete().
+ *
+ * The session keeps the tokens, the live recognizer, and checkpoints:
+ * recognizers frozen checkpointLag, 2 * checkpointLag, ... tokens behind it.
+ * Recognizers cannot be rewound nor copied: after an edit, the nearest
+ * recognizer whose tokens are all unchanged becomes the live one, and
+ * only the tokens after it are fed. Appending costs the appended tokens,
+ * an edit in the last tokens costs about checkpointLag plus the edit.
+ *
+ * A used checkpoint is gone: parseSessionIdle() rebuilds missing ones
+ * from scratch, with a budget, e.g. when the editor is idle.
+ */
+
+typedef struct parseSession parseSession_t;
+
+typedef struct parseSessionToken {
+  Marpa_Symbol_ID symbolId;
+  int             value;
+} parseSessionToken_t;
+
+typedef struct parseSessionOption {
+  size_t checkpointLag;    /* Distance between checkpoints, in tokens */
+  int    nCheckpoints;
+  size_t maxCatchUp;       /* Tokens fed per checkpoint in parseSessionRecognizer() to follow the live recognizer */
+} parseSessionOption_t;
+
+#define PARSESESSION_OPTION_DEFAULT { 64, 4, 64 }
+
+typedef struct parseSessionStatistics {
+  unsigned long nFed;        /* Tokens fed to all recognizers, since creation */
+  unsigned long nRebuilds;   /* Recognizers started from scratch */
+  unsigned long nReused;     /* parseSessionRecognizer() calls that kept a recognizer */
+} parseSessionStatistics_t;
+
+/* optionPtr may be NULL */
+parseSession_t  *parseSessionCreate(Marpa_Grammar g, parseSessionOption_t *optionPtr);
+/* Replaces the document. Only the tokens after the first changed one will be fed again */
+int              parseSessionSet(parseSession_t *parseSessionPtr, const parseSessionToken_t *tokens, size_t nTokens);
+/* Replaces nDeleted tokens at position start with nInserted tokens */
+int              parseSessionEdit(parseSession_t *parseSessionPtr, size_t start, size_t nDeleted, const parseSessionToken_t *tokens, size_t nInserted);
+/*
+ * Recognizer up to date with the document, owned by the session and valid until next edit.
+ * Returns NULL on failure: when the document has a rejected token, parseSessionErrorPosition() says which one.
+ */
+Marpa_Recognizer parseSessionRecognizer(parseSession_t *parseSessionPtr);
+/* Index of the token rejected by the last parseSessionRecognizer(), or -1 */
+long             parseSessionErrorPosition(parseSession_t *parseSessionPtr);
+/* Builds or advances checkpoints, feeding at most maxTokens tokens. Returns the number of tokens fed, or -1 */
+long             parseSessionIdle(parseSession_t *parseSessionPtr, size_t maxTokens);
+void             parseSessionStatistics(parseSession_t *parseSessionPtr, parseSessionStatistics_t *statisticsPtr);
+void             parseSessionFree(parseSession_t **parseSessionPtrPtr);
+
+#endif /* PARSE_SESSION_H */
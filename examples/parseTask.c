@@ -0,0 +1,244 @@
+#include <stdlib.h>
+#include <errno.h>
+#include "parseTask.h"
+
+struct parseTask {
+  Marpa_Grammar              g;
+  parseTaskOption_t          option;
+  parseTaskFeedCallback_t    feedCallbackPtr;
+  parseDriverStepCallback_t  stepCallbackPtr;
+  parseDriverTreeCallback_t  treeCallbackPtr;
+  void                      *userDataPtr;
+  Marpa_Recognizer           r;
+  Marpa_Bocage               b;
+  Marpa_Order                o;
+  Marpa_Tree                 t;
+  Marpa_Value                v;
+  int                        done;
+  parseTaskResult_t          result;
+};
+
+static int  _parseTaskUnit(parseTask_t *parseTaskPtr);
+static void _parseTaskDone(parseTask_t *parseTaskPtr, parseTaskStatus_t status);
+
+parseTask_t *parseTaskCreate(Marpa_Grammar g, parseTaskOption_t *optionPtr, parseTaskFeedCallback_t feedCallbackPtr, parseDriverStepCallback_t stepCallbackPtr, parseDriverTreeCallback_t treeCallbackPtr, void *userDataPtr)
+{
+  parseTaskOption_t  defaultOption = PARSETASK_OPTION_DEFAULT;
+  parseTask_t       *parseTaskPtr;
+
+  if (g == NULL || feedCallbackPtr == NULL || stepCallbackPtr == NULL || (optionPtr != NULL && optionPtr->maxTrees < 0)) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  parseTaskPtr = malloc(sizeof(parseTask_t));
+  if (parseTaskPtr == NULL) {
+    return NULL;
+  }
+  parseTaskPtr->g                  = g;
+  parseTaskPtr->option             = (optionPtr != NULL) ? *optionPtr : defaultOption;
+  parseTaskPtr->feedCallbackPtr    = feedCallbackPtr;
+  parseTaskPtr->stepCallbackPtr    = stepCallbackPtr;
+  parseTaskPtr->treeCallbackPtr    = treeCallbackPtr;
+  parseTaskPtr->userDataPtr        = userDataPtr;
+  parseTaskPtr->b                  = NULL;
+  parseTaskPtr->o                  = NULL;
+  parseTaskPtr->t                  = NULL;
+  parseTaskPtr->v                  = NULL;
+  parseTaskPtr->done               = 0;
+  parseTaskPtr->result.status      = PARSETASK_STATUS_OK;
+  parseTaskPtr->result.phase       = PARSEMETRICS_PHASE_FEED;
+  parseTaskPtr->result.nEarlemes   = 0;
+  parseTaskPtr->result.nTrees      = 0;
+  parseTaskPtr->result.nUnits      = 0;
+  parseTaskPtr->result.nResumes    = 0;
+
+  marpa_g_error_clear(g);
+  parseTaskPtr->r = marpa_r_new(g);
+  if (parseTaskPtr->r == NULL || marpa_r_start_input(parseTaskPtr->r) < 0) {
+    parseTaskFree(&parseTaskPtr);
+    errno = ENOMEM;
+    return NULL;
+  }
+
+  return parseTaskPtr;
+}
+
+int parseTaskResume(parseTask_t *parseTaskPtr, int quantum)
+{
+  if (parseTaskPtr == NULL || quantum <= 0) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (parseTaskPtr->done) {
+    return PARSETASK_STATE_DONE;
+  }
+  parseTaskPtr->result.nResumes++;
+  while (quantum-- > 0) {
+    if (_parseTaskUnit(parseTaskPtr) < 0) {
+      return PARSETASK_STATE_WAITING;
+    }
+    parseTaskPtr->result.nUnits++;
+    if (parseTaskPtr->done) {
+      return PARSETASK_STATE_DONE;
+    }
+  }
+
+  return PARSETASK_STATE_RUNNABLE;
+}
+
+void parseTaskResult(parseTask_t *parseTaskPtr, parseTaskResult_t *resultPtr)
+{
+  if (parseTaskPtr == NULL || resultPtr == NULL) {
+    return;
+  }
+
+  *resultPtr = parseTaskPtr->result;
+}
+
+const char *parseTaskStatusName(parseTaskStatus_t status)
+{
+  switch (status) {
+  case PARSETASK_STATUS_OK:       return "ok";
+  case PARSETASK_STATUS_REJECTED: return "rejected";
+  case PARSETASK_STATUS_FAILED:   return "failed";
+  default:                        return "unknown";
+  }
+}
+
+void parseTaskFree(parseTask_t **parseTaskPtrPtr)
+{
+  parseTask_t *parseTaskPtr;
+
+  if (parseTaskPtrPtr == NULL || *parseTaskPtrPtr == NULL) {
+    return;
+  }
+
+  parseTaskPtr = *parseTaskPtrPtr;
+  /* Releases everything when not done */
+  _parseTaskDone(parseTaskPtr, parseTaskPtr->result.status);
+  free(parseTaskPtr);
+  *parseTaskPtrPtr = NULL;
+}
+
+/* One unit of work in the current phase. Returns 0, or -1 when waiting for input */
+static int _parseTaskUnit(parseTask_t *parseTaskPtr)
+{
+  parseTaskResult_t *resultPtr = &(parseTaskPtr->result);
+  Marpa_Step_Type    stepType;
+  int                rc;
+
+  switch (resultPtr->phase) {
+  case PARSEMETRICS_PHASE_FEED:
+    rc = (*parseTaskPtr->feedCallbackPtr)(parseTaskPtr->userDataPtr, parseTaskPtr->r);
+    if (rc == PARSETASK_FEED_WAIT) {
+      return -1;
+    }
+    if (rc == 0) {
+      resultPtr->phase = PARSEMETRICS_PHASE_BOCAGE;
+    } else if (rc < 0 || marpa_r_earleme_complete(parseTaskPtr->r) < 0) {
+      _parseTaskDone(parseTaskPtr, PARSETASK_STATUS_REJECTED);
+    } else {
+      resultPtr->nEarlemes++;
+    }
+    break;
+
+  case PARSEMETRICS_PHASE_BOCAGE:
+    parseTaskPtr->b = marpa_b_new(parseTaskPtr->r, marpa_r_latest_earley_set(parseTaskPtr->r));
+    if (parseTaskPtr->b == NULL) {
+      _parseTaskDone(parseTaskPtr, PARSETASK_STATUS_REJECTED);
+    } else {
+      /* The recognizer is no longer needed: the bocage keeps what it uses */
+      marpa_r_unref(parseTaskPtr->r);
+      parseTaskPtr->r  = NULL;
+      resultPtr->phase = PARSEMETRICS_PHASE_ORDER;
+    }
+    break;
+
+  case PARSEMETRICS_PHASE_ORDER:
+    parseTaskPtr->o = marpa_o_new(parseTaskPtr->b);
+    if (parseTaskPtr->o == NULL || marpa_o_high_rank_only_set(parseTaskPtr->o, parseTaskPtr->option.highRankOnly) < 0) {
+      _parseTaskDone(parseTaskPtr, PARSETASK_STATUS_FAILED);
+      break;
+    }
+    parseTaskPtr->t = marpa_t_new(parseTaskPtr->o);
+    if (parseTaskPtr->t == NULL) {
+      _parseTaskDone(parseTaskPtr, PARSETASK_STATUS_FAILED);
+    } else {
+      resultPtr->phase = PARSEMETRICS_PHASE_TREE;
+    }
+    break;
+
+  case PARSEMETRICS_PHASE_TREE:
+    if (parseTaskPtr->option.maxTrees > 0 && resultPtr->nTrees >= parseTaskPtr->option.maxTrees) {
+      _parseTaskDone(parseTaskPtr, PARSETASK_STATUS_OK);
+      break;
+    }
+    rc = marpa_t_next(parseTaskPtr->t);
+    if (rc == -1) {
+      /* Exhausted */
+      _parseTaskDone(parseTaskPtr, PARSETASK_STATUS_OK);
+      break;
+    }
+    if (rc < 0) {
+      _parseTaskDone(parseTaskPtr, PARSETASK_STATUS_FAILED);
+      break;
+    }
+    parseTaskPtr->v = parseDriverValueNew(parseTaskPtr->g, parseTaskPtr->t);
+    if (parseTaskPtr->v == NULL) {
+      _parseTaskDone(parseTaskPtr, PARSETASK_STATUS_FAILED);
+      break;
+    }
+    resultPtr->phase = PARSEMETRICS_PHASE_VALUATION;
+    break;
+
+  case PARSEMETRICS_PHASE_VALUATION:
+    stepType = marpa_v_step(parseTaskPtr->v);
+    if (stepType == MARPA_STEP_INACTIVE) {
+      marpa_v_unref(parseTaskPtr->v);
+      parseTaskPtr->v  = NULL;
+      resultPtr->phase = PARSEMETRICS_PHASE_TREE;
+      resultPtr->nTrees++;
+      if (parseTaskPtr->treeCallbackPtr != NULL && (*parseTaskPtr->treeCallbackPtr)(parseTaskPtr->userDataPtr, resultPtr->nTrees - 1) < 0) {
+	_parseTaskDone(parseTaskPtr, PARSETASK_STATUS_OK);
+      }
+    } else if (stepType < 0 || (*parseTaskPtr->stepCallbackPtr)(parseTaskPtr->userDataPtr, parseTaskPtr->v, stepType) < 0) {
+      _parseTaskDone(parseTaskPtr, PARSETASK_STATUS_FAILED);
+    }
+    break;
+
+  default:
+    _parseTaskDone(parseTaskPtr, PARSETASK_STATUS_FAILED);
+    break;
+  }
+
+  return 0;
+}
+
+/* Releases the libmarpa objects of the parse, the phase says where it stopped */
+static void _parseTaskDone(parseTask_t *parseTaskPtr, parseTaskStatus_t status)
+{
+  if (parseTaskPtr->v != NULL) {
+    marpa_v_unref(parseTaskPtr->v);
+    parseTaskPtr->v = NULL;
+  }
+  if (parseTaskPtr->t != NULL) {
+    marpa_t_unref(parseTaskPtr->t);
+    parseTaskPtr->t = NULL;
+  }
+  if (parseTaskPtr->o != NULL) {
+    marpa_o_unref(parseTaskPtr->o);
+    parseTaskPtr->o = NULL;
+  }
+  if (parseTaskPtr->b != NULL) {
+    marpa_b_unref(parseTaskPtr->b);
+    parseTaskPtr->b = NULL;
+  }
+  if (parseTaskPtr->r != NULL) {
+    marpa_r_unref(parseTaskPtr->r);
+    parseTaskPtr->r = NULL;
+  }
+  parseTaskPtr->done          = 1;
+  parseTaskPtr->result.status = status;
+}
@@ -0,0 +1,69 @@
+#ifndef PARSE_TASK_H
+#define PARSE_TASK_H
+
+#include <marpa.h>
+#include "parseMetrics.h"
+#include "parseDriver.h"
+
+/*
+ * Resumable parse: feed, bocage, order, trees and valuation as a state
+ * machine that parseTaskResume() advances by a bounded number of units
+ * of work, then returns. An event loop on one thread can then interleave
+ * many parses, e.g. round robin, and a long parse cannot hold up the
+ * short ones for more than one quantum.
+ *
+ * A unit is one earleme, marpa_b_new(), marpa_o_new() and marpa_t_new(),
+ * one marpa_t_next(), or one marpa_v_step(). A single libmarpa call
+ * cannot be interrupted: the units of feed and bocage are not of equal
+ * cost, only bounded in number.
+ *
+ * Each task owns its recognizer, bocage, order, tree and valuator. The
+ * grammar is shared by the tasks of a thread, not between threads.
+ */
+
+typedef struct parseTask parseTask_t;
+
+/* Returned by the feed callback when no input is available yet: the task waits */
+#define PARSETASK_FEED_WAIT 2
+
+/* Feeds the alternatives of one earleme. Returns 1 when fed, 0 at end of input, PARSETASK_FEED_WAIT, or -1 when the input is invalid */
+typedef int (*parseTaskFeedCallback_t)(void *userDataPtr, Marpa_Recognizer r);
+
+typedef struct parseTaskOption {
+  int highRankOnly;    /* Argument to marpa_o_high_rank_only_set() */
+  int maxTrees;        /* 0 means no limit */
+} parseTaskOption_t;
+
+#define PARSETASK_OPTION_DEFAULT { 1, 0 }
+
+typedef enum parseTaskState {
+  PARSETASK_STATE_RUNNABLE = 0,    /* The quantum was used up */
+  PARSETASK_STATE_WAITING,         /* The feed callback returned PARSETASK_FEED_WAIT */
+  PARSETASK_STATE_DONE             /* See parseTaskResult() */
+} parseTaskState_t;
+
+typedef enum parseTaskStatus {
+  PARSETASK_STATUS_OK = 0,         /* All trees, maxTrees, or a stop from the tree callback */
+  PARSETASK_STATUS_REJECTED,       /* Invalid input, or no parse */
+  PARSETASK_STATUS_FAILED          /* libmarpa failure, or abort from the step callback */
+} parseTaskStatus_t;
+
+typedef struct parseTaskResult {
+  parseTaskStatus_t   status;      /* Meaningful when done */
+  parseMetricsPhase_t phase;       /* Current phase, or where the parse stopped */
+  int                 nEarlemes;
+  int                 nTrees;
+  unsigned long       nUnits;
+  unsigned long       nResumes;
+} parseTaskResult_t;
+
+/* optionPtr may be NULL. Creates the recognizer: the first unit of work is the first earleme. The step and tree callbacks are parseDriver's */
+parseTask_t      *parseTaskCreate(Marpa_Grammar g, parseTaskOption_t *optionPtr, parseTaskFeedCallback_t feedCallbackPtr, parseDriverStepCallback_t stepCallbackPtr, parseDriverTreeCallback_t treeCallbackPtr, void *userDataPtr);
+/* Runs at most quantum units. Returns the new state, or -1 with errno set on invalid arguments. A done task stays done */
+int               parseTaskResume(parseTask_t *parseTaskPtr, int quantum);
+void              parseTaskResult(parseTask_t *parseTaskPtr, parseTaskResult_t *resultPtr);
+const char       *parseTaskStatusName(parseTaskStatus_t status);
+/* Also cancels: the libmarpa objects of an unfinished parse are unref'ed */
+void              parseTaskFree(parseTask_t **parseTaskPtrPtr);
+
+#endif /* PARSE_TASK_H */
@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <marpa.h>
+#include "thin_macros.h"
+#include "parseBudget.h"
+
+/*
+  Hostile inputs for a highly ambiguous grammar: the number of trees is
+  a Catalan number, the number of Earley items is quadratic. Each parse
+  runs under a budget and reports how it ended; the grammar, and the
+  worker, survive all of them. A late cancellation, after its parse
+  ended, must not stop the next parse.
+
+  :start ::= S
+  S ::= E
+  E ::= E E
+  E ::= a
+
+  Execution  : ./parse_budget
+*/
+
+typedef struct s_user {
+  Marpa_Symbol_ID a;
+  int             nRemaining;    /* Tokens still to feed */
+} s_user_t;
+
+typedef struct s_watchdog {
+  parseBudget_t *parseBudgetPtr;
+  useconds_t     delay;
+} s_watchdog_t;
+
+static void  _check        (Marpa_Error_Code errorCode, const char *call, int forcedCondition);
+static int   _feedCallback (void *userDataPtr, Marpa_Recognizer r);
+static int   _stepCallback (void *userDataPtr, Marpa_Value v, Marpa_Step_Type stepType);
+static void *_watchdog     (void *watchdogPtr);
+
+struct marpa_error_description_s {
+  Marpa_Error_Code error_code;
+  const char*name;
+  const char*suggested;
+};
+extern const struct marpa_error_description_s marpa_error_description[];
+
+int main() {
+  Marpa_Config        c;
+  Marpa_Grammar       g;
+  Marpa_Symbol_ID     S, E;
+  Marpa_Rule_ID       start_rule_id, pair_rule_id, a_rule_id;
+  s_user_t            user;
+  struct {
+    const char          *description;
+    int                  nTokens;
+    double               maxSeconds;
+    size_t               maxBytes;
+    useconds_t           cancelAfter;   /* Microseconds: 0 means no watchdog */
+    parseBudgetStatus_t  status;        /* Expected */
+  } runs[] = {
+    { "4 tokens, no budget",              4, 0.0,  0,                    0, PARSEBUDGET_STATUS_OK        },
+    { "30 tokens, 50 ms deadline",       30, 0.05, 0,                    0, PARSEBUDGET_STATUS_DEADLINE  },
+    { "3000 tokens, 16 MB budget",     3000, 0.0,  16 * 1024 * 1024,     0, PARSEBUDGET_STATUS_MEMORY    },
+    { "30 tokens, cancelled at 50 ms",   30, 0.0,  0,                50000, PARSEBUDGET_STATUS_CANCELLED },
+    { "6 tokens, after the others",       6, 0.05, 16 * 1024 * 1024,     0, PARSEBUDGET_STATUS_OK        }
+  };
+  unsigned int        i;
+
+  INIT_CONFIG(c);
+  CREATE_GRAMMAR(g, c);
+
+  CREATE_SYMBOL(S, g);
+  CREATE_SYMBOL(E, g);
+  CREATE_SYMBOL(user.a, g);
+
+  SET_START_SYMBOL(S, g);
+
+  {
+    Marpa_Symbol_ID rhs[] = { E };
+    CREATE_RULE(start_rule_id, g, S, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { E, E };
+    CREATE_RULE(pair_rule_id,  g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { user.a };
+    CREATE_RULE(a_rule_id,     g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+
+  PRECOMPUTE(g);
+
+  for (i = 0; i < ARRAY_LENGTH(runs); i++) {
+    parseBudgetOption_t  option = PARSEBUDGET_OPTION_DEFAULT;
+    parseBudget_t       *parseBudgetPtr;
+    parseBudgetResult_t  result;
+    s_watchdog_t         watchdog;
+    pthread_t            thread;
+    int                  watched = 0;
+
+    option.maxSeconds = runs[i].maxSeconds;
+    option.maxBytes   = runs[i].maxBytes;
+    parseBudgetPtr = parseBudgetCreate(&option);
+    if (parseBudgetPtr == NULL) {
+      fprintf(stderr, "parseBudgetCreate(): %s\n", strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+    if (runs[i].cancelAfter > 0) {
+      watchdog.parseBudgetPtr = parseBudgetPtr;
+      watchdog.delay          = runs[i].cancelAfter;
+      watched = (pthread_create(&thread, NULL, &_watchdog, &watchdog) == 0);
+    }
+
+    user.nRemaining = runs[i].nTokens;
+    parseBudgetRun(parseBudgetPtr, g, &_feedCallback, &_stepCallback, NULL, &user, &result);
+    fprintf(stderr, "%-30s: %s, %s phase, %d earlemes, %d trees, ~%ld bytes, %.3f s\n",
+	    runs[i].description,
+	    parseBudgetStatusName(result.status),
+	    parseMetricsPhaseName(result.phase),
+	    result.nEarlemes,
+	    result.nTrees,
+	    (long) result.estimatedBytes,
+	    result.elapsedSeconds);
+    if (result.status != runs[i].status) {
+      fprintf(stderr, "%s: expected %s\n", runs[i].description, parseBudgetStatusName(runs[i].status));
+      exit(EXIT_FAILURE);
+    }
+
+    if (watched) {
+      pthread_join(thread, NULL);
+    }
+
+    /* Same worker, late cancellation: the next parse ignores it */
+    parseBudgetCancel(parseBudgetPtr);
+    user.nRemaining = 4;
+    if (parseBudgetRun(parseBudgetPtr, g, &_feedCallback, &_stepCallback, NULL, &user, &result) < 0) {
+      fprintf(stderr, "%s: next parse %s\n", runs[i].description, parseBudgetStatusName(result.status));
+      exit(EXIT_FAILURE);
+    }
+    parseBudgetFree(&parseBudgetPtr);
+  }
+
+  marpa_g_unref(g);
+
+  exit(EXIT_SUCCESS);
+}
+
+static int _feedCallback(void *userDataPtr, Marpa_Recognizer r) {
+  s_user_t *userPtr = (s_user_t *) userDataPtr;
+
+  if (userPtr->nRemaining <= 0) {
+    return 0;
+  }
+  userPtr->nRemaining--;
+
+  return (marpa_r_alternative(r, userPtr->a, 1, 1) == MARPA_ERR_NONE) ? 1 : -1;
+}
+
+/* Valuation only walks the steps: the point is the cost of the trees */
+static int _stepCallback(void *userDataPtr, Marpa_Value v, Marpa_Step_Type stepType) {
+  return 0;
+}
+
+static void *_watchdog(void *watchdogPtr) {
+  s_watchdog_t *watchdog = (s_watchdog_t *) watchdogPtr;
+
+  usleep(watchdog->delay);
+  parseBudgetCancel(watchdog->parseBudgetPtr);
+
+  return NULL;
+}
+
+static void _check(Marpa_Error_Code errorCode, const char *call, int forcedCondition) {
+  if (forcedCondition != 0 || errorCode != MARPA_ERR_NONE) {
+    const char *function = (call != NULL) ? call : "<unknown>";
+    const char *msg = (errorCode >= 0 && errorCode < MARPA_ERROR_COUNT) ? marpa_error_description[errorCode].name : "Generic error";
+    fprintf(stderr,"%s: %s", function, msg);
+    exit(EXIT_FAILURE);
+  }
+}
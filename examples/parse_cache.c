@@ -0,0 +1,298 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <marpa.h>
+#include "thin_macros.h"
+#include "parseDriver.h"
+#include "parseMetrics.h"
+#include "parseCache.h"
+
+/*
+  Repeated expressions of the ambiguous_grammar.c grammar, the values of
+  all their trees computed once without cache, once with parseCache: a hit
+  skips the recognizer, the bocage and the valuation.
+
+  :start ::= S
+  S ::= E
+  E ::= E op E
+  E ::= number
+
+  Then a working set shift: a cache holding WORKING_SET entries that were
+  never read takes WORKING_SET new keys, which must all stay resident.
+
+  Execution  : ./parse_cache [nInputs [nDistinct]]
+*/
+
+#define MAX_TOKENS  16
+#define MAX_TREES   512
+#define GRAMMAR_ID  1                  /* Changes with the grammar */
+#define WORKING_SET 10
+
+typedef struct s_user {
+  Marpa_Rule_ID op_rule_id;
+  int           values[MAX_TOKENS];
+  int           results[MAX_TREES];    /* One per tree */
+  int           nResults;
+} s_user_t;
+
+static void _check        (Marpa_Error_Code errorCode, const char *call, int forcedCondition);
+static int  _stepCallback (void *userDataPtr, Marpa_Value v, Marpa_Step_Type stepType);
+static int  _treeCallback (void *userDataPtr, int treeIndex);
+static int  _shift        (Marpa_Symbol_ID number);
+
+struct marpa_error_description_s {
+  Marpa_Error_Code error_code;
+  const char*name;
+  const char*suggested;
+};
+extern const struct marpa_error_description_s marpa_error_description[];
+
+int main(int argc, char **argv) {
+  Marpa_Config            c;
+  Marpa_Grammar           g;
+  Marpa_Symbol_ID         S, E, op, number;
+  Marpa_Rule_ID           start_rule_id, number_rule_id;
+  parseDriver_t          *parseDriverPtr;
+  parseCache_t           *parseCachePtr;
+  parseCacheStatistics_t  statistics;
+  s_user_t                user;
+  int                     nInputs   = (argc > 1) ? atoi(argv[1]) : 100000;
+  int                     nDistinct = (argc > 2) ? atoi(argv[2]) : 500;
+  parseCacheToken_t      *pool;
+  int                    *poolLengths;
+  long long               checksums[2];
+  int                     pass;
+  int                     i;
+
+  if (nInputs <= 0 || nDistinct <= 0) {
+    fprintf(stderr, "Usage: %s [nInputs [nDistinct]]\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  INIT_CONFIG(c);
+  CREATE_GRAMMAR(g, c);
+
+  CREATE_SYMBOL(S, g);
+  CREATE_SYMBOL(E, g);
+  CREATE_SYMBOL(op, g);
+  CREATE_SYMBOL(number, g);
+
+  SET_START_SYMBOL(S, g);
+
+  {
+    Marpa_Symbol_ID rhs[] = { E };
+    CREATE_RULE(start_rule_id,   g, S, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { E, op, E };
+    CREATE_RULE(user.op_rule_id, g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { number };
+    CREATE_RULE(number_rule_id,  g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+
+  PRECOMPUTE(g);
+
+  parseDriverPtr = parseDriverCreate(g, NULL, &_stepCallback, &_treeCallback, &user);
+  parseCachePtr  = parseCacheCreate(NULL);
+  pool           = malloc(nDistinct * MAX_TOKENS * sizeof(parseCacheToken_t));
+  poolLengths    = malloc(nDistinct * sizeof(int));
+  if (parseDriverPtr == NULL || parseCachePtr == NULL || pool == NULL || poolLengths == NULL) {
+    fprintf(stderr, "Initialization failure: %s\n", strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  /* Expressions of 1 to 6 numbers: at most 42 trees */
+  srand(42);
+  for (i = 0; i < nDistinct; i++) {
+    parseCacheToken_t *tokens   = &(pool[i * MAX_TOKENS]);
+    int                nNumbers = 1 + rand() % 6;
+    int                j;
+
+    poolLengths[i] = 0;
+    for (j = 0; j < nNumbers; j++) {
+      if (j > 0) {
+	tokens[poolLengths[i]].symbolId = op;
+	tokens[poolLengths[i]].value    = "+-*"[rand() % 3];
+	poolLengths[i]++;
+      }
+      tokens[poolLengths[i]].symbolId = number;
+      tokens[poolLengths[i]].value    = rand() % 10;
+      poolLengths[i]++;
+    }
+  }
+
+  for (pass = 0; pass < 2; pass++) {
+    uint64_t start = parseMetricsNow();
+
+    checksums[pass] = 0;
+    srand(7);
+    for (i = 0; i < nInputs; i++) {
+      int                index   = rand() % nDistinct;
+      parseCacheToken_t *tokens  = &(pool[index * MAX_TOKENS]);
+      int                nTokens = poolLengths[index];
+      const void        *resultPtr;
+      size_t             resultLength;
+      int                j;
+
+      if (pass == 1 && parseCacheGet(parseCachePtr, GRAMMAR_ID, tokens, nTokens, &resultPtr, &resultLength) == 1) {
+	user.nResults = (int) (resultLength / sizeof(int));
+	memcpy(user.results, resultPtr, resultLength);
+      } else {
+	Marpa_Recognizer r;
+
+	CREATE_RECOGNIZER(r, g);
+	START_INPUT(r, g);
+	for (j = 0; j < nTokens; j++) {
+	  ALTERNATIVE(r, g, tokens[j].symbolId, tokens[j].value, 1);
+	  EARLEME_COMPLETE(r, g);
+	}
+	user.nResults = 0;
+	_check(marpa_g_error(g, NULL), "parseDriverRun()", parseDriverRun(parseDriverPtr, r) < 0);
+	marpa_r_unref(r);
+	if (pass == 1) {
+	  _check(MARPA_ERR_NONE, "parseCachePut()", parseCachePut(parseCachePtr, GRAMMAR_ID, tokens, nTokens, user.results, user.nResults * sizeof(int)) < 0);
+	}
+      }
+      for (j = 0; j < user.nResults; j++) {
+	checksums[pass] += user.results[j];
+      }
+    }
+    fprintf(stderr, "%s: checksum %lld, %.3f s\n", (pass == 0) ? "No cache  " : "parseCache", checksums[pass], (double) (parseMetricsNow() - start) / 1e9);
+  }
+
+  parseCacheStatistics(parseCachePtr, &statistics);
+  fprintf(stderr, "Hits: %lu, misses: %lu, evictions: %lu, entries: %ld, bytes: %ld\n",
+	  statistics.nHits,
+	  statistics.nMisses,
+	  statistics.nEvictions,
+	  (long) statistics.nEntries,
+	  (long) statistics.nBytes);
+  if (checksums[0] != checksums[1]) {
+    fprintf(stderr, "MISMATCH between cached and uncached results\n");
+    exit(EXIT_FAILURE);
+  }
+  if (_shift(number) < 0) {
+    exit(EXIT_FAILURE);
+  }
+
+  free(poolLengths);
+  free(pool);
+  parseCacheFree(&parseCachePtr);
+  parseDriverFree(&parseDriverPtr);
+  marpa_g_unref(g);
+
+  exit(EXIT_SUCCESS);
+}
+
+/* Stale entries, then a new working set: returns -1 unless all the new keys hit */
+static int _shift(Marpa_Symbol_ID number) {
+  parseCacheOption_t      option = PARSECACHE_OPTION_DEFAULT;
+  parseCache_t           *parseCachePtr;
+  parseCacheStatistics_t  statistics;
+  parseCacheToken_t       token;
+  const void             *resultPtr;
+  size_t                  resultLength;
+  int                     result = 0;
+  int                     nNew   = 0;
+  int                     nStale = 0;
+  int                     i;
+
+  /* All entries have the same size: the cap is WORKING_SET of them */
+  token.symbolId = number;
+  token.value    = 0;
+  parseCachePtr  = parseCacheCreate(&option);
+  if (parseCachePtr == NULL || parseCachePut(parseCachePtr, GRAMMAR_ID, &token, 1, &result, sizeof(result)) < 0) {
+    fprintf(stderr, "parseCache failure: %s\n", strerror(errno));
+    return -1;
+  }
+  parseCacheStatistics(parseCachePtr, &statistics);
+  parseCacheFree(&parseCachePtr);
+  option.maxBytes = WORKING_SET * statistics.nBytes;
+  parseCachePtr   = parseCacheCreate(&option);
+  if (parseCachePtr == NULL) {
+    fprintf(stderr, "parseCacheCreate(): %s\n", strerror(errno));
+    return -1;
+  }
+
+  for (i = 0; i < 2 * WORKING_SET; i++) {
+    token.value = i;
+    if (parseCachePut(parseCachePtr, GRAMMAR_ID, &token, 1, &result, sizeof(result)) < 0) {
+      fprintf(stderr, "parseCachePut(): %s\n", strerror(errno));
+      return -1;
+    }
+  }
+  for (i = 0; i < 2 * WORKING_SET; i++) {
+    token.value = i;
+    if (parseCacheGet(parseCachePtr, GRAMMAR_ID, &token, 1, &resultPtr, &resultLength) == 1) {
+      if (i < WORKING_SET) {
+	nStale++;
+      } else {
+	nNew++;
+      }
+    }
+  }
+  parseCacheFree(&parseCachePtr);
+
+  fprintf(stderr, "Working set shift: %d/%d new keys resident, %d stale\n", nNew, WORKING_SET, nStale);
+  if (nNew != WORKING_SET) {
+    fprintf(stderr, "New working set evicted\n");
+    return -1;
+  }
+
+  return 0;
+}
+
+static int _stepCallback(void *userDataPtr, Marpa_Value v, Marpa_Step_Type stepType) {
+  s_user_t *userPtr = (s_user_t *) userDataPtr;
+
+  switch (stepType) {
+  case MARPA_STEP_TOKEN:
+    if (marpa_v_result(v) >= MAX_TOKENS) {
+      return -1;
+    }
+    userPtr->values[marpa_v_result(v)] = marpa_v_token_value(v);
+    break;
+  case MARPA_STEP_RULE:
+    if (marpa_v_rule(v) == userPtr->op_rule_id) {
+      int  arg_0 = marpa_v_arg_0(v);
+      int *left  = &(userPtr->values[arg_0]);
+      int  right = userPtr->values[marpa_v_arg_n(v)];
+
+      switch (userPtr->values[arg_0 + 1]) {
+      case '+': *left += right; break;
+      case '-': *left -= right; break;
+      case '*': *left *= right; break;
+      default:
+	return -1;
+      }
+    }
+    /* Other rules pass their only value through: it already is at arg_0 */
+    break;
+  default:
+    break;
+  }
+
+  return 0;
+}
+
+static int _treeCallback(void *userDataPtr, int treeIndex) {
+  s_user_t *userPtr = (s_user_t *) userDataPtr;
+
+  if (userPtr->nResults >= MAX_TREES) {
+    return -1;
+  }
+  userPtr->results[userPtr->nResults++] = userPtr->values[0];
+  return 0;
+}
+
+static void _check(Marpa_Error_Code errorCode, const char *call, int forcedCondition) {
+  if (forcedCondition != 0 || errorCode != MARPA_ERR_NONE) {
+    const char *function = (call != NULL) ? call : "<unknown>";
+    const char *msg = (errorCode >= 0 && errorCode < MARPA_ERROR_COUNT) ? marpa_error_description[errorCode].name : "Generic error";
+    fprintf(stderr,"%s: %s", function, msg);
+    exit(EXIT_FAILURE);
+  }
+}
@@ -0,0 +1,520 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <marpa.h>
+#include "thin_macros.h"
+#include "parseDriver.h"
+#include "parseMetrics.h"
+#include "parseServer.h"
+#include "parseClient.h"
+
+/*
+  Resident parse server and its thin client, for the grammar of
+  ambiguous_grammar.c. The server builds and precomputes the grammar
+  once per worker thread: a request only pays for the recognizer and
+  the valuation. The value of a parse is the value of its bracketing.
+
+  :start ::= S
+  S ::= E
+  E ::= E op E
+  E ::= number
+
+  Without argument, the same random expressions are parsed cold, i.e.
+  building and precomputing the grammar every time, like a short-lived
+  CLI would, then sent to a server running in this process from several
+  client threads, and the values compared.
+
+  Execution  : ./parse_daemon
+               ./parse_daemon -s socketPath                  (until SIGINT or SIGTERM)
+               ./parse_daemon -c socketPath expression ...   (e.g. 2-0*3+1)
+*/
+
+#define GRAMMAR_ID     1
+#define MAX_TREES      16
+#define N_EXPRESSIONS  2000
+#define N_CLIENTS      4
+
+/* Ids are given by creation order: a client knows them without building the grammar */
+enum { SYMBOL_S = 0, SYMBOL_E, SYMBOL_OP, SYMBOL_NUMBER };
+enum { RULE_START = 0, RULE_OP, RULE_NUMBER };
+
+typedef struct s_cold {
+  int *values;           /* Valuator stack */
+  int  nValues;
+  int  results[MAX_TREES];
+  int  nResults;
+} s_cold_t;
+
+typedef struct s_expected {
+  char *expression;
+  int   results[MAX_TREES];
+  int   nResults;
+} s_expected_t;
+
+typedef struct s_client {
+  const char   *socketPath;
+  s_expected_t *expected;
+  int           first;           /* Expressions [first, first + n) */
+  int           n;
+  uint64_t     *latencies;       /* Per expression */
+  int           nMismatches;
+} s_client_t;
+
+static parseServer_t *serverPtr = NULL;   /* For the signal handler */
+
+static void          _check        (Marpa_Error_Code errorCode, const char *call, int forcedCondition);
+static Marpa_Grammar _grammar      (void *userDataPtr);
+static int           _ruleCallback (void *userDataPtr, Marpa_Rule_ID ruleId, const int *args, int nArgs, int *resultPtr);
+static int           _tokens       (const char *expression, parseProtocolToken_t **tokensPtr);
+static int           _coldParse    (const char *expression, s_cold_t *coldPtr);
+static int           _stepCallback (void *userDataPtr, Marpa_Value v, Marpa_Step_Type stepType);
+static int           _treeCallback (void *userDataPtr, int treeIndex);
+static void         *_client       (void *clientPtr);
+static void         *_server       (void *parseServerPtr);
+static void          _stop         (int signum);
+static int           _serve        (const char *socketPath);
+static int           _request      (const char *socketPath, char **expressions, int nExpressions);
+static int           _compare      (const void *p1, const void *p2);
+
+struct marpa_error_description_s {
+  Marpa_Error_Code error_code;
+  const char*name;
+  const char*suggested;
+};
+extern const struct marpa_error_description_s marpa_error_description[];
+
+int main(int argc, char **argv) {
+  parseServerGrammar_t  grammar = { GRAMMAR_ID, &_grammar, &_ruleCallback, NULL };
+  parseServerOption_t   option  = PARSESERVER_OPTION_DEFAULT;
+  parseServerStatistics_t statistics;
+  s_expected_t         *expected;
+  s_cold_t              cold;
+  s_client_t            clients[N_CLIENTS];
+  pthread_t             clientThreads[N_CLIENTS];
+  pthread_t             serverThread;
+  uint64_t             *latencies;
+  uint64_t              start, coldNs, warmNs;
+  char                  directory[] = "/tmp/parse_daemon.XXXXXX";
+  char                  socketPath[sizeof(directory) + 16];
+  int                   nMismatches = 0;
+  int                   i, j;
+
+  if (argc >= 3 && strcmp(argv[1], "-s") == 0) {
+    exit((_serve(argv[2]) < 0) ? EXIT_FAILURE : EXIT_SUCCESS);
+  }
+  if (argc >= 4 && strcmp(argv[1], "-c") == 0) {
+    exit((_request(argv[2], &(argv[3]), argc - 3) < 0) ? EXIT_FAILURE : EXIT_SUCCESS);
+  }
+  if (argc != 1) {
+    fprintf(stderr, "Usage: %s [-s socketPath | -c socketPath expression ...]\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  /* Random expressions of 1 to 6 operands */
+  expected  = malloc(N_EXPRESSIONS * sizeof(s_expected_t));
+  latencies = malloc(N_EXPRESSIONS * sizeof(uint64_t));
+  if (expected == NULL || latencies == NULL) {
+    fprintf(stderr, "malloc() failure\n");
+    exit(EXIT_FAILURE);
+  }
+  srand(42);
+  for (i = 0; i < N_EXPRESSIONS; i++) {
+    int nOperands = 1 + rand() % 6;
+
+    expected[i].expression = malloc(nOperands * 8);
+    if (expected[i].expression == NULL) {
+      fprintf(stderr, "malloc() failure\n");
+      exit(EXIT_FAILURE);
+    }
+    expected[i].expression[0] = '\0';
+    for (j = 0; j < nOperands; j++) {
+      char *p = expected[i].expression + strlen(expected[i].expression);
+
+      if (j > 0) {
+	*p++ = "+-*"[rand() % 3];
+      }
+      sprintf(p, "%d", rand() % 100);
+    }
+  }
+
+  /* Cold: grammar and precomputation every time */
+  cold.values  = NULL;
+  cold.nValues = 0;
+  start = parseMetricsNow();
+  for (i = 0; i < N_EXPRESSIONS; i++) {
+    if (_coldParse(expected[i].expression, &cold) < 0) {
+      fprintf(stderr, "%s: cold parse failure\n", expected[i].expression);
+      exit(EXIT_FAILURE);
+    }
+    memcpy(expected[i].results, cold.results, cold.nResults * sizeof(int));
+    expected[i].nResults = cold.nResults;
+  }
+  coldNs = parseMetricsNow() - start;
+  free(cold.values);
+
+  /* Warm: a server in this process, N_CLIENTS client threads, and fewer workers: they take requests, not connections */
+  if (mkdtemp(directory) == NULL) {
+    fprintf(stderr, "mkdtemp(): %s\n", strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  sprintf(socketPath, "%s/parse.sock", directory);
+  option.nThreads = N_CLIENTS / 2;
+  option.maxTrees = MAX_TREES;
+  serverPtr = parseServerCreate(socketPath, &grammar, 1, &option);
+  if (serverPtr == NULL || pthread_create(&serverThread, NULL, &_server, serverPtr) != 0) {
+    fprintf(stderr, "Server failure: %s\n", strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  start = parseMetricsNow();
+  for (i = 0; i < N_CLIENTS; i++) {
+    clients[i].socketPath  = socketPath;
+    clients[i].expected    = expected;
+    clients[i].first       = i * (N_EXPRESSIONS / N_CLIENTS);
+    clients[i].n           = (i == N_CLIENTS - 1) ? N_EXPRESSIONS - clients[i].first : N_EXPRESSIONS / N_CLIENTS;
+    clients[i].latencies   = latencies;
+    clients[i].nMismatches = 0;
+    if (pthread_create(&(clientThreads[i]), NULL, &_client, &(clients[i])) != 0) {
+      fprintf(stderr, "pthread_create(): %s\n", strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+  }
+  for (i = 0; i < N_CLIENTS; i++) {
+    pthread_join(clientThreads[i], NULL);
+    nMismatches += clients[i].nMismatches;
+  }
+  warmNs = parseMetricsNow() - start;
+
+  parseServerStop(serverPtr);
+  pthread_join(serverThread, NULL);
+  parseServerStatistics(serverPtr, &statistics);
+  parseServerFree(&serverPtr);
+  rmdir(directory);
+
+  qsort(latencies, N_EXPRESSIONS, sizeof(uint64_t), &_compare);
+  fprintf(stderr, "cold: %d parses, %.1f us per parse\n", N_EXPRESSIONS, (double) coldNs / N_EXPRESSIONS / 1e3);
+  fprintf(stderr, "warm: %d parses from %d clients, %.1f us per parse, latency p50 %.1f us, p99 %.1f us\n",
+	  N_EXPRESSIONS, N_CLIENTS,
+	  (double) warmNs / N_EXPRESSIONS / 1e3,
+	  (double) latencies[N_EXPRESSIONS / 2] / 1e3,
+	  (double) latencies[(N_EXPRESSIONS * 99) / 100] / 1e3);
+  fprintf(stderr, "server: %lu connections, %lu requests, %lu rejected, %lu failed, %d mismatches\n",
+	  statistics.nConnections, statistics.nRequests, statistics.nRejected, statistics.nFailed, nMismatches);
+
+  for (i = 0; i < N_EXPRESSIONS; i++) {
+    free(expected[i].expression);
+  }
+  free(expected);
+  free(latencies);
+
+  exit((nMismatches > 0) ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+static Marpa_Grammar _grammar(void *userDataPtr) {
+  Marpa_Config    c;
+  Marpa_Grammar   g;
+  Marpa_Symbol_ID S, E, op, number;
+  Marpa_Rule_ID   start_rule_id, op_rule_id, number_rule_id;
+
+  INIT_CONFIG(c);
+  CREATE_GRAMMAR(g, c);
+
+  CREATE_SYMBOL(S, g);
+  CREATE_SYMBOL(E, g);
+  CREATE_SYMBOL(op, g);
+  CREATE_SYMBOL(number, g);
+  _check(MARPA_ERR_NONE, "Symbol ids", S != SYMBOL_S || E != SYMBOL_E || op != SYMBOL_OP || number != SYMBOL_NUMBER);
+
+  SET_START_SYMBOL(S, g);
+
+  {
+    Marpa_Symbol_ID rhs[] = { E };
+    CREATE_RULE(start_rule_id,  g, S, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { E, op, E };
+    CREATE_RULE(op_rule_id,     g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { number };
+    CREATE_RULE(number_rule_id, g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+  _check(MARPA_ERR_NONE, "Rule ids", start_rule_id != RULE_START || op_rule_id != RULE_OP || number_rule_id != RULE_NUMBER);
+
+  PRECOMPUTE(g);
+
+  return g;
+}
+
+/* Shared by the server and the cold parses */
+static int _ruleCallback(void *userDataPtr, Marpa_Rule_ID ruleId, const int *args, int nArgs, int *resultPtr) {
+  if (ruleId != RULE_OP || nArgs != 3) {
+    *resultPtr = args[0];
+    return 0;
+  }
+  switch (args[1]) {
+  case '+':
+    *resultPtr = args[0] + args[2];
+    break;
+  case '-':
+    *resultPtr = args[0] - args[2];
+    break;
+  case '*':
+    *resultPtr = args[0] * args[2];
+    break;
+  default:
+    return -1;
+  }
+
+  return 0;
+}
+
+/* Returns the number of tokens, or -1 on an invalid character */
+static int _tokens(const char *expression, parseProtocolToken_t **tokensPtr) {
+  parseProtocolToken_t *tokens = malloc((strlen(expression) + 1) * sizeof(parseProtocolToken_t));
+  const char           *p      = expression;
+  int                   nTokens = 0;
+
+  if (tokens == NULL) {
+    return -1;
+  }
+  while (*p != '\0') {
+    if (*p >= '0' && *p <= '9') {
+      tokens[nTokens].symbolId = SYMBOL_NUMBER;
+      tokens[nTokens].value    = 0;
+      while (*p >= '0' && *p <= '9') {
+	tokens[nTokens].value = tokens[nTokens].value * 10 + (*p++ - '0');
+      }
+    } else if (*p == '+' || *p == '-' || *p == '*') {
+      tokens[nTokens].symbolId = SYMBOL_OP;
+      tokens[nTokens].value    = *p++;
+    } else {
+      free(tokens);
+      return -1;
+    }
+    nTokens++;
+  }
+
+  *tokensPtr = tokens;
+  return nTokens;
+}
+
+/* What a short-lived CLI does for every input */
+static int _coldParse(const char *expression, s_cold_t *coldPtr) {
+  parseEnumeratorOption_t  option = PARSEENUMERATOR_OPTION_DEFAULT;
+  parseProtocolToken_t    *tokens;
+  parseDriver_t           *parseDriverPtr;
+  Marpa_Grammar            g;
+  Marpa_Recognizer         r;
+  int                      nTokens = _tokens(expression, &tokens);
+  int                      i;
+  int                      rc;
+
+  if (nTokens < 0) {
+    return -1;
+  }
+
+  g = _grammar(NULL);
+  option.maxTrees = MAX_TREES;
+  parseDriverPtr  = parseDriverCreate(g, &option, &_stepCallback, &_treeCallback, coldPtr);
+  if (parseDriverPtr == NULL) {
+    free(tokens);
+    marpa_g_unref(g);
+    return -1;
+  }
+  CREATE_RECOGNIZER(r, g);
+  START_INPUT(r, g);
+  for (i = 0; i < nTokens; i++) {
+    ALTERNATIVE(r, g, tokens[i].symbolId, tokens[i].value, 1);
+    EARLEME_COMPLETE(r, g);
+  }
+  coldPtr->nResults = 0;
+  rc = parseDriverRun(parseDriverPtr, r);
+
+  marpa_r_unref(r);
+  parseDriverFree(&parseDriverPtr);
+  marpa_g_unref(g);
+  free(tokens);
+
+  return rc;
+}
+
+static int _stepCallback(void *userDataPtr, Marpa_Value v, Marpa_Step_Type stepType) {
+  s_cold_t *coldPtr = (s_cold_t *) userDataPtr;
+  int       top     = (stepType == MARPA_STEP_RULE) ? marpa_v_arg_n(v) : marpa_v_result(v);
+  int       value;
+
+  if (top >= coldPtr->nValues) {
+    int  nValues = (top + 1) * 2;
+    int *values  = realloc(coldPtr->values, nValues * sizeof(int));
+
+    if (values == NULL) {
+      return -1;
+    }
+    coldPtr->values  = values;
+    coldPtr->nValues = nValues;
+  }
+
+  switch (stepType) {
+  case MARPA_STEP_TOKEN:
+    coldPtr->values[marpa_v_result(v)] = marpa_v_token_value(v);
+    break;
+  case MARPA_STEP_RULE:
+    if (_ruleCallback(NULL, marpa_v_rule(v), &(coldPtr->values[marpa_v_arg_0(v)]), marpa_v_arg_n(v) - marpa_v_arg_0(v) + 1, &value) < 0) {
+      return -1;
+    }
+    coldPtr->values[marpa_v_result(v)] = value;
+    break;
+  default:
+    break;
+  }
+
+  return 0;
+}
+
+static int _treeCallback(void *userDataPtr, int treeIndex) {
+  s_cold_t *coldPtr = (s_cold_t *) userDataPtr;
+
+  if (coldPtr->nResults < MAX_TREES) {
+    coldPtr->results[coldPtr->nResults++] = coldPtr->values[0];
+  }
+  return 0;
+}
+
+static void *_client(void *clientPtr) {
+  s_client_t    *client = (s_client_t *) clientPtr;
+  parseClient_t *parseClientPtr = parseClientCreate(client->socketPath);
+  int            i;
+
+  if (parseClientPtr == NULL) {
+    fprintf(stderr, "parseClientCreate(): %s\n", strerror(errno));
+    client->nMismatches = client->n;
+    return NULL;
+  }
+
+  for (i = client->first; i < client->first + client->n; i++) {
+    s_expected_t         *expectedPtr = &(client->expected[i]);
+    parseProtocolToken_t *tokens;
+    const int32_t        *results;
+    int                   nResults;
+    int                   nTokens = _tokens(expectedPtr->expression, &tokens);
+    uint64_t              start   = parseMetricsNow();
+    int                   status  = parseClientParse(parseClientPtr, GRAMMAR_ID, tokens, nTokens, &results, &nResults);
+
+    client->latencies[i] = parseMetricsNow() - start;
+    free(tokens);
+    if (status != PARSEPROTOCOL_STATUS_OK || nResults != expectedPtr->nResults ||
+	memcmp(results, expectedPtr->results, nResults * sizeof(int)) != 0) {
+      fprintf(stderr, "%s: %s, %d values instead of %d\n",
+	      expectedPtr->expression,
+	      (status < 0) ? strerror(errno) : parseProtocolStatusName(status),
+	      nResults,
+	      expectedPtr->nResults);
+      client->nMismatches++;
+    }
+  }
+
+  parseClientFree(&parseClientPtr);
+  return NULL;
+}
+
+static void *_server(void *parseServerPtr) {
+  if (parseServerRun((parseServer_t *) parseServerPtr) < 0) {
+    fprintf(stderr, "parseServerRun(): %s\n", strerror(errno));
+  }
+  return NULL;
+}
+
+static void _stop(int signum) {
+  parseServerStop(serverPtr);
+}
+
+/* -s socketPath */
+static int _serve(const char *socketPath) {
+  parseServerGrammar_t    grammar = { GRAMMAR_ID, &_grammar, &_ruleCallback, NULL };
+  parseServerOption_t     option  = PARSESERVER_OPTION_DEFAULT;
+  parseServerStatistics_t statistics;
+  struct sigaction        action;
+  int                     rc;
+
+  option.maxTrees = MAX_TREES;
+  serverPtr = parseServerCreate(socketPath, &grammar, 1, &option);
+  if (serverPtr == NULL) {
+    fprintf(stderr, "%s: %s\n", socketPath, strerror(errno));
+    return -1;
+  }
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = &_stop;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+
+  fprintf(stderr, "Serving grammar %d on %s\n", GRAMMAR_ID, socketPath);
+  rc = parseServerRun(serverPtr);
+  parseServerStatistics(serverPtr, &statistics);
+  fprintf(stderr, "%lu connections, %lu requests, %lu rejected, %lu failed\n",
+	  statistics.nConnections, statistics.nRequests, statistics.nRejected, statistics.nFailed);
+  parseServerFree(&serverPtr);
+
+  return rc;
+}
+
+/* -c socketPath expression ... */
+static int _request(const char *socketPath, char **expressions, int nExpressions) {
+  parseClient_t *parseClientPtr = parseClientCreate(socketPath);
+  int            rc = 0;
+  int            i, j;
+
+  if (parseClientPtr == NULL) {
+    fprintf(stderr, "%s: %s\n", socketPath, strerror(errno));
+    return -1;
+  }
+
+  for (i = 0; i < nExpressions; i++) {
+    parseProtocolToken_t *tokens;
+    const int32_t        *results;
+    int                   nResults;
+    int                   nTokens = _tokens(expressions[i], &tokens);
+    int                   status;
+
+    if (nTokens < 0) {
+      fprintf(stderr, "%s: invalid character\n", expressions[i]);
+      rc = -1;
+      continue;
+    }
+    status = parseClientParse(parseClientPtr, GRAMMAR_ID, tokens, nTokens, &results, &nResults);
+    free(tokens);
+    if (status < 0) {
+      fprintf(stderr, "%s: %s\n", expressions[i], strerror(errno));
+      rc = -1;
+      break;
+    }
+    printf("%s: %s", expressions[i], parseProtocolStatusName(status));
+    for (j = 0; j < nResults; j++) {
+      printf(" %d", (int) results[j]);
+    }
+    printf("\n");
+  }
+
+  parseClientFree(&parseClientPtr);
+  return rc;
+}
+
+static int _compare(const void *p1, const void *p2) {
+  uint64_t l1 = *((const uint64_t *) p1);
+  uint64_t l2 = *((const uint64_t *) p2);
+
+  return (l1 < l2) ? -1 : (l1 > l2) ? 1 : 0;
+}
+
+static void _check(Marpa_Error_Code errorCode, const char *call, int forcedCondition) {
+  if (forcedCondition != 0 || errorCode != MARPA_ERR_NONE) {
+    const char *function = (call != NULL) ? call : "<unknown>";
+    const char *msg = (errorCode >= 0 && errorCode < MARPA_ERROR_COUNT) ? marpa_error_description[errorCode].name : "Generic error";
+    fprintf(stderr,"%s: %s", function, msg);
+    exit(EXIT_FAILURE);
+  }
+}
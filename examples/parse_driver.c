@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <marpa.h>
+#include "thin_macros.h"
+#include "parseDriver.h"
+#include "parseMetrics.h"
+
+/*
+  One parseDriver reused over several inputs of the ambiguous_grammar.c
+  grammar: unambiguous inputs skip parseEnumeratorRun(). Phase metrics are
+  dumped at exit.
+
+  :start ::= S
+  S ::= E
+  E ::= E op E
+  E ::= number
+
+  Execution  : ./parse_driver
+*/
+
+#define MAX_TOKENS 64
+
+typedef struct s_user {
+  Marpa_Rule_ID op_rule_id;
+  int           values[MAX_TOKENS];
+  const char   *input;
+} s_user_t;
+
+static void _check        (Marpa_Error_Code errorCode, const char *call, int forcedCondition);
+static int  _stepCallback (void *userDataPtr, Marpa_Value v, Marpa_Step_Type stepType);
+static int  _treeCallback (void *userDataPtr, int treeIndex);
+
+struct marpa_error_description_s {
+  Marpa_Error_Code error_code;
+  const char*name;
+  const char*suggested;
+};
+extern const struct marpa_error_description_s marpa_error_description[];
+
+int main() {
+  Marpa_Config            c;
+  Marpa_Grammar           g;
+  Marpa_Symbol_ID         S, E, op, number;
+  Marpa_Rule_ID           start_rule_id, number_rule_id;
+  parseDriver_t          *parseDriverPtr;
+  parseEnumeratorOption_t option = PARSEENUMERATOR_OPTION_DEFAULT;
+  parseDriverStatistics_t statistics;
+  s_user_t                user;
+  const char             *inputs[] = { "7", "1+2", "1+2*3", "1-2-3-4" };
+  unsigned int            i;
+
+  INIT_CONFIG(c);
+  CREATE_GRAMMAR(g, c);
+
+  CREATE_SYMBOL(S, g);
+  CREATE_SYMBOL(E, g);
+  CREATE_SYMBOL(op, g);
+  CREATE_SYMBOL(number, g);
+
+  SET_START_SYMBOL(S, g);
+
+  {
+    Marpa_Symbol_ID rhs[] = { E };
+    CREATE_RULE(start_rule_id,   g, S, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { E, op, E };
+    CREATE_RULE(user.op_rule_id, g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { number };
+    CREATE_RULE(number_rule_id,  g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+
+  option.metricsPtr = parseMetricsCreate();
+  if (option.metricsPtr == NULL || parseMetricsDumpAtExit(option.metricsPtr) < 0) {
+    fprintf(stderr, "parseMetricsCreate(): %s\n", strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  PARSEMETRICS_TIME(option.metricsPtr, PARSEMETRICS_PHASE_PRECOMPUTE, PRECOMPUTE(g));
+
+  /* The driver is created once for the grammar */
+  parseDriverPtr = parseDriverCreate(g, &option, &_stepCallback, &_treeCallback, &user);
+  if (parseDriverPtr == NULL) {
+    fprintf(stderr, "parseDriverCreate(): %s\n", strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  for (i = 0; i < ARRAY_LENGTH(inputs); i++) {
+    Marpa_Recognizer r;
+    const char      *p;
+
+    user.input = inputs[i];
+
+    PARSEMETRICS_TIME(option.metricsPtr, PARSEMETRICS_PHASE_FEED, {
+	CREATE_RECOGNIZER(r, g);
+	START_INPUT(r, g);
+	for (p = inputs[i]; *p != '\0'; p++) {
+	  if (*p >= '0' && *p <= '9') {
+	    ALTERNATIVE(r, g, number, *p - '0', 1);
+	  } else {
+	    ALTERNATIVE(r, g, op, *p, 1);
+	  }
+	  EARLEME_COMPLETE(r, g);
+	}
+      });
+
+    _check(marpa_g_error(g, NULL), "parseDriverRun()", parseDriverRun(parseDriverPtr, r) < 0);
+    marpa_r_unref(r);
+  }
+
+  parseDriverStatistics(parseDriverPtr, &statistics);
+  fprintf(stderr, "Unambiguous: %lu, enumerated: %lu, trees: %lu\n", statistics.nFastPath, statistics.nFullPath, statistics.nTrees);
+
+  parseDriverFree(&parseDriverPtr);
+  marpa_g_unref(g);
+
+  exit(EXIT_SUCCESS);
+}
+
+static int _stepCallback(void *userDataPtr, Marpa_Value v, Marpa_Step_Type stepType) {
+  s_user_t *userPtr = (s_user_t *) userDataPtr;
+
+  switch (stepType) {
+  case MARPA_STEP_TOKEN:
+    if (marpa_v_result(v) >= MAX_TOKENS) {
+      return -1;
+    }
+    userPtr->values[marpa_v_result(v)] = marpa_v_token_value(v);
+    break;
+  case MARPA_STEP_RULE:
+    if (marpa_v_rule(v) == userPtr->op_rule_id) {
+      int  arg_0 = marpa_v_arg_0(v);
+      int *left  = &(userPtr->values[arg_0]);
+      int  right = userPtr->values[marpa_v_arg_n(v)];
+
+      switch (userPtr->values[arg_0 + 1]) {
+      case '+': *left += right; break;
+      case '-': *left -= right; break;
+      case '*': *left *= right; break;
+      default:
+	return -1;
+      }
+    }
+    /* Other rules pass their only value through: it already is at arg_0 */
+    break;
+  default:
+    break;
+  }
+
+  return 0;
+}
+
+static int _treeCallback(void *userDataPtr, int treeIndex) {
+  s_user_t *userPtr = (s_user_t *) userDataPtr;
+
+  fprintf(stderr, "%s, tree %d: %d\n", userPtr->input, treeIndex, userPtr->values[0]);
+  return 0;
+}
+
+static void _check(Marpa_Error_Code errorCode, const char *call, int forcedCondition) {
+  if (forcedCondition != 0 || errorCode != MARPA_ERR_NONE) {
+    const char *function = (call != NULL) ? call : "<unknown>";
+    const char *msg = (errorCode >= 0 && errorCode < MARPA_ERROR_COUNT) ? marpa_error_description[errorCode].name : "Generic error";
+    fprintf(stderr,"%s: %s", function, msg);
+    exit(EXIT_FAILURE);
+  }
+}
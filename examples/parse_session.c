@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <marpa.h>
+#include "thin_macros.h"
+#include "parseSession.h"
+
+/*
+  Editor-like workload on a long sum 1+1+...+1: edits near the end of the
+  document only feed the tokens after the nearest checkpoint. An edit uses
+  up a checkpoint: between edits, as the editor would when idle,
+  parseSessionIdle() rebuilds them, else once all are used up an edit
+  re-feeds the whole document.
+
+  :start ::= S
+  S ::= E
+  E ::= E op number
+  E ::= number
+
+  Execution  : ./parse_session [operands [edits]]
+*/
+
+static void          _check (Marpa_Error_Code errorCode, const char *call, int forcedCondition);
+static unsigned long _parse (parseSession_t *parseSessionPtr, Marpa_Grammar g, const char *what);
+
+struct marpa_error_description_s {
+  Marpa_Error_Code error_code;
+  const char*name;
+  const char*suggested;
+};
+extern const struct marpa_error_description_s marpa_error_description[];
+
+int main(int argc, char **argv) {
+  Marpa_Config         c;
+  Marpa_Grammar        g;
+  Marpa_Symbol_ID      S, E, op, number;
+  Marpa_Rule_ID        start_rule_id, op_rule_id, number_rule_id;
+  parseSession_t      *parseSessionPtr;
+  parseSessionToken_t *tokens;
+  parseSessionToken_t  appended[2];
+  int                  nOperands = (argc > 1) ? atoi(argv[1]) : 10000;
+  int                  nEdits    = (argc > 2) ? atoi(argv[2]) : 5;
+  size_t               nTokens;
+  int                  i;
+
+  if (nOperands <= 0 || nEdits < 0) {
+    fprintf(stderr, "Usage: %s [operands [edits]]\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  INIT_CONFIG(c);
+  CREATE_GRAMMAR(g, c);
+
+  CREATE_SYMBOL(S, g);
+  CREATE_SYMBOL(E, g);
+  CREATE_SYMBOL(op, g);
+  CREATE_SYMBOL(number, g);
+
+  SET_START_SYMBOL(S, g);
+
+  {
+    Marpa_Symbol_ID rhs[] = { E };
+    CREATE_RULE(start_rule_id,  g, S, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { E, op, number };
+    CREATE_RULE(op_rule_id,     g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { number };
+    CREATE_RULE(number_rule_id, g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+
+  PRECOMPUTE(g);
+
+  nTokens = 2 * nOperands - 1;
+  tokens  = malloc(nTokens * sizeof(parseSessionToken_t));
+  if (tokens == NULL) {
+    fprintf(stderr, "malloc() failure\n");
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < (int) nTokens; i++) {
+    tokens[i].symbolId = (i % 2) ? op : number;
+    tokens[i].value    = (i % 2) ? '+' : 1;
+  }
+
+  parseSessionPtr = parseSessionCreate(g, NULL);
+  if (parseSessionPtr == NULL) {
+    fprintf(stderr, "parseSessionCreate(): %s\n", strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  if (parseSessionSet(parseSessionPtr, tokens, nTokens) < 0) {
+    fprintf(stderr, "parseSessionSet(): %s\n", strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  _parse(parseSessionPtr, g, "initial parse");
+  fprintf(stderr, "%-24s %ld tokens\n", "idle", parseSessionIdle(parseSessionPtr, nTokens * 8));
+
+  /* Change operands near the end, as the editor would after re-lexing the whole document */
+  for (i = 0; i < nEdits; i++) {
+    char what[64];
+
+    tokens[nTokens - 1 - 2 * (i % 8)].value = i + 2;
+    if (parseSessionSet(parseSessionPtr, tokens, nTokens) < 0) {
+      fprintf(stderr, "parseSessionSet(): %s\n", strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+    sprintf(what, "edit %d", i + 1);
+    if (_parse(parseSessionPtr, g, what) >= nTokens) {
+      fprintf(stderr, "%s re-fed the whole document\n", what);
+      exit(EXIT_FAILURE);
+    }
+    fprintf(stderr, "%-24s %ld tokens\n", "idle", parseSessionIdle(parseSessionPtr, nTokens * 8));
+  }
+
+  /* Appends cost the appended tokens */
+  appended[0].symbolId = op;
+  appended[0].value    = '+';
+  appended[1].symbolId = number;
+  appended[1].value    = 1;
+  parseSessionEdit(parseSessionPtr, nTokens, 0, appended, ARRAY_LENGTH(appended));
+  _parse(parseSessionPtr, g, "append");
+
+  /* A rejected token is reported, and fixing it costs no full re-feed */
+  parseSessionEdit(parseSessionPtr, nTokens + 1, 1, appended, 1);
+  if (parseSessionRecognizer(parseSessionPtr) != NULL) {
+    fprintf(stderr, "op after op was accepted !?\n");
+    exit(EXIT_FAILURE);
+  }
+  fprintf(stderr, "%-24s token %ld rejected\n", "syntax error", parseSessionErrorPosition(parseSessionPtr));
+  parseSessionEdit(parseSessionPtr, nTokens + 1, 1, appended + 1, 1);
+  _parse(parseSessionPtr, g, "fix");
+
+  parseSessionFree(&parseSessionPtr);
+  free(tokens);
+  marpa_g_unref(g);
+
+  exit(EXIT_SUCCESS);
+}
+
+/* Returns the number of tokens fed */
+static unsigned long _parse(parseSession_t *parseSessionPtr, Marpa_Grammar g, const char *what) {
+  parseSessionStatistics_t before;
+  parseSessionStatistics_t after;
+  Marpa_Recognizer         r;
+  Marpa_Bocage             b;
+
+  parseSessionStatistics(parseSessionPtr, &before);
+  r = parseSessionRecognizer(parseSessionPtr);
+  _check(marpa_g_error(g, NULL), "parseSessionRecognizer()", r == NULL);
+  parseSessionStatistics(parseSessionPtr, &after);
+
+  CREATE_BOCAGE(b, g, r, marpa_r_latest_earley_set(r));
+  fprintf(stderr, "%-24s %lu tokens fed, %lu recognizers started, ambiguity %d\n",
+	  what,
+	  after.nFed - before.nFed,
+	  after.nRebuilds - before.nRebuilds,
+	  marpa_b_ambiguity_metric(b));
+  marpa_b_unref(b);
+
+  return after.nFed - before.nFed;
+}
+
+static void _check(Marpa_Error_Code errorCode, const char *call, int forcedCondition) {
+  if (forcedCondition != 0 || errorCode != MARPA_ERR_NONE) {
+    const char *function = (call != NULL) ? call : "<unknown>";
+    const char *msg = (errorCode >= 0 && errorCode < MARPA_ERROR_COUNT) ? marpa_error_description[errorCode].name : "Generic error";
+    fprintf(stderr,"%s: %s", function, msg);
+    exit(EXIT_FAILURE);
+  }
+}
@@ -0,0 +1,342 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <marpa.h>
+#include "thin_macros.h"
+#include "parsePrecedence.h"
+#include "parseCount.h"
+
+/*
+  The expressions of ambiguous_grammar.c, with precedence and
+  associativity. The flat grammar has a parse per bracketing, the
+  precedenced one has a single parse: the usual one.
+
+  Flat grammar:
+
+  :start ::= S
+  S ::= E
+  E ::= E op E | number | '(' E ')'
+
+  Precedenced grammar, tightest first, expanded by CREATE_PRECEDENCE_RULES():
+
+  :start ::= S
+  S ::= E
+  E ::=    number | '(' E ')' assoc => group
+        || E '^' E            assoc => right
+        || E '*' E            assoc => left
+        || E '+' E | E '-' E  assoc => left
+
+  Expected values:
+
+  2-0*3+1       == 3
+  2^3^2         == 512
+  (2-0)*(3+1)   == 8
+  1-1-1-...-1   == -98 (100 operands)
+
+  Execution  : ./precedence_grammar [expression ...]
+*/
+
+#define MAX_TOKENS 1024
+
+enum { TOKEN_NUMBER = 0, TOKEN_LPAREN, TOKEN_RPAREN, TOKEN_POW, TOKEN_MUL, TOKEN_ADD, TOKEN_SUB, TOKEN_COUNT };
+
+/* Index in the alternatives given to CREATE_PRECEDENCE_RULES() */
+enum { ALTERNATIVE_NUMBER = 0, ALTERNATIVE_GROUP, ALTERNATIVE_POW, ALTERNATIVE_MUL, ALTERNATIVE_ADD, ALTERNATIVE_SUB };
+
+typedef struct s_token {
+  int kind;
+  int value;
+} s_token_t;
+
+typedef struct s_grammar {
+  Marpa_Grammar      g;
+  Marpa_Symbol_ID    symbols[TOKEN_COUNT];   /* Per token kind */
+  parsePrecedence_t *parsePrecedencePtr;     /* NULL for the flat grammar */
+} s_grammar_t;
+
+static void _check       (Marpa_Error_Code errorCode, const char *call, int forcedCondition);
+static void _flat        (s_grammar_t *grammarPtr);
+static void _precedenced (s_grammar_t *grammarPtr);
+static int  _tokens      (const char *expression, s_token_t *tokens);
+static void _parse       (s_grammar_t *grammarPtr, s_token_t *tokens, int nTokens, uint64_t *countPtr, int *saturatedPtr, int *valuePtr);
+static int  _value       (s_grammar_t *grammarPtr, Marpa_Tree t);
+
+struct marpa_error_description_s {
+  Marpa_Error_Code error_code;
+  const char*name;
+  const char*suggested;
+};
+extern const struct marpa_error_description_s marpa_error_description[];
+
+int main(int argc, char **argv) {
+  s_grammar_t  flat;
+  s_grammar_t  precedenced;
+  char        *defaults[] = { "2-0*3+1", "2^3^2", "(2-0)*(3+1)", NULL };
+  char         chain[100 * 2];
+  s_token_t    tokens[MAX_TOKENS];
+  int          i;
+
+  _flat(&flat);
+  _precedenced(&precedenced);
+
+  /* 1-1-...-1 */
+  for (i = 0; i < 100; i++) {
+    chain[2 * i]     = '1';
+    chain[2 * i + 1] = '-';
+  }
+  chain[sizeof(chain) - 1] = '\0';
+  defaults[3] = chain;
+
+  for (i = 0; i < ((argc > 1) ? argc - 1 : (int) ARRAY_LENGTH(defaults)); i++) {
+    const char *expression = (argc > 1) ? argv[i + 1] : defaults[i];
+    int         nTokens    = _tokens(expression, tokens);
+    uint64_t    flatCount, count;
+    int         flatSaturated, saturated;
+    int         value;
+
+    if (nTokens < 0) {
+      fprintf(stderr, "%.20s: invalid expression\n", expression);
+      continue;
+    }
+    _parse(&flat, tokens, nTokens, &flatCount, &flatSaturated, NULL);
+    _parse(&precedenced, tokens, nTokens, &count, &saturated, &value);
+    fprintf(stderr, "%.20s%s: flat grammar %s%lu parses, precedenced grammar %lu parse, value %d\n",
+	    expression,
+	    (strlen(expression) > 20) ? "..." : "",
+	    flatSaturated ? "more than " : "",
+	    (unsigned long) flatCount,
+	    (unsigned long) count,
+	    value);
+  }
+
+  parsePrecedenceFree(&(precedenced.parsePrecedencePtr));
+  marpa_g_unref(precedenced.g);
+  marpa_g_unref(flat.g);
+
+  exit(EXIT_SUCCESS);
+}
+
+static void _flat(s_grammar_t *grammarPtr) {
+  Marpa_Config    c;
+  Marpa_Grammar   g;
+  Marpa_Symbol_ID S, E, op;
+  Marpa_Rule_ID   start_rule_id, op_rule_id, number_rule_id, group_rule_id;
+  int             i;
+
+  INIT_CONFIG(c);
+  CREATE_GRAMMAR(g, c);
+
+  CREATE_SYMBOL(S, g);
+  CREATE_SYMBOL(E, g);
+  CREATE_SYMBOL(op, g);
+  for (i = 0; i < TOKEN_COUNT; i++) {
+    if (i == TOKEN_NUMBER || i == TOKEN_LPAREN || i == TOKEN_RPAREN) {
+      CREATE_SYMBOL(grammarPtr->symbols[i], g);
+    } else {
+      /* All operators are the same terminal */
+      grammarPtr->symbols[i] = op;
+    }
+  }
+
+  SET_START_SYMBOL(S, g);
+
+  {
+    Marpa_Symbol_ID rhs[] = { E };
+    CREATE_RULE(start_rule_id,  g, S, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { E, op, E };
+    CREATE_RULE(op_rule_id,     g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { grammarPtr->symbols[TOKEN_NUMBER] };
+    CREATE_RULE(number_rule_id, g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { grammarPtr->symbols[TOKEN_LPAREN], E, grammarPtr->symbols[TOKEN_RPAREN] };
+    CREATE_RULE(group_rule_id,  g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+
+  PRECOMPUTE(g);
+
+  grammarPtr->g                  = g;
+  grammarPtr->parsePrecedencePtr = NULL;
+}
+
+static void _precedenced(s_grammar_t *grammarPtr) {
+  Marpa_Config       c;
+  Marpa_Grammar      g;
+  Marpa_Symbol_ID    S, E;
+  Marpa_Rule_ID      start_rule_id;
+  parsePrecedence_t *parsePrecedencePtr;
+  Marpa_Symbol_ID   *s = grammarPtr->symbols;
+  int                i;
+
+  INIT_CONFIG(c);
+  CREATE_GRAMMAR(g, c);
+
+  CREATE_SYMBOL(S, g);
+  CREATE_SYMBOL(E, g);
+  for (i = 0; i < TOKEN_COUNT; i++) {
+    CREATE_SYMBOL(s[i], g);
+  }
+
+  SET_START_SYMBOL(S, g);
+
+  {
+    Marpa_Symbol_ID rhs[] = { E };
+    CREATE_RULE(start_rule_id, g, S, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID              number[] = { s[TOKEN_NUMBER] };
+    Marpa_Symbol_ID              group[]  = { s[TOKEN_LPAREN], E, s[TOKEN_RPAREN] };
+    Marpa_Symbol_ID              pow[]    = { E, s[TOKEN_POW], E };
+    Marpa_Symbol_ID              mul[]    = { E, s[TOKEN_MUL], E };
+    Marpa_Symbol_ID              add[]    = { E, s[TOKEN_ADD], E };
+    Marpa_Symbol_ID              sub[]    = { E, s[TOKEN_SUB], E };
+    parsePrecedenceAlternative_t alternatives[] = {
+      /* In the order of ALTERNATIVE_* */
+      { 0, PARSEPRECEDENCE_ASSOC_LEFT,  number, ARRAY_LENGTH(number) },
+      { 0, PARSEPRECEDENCE_ASSOC_GROUP, group,  ARRAY_LENGTH(group)  },
+      { 1, PARSEPRECEDENCE_ASSOC_RIGHT, pow,    ARRAY_LENGTH(pow)    },
+      { 2, PARSEPRECEDENCE_ASSOC_LEFT,  mul,    ARRAY_LENGTH(mul)    },
+      { 3, PARSEPRECEDENCE_ASSOC_LEFT,  add,    ARRAY_LENGTH(add)    },
+      { 3, PARSEPRECEDENCE_ASSOC_LEFT,  sub,    ARRAY_LENGTH(sub)    }
+    };
+    CREATE_PRECEDENCE_RULES(parsePrecedencePtr, g, E, alternatives, ARRAY_LENGTH(alternatives));
+  }
+
+  PRECOMPUTE(g);
+
+  grammarPtr->g                  = g;
+  grammarPtr->parsePrecedencePtr = parsePrecedencePtr;
+}
+
+/* Returns the number of tokens, or -1 */
+static int _tokens(const char *expression, s_token_t *tokens) {
+  const char *p       = expression;
+  const char *kinds   = "()^*+-";
+  int         nTokens = 0;
+
+  while (*p != '\0') {
+    if (nTokens >= MAX_TOKENS) {
+      return -1;
+    }
+    if (*p >= '0' && *p <= '9') {
+      tokens[nTokens].kind  = TOKEN_NUMBER;
+      tokens[nTokens].value = 0;
+      while (*p >= '0' && *p <= '9') {
+	tokens[nTokens].value = tokens[nTokens].value * 10 + (*p++ - '0');
+      }
+    } else if (strchr(kinds, *p) != NULL) {
+      tokens[nTokens].kind  = TOKEN_LPAREN + (int) (strchr(kinds, *p) - kinds);
+      tokens[nTokens].value = *p++;
+    } else {
+      return -1;
+    }
+    nTokens++;
+  }
+
+  return nTokens;
+}
+
+/* Counts the parses from the bocage and, when valuePtr is not NULL, valuates the first one */
+static void _parse(s_grammar_t *grammarPtr, s_token_t *tokens, int nTokens, uint64_t *countPtr, int *saturatedPtr, int *valuePtr) {
+  Marpa_Grammar    g = grammarPtr->g;
+  Marpa_Recognizer r;
+  Marpa_Bocage     b;
+  Marpa_Order      o;
+  Marpa_Tree       t;
+  int              i;
+  int              rc;
+
+  CREATE_RECOGNIZER(r, g);
+  START_INPUT(r, g);
+  for (i = 0; i < nTokens; i++) {
+    ALTERNATIVE(r, g, grammarPtr->symbols[tokens[i].kind], tokens[i].value, 1);
+    EARLEME_COMPLETE(r, g);
+  }
+  CREATE_BOCAGE(b, g, r, marpa_r_latest_earley_set(r));
+
+  rc = parseCount(g, b, countPtr, NULL, NULL);
+  _check(marpa_g_error(g, NULL), "parseCount()", rc < 0);
+  *saturatedPtr = rc;
+
+  if (valuePtr != NULL) {
+    CREATE_ORDER(o, b, g);
+    CREATE_TREE(t, o, g);
+    _check(marpa_g_error(g, NULL), "marpa_t_next()", marpa_t_next(t) < 0);
+    *valuePtr = _value(grammarPtr, t);
+    marpa_t_unref(t);
+    marpa_o_unref(o);
+  }
+
+  marpa_b_unref(b);
+  marpa_r_unref(r);
+}
+
+/* Semantic actions are per alternative: the stratified rules are mapped back to them */
+static int _value(s_grammar_t *grammarPtr, Marpa_Tree t) {
+  Marpa_Grammar   g      = grammarPtr->g;
+  int             values[MAX_TOKENS * 2];
+  int             highestRuleId = marpa_g_highest_rule_id(g);
+  Marpa_Value     v;
+  Marpa_Step_Type stepType;
+  int             ruleId;
+  int             p, n, i;
+
+  CREATE_VALUATOR(v, t, g);
+  for (ruleId = 0; ruleId <= highestRuleId; ruleId++) {
+    marpa_v_rule_is_valued_set(v, ruleId, 1);
+  }
+
+  while ((stepType = marpa_v_step(v)) != MARPA_STEP_INACTIVE) {
+    _check(marpa_g_error(g, NULL), "marpa_v_step()", stepType < 0 || marpa_v_result(v) >= (int) ARRAY_LENGTH(values));
+    switch (stepType) {
+    case MARPA_STEP_TOKEN:
+      values[marpa_v_result(v)] = marpa_v_token_value(v);
+      break;
+    case MARPA_STEP_RULE:
+      p = marpa_v_arg_0(v);
+      switch (parsePrecedenceAlternative(grammarPtr->parsePrecedencePtr, marpa_v_rule(v))) {
+      case ALTERNATIVE_GROUP:
+	values[marpa_v_result(v)] = values[p + 1];
+	break;
+      case ALTERNATIVE_POW:
+	for (n = 1, i = 0; i < values[p + 2]; i++) {
+	  n *= values[p];
+	}
+	values[marpa_v_result(v)] = n;
+	break;
+      case ALTERNATIVE_MUL:
+	values[marpa_v_result(v)] = values[p] * values[p + 2];
+	break;
+      case ALTERNATIVE_ADD:
+	values[marpa_v_result(v)] = values[p] + values[p + 2];
+	break;
+      case ALTERNATIVE_SUB:
+	values[marpa_v_result(v)] = values[p] - values[p + 2];
+	break;
+      default:
+	/* Number, S ::= E and the rules between levels */
+	values[marpa_v_result(v)] = values[p];
+	break;
+      }
+      break;
+    default:
+      break;
+    }
+  }
+  marpa_v_unref(v);
+
+  return values[0];
+}
+
+static void _check(Marpa_Error_Code errorCode, const char *call, int forcedCondition) {
+  if (forcedCondition != 0 || errorCode != MARPA_ERR_NONE) {
+    const char *function = (call != NULL) ? call : "<unknown>";
+    const char *msg = (errorCode >= 0 && errorCode < MARPA_ERROR_COUNT) ? marpa_error_description[errorCode].name : "Generic error";
+    fprintf(stderr,"%s: %s", function, msg);
+    exit(EXIT_FAILURE);
+  }
+}
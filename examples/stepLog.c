@@ -0,0 +1,542 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include "stepLog.h"
+
+#define STEPLOG_HEADER_SIZE   16
+#define STEPLOG_VARINT_MAX    10   /* Enough for 64 bits */
+#define STEPLOG_STEP_MAX      (1 + 5 * STEPLOG_VARINT_MAX)
+#define STEPLOG_INIT_SIZE     4096
+
+struct stepLogWriter {
+  int                 fd;
+  unsigned char      *buf;         /* Steps of the current tree */
+  size_t              bufLength;
+  size_t              allocSize;
+  unsigned long       nSteps;      /* In the current tree */
+  int                 lastResult;
+  Marpa_Earley_Set_ID lastEarleySetId;
+  size_t              nBytes;      /* Written by this writer */
+  off_t               fileLength;  /* After the last complete frame */
+};
+
+struct stepLogReader {
+  unsigned char      *map;
+  size_t              mapLength;
+  size_t              offset;      /* Next frame */
+  size_t              stepOffset;  /* Next step in the current tree */
+  size_t              stepEnd;     /* End of the current tree */
+  int                 lastResult;
+  Marpa_Earley_Set_ID lastEarleySetId;
+};
+
+static size_t _stepLogPutVarint(unsigned char *p, uint64_t value);
+static size_t _stepLogPutSigned(unsigned char *p, int64_t value);
+static int    _stepLogGetVarint(const unsigned char *p, size_t end, size_t *offsetPtr, uint64_t *valuePtr);
+static int    _stepLogGetSigned(const unsigned char *p, size_t end, size_t *offsetPtr, int64_t *valuePtr);
+static void   _stepLogHeader(unsigned char *header);
+static size_t _stepLogValidLength(const unsigned char *p, size_t length);
+
+stepLogWriter_t *stepLogWriterCreate(const char *path)
+{
+  stepLogWriter_t *stepLogWriterPtr;
+  unsigned char    header[STEPLOG_HEADER_SIZE];
+  struct stat      st;
+  off_t            fileLength;
+  int              fd;
+
+  if (path == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    return NULL;
+  }
+  if (fstat(fd, &st) < 0) {
+    close(fd);
+    return NULL;
+  }
+
+  _stepLogHeader(header);
+  if (st.st_size == 0) {
+    if (write(fd, header, STEPLOG_HEADER_SIZE) != STEPLOG_HEADER_SIZE) {
+      close(fd);
+      return NULL;
+    }
+  } else {
+    /* Keep the complete frames only, so that appended frames are reachable */
+    unsigned char *map;
+    size_t         validLength;
+
+    if ((size_t) st.st_size < STEPLOG_HEADER_SIZE) {
+      close(fd);
+      errno = EILSEQ;
+      return NULL;
+    }
+    map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+      close(fd);
+      return NULL;
+    }
+    if (memcmp(map, header, STEPLOG_HEADER_SIZE) != 0) {
+      munmap(map, (size_t) st.st_size);
+      close(fd);
+      errno = EILSEQ;
+      return NULL;
+    }
+    validLength = _stepLogValidLength(map, (size_t) st.st_size);
+    munmap(map, (size_t) st.st_size);
+    if (validLength < (size_t) st.st_size && ftruncate(fd, (off_t) validLength) < 0) {
+      close(fd);
+      return NULL;
+    }
+  }
+  fileLength = lseek(fd, 0, SEEK_END);
+  if (fileLength < 0) {
+    close(fd);
+    return NULL;
+  }
+
+  stepLogWriterPtr = malloc(sizeof(stepLogWriter_t));
+  if (stepLogWriterPtr == NULL) {
+    close(fd);
+    return NULL;
+  }
+  stepLogWriterPtr->buf = malloc(STEPLOG_INIT_SIZE);
+  if (stepLogWriterPtr->buf == NULL) {
+    free(stepLogWriterPtr);
+    close(fd);
+    return NULL;
+  }
+
+  stepLogWriterPtr->fd              = fd;
+  stepLogWriterPtr->bufLength       = 0;
+  stepLogWriterPtr->allocSize       = STEPLOG_INIT_SIZE;
+  stepLogWriterPtr->nSteps          = 0;
+  stepLogWriterPtr->lastResult      = 0;
+  stepLogWriterPtr->lastEarleySetId = 0;
+  stepLogWriterPtr->nBytes          = 0;
+  stepLogWriterPtr->fileLength      = fileLength;
+
+  return stepLogWriterPtr;
+}
+
+int stepLogWriterStep(stepLogWriter_t *stepLogWriterPtr, Marpa_Value v, Marpa_Step_Type stepType)
+{
+  unsigned char      *p;
+  int                 result;
+  Marpa_Earley_Set_ID endEarleySetId;
+
+  if (stepLogWriterPtr == NULL || v == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (stepLogWriterPtr->bufLength + STEPLOG_STEP_MAX > stepLogWriterPtr->allocSize) {
+    size_t         allocSize = stepLogWriterPtr->allocSize * 2;
+    unsigned char *buf       = realloc(stepLogWriterPtr->buf, allocSize);
+
+    if (buf == NULL) {
+      return -1;
+    }
+    stepLogWriterPtr->buf       = buf;
+    stepLogWriterPtr->allocSize = allocSize;
+  }
+
+  p              = stepLogWriterPtr->buf + stepLogWriterPtr->bufLength;
+  result         = marpa_v_result(v);
+  endEarleySetId = marpa_v_es_id(v);
+
+  *p++ = (unsigned char) stepType;
+  switch (stepType) {
+  case MARPA_STEP_RULE:
+    p += _stepLogPutVarint(p, (uint64_t) marpa_v_rule(v));
+    p += _stepLogPutSigned(p, (int64_t) result - stepLogWriterPtr->lastResult);
+    p += _stepLogPutSigned(p, (int64_t) marpa_v_arg_0(v) - result);
+    p += _stepLogPutSigned(p, (int64_t) marpa_v_arg_n(v) - marpa_v_arg_0(v));
+    p += _stepLogPutSigned(p, (int64_t) endEarleySetId - stepLogWriterPtr->lastEarleySetId);
+    p += _stepLogPutSigned(p, (int64_t) endEarleySetId - marpa_v_rule_start_es_id(v));
+    break;
+  case MARPA_STEP_TOKEN:
+    p += _stepLogPutVarint(p, (uint64_t) marpa_v_token(v));
+    p += _stepLogPutSigned(p, (int64_t) marpa_v_token_value(v));
+    p += _stepLogPutSigned(p, (int64_t) result - stepLogWriterPtr->lastResult);
+    p += _stepLogPutSigned(p, (int64_t) endEarleySetId - stepLogWriterPtr->lastEarleySetId);
+    p += _stepLogPutSigned(p, (int64_t) endEarleySetId - marpa_v_token_start_es_id(v));
+    break;
+  case MARPA_STEP_NULLING_SYMBOL:
+    p += _stepLogPutVarint(p, (uint64_t) marpa_v_symbol(v));
+    p += _stepLogPutSigned(p, (int64_t) result - stepLogWriterPtr->lastResult);
+    p += _stepLogPutSigned(p, (int64_t) endEarleySetId - stepLogWriterPtr->lastEarleySetId);
+    break;
+  default:
+    /* Other step types carry nothing to replay */
+    return 0;
+  }
+
+  stepLogWriterPtr->bufLength       = p - stepLogWriterPtr->buf;
+  stepLogWriterPtr->lastResult      = result;
+  stepLogWriterPtr->lastEarleySetId = endEarleySetId;
+  stepLogWriterPtr->nSteps++;
+
+  return 0;
+}
+
+int stepLogWriterTreeEnd(stepLogWriter_t *stepLogWriterPtr)
+{
+  unsigned char frame[1 + 2 * STEPLOG_VARINT_MAX];
+  size_t        frameLength = 0;
+  struct iovec  iov[2];
+  size_t        total;
+  ssize_t       written;
+
+  if (stepLogWriterPtr == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  frame[frameLength++] = STEPLOG_TAG_TREE;
+  frameLength += _stepLogPutVarint(frame + frameLength, (uint64_t) stepLogWriterPtr->nSteps);
+  frameLength += _stepLogPutVarint(frame + frameLength, (uint64_t) stepLogWriterPtr->bufLength);
+
+  iov[0].iov_base = frame;
+  iov[0].iov_len  = frameLength;
+  iov[1].iov_base = stepLogWriterPtr->buf;
+  iov[1].iov_len  = stepLogWriterPtr->bufLength;
+  total           = frameLength + stepLogWriterPtr->bufLength;
+
+  /* The next tree starts from scratch whatever happens */
+  stepLogWriterPtr->bufLength       = 0;
+  stepLogWriterPtr->nSteps          = 0;
+  stepLogWriterPtr->lastResult      = 0;
+  stepLogWriterPtr->lastEarleySetId = 0;
+
+  written = writev(stepLogWriterPtr->fd, iov, 2);
+  if (written < 0) {
+    return -1;
+  }
+  if ((size_t) written != total) {
+    /* Short write: drop the truncated frame so that the next ones stay reachable */
+    if (ftruncate(stepLogWriterPtr->fd, stepLogWriterPtr->fileLength) == 0) {
+      lseek(stepLogWriterPtr->fd, 0, SEEK_END);
+    }
+    errno = EIO;
+    return -1;
+  }
+  stepLogWriterPtr->nBytes     += total;
+  stepLogWriterPtr->fileLength += (off_t) total;
+
+  return 0;
+}
+
+size_t stepLogWriterBytes(stepLogWriter_t *stepLogWriterPtr)
+{
+  return (stepLogWriterPtr != NULL) ? stepLogWriterPtr->nBytes : 0;
+}
+
+int stepLogWriterFree(stepLogWriter_t **stepLogWriterPtrPtr)
+{
+  stepLogWriter_t *stepLogWriterPtr;
+  int              rc;
+
+  if (stepLogWriterPtrPtr == NULL) {
+    return 0;
+  }
+  stepLogWriterPtr = *stepLogWriterPtrPtr;
+  if (stepLogWriterPtr == NULL) {
+    return 0;
+  }
+
+  rc = close(stepLogWriterPtr->fd);
+  free(stepLogWriterPtr->buf);
+  free(stepLogWriterPtr);
+
+  *stepLogWriterPtrPtr = NULL;
+  return rc;
+}
+
+stepLogReader_t *stepLogReaderCreate(const char *path)
+{
+  stepLogReader_t *stepLogReaderPtr;
+  unsigned char    header[STEPLOG_HEADER_SIZE];
+  unsigned char   *map;
+  struct stat      st;
+  int              fd;
+
+  if (path == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  if (fstat(fd, &st) < 0) {
+    close(fd);
+    return NULL;
+  }
+  if ((size_t) st.st_size < STEPLOG_HEADER_SIZE) {
+    close(fd);
+    errno = EILSEQ;
+    return NULL;
+  }
+  map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  /* The mapping stays valid after close() */
+  close(fd);
+  if (map == MAP_FAILED) {
+    return NULL;
+  }
+  _stepLogHeader(header);
+  if (memcmp(map, header, STEPLOG_HEADER_SIZE) != 0) {
+    munmap(map, (size_t) st.st_size);
+    errno = EILSEQ;
+    return NULL;
+  }
+  madvise(map, (size_t) st.st_size, MADV_SEQUENTIAL);
+
+  stepLogReaderPtr = malloc(sizeof(stepLogReader_t));
+  if (stepLogReaderPtr == NULL) {
+    munmap(map, (size_t) st.st_size);
+    return NULL;
+  }
+
+  stepLogReaderPtr->map             = map;
+  stepLogReaderPtr->mapLength       = (size_t) st.st_size;
+  stepLogReaderPtr->offset          = STEPLOG_HEADER_SIZE;
+  stepLogReaderPtr->stepOffset      = STEPLOG_HEADER_SIZE;
+  stepLogReaderPtr->stepEnd         = STEPLOG_HEADER_SIZE;
+  stepLogReaderPtr->lastResult      = 0;
+  stepLogReaderPtr->lastEarleySetId = 0;
+
+  return stepLogReaderPtr;
+}
+
+int stepLogReaderNextTree(stepLogReader_t *stepLogReaderPtr)
+{
+  size_t   offset;
+  uint64_t nSteps;
+  uint64_t nBytes;
+
+  if (stepLogReaderPtr == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  offset = stepLogReaderPtr->offset;
+  if (offset >= stepLogReaderPtr->mapLength) {
+    return 0;
+  }
+  if (stepLogReaderPtr->map[offset++] != STEPLOG_TAG_TREE ||
+      _stepLogGetVarint(stepLogReaderPtr->map, stepLogReaderPtr->mapLength, &offset, &nSteps) < 0 ||
+      _stepLogGetVarint(stepLogReaderPtr->map, stepLogReaderPtr->mapLength, &offset, &nBytes) < 0) {
+    errno = EILSEQ;
+    return -1;
+  }
+  if (nBytes > stepLogReaderPtr->mapLength - offset) {
+    /* Truncated last frame */
+    return 0;
+  }
+
+  stepLogReaderPtr->stepOffset      = offset;
+  stepLogReaderPtr->stepEnd         = offset + (size_t) nBytes;
+  stepLogReaderPtr->offset          = stepLogReaderPtr->stepEnd;
+  stepLogReaderPtr->lastResult      = 0;
+  stepLogReaderPtr->lastEarleySetId = 0;
+
+  return 1;
+}
+
+int stepLogReaderNextStep(stepLogReader_t *stepLogReaderPtr, stepLogStep_t *stepPtr)
+{
+  const unsigned char *map;
+  size_t               end;
+  size_t               offset;
+  uint64_t             id;
+  int64_t              value       = 0;
+  int64_t              resultDelta;
+  int64_t              arg0Delta   = 0;
+  int64_t              argNDelta   = 0;
+  int64_t              endDelta;
+  int64_t              startDelta  = 0;
+  int                  rc;
+
+  if (stepLogReaderPtr == NULL || stepPtr == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  map    = stepLogReaderPtr->map;
+  end    = stepLogReaderPtr->stepEnd;
+  offset = stepLogReaderPtr->stepOffset;
+  if (offset >= end) {
+    return 0;
+  }
+
+  stepPtr->stepType = (Marpa_Step_Type) map[offset++];
+  switch (stepPtr->stepType) {
+  case MARPA_STEP_RULE:
+    rc = (_stepLogGetVarint(map, end, &offset, &id) < 0
+      || _stepLogGetSigned(map, end, &offset, &resultDelta) < 0
+      || _stepLogGetSigned(map, end, &offset, &arg0Delta) < 0
+      || _stepLogGetSigned(map, end, &offset, &argNDelta) < 0
+      || _stepLogGetSigned(map, end, &offset, &endDelta) < 0
+      || _stepLogGetSigned(map, end, &offset, &startDelta) < 0) ? -1 : 0;
+    break;
+  case MARPA_STEP_TOKEN:
+    rc = (_stepLogGetVarint(map, end, &offset, &id) < 0
+      || _stepLogGetSigned(map, end, &offset, &value) < 0
+      || _stepLogGetSigned(map, end, &offset, &resultDelta) < 0
+      || _stepLogGetSigned(map, end, &offset, &endDelta) < 0
+      || _stepLogGetSigned(map, end, &offset, &startDelta) < 0) ? -1 : 0;
+    break;
+  case MARPA_STEP_NULLING_SYMBOL:
+    rc = (_stepLogGetVarint(map, end, &offset, &id) < 0
+      || _stepLogGetSigned(map, end, &offset, &resultDelta) < 0
+      || _stepLogGetSigned(map, end, &offset, &endDelta) < 0) ? -1 : 0;
+    break;
+  default:
+    rc = -1;
+    break;
+  }
+  if (rc < 0) {
+    errno = EILSEQ;
+    return -1;
+  }
+
+  stepPtr->id               = (int) id;
+  stepPtr->value            = (int) value;
+  stepPtr->result           = stepLogReaderPtr->lastResult + (int) resultDelta;
+  stepPtr->arg0             = stepPtr->result + (int) arg0Delta;
+  stepPtr->argN             = stepPtr->arg0 + (int) argNDelta;
+  stepPtr->endEarleySetId   = stepLogReaderPtr->lastEarleySetId + (Marpa_Earley_Set_ID) endDelta;
+  stepPtr->startEarleySetId = stepPtr->endEarleySetId - (Marpa_Earley_Set_ID) startDelta;
+  if (stepPtr->stepType != MARPA_STEP_RULE) {
+    stepPtr->arg0 = stepPtr->argN = stepPtr->result;
+  }
+
+  stepLogReaderPtr->stepOffset      = offset;
+  stepLogReaderPtr->lastResult      = stepPtr->result;
+  stepLogReaderPtr->lastEarleySetId = stepPtr->endEarleySetId;
+
+  return 1;
+}
+
+void stepLogReaderFree(stepLogReader_t **stepLogReaderPtrPtr)
+{
+  stepLogReader_t *stepLogReaderPtr;
+
+  if (stepLogReaderPtrPtr == NULL) {
+    return;
+  }
+  stepLogReaderPtr = *stepLogReaderPtrPtr;
+  if (stepLogReaderPtr == NULL) {
+    return;
+  }
+
+  munmap(stepLogReaderPtr->map, stepLogReaderPtr->mapLength);
+  free(stepLogReaderPtr);
+
+  *stepLogReaderPtrPtr = NULL;
+  return;
+}
+
+static size_t _stepLogPutVarint(unsigned char *p, uint64_t value)
+{
+  size_t length = 0;
+
+  while (value >= 0x80) {
+    p[length++] = (unsigned char) (value | 0x80);
+    value >>= 7;
+  }
+  p[length++] = (unsigned char) value;
+
+  return length;
+}
+
+static size_t _stepLogPutSigned(unsigned char *p, int64_t value)
+{
+  /* Zigzag: small negative deltas stay small */
+  return _stepLogPutVarint(p, ((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+}
+
+static int _stepLogGetVarint(const unsigned char *p, size_t end, size_t *offsetPtr, uint64_t *valuePtr)
+{
+  size_t   offset = *offsetPtr;
+  uint64_t value  = 0;
+  int      shift;
+
+  for (shift = 0; shift < 7 * STEPLOG_VARINT_MAX; shift += 7) {
+    unsigned char c;
+
+    if (offset >= end) {
+      return -1;
+    }
+    c = p[offset++];
+    value |= (uint64_t) (c & 0x7F) << shift;
+    if ((c & 0x80) == 0) {
+      *offsetPtr = offset;
+      *valuePtr  = value;
+      return 0;
+    }
+  }
+
+  return -1;
+}
+
+static int _stepLogGetSigned(const unsigned char *p, size_t end, size_t *offsetPtr, int64_t *valuePtr)
+{
+  uint64_t value;
+
+  if (_stepLogGetVarint(p, end, offsetPtr, &value) < 0) {
+    return -1;
+  }
+  *valuePtr = (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+
+  return 0;
+}
+
+static void _stepLogHeader(unsigned char *header)
+{
+  uint32_t version = STEPLOG_VERSION;
+  int      i;
+
+  memset(header, 0, STEPLOG_HEADER_SIZE);
+  memcpy(header, STEPLOG_MAGIC, 8);
+  /* Little endian whatever the host */
+  for (i = 0; i < 4; i++) {
+    header[8 + i] = (unsigned char) (version >> (8 * i));
+  }
+}
+
+static size_t _stepLogValidLength(const unsigned char *p, size_t length)
+{
+  size_t offset = STEPLOG_HEADER_SIZE;
+
+  while (offset < length) {
+    size_t   frameOffset = offset;
+    uint64_t nSteps;
+    uint64_t nBytes;
+
+    offset++;
+    if (p[frameOffset] != STEPLOG_TAG_TREE ||
+	_stepLogGetVarint(p, length, &offset, &nSteps) < 0 ||
+	_stepLogGetVarint(p, length, &offset, &nBytes) < 0 ||
+	nBytes > length - offset) {
+      return frameOffset;
+    }
+    offset += (size_t) nBytes;
+  }
+
+  return offset;
+}
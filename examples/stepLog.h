@@ -0,0 +1,57 @@
+#ifndef STEP_LOG_H
+#define STEP_LOG_H
+
+#include <stddef.h>
+#include <marpa.h>
+
+/*
+ * Append-only log of marpa_v_step() sequences, so that semantics can be
+ * re-run later, or by another process, without recognizing the input again.
+ *
+ * File layout: a 16 bytes header, then one frame per tree:
+ *   STEPLOG_TAG_TREE, varint number of steps, varint number of bytes, steps...
+ * Each step is its type byte followed by a fixed list of varints per type.
+ * Stack indices and Earley set ids are delta coded against the previous
+ * step of the same tree, so that a typical step takes 4 to 6 bytes.
+ * A frame is written with a single writev() when the tree ends; a truncated
+ * last frame, i.e. an interrupted writer, is dropped by the next writer.
+ */
+
+#define STEPLOG_MAGIC    "MARPASTP"
+#define STEPLOG_VERSION  1
+#define STEPLOG_TAG_TREE 0xFE
+
+typedef struct stepLogWriter stepLogWriter_t;
+typedef struct stepLogReader stepLogReader_t;
+
+/* Decoded step: ruleId, tokenId or symbolId in id, depending on stepType */
+typedef struct stepLogStep {
+  Marpa_Step_Type     stepType;
+  int                 id;
+  int                 value;              /* MARPA_STEP_TOKEN only */
+  int                 result;
+  int                 arg0;               /* MARPA_STEP_RULE only */
+  int                 argN;               /* MARPA_STEP_RULE only */
+  Marpa_Earley_Set_ID startEarleySetId;
+  Marpa_Earley_Set_ID endEarleySetId;
+} stepLogStep_t;
+
+/* Creates the file if needed, else checks it and appends after its last complete frame. One writer at a time */
+stepLogWriter_t *stepLogWriterCreate(const char *path);
+/* Records the current step of v. The first step after a tree end starts a new tree */
+int              stepLogWriterStep(stepLogWriter_t *stepLogWriterPtr, Marpa_Value v, Marpa_Step_Type stepType);
+/* Writes the current tree to the file */
+int              stepLogWriterTreeEnd(stepLogWriter_t *stepLogWriterPtr);
+size_t           stepLogWriterBytes(stepLogWriter_t *stepLogWriterPtr);
+/* A tree without stepLogWriterTreeEnd() is not written */
+int              stepLogWriterFree(stepLogWriter_t **stepLogWriterPtrPtr);
+
+/* The file is mmap()ed read-only, steps are decoded in place */
+stepLogReader_t *stepLogReaderCreate(const char *path);
+/* Returns 1 when positioned on the next tree, 0 at end of log, -1 with errno set to EILSEQ if corrupted */
+int              stepLogReaderNextTree(stepLogReader_t *stepLogReaderPtr);
+/* Returns 1 with *stepPtr filled, 0 at end of the current tree, -1 with errno set to EILSEQ if corrupted */
+int              stepLogReaderNextStep(stepLogReader_t *stepLogReaderPtr, stepLogStep_t *stepPtr);
+void             stepLogReaderFree(stepLogReader_t **stepLogReaderPtrPtr);
+
+#endif /* STEP_LOG_H */
@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <marpa.h>
+#include "thin_macros.h"
+#include "parseDriver.h"
+#include "stepLog.h"
+
+/*
+  Parsing and semantics in separate runs: every tree of an expression
+  of the ambiguous_grammar.c grammar is appended to a step log, then
+  the whole log is replayed and evaluated without any recognizer.
+
+  :start ::= S
+  S ::= E
+  E ::= E op E
+  E ::= number
+
+  Execution  : ./step_log logfile [expression]
+               Without expression, the log is replayed only.
+*/
+
+#define MAX_TOKENS 64
+
+typedef struct s_user {
+  stepLogWriter_t *stepLogWriterPtr;
+} s_user_t;
+
+static void _check        (Marpa_Error_Code errorCode, const char *call, int forcedCondition);
+static int  _stepCallback (void *userDataPtr, Marpa_Value v, Marpa_Step_Type stepType);
+static int  _treeCallback (void *userDataPtr, int treeIndex);
+static int  _replay       (const char *path, Marpa_Rule_ID op_rule_id);
+
+struct marpa_error_description_s {
+  Marpa_Error_Code error_code;
+  const char*name;
+  const char*suggested;
+};
+extern const struct marpa_error_description_s marpa_error_description[];
+
+int main(int argc, char **argv) {
+  Marpa_Config     c;
+  Marpa_Grammar    g;
+  Marpa_Symbol_ID  S, E, op, number;
+  Marpa_Rule_ID    start_rule_id, op_rule_id, number_rule_id;
+  s_user_t         user;
+
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s logfile [expression]\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  /* Rule ids are the same in every run, which is all the replay needs */
+  INIT_CONFIG(c);
+  CREATE_GRAMMAR(g, c);
+
+  CREATE_SYMBOL(S, g);
+  CREATE_SYMBOL(E, g);
+  CREATE_SYMBOL(op, g);
+  CREATE_SYMBOL(number, g);
+
+  SET_START_SYMBOL(S, g);
+
+  {
+    Marpa_Symbol_ID rhs[] = { E };
+    CREATE_RULE(start_rule_id,  g, S, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { E, op, E };
+    CREATE_RULE(op_rule_id,     g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { number };
+    CREATE_RULE(number_rule_id, g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+
+  if (argc > 2) {
+    Marpa_Recognizer r;
+    parseDriver_t   *parseDriverPtr;
+    const char      *p;
+    int              nTrees;
+
+    PRECOMPUTE(g);
+    CREATE_RECOGNIZER(r, g);
+    START_INPUT(r, g);
+    for (p = argv[2]; *p != '\0'; p++) {
+      if (*p >= '0' && *p <= '9') {
+	ALTERNATIVE(r, g, number, *p - '0', 1);
+      } else {
+	ALTERNATIVE(r, g, op, *p, 1);
+      }
+      EARLEME_COMPLETE(r, g);
+    }
+
+    user.stepLogWriterPtr = stepLogWriterCreate(argv[1]);
+    if (user.stepLogWriterPtr == NULL) {
+      fprintf(stderr, "stepLogWriterCreate(): %s\n", strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+    parseDriverPtr = parseDriverCreate(g, NULL, &_stepCallback, &_treeCallback, &user);
+    if (parseDriverPtr == NULL) {
+      fprintf(stderr, "parseDriverCreate(): %s\n", strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+
+    nTrees = parseDriverRun(parseDriverPtr, r);
+    _check(marpa_g_error(g, NULL), "parseDriverRun()", nTrees < 0);
+    fprintf(stderr, "%s: %d trees logged in %ld bytes\n", argv[2], nTrees, (long) stepLogWriterBytes(user.stepLogWriterPtr));
+
+    parseDriverFree(&parseDriverPtr);
+    if (stepLogWriterFree(&(user.stepLogWriterPtr)) < 0) {
+      fprintf(stderr, "stepLogWriterFree(): %s\n", strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+    marpa_r_unref(r);
+  }
+
+  if (_replay(argv[1], op_rule_id) < 0) {
+    fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  marpa_g_unref(g);
+
+  exit(EXIT_SUCCESS);
+}
+
+static int _stepCallback(void *userDataPtr, Marpa_Value v, Marpa_Step_Type stepType) {
+  s_user_t *userPtr = (s_user_t *) userDataPtr;
+
+  return stepLogWriterStep(userPtr->stepLogWriterPtr, v, stepType);
+}
+
+static int _treeCallback(void *userDataPtr, int treeIndex) {
+  s_user_t *userPtr = (s_user_t *) userDataPtr;
+
+  return stepLogWriterTreeEnd(userPtr->stepLogWriterPtr);
+}
+
+/* Same semantics as ambiguous_grammar.c, from the log only */
+static int _replay(const char *path, Marpa_Rule_ID op_rule_id) {
+  stepLogReader_t *stepLogReaderPtr = stepLogReaderCreate(path);
+  stepLogStep_t    step;
+  int              values[MAX_TOKENS];
+  int              nTrees = 0;
+  int              rc;
+
+  if (stepLogReaderPtr == NULL) {
+    return -1;
+  }
+
+  while ((rc = stepLogReaderNextTree(stepLogReaderPtr)) > 0) {
+    values[0] = 0;
+    while ((rc = stepLogReaderNextStep(stepLogReaderPtr, &step)) > 0) {
+      if (step.argN >= MAX_TOKENS) {
+	errno = ERANGE;
+	rc = -1;
+	break;
+      }
+      switch (step.stepType) {
+      case MARPA_STEP_TOKEN:
+	values[step.result] = step.value;
+	break;
+      case MARPA_STEP_RULE:
+	if (step.id == op_rule_id) {
+	  int *left  = &(values[step.arg0]);
+	  int  right = values[step.argN];
+
+	  switch (values[step.arg0 + 1]) {
+	  case '+': *left += right; break;
+	  case '-': *left -= right; break;
+	  case '*': *left *= right; break;
+	  default:  *left  = 0;     break;
+	  }
+	}
+	/* Other rules: value is passed through, already in values[arg0] */
+	break;
+      default:
+	break;
+      }
+    }
+    if (rc < 0) {
+      break;
+    }
+    fprintf(stdout, "Tree %d: %d\n", ++nTrees, values[0]);
+  }
+
+  stepLogReaderFree(&stepLogReaderPtr);
+
+  return rc;
+}
+
+static void _check(Marpa_Error_Code errorCode, const char *call, int forcedCondition) {
+  if (forcedCondition != 0 || errorCode != MARPA_ERR_NONE) {
+    const char *function = (call != NULL) ? call : "<unknown>";
+    const char *msg = (errorCode >= 0 && errorCode < MARPA_ERROR_COUNT) ? marpa_error_description[errorCode].name : "Generic error";
+    fprintf(stderr,"%s: %s", function, msg);
+    exit(EXIT_FAILURE);
+  }
+}
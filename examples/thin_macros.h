@@ -54,6 +54,24 @@
     _check(marpa_g_error((g), NULL), "marpa_g_rule_new()", ruleId < 0);	\
   }
 
+/* Stratified rules for precedenced alternatives of lhs, see parsePrecedence.h */
+#define CREATE_PRECEDENCE_RULES(precedencePtr, g, lhs, alternatives, nAlternatives) { \
+    marpa_g_error_clear(g);						\
+    precedencePtr = parsePrecedenceCreate((g), (lhs), (alternatives), (nAlternatives)); \
+    _check(marpa_g_error((g), NULL), "parsePrecedenceCreate()", precedencePtr == NULL); \
+  }
+
+#define CREATE_SEQUENCE(ruleId, g, lhs, rhs, separator, min, flags) {	\
+    marpa_g_error_clear(g);						\
+    ruleId = marpa_g_sequence_new((g), (lhs), (rhs), (separator), (min), (flags)); \
+    _check(marpa_g_error((g), NULL), "marpa_g_sequence_new()", ruleId < 0); \
+  }
+
+#define RULE_RANK_SET(ruleId, g, rank) {				\
+    marpa_g_error_clear(g);						\
+    _check(marpa_g_error((g), NULL), "marpa_g_rule_rank_set()", marpa_g_rule_rank_set((g), (ruleId), (rank)) == -2); \
+  }
+
 #define START_INPUT(r, g) {						\
     marpa_g_error_clear(g);						\
     _check(marpa_g_error((g), NULL), "marpa_r_start_input()", marpa_r_start_input(r) < 0); \
@@ -79,5 +97,24 @@
     _check(marpa_g_error((g), NULL), "marpa_r_earleme_complete()", marpa_r_earleme_complete(r) < 0); \
   }
 
+/* Same as ALTERNATIVE() and EARLEME_COMPLETE(), recorded in an earleyProfile_t when p is not NULL */
+#define PROFILED_ALTERNATIVE(p, r, g, token_id, value, length) {	\
+    if ((p) == NULL) {							\
+      ALTERNATIVE(r, g, token_id, value, length);			\
+    } else {								\
+      marpa_g_error_clear(g);						\
+      _check(marpa_g_error((g), NULL), "marpa_r_alternative()", earleyProfileAlternative((p), (token_id), (value), (length)) != MARPA_ERR_NONE); \
+    }									\
+  }
+
+#define PROFILED_EARLEME_COMPLETE(p, r, g) {				\
+    if ((p) == NULL) {							\
+      EARLEME_COMPLETE(r, g);						\
+    } else {								\
+      marpa_g_error_clear(g);						\
+      _check(marpa_g_error((g), NULL), "marpa_r_earleme_complete()", earleyProfileEarlemeComplete(p) < 0); \
+    }									\
+  }
+
 #endif /* THIN_MACROS_H */
 
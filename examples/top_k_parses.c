@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <marpa.h>
+#include "thin_macros.h"
+#include "parseEnumerator.h"
+#include "parseCount.h"
+
+/*
+  Bounded enumeration of the parses of 1+1+...+1, where '+' is read both
+as add and as the generic op. The number of parses is the Catalan number
+of the number of operators, times 2 per operator. add is ranked above op:
+the top-k trees must read every '+' as add.
+
+  :start ::= S
+  S ::= E
+  E ::= E op E      rank 0
+  E ::= E add E     rank 1
+  E ::= number
+
+  Execution  : ./top_k_parses [operands [k [seconds [highRankOnly]]]]
+*/
+
+typedef struct topKParses {
+  Marpa_Rule_ID op_rule_id;
+  int           highRankOnly;
+} topKParses_t;
+
+static void _check        (Marpa_Error_Code errorCode, const char *call, int forcedCondition);
+static int  _treeCallback (void *userDataPtr, Marpa_Tree t, int treeIndex);
+
+struct marpa_error_description_s {
+  Marpa_Error_Code error_code;
+  const char*name;
+  const char*suggested;
+};
+extern const struct marpa_error_description_s marpa_error_description[];
+
+int main(int argc, char **argv) {
+  Marpa_Config             c;
+  Marpa_Grammar            g;
+  Marpa_Symbol_ID          S, E, op, add, number;
+  Marpa_Rule_ID            start_rule_id, op_rule_id, add_rule_id, number_rule_id;
+  Marpa_Recognizer         r;
+  Marpa_Bocage             b;
+  uint64_t                 nParses;
+  int                      nOperands = (argc > 1) ? atoi(argv[1]) : 12;
+  parseEnumeratorOption_t  option    = PARSEENUMERATOR_OPTION_DEFAULT;
+  parseEnumeratorResult_t  result;
+  topKParses_t             topKParses;
+  int                      i;
+
+  option.maxTrees   = (argc > 2) ? atoi(argv[2]) : 5;
+  option.maxSeconds = (argc > 3) ? atof(argv[3]) : 1.0;
+  if (argc > 4) {
+    option.highRankOnly = atoi(argv[4]);
+  }
+
+  if (nOperands <= 0) {
+    fprintf(stderr, "Usage: %s [operands [k [seconds [highRankOnly]]]]\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  INIT_CONFIG(c);
+  CREATE_GRAMMAR(g, c);
+
+  CREATE_SYMBOL(S, g);
+  CREATE_SYMBOL(E, g);
+  CREATE_SYMBOL(op, g);
+  CREATE_SYMBOL(add, g);
+  CREATE_SYMBOL(number, g);
+
+  SET_START_SYMBOL(S, g);
+
+  {
+    Marpa_Symbol_ID rhs[] = { E };
+    CREATE_RULE(start_rule_id,  g, S, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { E, op, E };
+    CREATE_RULE(op_rule_id,     g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { E, add, E };
+    CREATE_RULE(add_rule_id,    g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+  {
+    Marpa_Symbol_ID rhs[] = { number };
+    CREATE_RULE(number_rule_id, g, E, rhs, ARRAY_LENGTH(rhs));
+  }
+
+  RULE_RANK_SET(add_rule_id, g, 1);
+
+  PRECOMPUTE(g);
+  CREATE_RECOGNIZER(r, g);
+  START_INPUT(r, g);
+
+  for (i = 0; i < nOperands; i++) {
+    if (i > 0) {
+      ALTERNATIVE(r, g, op, '+', 1);
+      ALTERNATIVE(r, g, add, '+', 1);
+      EARLEME_COMPLETE(r, g);
+    }
+    ALTERNATIVE(r, g, number, 1, 1);
+    EARLEME_COMPLETE(r, g);
+  }
+
+  CREATE_BOCAGE(b, g, r, marpa_r_latest_earley_set(r));
+
+  _check(marpa_g_error(g, NULL), "parseCount()", parseCount(g, b, &nParses, NULL, NULL) < 0);
+  fprintf(stderr, "%llu parses in the bocage\n", (unsigned long long) nParses);
+
+  topKParses.op_rule_id   = op_rule_id;
+  topKParses.highRankOnly = option.highRankOnly;
+  _check(marpa_g_error(g, NULL), "parseEnumeratorRun()", parseEnumeratorRun(g, b, &option, &_treeCallback, &topKParses, &result) < 0);
+
+  fprintf(stderr, "%d trees in %.6f s, stop reason %d, ambiguity metric %d, %s%llu skipped\n",
+	  result.nTrees,
+	  result.elapsedSeconds,
+	  (int) result.stop,
+	  result.ambiguityMetric,
+	  result.nSkippedIsExact ? "" : "at least ",
+	  (unsigned long long) result.nSkipped);
+
+  marpa_b_unref(b);
+  marpa_r_unref(r);
+  marpa_g_unref(g);
+
+  exit(EXIT_SUCCESS);
+}
+
+/* Trees come in rank order: the first one, and all of them when lower ranks are pruned, never read '+' as op */
+static int _treeCallback(void *userDataPtr, Marpa_Tree t, int treeIndex) {
+  topKParses_t    *topKParsesPtr = (topKParses_t *) userDataPtr;
+  Marpa_Value      v             = marpa_v_new(t);
+  int              nOps          = 0;
+  Marpa_Step_Type  type;
+
+  if (v == NULL) {
+    return -1;
+  }
+  marpa_v_rule_is_valued_set(v, topKParsesPtr->op_rule_id, 1);
+  while ((type = marpa_v_step(v)) != MARPA_STEP_INACTIVE) {
+    if (type < 0) {
+      marpa_v_unref(v);
+      return -1;
+    }
+    if (type == MARPA_STEP_RULE && marpa_v_rule(v) == topKParsesPtr->op_rule_id) {
+      nOps++;
+    }
+  }
+  marpa_v_unref(v);
+
+  fprintf(stderr, "Tree %d: %d op\n", treeIndex, nOps);
+  if (nOps > 0 && (treeIndex == 0 || topKParsesPtr->highRankOnly)) {
+    fprintf(stderr, "Tree %d is not in rank order\n", treeIndex);
+    exit(EXIT_FAILURE);
+  }
+  return 0;
+}
+
+static void _check(Marpa_Error_Code errorCode, const char *call, int forcedCondition) {
+  if (forcedCondition != 0 || errorCode != MARPA_ERR_NONE) {
+    const char *function = (call != NULL) ? call : "<unknown>";
+    const char *msg = (errorCode >= 0 && errorCode < MARPA_ERROR_COUNT) ? marpa_error_description[errorCode].name : "Generic error";
+    fprintf(stderr,"%s: %s", function, msg);
+    exit(EXIT_FAILURE);
+  }
+}
@@ -0,0 +1,146 @@
+/*
+ * libmarpa with allocator hooks: the amalgamation, with its malloc(),
+ * calloc(), realloc() and free() calls redirected to the allocator
+ * current on the calling thread. See marpa_alloc.h.
+ *
+ * Each block is preceded by a header with its allocator and its size.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <assert.h>
+#include "marpa_alloc.h"
+
+typedef union marpa__alloc_header {
+  struct {
+    const Marpa_Allocator *allocator;     /* NULL: malloc() */
+    size_t                 size;
+  } block;
+  long double              align;         /* User data is aligned as malloc()'s */
+} marpa__alloc_header;
+
+static __thread const Marpa_Allocator *marpa__allocator_current = NULL;
+
+static void *marpa__alloc_malloc  (size_t size);
+static void *marpa__alloc_calloc  (size_t nmemb, size_t size);
+static void *marpa__alloc_realloc (void *ptr, size_t size);
+static void  marpa__alloc_free    (void *ptr);
+
+/* Object-like: libmarpa's uses of them as function pointers are redirected too */
+#define malloc  marpa__alloc_malloc
+#define calloc  marpa__alloc_calloc
+#define realloc marpa__alloc_realloc
+#define free    marpa__alloc_free
+
+#include "marpa_amalgamated.c"
+
+#undef malloc
+#undef calloc
+#undef realloc
+#undef free
+
+const Marpa_Allocator *marpa_allocator_set(const Marpa_Allocator *allocator)
+{
+  const Marpa_Allocator *previous = marpa__allocator_current;
+
+  marpa__allocator_current = allocator;
+
+  return previous;
+}
+
+const Marpa_Allocator *marpa_allocator_get(void)
+{
+  return marpa__allocator_current;
+}
+
+static void *marpa__alloc_malloc(size_t size)
+{
+  const Marpa_Allocator *allocator = marpa__allocator_current;
+  marpa__alloc_header   *header;
+
+  if (size > (size_t) -1 - sizeof(marpa__alloc_header)) {
+    return NULL;
+  }
+  header = (allocator != NULL)
+    ? (*allocator->malloc)(allocator->context, sizeof(marpa__alloc_header) + size)
+    : malloc(sizeof(marpa__alloc_header) + size);
+  if (header == NULL) {
+    return NULL;
+  }
+  header->block.allocator = allocator;
+  header->block.size      = size;
+
+  return header + 1;
+}
+
+static void *marpa__alloc_calloc(size_t nmemb, size_t size)
+{
+  void *ptr;
+
+  if (size != 0 && nmemb > (size_t) -1 / size) {
+    return NULL;
+  }
+  ptr = marpa__alloc_malloc(nmemb * size);
+  if (ptr != NULL) {
+    memset(ptr, 0, nmemb * size);
+  }
+
+  return ptr;
+}
+
+/* A block is reallocated by the allocator it came from */
+static void *marpa__alloc_realloc(void *ptr, size_t size)
+{
+  marpa__alloc_header   *header;
+  const Marpa_Allocator *allocator;
+
+  if (ptr == NULL) {
+    return marpa__alloc_malloc(size);
+  }
+  if (size > (size_t) -1 - sizeof(marpa__alloc_header)) {
+    return NULL;
+  }
+  header    = (marpa__alloc_header *) ptr - 1;
+  allocator = header->block.allocator;
+
+  if (allocator == NULL) {
+    header = realloc(header, sizeof(marpa__alloc_header) + size);
+  } else if (allocator->realloc != NULL) {
+    header = (*allocator->realloc)(allocator->context, header, sizeof(marpa__alloc_header) + size);
+  } else {
+    marpa__alloc_header *newHeader = (*allocator->malloc)(allocator->context, sizeof(marpa__alloc_header) + size);
+
+    if (newHeader != NULL) {
+      memcpy(newHeader + 1, header + 1, (header->block.size < size) ? header->block.size : size);
+      newHeader->block.allocator = allocator;
+      (*allocator->free)(allocator->context, header);
+    }
+    header = newHeader;
+  }
+  if (header == NULL) {
+    return NULL;
+  }
+  header->block.size = size;
+
+  return header + 1;
+}
+
+static void marpa__alloc_free(void *ptr)
+{
+  marpa__alloc_header   *header;
+  const Marpa_Allocator *allocator;
+
+  if (ptr == NULL) {
+    return;
+  }
+  header    = (marpa__alloc_header *) ptr - 1;
+  allocator = header->block.allocator;
+  if (allocator == NULL) {
+    free(header);
+  } else {
+    (*allocator->free)(allocator->context, header);
+  }
+}
@@ -0,0 +1,34 @@
+#ifndef MARPA_ALLOC_H
+#define MARPA_ALLOC_H
+
+#include <stddef.h>
+
+/*
+ * Allocator hooks for libmarpa, when compiled from marpa_alloc.c instead
+ * of linked with -lmarpa: every allocation libmarpa does goes to the
+ * allocator current on the calling thread. marpa_g_new(), marpa_r_new(),
+ * etc., and all the calls that grow their objects, allocate with it.
+ *
+ * Each block remembers its allocator: an object can be unref'ed from any
+ * thread, and goes back to the allocator it came from. An allocator, and
+ * what it allocated, must outlive the libmarpa objects allocated with it.
+ *
+ * A pool whose free is a nop can make the unrefs of a parse cheap, not
+ * unnecessary: marpa_r_new(), marpa_b_new(), etc. take a reference on
+ * their grammar, that only their unref gives back. Either unref every
+ * recognizer, bocage, order, tree and valuator before releasing the pool,
+ * or allocate the grammar from the same pool and release them all with it.
+ */
+
+typedef struct marpa_allocator {
+  void *(*malloc)(void *context, size_t size);                 /* Required */
+  void *(*realloc)(void *context, void *ptr, size_t size);     /* NULL: malloc, copy and free */
+  void  (*free)(void *context, void *ptr);                     /* Required, may be a nop */
+  void   *context;
+} Marpa_Allocator;
+
+/* For the calling thread. NULL restores malloc(). Returns the previous one */
+const Marpa_Allocator *marpa_allocator_set(const Marpa_Allocator *allocator);
+const Marpa_Allocator *marpa_allocator_get(void);
+
+#endif /* MARPA_ALLOC_H */
@@ -0,0 +1,127 @@
+/*
+ * libmarpa-prof: the amalgamation, with USDT probes around the public
+ * functions of each phase. The originals are renamed before the
+ * amalgamation is included, and wrapped below under their public names.
+ *
+ * Probes, provider marpa:
+ *   precompute__start (g)                  precompute__end (g, rc)
+ *   alternative__accepted (r, symbolId, value, length)
+ *   alternative__rejected (r, symbolId, errorCode)
+ *   earleme__complete (r, rc)
+ *   bocage__new (r, earleySetId, b)        order__new (b, o)
+ *   tree__new (o, t)                       tree__next (t, rc)
+ *   value__new (t, v)                      value__step (v, stepType)
+ *
+ * A probe is a nop until a tracer attaches to it, e.g.:
+ * bpftrace -e 'usdt:/usr/lib/x86_64-linux-gnu/marpa-prof/libmarpa-*.so:marpa:earleme__complete { @[pid] = count(); }'
+ */
+#include <sys/sdt.h>
+
+#define marpa_g_precompute        _marpa_unprobed_g_precompute
+#define marpa_r_alternative       _marpa_unprobed_r_alternative
+#define marpa_r_earleme_complete  _marpa_unprobed_r_earleme_complete
+#define marpa_b_new               _marpa_unprobed_b_new
+#define marpa_o_new               _marpa_unprobed_o_new
+#define marpa_t_new               _marpa_unprobed_t_new
+#define marpa_t_next              _marpa_unprobed_t_next
+#define marpa_v_new               _marpa_unprobed_v_new
+#define marpa_v_step              _marpa_unprobed_v_step
+
+#include "marpa_amalgamated.c"
+
+#undef marpa_g_precompute
+#undef marpa_r_alternative
+#undef marpa_r_earleme_complete
+#undef marpa_b_new
+#undef marpa_o_new
+#undef marpa_t_new
+#undef marpa_t_next
+#undef marpa_v_new
+#undef marpa_v_step
+
+int marpa_g_precompute(Marpa_Grammar g)
+{
+  int rc;
+
+  DTRACE_PROBE1(marpa, precompute__start, g);
+  rc = _marpa_unprobed_g_precompute(g);
+  DTRACE_PROBE2(marpa, precompute__end, g, rc);
+
+  return rc;
+}
+
+int marpa_r_alternative(Marpa_Recognizer r, Marpa_Symbol_ID token_id, int value, int length)
+{
+  int errorCode = _marpa_unprobed_r_alternative(r, token_id, value, length);
+
+  if (errorCode == MARPA_ERR_NONE) {
+    DTRACE_PROBE4(marpa, alternative__accepted, r, token_id, value, length);
+  } else {
+    DTRACE_PROBE3(marpa, alternative__rejected, r, token_id, errorCode);
+  }
+
+  return errorCode;
+}
+
+Marpa_Earleme marpa_r_earleme_complete(Marpa_Recognizer r)
+{
+  Marpa_Earleme rc = _marpa_unprobed_r_earleme_complete(r);
+
+  DTRACE_PROBE2(marpa, earleme__complete, r, rc);
+
+  return rc;
+}
+
+Marpa_Bocage marpa_b_new(Marpa_Recognizer r, Marpa_Earley_Set_ID earley_set_ID)
+{
+  Marpa_Bocage b = _marpa_unprobed_b_new(r, earley_set_ID);
+
+  DTRACE_PROBE3(marpa, bocage__new, r, earley_set_ID, b);
+
+  return b;
+}
+
+Marpa_Order marpa_o_new(Marpa_Bocage b)
+{
+  Marpa_Order o = _marpa_unprobed_o_new(b);
+
+  DTRACE_PROBE2(marpa, order__new, b, o);
+
+  return o;
+}
+
+Marpa_Tree marpa_t_new(Marpa_Order o)
+{
+  Marpa_Tree t = _marpa_unprobed_t_new(o);
+
+  DTRACE_PROBE2(marpa, tree__new, o, t);
+
+  return t;
+}
+
+int marpa_t_next(Marpa_Tree t)
+{
+  int rc = _marpa_unprobed_t_next(t);
+
+  DTRACE_PROBE2(marpa, tree__next, t, rc);
+
+  return rc;
+}
+
+Marpa_Value marpa_v_new(Marpa_Tree t)
+{
+  Marpa_Value v = _marpa_unprobed_v_new(t);
+
+  DTRACE_PROBE2(marpa, value__new, t, v);
+
+  return v;
+}
+
+Marpa_Step_Type marpa_v_step(Marpa_Value v)
+{
+  Marpa_Step_Type stepType = _marpa_unprobed_v_step(v);
+
+  DTRACE_PROBE2(marpa, value__step, v, stepType);
+
+  return stepType;
+}